@@ -0,0 +1,344 @@
+/**
+ * @file json_writer.c
+ * @brief 无堆内存申请的流式JSON生成器
+ * @version 1.0
+ * @date 2024-06-20
+ *
+ * @copyright Copyright (c) 2024  雅马哈发动机（厦门）信息系统有限公司
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <math.h>
+#include <float.h>
+#include "json_writer.h"
+
+void json_writer_init(json_writer_t *writer, char *buf, size_t size)
+{
+    memset(writer, 0, sizeof(json_writer_t));
+    writer->buf = buf;
+    writer->size = size;
+    writer->err = (buf == NULL || size == 0) ? ESP_ERR_NO_MEM : ESP_OK;
+    if (writer->err == ESP_OK)
+    {
+        buf[0] = '\0';
+    }
+}
+
+/**
+ * @brief  写入数据, 预留结尾'\0'的空间
+ * @param  writer
+ * @param  data
+ * @param  len
+ */
+static void json_writer_put(json_writer_t *writer, const char *data, size_t len)
+{
+    if (writer->err != ESP_OK)
+    {
+        return;
+    }
+    if (writer->len + len + 1 > writer->size)
+    {
+        writer->err = ESP_ERR_NO_MEM;
+        return;
+    }
+    memcpy(writer->buf + writer->len, data, len);
+    writer->len += len;
+}
+
+static void json_writer_put_char(json_writer_t *writer, char c)
+{
+    json_writer_put(writer, &c, 1);
+}
+
+/**
+ * @brief  检查当前位置可以写入值, 并写入数组元素之间的逗号
+ * @param  writer
+ * @return bool
+ */
+static bool json_writer_value_begin(json_writer_t *writer)
+{
+    if (writer->err != ESP_OK)
+    {
+        return false;
+    }
+    if (writer->depth == 0)
+    {
+        if (writer->len > 0) // 顶层只允许一个值
+        {
+            writer->err = ESP_ERR_INVALID_STATE;
+            return false;
+        }
+        return true;
+    }
+    uint8_t level = writer->depth - 1;
+    if (writer->container[level] == '{')
+    {
+        if (!writer->expect_value) // 对象中的值必须跟在键之后
+        {
+            writer->err = ESP_ERR_INVALID_STATE;
+            return false;
+        }
+        writer->expect_value = false;
+        return true;
+    }
+    if (writer->has_item[level])
+    {
+        json_writer_put_char(writer, ',');
+    }
+    writer->has_item[level] = true;
+    return writer->err == ESP_OK;
+}
+
+static void json_writer_container_begin(json_writer_t *writer, char open)
+{
+    if (!json_writer_value_begin(writer))
+    {
+        return;
+    }
+    if (writer->depth >= JSON_WRITER_MAX_DEPTH)
+    {
+        writer->err = ESP_ERR_INVALID_STATE;
+        return;
+    }
+    json_writer_put_char(writer, open);
+    writer->container[writer->depth] = open;
+    writer->has_item[writer->depth] = false;
+    writer->depth++;
+}
+
+static void json_writer_container_end(json_writer_t *writer, char open, char close)
+{
+    if (writer->err != ESP_OK)
+    {
+        return;
+    }
+    if (writer->depth == 0 || writer->container[writer->depth - 1] != open || writer->expect_value)
+    {
+        writer->err = ESP_ERR_INVALID_STATE;
+        return;
+    }
+    json_writer_put_char(writer, close);
+    writer->depth--;
+}
+
+void json_writer_object_begin(json_writer_t *writer)
+{
+    json_writer_container_begin(writer, '{');
+}
+
+void json_writer_object_end(json_writer_t *writer)
+{
+    json_writer_container_end(writer, '{', '}');
+}
+
+void json_writer_array_begin(json_writer_t *writer)
+{
+    json_writer_container_begin(writer, '[');
+}
+
+void json_writer_array_end(json_writer_t *writer)
+{
+    json_writer_container_end(writer, '[', ']');
+}
+
+/**
+ * @brief  写入带引号的转义字符串
+ * @param  writer
+ * @param  str
+ */
+static void json_writer_put_string(json_writer_t *writer, const char *str)
+{
+    static const char hex[] = "0123456789abcdef";
+    json_writer_put_char(writer, '\"');
+    const char *run = str; // 无需转义的连续字符一次写入
+    for (const char *p = str; *p != '\0'; p++)
+    {
+        unsigned char c = (unsigned char)*p;
+        if (c >= 0x20 && c != '\"' && c != '\\')
+        {
+            continue;
+        }
+        json_writer_put(writer, run, p - run);
+        run = p + 1;
+        char escape[6] = {'\\', 0};
+        size_t escape_len = 2;
+        switch (c)
+        {
+        case '\"':
+            escape[1] = '\"';
+            break;
+        case '\\':
+            escape[1] = '\\';
+            break;
+        case '\b':
+            escape[1] = 'b';
+            break;
+        case '\f':
+            escape[1] = 'f';
+            break;
+        case '\n':
+            escape[1] = 'n';
+            break;
+        case '\r':
+            escape[1] = 'r';
+            break;
+        case '\t':
+            escape[1] = 't';
+            break;
+        default:
+            escape[1] = 'u';
+            escape[2] = '0';
+            escape[3] = '0';
+            escape[4] = hex[c >> 4];
+            escape[5] = hex[c & 0x0F];
+            escape_len = 6;
+            break;
+        }
+        json_writer_put(writer, escape, escape_len);
+    }
+    json_writer_put(writer, run, strlen(run));
+    json_writer_put_char(writer, '\"');
+}
+
+void json_writer_key(json_writer_t *writer, const char *key)
+{
+    if (writer->err != ESP_OK)
+    {
+        return;
+    }
+    if (writer->depth == 0 || writer->container[writer->depth - 1] != '{' || writer->expect_value || key == NULL)
+    {
+        writer->err = ESP_ERR_INVALID_STATE;
+        return;
+    }
+    uint8_t level = writer->depth - 1;
+    if (writer->has_item[level])
+    {
+        json_writer_put_char(writer, ',');
+    }
+    writer->has_item[level] = true;
+    json_writer_put_string(writer, key);
+    json_writer_put_char(writer, ':');
+    writer->expect_value = true;
+}
+
+void json_writer_string(json_writer_t *writer, const char *str)
+{
+    if (str == NULL)
+    {
+        json_writer_null(writer);
+        return;
+    }
+    if (json_writer_value_begin(writer))
+    {
+        json_writer_put_string(writer, str);
+    }
+}
+
+void json_writer_int(json_writer_t *writer, int64_t value)
+{
+    char number[24];
+    if (json_writer_value_begin(writer))
+    {
+        json_writer_put(writer, number, snprintf(number, sizeof(number), "%" PRId64, value));
+    }
+}
+
+void json_writer_uint(json_writer_t *writer, uint64_t value)
+{
+    char number[24];
+    if (json_writer_value_begin(writer))
+    {
+        json_writer_put(writer, number, snprintf(number, sizeof(number), "%" PRIu64, value));
+    }
+}
+
+void json_writer_double(json_writer_t *writer, double value)
+{
+    char number[32];
+    int len;
+    if (!json_writer_value_begin(writer))
+    {
+        return;
+    }
+    if (isnan(value) || isinf(value))
+    {
+        json_writer_put(writer, "null", 4);
+        return;
+    }
+    len = snprintf(number, sizeof(number), "%1.15g", value);
+    double test = strtod(number, NULL);
+    if (fabs(test - value) > fmax(fabs(test), fabs(value)) * DBL_EPSILON) // 15位不能还原时使用17位
+    {
+        len = snprintf(number, sizeof(number), "%1.17g", value);
+    }
+    json_writer_put(writer, number, len);
+}
+
+void json_writer_bool(json_writer_t *writer, bool value)
+{
+    if (json_writer_value_begin(writer))
+    {
+        json_writer_put(writer, value ? "true" : "false", value ? 4 : 5);
+    }
+}
+
+void json_writer_null(json_writer_t *writer)
+{
+    if (json_writer_value_begin(writer))
+    {
+        json_writer_put(writer, "null", 4);
+    }
+}
+
+void json_writer_raw(json_writer_t *writer, const char *json, size_t len)
+{
+    if (json_writer_value_begin(writer))
+    {
+        json_writer_put(writer, json, len);
+    }
+}
+
+void json_writer_key_string(json_writer_t *writer, const char *key, const char *str)
+{
+    json_writer_key(writer, key);
+    json_writer_string(writer, str);
+}
+
+void json_writer_key_int(json_writer_t *writer, const char *key, int64_t value)
+{
+    json_writer_key(writer, key);
+    json_writer_int(writer, value);
+}
+
+void json_writer_key_uint(json_writer_t *writer, const char *key, uint64_t value)
+{
+    json_writer_key(writer, key);
+    json_writer_uint(writer, value);
+}
+
+void json_writer_key_double(json_writer_t *writer, const char *key, double value)
+{
+    json_writer_key(writer, key);
+    json_writer_double(writer, value);
+}
+
+esp_err_t json_writer_finish(json_writer_t *writer, size_t *len)
+{
+    if (writer->err == ESP_OK && (writer->depth != 0 || writer->expect_value || writer->len == 0))
+    {
+        writer->err = ESP_ERR_INVALID_STATE;
+    }
+    if (writer->err == ESP_OK)
+    {
+        writer->buf[writer->len] = '\0';
+    }
+    if (len != NULL)
+    {
+        *len = writer->err == ESP_OK ? writer->len : 0;
+    }
+    return writer->err;
+}
@@ -32,11 +32,13 @@
 #include "esp_eth_mac.h"
 #include "esp_sntp.h"
 #include "esp_https_ota.h"
+#include "esp_timer.h"
 // RTOS
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
 #include "freertos/event_groups.h"
+#include "freertos/ringbuf.h"
 #include <sys/time.h>
 // Network
 #include <sys/socket.h>
@@ -78,6 +80,7 @@
 #include "data_type.h"
 #include "business.h"
 #include "mqtt_cmd_type.h"
+#include "json_writer.h"
 
 // 宏定义
 #define FIRMWARE_VERSION "V0.0.1" // 固件版本名
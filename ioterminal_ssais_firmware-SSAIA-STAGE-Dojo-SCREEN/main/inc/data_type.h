@@ -27,10 +27,10 @@
 #define MAX_BOX_PARAM_LEN 16384
 // MQTT CONFIG
 #define MQTT_RECEIVE_QUEUE_LEN 8 // Mqtt 接收数据队列长度
-#define MQTT_PUBISH_QUEUE_LEN 8  // Mqtt 发送数据队列长度
+#define MQTT_PUBLISH_RING_SIZE (64 * 1024) // Mqtt 发送环形缓冲区字节数(PSRAM),内联消息最大约为其一半
+#define MQTT_PUBLISH_CHUNK_SIZE (8 * 1024) // 超过该长度的外部数据分段发布到 发布主题/chunk/<编号>/<段号>/<段数>
 #define MQTT_TOPIC_MAX_LEN 128
 #define MQTT_RECEIVE_DATA_MAX_LEN 16384
-#define MQTT_PUBLISH_DATA_MAX_LEN 16384
 
 // SCANNER CONFIG
 #define SCANNER_INPUT_QUEUE_LEN 16      // 扫码枪输入队列长度
@@ -85,11 +85,13 @@ typedef struct _MqttReceiveData
     char data[MQTT_RECEIVE_DATA_MAX_LEN];
 } MqttReceiveData_t;
 
-typedef struct _MqttPublishData
+typedef struct _MqttPubRecord
 {
-    uint16_t dataLen;
-    char data[MQTT_PUBLISH_DATA_MAX_LEN];
-} MqttPublishData_t;
+    int64_t enqueueTime; // 入队时间(微秒),用于统计发布延迟
+    uint32_t dataLen;
+    char *extData; // 非NULL时数据位于外部缓冲区,由MQTT任务发送完成后释放
+    char data[];   // 内联数据(extData为NULL时有效)
+} MqttPubRecord_t;
 
 typedef struct _DioInputData
 {
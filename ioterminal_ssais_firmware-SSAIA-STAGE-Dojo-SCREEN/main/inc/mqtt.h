@@ -45,6 +45,11 @@ typedef enum
 #define MQTT_CONTROL_TYPE_MINNUM_CLASSIFY_BUSINESS 200
 #define MQTT_CONTROL_TYPE_MAXNUM_CLASSIFY_BUSINESS 19999
 
+#define MQTT_TASK_PUB_BUDGET 16 // 每次循环最多发布的消息数(分段发布时每段计一条)
+#define MQTT_CHUNK_TOPIC_SUFFIX "/chunk" // 分段发布主题 = 发布主题 + 后缀 + /<编号>/<段号>/<段数>
+#define MQTT_PUB_STAT_LOG_INTERVAL_MS 60000 // 发布路径统计日志输出周期
+#define MQTT_STATUS_MSG_MAX_LEN 512 // 固定格式状态消息的最大长度(栈上生成)
+
 // MQTT命令类型范围定义与处理结构体
 typedef struct
 {
@@ -68,6 +73,8 @@ extern esp_mqtt_client_handle_t mqttInit(MqttConfigData_t *mqttConfigData);
 extern void mqttEventHandler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data);
 extern void mqttDefaultTopicPubStrMsg(uint16_t controlType, uint16_t notifyType, const char *jsonObjName, const char *str);
 extern void mqttDefaultTopicPubNumMsg(uint16_t controlType, uint16_t notifyType, const char *jsonObjName, uint32_t num);
+extern esp_err_t mqttPubRingSend(const char *data, size_t dataLen);
+extern esp_err_t mqttPubRingSendExternal(char *data, size_t dataLen);
 extern esp_err_t mqttPubBoxInfoMsg();
 void mqttPubScreenCtrlMsg(uint16_t controlType,uint16_t notifyType,uint32_t screen_id,uint32_t control_id,uint32_t state);
 void mqttPubScreenTextMsg(uint16_t controlType,uint16_t notifyType,uint32_t screen_id,uint32_t control_id,const char *string,uint32_t jsonlen);
@@ -23,7 +23,7 @@
 #define NETWORK_TASK_PRIVILEGE                          1
 
 extern QueueHandle_t g_mqttRecvDataQueueHandler;        // MQTT 数据接收队列
-extern QueueHandle_t g_mqttPubDataQueueHandler;         // MQTT 数据发送队列
+extern RingbufHandle_t g_mqttPubRingHandle;             // MQTT 数据发送环形缓冲区
 extern QueueHandle_t g_dioInpDataQueueHandler;          // DIO 输入数据接收队列
 
 extern void screenCmdRecvTask(void *pvParameters);
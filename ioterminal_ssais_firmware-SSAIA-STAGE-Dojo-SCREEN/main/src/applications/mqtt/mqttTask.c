@@ -20,7 +20,20 @@ static uint16_t s_mqttConnectRetry = 0, s_mqttMaximumRetry = 0;
 static MqttState_t s_mqttState = MQTT_DISCONNECT;
 static MqttState_t s_lastMqttState = MQTT_DISCONNECT;
 QueueHandle_t g_mqttRecvDataQueueHandler; // MQTT 数据接收队列
-QueueHandle_t g_mqttPubDataQueueHandler;  // MQTT 数据发送队列
+RingbufHandle_t g_mqttPubRingHandle;      // MQTT 数据发送环形缓冲区(变长记录)
+
+/* 发布路径统计,周期性输出到日志 */
+typedef struct
+{
+    uint32_t published;   // 发布的消息
+    uint32_t dropped;     // 发送缓冲区满或内存不足丢弃的消息
+    uint32_t heapAlloc;   // 超出内联长度的消息申请堆内存次数
+    uint32_t chunks;      // 分段发布的数据段
+    uint32_t maxLatency;  // 统计周期内入队到发布的最大延迟(微秒)
+    uint64_t sumLatency;  // 统计周期内延迟总和(微秒)
+    uint32_t windowCount; // 统计周期内发布的消息
+} MqttPubStat_t;
+static MqttPubStat_t s_mqttPubStat = {0};
 static mqtt_cmd_handle_t s_sysSetPageHandle[MQTT_CONTROL_TYPE_CLASSIFY_MAX] = {
     [MQTT_CONTROL_TYPE_CLASSIFY_SCREEN_CONTROL] = {.mqttControlTypeClassify = MQTT_CONTROL_TYPE_CLASSIFY_SCREEN_CONTROL,
                                                    .minClassifyNum = MQTT_CONTROL_TYPE_MINNUM_CLASSIFY_SCREEN_CONTROL,
@@ -283,66 +296,217 @@ esp_err_t mqttCmdRecvHandle(MqttReceiveData_t *mqttRecvData)
 }
 
 /**
- * @brief  从默认主题发布MQTT库位信息
+ * @brief  将消息复制到发送环形缓冲区
+ *         消息直接写入缓冲区内的变长记录,不申请堆内存;超出单条记录上限时复制到PSRAM后按外部数据发送
+ * @param  data
+ * @param  dataLen
+ * @return esp_err_t
  */
-esp_err_t mqttPubBoxInfoMsg()
+esp_err_t mqttPubRingSend(const char *data, size_t dataLen)
 {
-    // 使用PSRAM动态分配MqttPublishData_t
-    MqttPublishData_t *_mqttPubData = (MqttPublishData_t *)heap_caps_malloc(sizeof(MqttPublishData_t), MALLOC_CAP_SPIRAM);
-    if (_mqttPubData == NULL)
+    MqttPubRecord_t *_record = NULL;
+    if (sizeof(MqttPubRecord_t) + dataLen > xRingbufferGetMaxItemSize(g_mqttPubRingHandle))
     {
-        ESP_LOGE(TAG, "mqttPubBoxInfoMsg Failed to allocate PSRAM for MqttPublishData_t");
-        return ESP_ERR_NO_MEM;
+        char *_extData = heap_caps_malloc(dataLen, MALLOC_CAP_SPIRAM);
+        if (_extData == NULL)
+        {
+            s_mqttPubStat.dropped++;
+            ESP_LOGE(TAG, "No memory for MQTT publish data, message dropped (%u bytes)", dataLen);
+            return ESP_ERR_NO_MEM;
+        }
+        s_mqttPubStat.heapAlloc++;
+        memcpy(_extData, data, dataLen);
+        return mqttPubRingSendExternal(_extData, dataLen);
+    }
+    if (xRingbufferSendAcquire(g_mqttPubRingHandle, (void **)&_record, sizeof(MqttPubRecord_t) + dataLen, pdMS_TO_TICKS(100)) != pdTRUE)
+    {
+        s_mqttPubStat.dropped++;
+        ESP_LOGE(TAG, "MQTT publish ring is full, message dropped (%u bytes)", dataLen);
+        return ESP_ERR_TIMEOUT;
+    }
+    _record->enqueueTime = esp_timer_get_time();
+    _record->dataLen = dataLen;
+    _record->extData = NULL;
+    memcpy(_record->data, data, dataLen);
+    xRingbufferSendComplete(g_mqttPubRingHandle, _record);
+    return ESP_OK;
+}
+
+/**
+ * @brief  将外部缓冲区的消息按引用放入发送环形缓冲区
+ *         缓冲区所有权移交给MQTT任务,发送完成(或失败)后以free释放,可直接传入cJSON_PrintUnformatted的结果;
+ *         超过MQTT_PUBLISH_CHUNK_SIZE的数据分段发布
+ * @param  data     heap_caps_malloc/malloc申请的缓冲区
+ * @param  dataLen
+ * @return esp_err_t
+ */
+esp_err_t mqttPubRingSendExternal(char *data, size_t dataLen)
+{
+    MqttPubRecord_t *_record = NULL;
+    if (xRingbufferSendAcquire(g_mqttPubRingHandle, (void **)&_record, sizeof(MqttPubRecord_t), pdMS_TO_TICKS(100)) != pdTRUE)
+    {
+        s_mqttPubStat.dropped++;
+        ESP_LOGE(TAG, "MQTT publish ring is full, message dropped (%u bytes)", dataLen);
+        free(data);
+        return ESP_ERR_TIMEOUT;
+    }
+    _record->enqueueTime = esp_timer_get_time();
+    _record->dataLen = dataLen;
+    _record->extData = data;
+    xRingbufferSendComplete(g_mqttPubRingHandle, _record);
+    return ESP_OK;
+}
+
+/**
+ * @brief  记录一条消息从入队到发布的延迟
+ * @param  enqueueTime
+ */
+static void mqttPubStatRecord(int64_t enqueueTime)
+{
+    uint32_t _latency = esp_timer_get_time() - enqueueTime;
+    s_mqttPubStat.published++;
+    s_mqttPubStat.windowCount++;
+    s_mqttPubStat.sumLatency += _latency;
+    if (_latency > s_mqttPubStat.maxLatency)
+    {
+        s_mqttPubStat.maxLatency = _latency;
+    }
+}
+
+/**
+ * @brief  周期性输出发布路径统计(消息数、丢弃、堆内存申请、分段、延迟),并开始新的统计周期
+ */
+static void mqttPubStatLog()
+{
+    static uint32_t s_lastLogTime = 0;
+    if (esp_log_timestamp() - s_lastLogTime < MQTT_PUB_STAT_LOG_INTERVAL_MS)
+    {
+        return;
+    }
+    s_lastLogTime = esp_log_timestamp();
+    if (s_mqttPubStat.windowCount > 0)
+    {
+        ESP_LOGI(TAG, "Publish stat: pub=%lu drop=%lu alloc=%lu chunk=%lu latency avg=%lluus max=%luus",
+                 s_mqttPubStat.published, s_mqttPubStat.dropped, s_mqttPubStat.heapAlloc, s_mqttPubStat.chunks,
+                 s_mqttPubStat.sumLatency / s_mqttPubStat.windowCount, s_mqttPubStat.maxLatency);
     }
-    cJSON *msgBuff = NULL;
-    msgBuff = cJSON_CreateObject();
-    cJSON_AddNumberToObject(msgBuff, "control_type", MQTT_CONTROL_TYPE_BUSINESS_BOX_OPERATE);
-    cJSON_AddNumberToObject(msgBuff, "notify_type", NOTIFY_BOX_INFO);
+    s_mqttPubStat.windowCount = 0;
+    s_mqttPubStat.sumLatency = 0;
+    s_mqttPubStat.maxLatency = 0;
+}
+
+/**
+ * @brief  按配额发送环形缓冲区中的消息
+ *         内联消息与不超过MQTT_PUBLISH_CHUNK_SIZE的外部数据整条发布;更大的外部数据从记录中取出后
+ *         每次发布一段到 发布主题/chunk/<编号>/<段号>/<段数>,剩余的段在后续循环中继续发送
+ * @param  pubTopic
+ * @param  pubQos
+ * @param  waitTicks    缓冲区为空时的等待时间
+ */
+static void mqttPubRingProcess(const char *pubTopic, int pubQos, TickType_t waitTicks)
+{
+    static char *s_chunkData = NULL; // 正在分段发布的外部数据
+    static size_t s_chunkDataLen = 0;
+    static uint32_t s_chunkIndex = 0, s_chunkCount = 0, s_chunkId = 0;
+    static int64_t s_chunkEnqueueTime = 0;
+    static char s_chunkTopic[MQTT_TOPIC_MAX_LEN + 32] = {0};
+    size_t _published = 0;
+    while (_published < MQTT_TASK_PUB_BUDGET)
+    {
+        if (s_chunkData != NULL)
+        {
+            size_t _offset = s_chunkIndex * MQTT_PUBLISH_CHUNK_SIZE;
+            size_t _len = s_chunkDataLen - _offset < MQTT_PUBLISH_CHUNK_SIZE ? s_chunkDataLen - _offset : MQTT_PUBLISH_CHUNK_SIZE;
+            snprintf(s_chunkTopic, sizeof(s_chunkTopic), "%s%s/%lu/%lu/%lu", pubTopic, MQTT_CHUNK_TOPIC_SUFFIX, s_chunkId, s_chunkIndex, s_chunkCount);
+            esp_mqtt_client_publish(g_mqttClientHandle, s_chunkTopic, s_chunkData + _offset, _len, pubQos, 0);
+            s_mqttPubStat.chunks++;
+            _published++;
+            if (++s_chunkIndex >= s_chunkCount)
+            {
+                mqttPubStatRecord(s_chunkEnqueueTime);
+                free(s_chunkData);
+                s_chunkData = NULL;
+            }
+            continue;
+        }
+        size_t _itemSize = 0;
+        MqttPubRecord_t *_record = xRingbufferReceive(g_mqttPubRingHandle, &_itemSize, _published == 0 ? waitTicks : 0);
+        if (_record == NULL)
+        {
+            break;
+        }
+        if (_record->extData != NULL && _record->dataLen > MQTT_PUBLISH_CHUNK_SIZE)
+        {
+            s_chunkData = _record->extData;
+            s_chunkDataLen = _record->dataLen;
+            s_chunkEnqueueTime = _record->enqueueTime;
+            s_chunkIndex = 0;
+            s_chunkCount = (_record->dataLen + MQTT_PUBLISH_CHUNK_SIZE - 1) / MQTT_PUBLISH_CHUNK_SIZE;
+            s_chunkId++;
+            ESP_LOGI(TAG, "MQTT chunked publish %lu: %lu bytes, %lu chunks", s_chunkId, _record->dataLen, s_chunkCount);
+            vRingbufferReturnItem(g_mqttPubRingHandle, _record); // 数据已转移,记录立即归还
+            continue;
+        }
+        const char *_data = _record->extData != NULL ? _record->extData : _record->data;
+        ESP_LOGI(TAG, "MQTT Publish. Topic: %.*s", strlen(pubTopic), pubTopic);
+        ESP_LOGI(TAG, "MQTT Publish Data:\n%.*s", _record->dataLen, _data);
+        esp_mqtt_client_publish(g_mqttClientHandle, pubTopic, _data, _record->dataLen, pubQos, 0);
+        mqttPubStatRecord(_record->enqueueTime);
+        _published++;
+        free(_record->extData);
+        vRingbufferReturnItem(g_mqttPubRingHandle, _record);
+    }
+}
+
+/**
+ * @brief  从默认主题发布MQTT库位信息
+ *         库位参数长度随库位数量增长,JSON按引用移交给MQTT任务,超过MQTT_PUBLISH_CHUNK_SIZE时分段发布
+ */
+esp_err_t mqttPubBoxInfoMsg()
+{
     char *boxParamStr = readBoxParamFromNvs();
+    const char *_boxParam = "{}";
     if (boxParamStr == NULL)
     {
         ESP_LOGE(TAG, "Failed to read box param from NVS.");
-        cJSON_AddObjectToObject(msgBuff, "data");
     }
     else
     {
-        cJSON *boxParamJson = cJSON_Parse(boxParamStr);
-        if (boxParamJson == NULL)
+        const char *_start = boxParamStr + strspn(boxParamStr, " \t\r\n");
+        if (*_start == '{' || *_start == '[') // NVS中保存的是下发时已校验的JSON,直接嵌入不再解析
         {
-            ESP_LOGE(TAG, "Failed to parse box param JSON");
-            cJSON_AddObjectToObject(msgBuff, "data");
+            _boxParam = _start;
         }
         else
         {
-            cJSON_AddItemToObject(msgBuff, "data", boxParamJson);
+            ESP_LOGE(TAG, "Box param in NVS is not JSON");
         }
     }
-    heap_caps_free(boxParamStr);
-    char *jsonStr = NULL;
-    jsonStr = cJSON_PrintUnformatted(msgBuff);
-    // 复制数据到PSRAM中的结构体
-    _mqttPubData->dataLen = strlen(jsonStr);
-    if (_mqttPubData->dataLen >= MQTT_PUBLISH_DATA_MAX_LEN)
+    size_t _size = strlen(_boxParam) + MQTT_STATUS_MSG_MAX_LEN;
+    char *_msg = heap_caps_malloc(_size, MALLOC_CAP_SPIRAM);
+    if (_msg == NULL)
     {
-        ESP_LOGE(TAG, "JSON string too long");
-        cJSON_free(jsonStr);
-        cJSON_Delete(msgBuff);
-        heap_caps_free(_mqttPubData);
-        return ESP_ERR_INVALID_SIZE;
+        ESP_LOGE(TAG, "mqttPubBoxInfoMsg Failed to allocate PSRAM for box info");
+        heap_caps_free(boxParamStr);
+        return ESP_ERR_NO_MEM;
     }
-    strcpy(_mqttPubData->data, jsonStr);
-
-    // 发送到队列
-    if (xQueueSend(g_mqttPubDataQueueHandler, _mqttPubData, pdMS_TO_TICKS(100)) != pdTRUE)
+    json_writer_t _writer;
+    size_t _len;
+    json_writer_init(&_writer, _msg, _size);
+    json_writer_object_begin(&_writer);
+    json_writer_key_int(&_writer, "control_type", MQTT_CONTROL_TYPE_BUSINESS_BOX_OPERATE);
+    json_writer_key_int(&_writer, "notify_type", NOTIFY_BOX_INFO);
+    json_writer_key(&_writer, "data");
+    json_writer_raw(&_writer, _boxParam, strlen(_boxParam));
+    json_writer_object_end(&_writer);
+    esp_err_t err = json_writer_finish(&_writer, &_len);
+    heap_caps_free(boxParamStr);
+    if (err != ESP_OK)
     {
-        ESP_LOGE(TAG, "Failed to send to MQTT publish queue");
+        heap_caps_free(_msg);
+        return err;
     }
-
-    // 清理资源
-    cJSON_free(jsonStr);
-    cJSON_Delete(msgBuff);
-    heap_caps_free(_mqttPubData);
-    return ESP_OK;
+    return mqttPubRingSendExternal(_msg, _len);
 }
 
 /**
@@ -354,45 +518,24 @@ esp_err_t mqttPubBoxInfoMsg()
  */
 void mqttDefaultTopicPubStrMsg(uint16_t controlType, uint16_t notifyType, const char *jsonObjName, const char *str)
 {
-    // 使用PSRAM动态分配MqttPublishData_t
-    MqttPublishData_t *_mqttPubData = (MqttPublishData_t *)heap_caps_malloc(sizeof(MqttPublishData_t), MALLOC_CAP_SPIRAM);
-    if (_mqttPubData == NULL)
-    {
-        ESP_LOGE(TAG, "mqttDefaultTopicPubStrMsg Failed to allocate PSRAM for MqttPublishData_t");
-        return;
-    }
-    cJSON *msgBuff = NULL;
-    msgBuff = cJSON_CreateObject();
-    cJSON_AddNumberToObject(msgBuff, "control_type", controlType);
-    cJSON_AddNumberToObject(msgBuff, "notify_type", notifyType);
-    cJSON *data = NULL;
-    data = cJSON_CreateObject();
-    cJSON_AddStringToObject(data, jsonObjName, str);
-    cJSON_AddItemToObject(msgBuff, "data", data);
-    char *jsonStr = NULL;
-    jsonStr = cJSON_PrintUnformatted(msgBuff);
-    // 复制数据到PSRAM中的结构体
-    _mqttPubData->dataLen = strlen(jsonStr);
-    if (_mqttPubData->dataLen >= MQTT_PUBLISH_DATA_MAX_LEN)
-    {
-        ESP_LOGE(TAG, "JSON string too long");
-        cJSON_free(jsonStr);
-        cJSON_Delete(msgBuff);
-        heap_caps_free(_mqttPubData);
+    char _msg[MQTT_STATUS_MSG_MAX_LEN];
+    json_writer_t _writer;
+    size_t _len;
+    json_writer_init(&_writer, _msg, sizeof(_msg));
+    json_writer_object_begin(&_writer);
+    json_writer_key_int(&_writer, "control_type", controlType);
+    json_writer_key_int(&_writer, "notify_type", notifyType);
+    json_writer_key(&_writer, "data");
+    json_writer_object_begin(&_writer);
+    json_writer_key_string(&_writer, jsonObjName, str);
+    json_writer_object_end(&_writer);
+    json_writer_object_end(&_writer);
+    if (json_writer_finish(&_writer, &_len) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Status message %d/%d too long, dropped", controlType, notifyType);
         return;
     }
-    strcpy(_mqttPubData->data, jsonStr);
-
-    // 发送到队列
-    if (xQueueSend(g_mqttPubDataQueueHandler, _mqttPubData, pdMS_TO_TICKS(100)) != pdTRUE)
-    {
-        ESP_LOGE(TAG, "Failed to send to MQTT publish queue");
-    }
-
-    // 清理资源
-    cJSON_free(jsonStr);
-    cJSON_Delete(msgBuff);
-    heap_caps_free(_mqttPubData);
+    mqttPubRingSend(_msg, _len);
 }
 
 /**
@@ -404,45 +547,24 @@ void mqttDefaultTopicPubStrMsg(uint16_t controlType, uint16_t notifyType, const
  */
 void mqttDefaultTopicPubNumMsg(uint16_t controlType, uint16_t notifyType, const char *jsonObjName, uint32_t num)
 {
-    // 使用PSRAM动态分配MqttPublishData_t
-    MqttPublishData_t *_mqttPubData = (MqttPublishData_t *)heap_caps_malloc(sizeof(MqttPublishData_t), MALLOC_CAP_SPIRAM);
-    if (_mqttPubData == NULL)
-    {
-        ESP_LOGE(TAG, "mqttDefaultTopicPubNumMsg Failed to allocate PSRAM for MqttPublishData_t");
-        return;
-    }
-    cJSON *msgBuff = NULL;
-    msgBuff = cJSON_CreateObject();
-    cJSON_AddNumberToObject(msgBuff, "control_type", controlType);
-    cJSON_AddNumberToObject(msgBuff, "notify_type", notifyType);
-    cJSON *data = NULL;
-    data = cJSON_CreateObject();
-    cJSON_AddNumberToObject(data, jsonObjName, num);
-    cJSON_AddItemToObject(msgBuff, "data", data);
-    char *jsonStr = NULL;
-    jsonStr = cJSON_PrintUnformatted(msgBuff);
-    // 复制数据到PSRAM中的结构体
-    _mqttPubData->dataLen = strlen(jsonStr);
-    if (_mqttPubData->dataLen >= MQTT_PUBLISH_DATA_MAX_LEN)
-    {
-        ESP_LOGE(TAG, "JSON string too long");
-        cJSON_free(jsonStr);
-        cJSON_Delete(msgBuff);
-        heap_caps_free(_mqttPubData);
+    char _msg[MQTT_STATUS_MSG_MAX_LEN];
+    json_writer_t _writer;
+    size_t _len;
+    json_writer_init(&_writer, _msg, sizeof(_msg));
+    json_writer_object_begin(&_writer);
+    json_writer_key_int(&_writer, "control_type", controlType);
+    json_writer_key_int(&_writer, "notify_type", notifyType);
+    json_writer_key(&_writer, "data");
+    json_writer_object_begin(&_writer);
+    json_writer_key_uint(&_writer, jsonObjName, num);
+    json_writer_object_end(&_writer);
+    json_writer_object_end(&_writer);
+    if (json_writer_finish(&_writer, &_len) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Status message %d/%d too long, dropped", controlType, notifyType);
         return;
     }
-    strcpy(_mqttPubData->data, jsonStr);
-
-    // 发送到队列
-    if (xQueueSend(g_mqttPubDataQueueHandler, _mqttPubData, pdMS_TO_TICKS(100)) != pdTRUE)
-    {
-        ESP_LOGE(TAG, "Failed to send to MQTT publish queue");
-    }
-
-    // 清理资源
-    cJSON_free(jsonStr);
-    cJSON_Delete(msgBuff);
-    heap_caps_free(_mqttPubData);
+    mqttPubRingSend(_msg, _len);
 }
 
 /**
@@ -452,7 +574,6 @@ void mqttDefaultTopicPubNumMsg(uint16_t controlType, uint16_t notifyType, const
 void mqttTask(void *pvParameters)
 {
     MqttReceiveData_t *mqttRecvData = NULL;
-    MqttPublishData_t *mqttPubData = NULL;
 
     // 在循环外分配内存
     mqttRecvData = (MqttReceiveData_t *)heap_caps_malloc(sizeof(MqttReceiveData_t), MALLOC_CAP_SPIRAM);
@@ -463,15 +584,6 @@ void mqttTask(void *pvParameters)
         return;
     }
 
-    mqttPubData = (MqttPublishData_t *)heap_caps_malloc(sizeof(MqttPublishData_t), MALLOC_CAP_SPIRAM);
-    if (mqttPubData == NULL)
-    {
-        ESP_LOGE(TAG, "Failed to allocate memory for mqttPubData");
-        heap_caps_free(mqttRecvData);
-        vTaskDelete(NULL);
-        return;
-    }
-
     static char pubTopic[MQTT_TOPIC_MAX_LEN] = {0};
     static int pubQos;
     pubQos = g_nvsData.networkConfigData.mqttConfigData.pubQos;
@@ -497,12 +609,8 @@ void mqttTask(void *pvParameters)
         }
         if (getMqttState() == MQTT_READY)
         {
-            if (xQueueReceive(g_mqttPubDataQueueHandler, mqttPubData, pdMS_TO_TICKS(10)) == pdTRUE) // 处理队列中的发送任务
-            {
-                ESP_LOGI(TAG, "MQTT Publish. Topic: %.*s", strlen(pubTopic), pubTopic);
-                ESP_LOGI(TAG, "MQTT Publish Data:\n%.*s", mqttPubData->dataLen, mqttPubData->data);
-                esp_mqtt_client_publish(g_mqttClientHandle, pubTopic, mqttPubData->data, mqttPubData->dataLen, pubQos, 0);
-            }
+            mqttPubRingProcess(pubTopic, pubQos, pdMS_TO_TICKS(10)); // 处理缓冲区中的发送任务
+            mqttPubStatLog();
             vTaskDelay(pdMS_TO_TICKS(1));
         }
                 /* ---------- 新增：扫码枪条码转发 MQTT ---------- */
@@ -519,159 +627,115 @@ void mqttTask(void *pvParameters)
 
     // 在任务结束时释放内存
     heap_caps_free(mqttRecvData);
-    heap_caps_free(mqttPubData);
     vTaskDelete(NULL);
 }
+/**
+ * @brief  从默认主题发布串口屏控件状态
+ * @param  controlType  消息类型
+ * @param  notifyType   通知类型
+ * @param  screen_id    画面ID
+ * @param  control_id   控件ID
+ * @param  state        控件状态
+ */
 void mqttPubScreenCtrlMsg(uint16_t controlType,
                           uint16_t notifyType,
                           uint32_t screen_id,
                           uint32_t control_id,
                           uint32_t state)
 {
-    MqttPublishData_t *_mqttPubData =
-        (MqttPublishData_t *)heap_caps_malloc(sizeof(MqttPublishData_t), MALLOC_CAP_SPIRAM);
-    if (_mqttPubData == NULL) {
-        ESP_LOGE("MQTT", "malloc failed");
+    char _msg[MQTT_STATUS_MSG_MAX_LEN];
+    json_writer_t _writer;
+    size_t _len;
+    json_writer_init(&_writer, _msg, sizeof(_msg));
+    json_writer_object_begin(&_writer);
+    json_writer_key_int(&_writer, "control_type", controlType);
+    json_writer_key_int(&_writer, "notify_type", notifyType);
+    json_writer_key(&_writer, "data");
+    json_writer_object_begin(&_writer);
+    json_writer_key_uint(&_writer, "screen_id", screen_id);
+    json_writer_key_uint(&_writer, "control_id", control_id);
+    json_writer_key_uint(&_writer, "state", state);
+    json_writer_object_end(&_writer);
+    json_writer_object_end(&_writer);
+    if (json_writer_finish(&_writer, &_len) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Status message %d/%d too long, dropped", controlType, notifyType);
         return;
     }
-
-
-    cJSON *root = cJSON_CreateObject();
-    cJSON_AddNumberToObject(root, "control_type", controlType);
-    cJSON_AddNumberToObject(root, "notify_type",  notifyType);
-
-    cJSON *data = cJSON_CreateObject();
-    cJSON_AddNumberToObject(data, "screen_id",  screen_id);
-    cJSON_AddNumberToObject(data, "control_id", control_id);
-    cJSON_AddNumberToObject(data, "state",      state);
-    cJSON_AddItemToObject(root, "data", data);
-
-    char *jsonStr = cJSON_PrintUnformatted(root);
-    size_t len = strlen(jsonStr);
-
-
-    // 复制数据到PSRAM中的结构体
-    _mqttPubData->dataLen = strlen(jsonStr);
-    if (_mqttPubData->dataLen >= MQTT_PUBLISH_DATA_MAX_LEN)
-    {
-        ESP_LOGE(TAG, "JSON string too long");
-        cJSON_free(jsonStr);
-        cJSON_Delete(root);
-        heap_caps_free(_mqttPubData);
-        return;
-    }
-    strcpy(_mqttPubData->data, jsonStr);
-
-    // 发送到队列
-    if (xQueueSend(g_mqttPubDataQueueHandler, _mqttPubData, pdMS_TO_TICKS(100)) != pdTRUE)
-    {
-        ESP_LOGE(TAG, "Failed to send to MQTT publish queue");
-    }
-
-
-    cJSON_free(jsonStr);
-    cJSON_Delete(root);
-    heap_caps_free(_mqttPubData);
+    mqttPubRingSend(_msg, _len);
 }
 
-
+/**
+ * @brief  从默认主题发布串口屏进度条数值
+ * @param  controlType  消息类型
+ * @param  notifyType   通知类型
+ * @param  screen_id    画面ID
+ * @param  control_id   控件ID
+ * @param  value        进度条数值
+ */
 void mqttPubScreenProgressBarMsg(uint16_t controlType,
-uint16_t notifyType,
-uint32_t screen_id,
-uint32_t control_id,
-uint32_t value)
-{
-MqttPublishData_t *_mqttPubData =
-(MqttPublishData_t *)heap_caps_malloc(sizeof(MqttPublishData_t), MALLOC_CAP_SPIRAM);
-if (_mqttPubData == NULL) {
-ESP_LOGE("MQTT", "malloc failed");
-return;
-}
-
-cJSON *root = cJSON_CreateObject();
-cJSON_AddNumberToObject(root, "control_type", controlType);
-cJSON_AddNumberToObject(root, "notify_type",  notifyType);
-
-cJSON *data = cJSON_CreateObject();
-cJSON_AddNumberToObject(data, "screen_id",  screen_id);
-cJSON_AddNumberToObject(data, "control_id", control_id);
-cJSON_AddNumberToObject(data, "value", value);
-cJSON_AddItemToObject(root, "data", data);
-
-char *jsonStr = cJSON_PrintUnformatted(root);
-size_t len = strlen(jsonStr);
-
-// 复制数据到PSRAM中的结构体
-_mqttPubData->dataLen = strlen(jsonStr);
-if (_mqttPubData->dataLen >= MQTT_PUBLISH_DATA_MAX_LEN)
-{
-    ESP_LOGE(TAG, "JSON string too long");
-    cJSON_free(jsonStr);
-    cJSON_Delete(root);
-    heap_caps_free(_mqttPubData);
-    return;
-}
-strcpy(_mqttPubData->data, jsonStr);
-
-// 发送到队列
-if (xQueueSend(g_mqttPubDataQueueHandler, _mqttPubData, pdMS_TO_TICKS(100)) != pdTRUE)
+                                 uint16_t notifyType,
+                                 uint32_t screen_id,
+                                 uint32_t control_id,
+                                 uint32_t value)
 {
-    ESP_LOGE(TAG, "Failed to send to MQTT publish queue");
-}
-
-cJSON_free(jsonStr);
-cJSON_Delete(root);
-heap_caps_free(_mqttPubData);
-
+    char _msg[MQTT_STATUS_MSG_MAX_LEN];
+    json_writer_t _writer;
+    size_t _len;
+    json_writer_init(&_writer, _msg, sizeof(_msg));
+    json_writer_object_begin(&_writer);
+    json_writer_key_int(&_writer, "control_type", controlType);
+    json_writer_key_int(&_writer, "notify_type", notifyType);
+    json_writer_key(&_writer, "data");
+    json_writer_object_begin(&_writer);
+    json_writer_key_uint(&_writer, "screen_id", screen_id);
+    json_writer_key_uint(&_writer, "control_id", control_id);
+    json_writer_key_uint(&_writer, "value", value);
+    json_writer_object_end(&_writer);
+    json_writer_object_end(&_writer);
+    if (json_writer_finish(&_writer, &_len) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Status message %d/%d too long, dropped", controlType, notifyType);
+        return;
+    }
+    mqttPubRingSend(_msg, _len);
 }
 
-
+/**
+ * @brief  从默认主题发布串口屏文本控件内容
+ * @param  controlType  消息类型
+ * @param  notifyType   通知类型
+ * @param  screen_id    画面ID
+ * @param  control_id   控件ID
+ * @param  string       文本内容
+ * @param  jsonlen      文本长度
+ */
 void mqttPubScreenTextMsg(uint16_t controlType,
-uint16_t notifyType,
-uint32_t screen_id,
-uint32_t control_id,
-const char *string, 
-uint32_t jsonlen)
+                          uint16_t notifyType,
+                          uint32_t screen_id,
+                          uint32_t control_id,
+                          const char *string,
+                          uint32_t jsonlen)
 {
-MqttPublishData_t *_mqttPubData =
-(MqttPublishData_t *)heap_caps_malloc(sizeof(MqttPublishData_t), MALLOC_CAP_SPIRAM);
-if (_mqttPubData == NULL) {
-ESP_LOGE("MQTT", "malloc failed");
-return;
-}
-
-cJSON *root = cJSON_CreateObject();
-cJSON_AddNumberToObject(root, "control_type", controlType);
-cJSON_AddNumberToObject(root, "notify_type", notifyType);
-
-cJSON *data = cJSON_CreateObject();
-cJSON_AddNumberToObject(data, "screen_id", screen_id);
-cJSON_AddNumberToObject(data, "control_id", control_id);
-cJSON_AddStringToObject(data, "string", string);  
-cJSON_AddNumberToObject(data, "len", jsonlen);
-cJSON_AddItemToObject(root, "data", data);
-
-char *jsonStr = cJSON_PrintUnformatted(root);
-size_t jsonLen = strlen(jsonStr);
-
-if (jsonLen >= MQTT_PUBLISH_DATA_MAX_LEN) {
-    ESP_LOGE(TAG, "JSON string too long");
-    cJSON_free(jsonStr);
-    cJSON_Delete(root);
-    heap_caps_free(_mqttPubData);
-    return;
-}
-
-strcpy(_mqttPubData->data, jsonStr);
-_mqttPubData->dataLen = jsonLen;
-
-if (xQueueSend(g_mqttPubDataQueueHandler, _mqttPubData, pdMS_TO_TICKS(100)) != pdTRUE) {
-    ESP_LOGE(TAG, "Failed to send to MQTT publish queue");
-}
-
-cJSON_free(jsonStr);
-cJSON_Delete(root);
-heap_caps_free(_mqttPubData);
-
+    char _msg[MQTT_STATUS_MSG_MAX_LEN];
+    json_writer_t _writer;
+    size_t _len;
+    json_writer_init(&_writer, _msg, sizeof(_msg));
+    json_writer_object_begin(&_writer);
+    json_writer_key_int(&_writer, "control_type", controlType);
+    json_writer_key_int(&_writer, "notify_type", notifyType);
+    json_writer_key(&_writer, "data");
+    json_writer_object_begin(&_writer);
+    json_writer_key_uint(&_writer, "screen_id", screen_id);
+    json_writer_key_uint(&_writer, "control_id", control_id);
+    json_writer_key_string(&_writer, "string", string);
+    json_writer_key_uint(&_writer, "len", jsonlen);
+    json_writer_object_end(&_writer);
+    json_writer_object_end(&_writer);
+    if (json_writer_finish(&_writer, &_len) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Status message %d/%d too long, dropped", controlType, notifyType);
+        return;
+    }
+    mqttPubRingSend(_msg, _len);
 }
-
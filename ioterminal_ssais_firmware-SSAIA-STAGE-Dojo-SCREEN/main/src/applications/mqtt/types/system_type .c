@@ -16,23 +16,25 @@ static char *TAG = "MQTT_SYSTEM_CMD";
  */
 void mqttPubOtaParameterMsg()
 {
-    MqttPublishData_t _mqttPubData;
-    cJSON *msgBuff = NULL;
-    msgBuff = cJSON_CreateObject();
-    cJSON_AddNumberToObject(msgBuff, "control_type", MQTT_CONTROL_TYPE_SYSTEM_OTA);
-    cJSON_AddNumberToObject(msgBuff, "notify_type", NOTIFY_OTA_NVS_PARAMETER);
-    cJSON *data = NULL;
-    data = cJSON_CreateObject();
-    cJSON_AddStringToObject(data, "url", g_nvsData.networkConfigData.otaConfigData.esp32OtaServer);
-    cJSON_AddStringToObject(data, "file_name", g_nvsData.networkConfigData.otaConfigData.firmwareFileName);
-    cJSON_AddItemToObject(msgBuff, "data", data);
-    char *jsonStr = NULL;
-    jsonStr = cJSON_PrintUnformatted(msgBuff);
-    _mqttPubData.dataLen = strlen(jsonStr);
-    strcpy(_mqttPubData.data, jsonStr);
-    xQueueSend(g_mqttPubDataQueueHandler, &_mqttPubData, pdMS_TO_TICKS(100));
-    cJSON_free(jsonStr);
-    cJSON_Delete(msgBuff);
+    char _msg[MQTT_STATUS_MSG_MAX_LEN + MAX_URL_BUF_LEN + MAX_FIRMWARE_FILE_NAME_LEN];
+    json_writer_t _writer;
+    size_t _len;
+    json_writer_init(&_writer, _msg, sizeof(_msg));
+    json_writer_object_begin(&_writer);
+    json_writer_key_int(&_writer, "control_type", MQTT_CONTROL_TYPE_SYSTEM_OTA);
+    json_writer_key_int(&_writer, "notify_type", NOTIFY_OTA_NVS_PARAMETER);
+    json_writer_key(&_writer, "data");
+    json_writer_object_begin(&_writer);
+    json_writer_key_string(&_writer, "url", g_nvsData.networkConfigData.otaConfigData.esp32OtaServer);
+    json_writer_key_string(&_writer, "file_name", g_nvsData.networkConfigData.otaConfigData.firmwareFileName);
+    json_writer_object_end(&_writer);
+    json_writer_object_end(&_writer);
+    if (json_writer_finish(&_writer, &_len) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "OTA parameter message too long");
+        return;
+    }
+    mqttPubRingSend(_msg, _len);
 }
 
 /**
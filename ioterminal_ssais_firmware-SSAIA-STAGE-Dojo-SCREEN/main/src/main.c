@@ -78,7 +78,7 @@ void app_main(void)
 
     ESP_LOGI(TAG, "--------------------------Init MQTT---------------------------");
     g_mqttRecvDataQueueHandler = xQueueCreateWithCaps(MQTT_RECEIVE_QUEUE_LEN, sizeof(MqttReceiveData_t), MALLOC_CAP_SPIRAM);
-    g_mqttPubDataQueueHandler = xQueueCreateWithCaps(MQTT_PUBISH_QUEUE_LEN, sizeof(MqttPublishData_t), MALLOC_CAP_SPIRAM);
+    g_mqttPubRingHandle = xRingbufferCreateWithCaps(MQTT_PUBLISH_RING_SIZE, RINGBUF_TYPE_NOSPLIT, MALLOC_CAP_SPIRAM);
     mqttDefaultTopicPubStrMsg(MQTT_CONTROL_TYPE_SYSTEM_REBOOT, NOTIFY_SYSTEM_REBOOT, "version", FIRMWARE_VERSION);
     xTaskCreate(mqttTask, "mqttTask", 16384, NULL, MQTT_TASK_PRIVILEGE | portPRIVILEGE_BIT, NULL);
 
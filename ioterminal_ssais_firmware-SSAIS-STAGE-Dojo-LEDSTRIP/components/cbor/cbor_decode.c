@@ -0,0 +1,302 @@
+/**
+ * @file cbor_decode.c
+ * @brief CBOR解码为cJSON对象树
+ * @version 1.0
+ * @date 2024-06-24
+ *
+ * @copyright Copyright (c) 2024  雅马哈发动机（厦门）信息系统有限公司
+ *
+ */
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include "cbor_decode.h"
+
+#define CBOR_MAJOR_UINT 0
+#define CBOR_MAJOR_NEGINT 1
+#define CBOR_MAJOR_BYTES 2
+#define CBOR_MAJOR_TEXT 3
+#define CBOR_MAJOR_ARRAY 4
+#define CBOR_MAJOR_MAP 5
+#define CBOR_MAJOR_TAG 6
+#define CBOR_MAJOR_SIMPLE 7
+#define CBOR_INFO_INDEFINITE 31
+#define CBOR_BREAK 0xFF
+
+typedef struct
+{
+    const uint8_t *data;
+    size_t len;
+    size_t pos;
+} cbor_reader_t;
+
+/**
+ * @brief  读取数据项头部
+ * @param  reader
+ * @param  major    主类型
+ * @param  info     附加信息(低5位)
+ * @param  value    参数值(整数值、长度或浮点数的原始位)
+ * @return bool
+ */
+static bool cbor_read_head(cbor_reader_t *reader, uint8_t *major, uint8_t *info, uint64_t *value)
+{
+    if (reader->pos >= reader->len)
+    {
+        return false;
+    }
+    uint8_t initial = reader->data[reader->pos++];
+    *major = initial >> 5;
+    *info = initial & 0x1F;
+    if (*info < 24 || *info == CBOR_INFO_INDEFINITE)
+    {
+        *value = *info;
+        return true;
+    }
+    if (*info > 27)
+    {
+        return false;
+    }
+    size_t bytes = 1u << (*info - 24);
+    if (reader->len - reader->pos < bytes)
+    {
+        return false;
+    }
+    *value = 0;
+    for (size_t i = 0; i < bytes; i++)
+    {
+        *value = (*value << 8) | reader->data[reader->pos++];
+    }
+    return true;
+}
+
+static double cbor_half_to_double(uint16_t half)
+{
+    int exponent = (half >> 10) & 0x1F;
+    double mantissa = half & 0x3FF;
+    double value;
+    if (exponent == 0)
+    {
+        value = ldexp(mantissa, -24);
+    }
+    else if (exponent == 0x1F)
+    {
+        value = mantissa == 0 ? INFINITY : NAN;
+    }
+    else
+    {
+        value = ldexp(mantissa + 1024, exponent - 25);
+    }
+    return (half & 0x8000) ? -value : value;
+}
+
+/**
+ * @brief  读取定长文本(不含结尾'\0'), 返回指向输入缓冲区的指针
+ * @param  reader
+ * @param  len
+ * @return const char* 失败返回NULL
+ */
+static const char *cbor_read_text(cbor_reader_t *reader, size_t *len)
+{
+    uint8_t major, info;
+    uint64_t value;
+    if (!cbor_read_head(reader, &major, &info, &value) || major != CBOR_MAJOR_TEXT || info == CBOR_INFO_INDEFINITE)
+    {
+        return NULL;
+    }
+    if (value > reader->len - reader->pos)
+    {
+        return NULL;
+    }
+    const char *text = (const char *)&reader->data[reader->pos];
+    reader->pos += value;
+    *len = value;
+    return text;
+}
+
+/**
+ * @brief  复制文本为以'\0'结尾的字符串(cJSON_malloc申请, 由cJSON_Delete释放)
+ * @param  text
+ * @param  len
+ * @return char*
+ */
+static char *cbor_text_dup(const char *text, size_t len)
+{
+    char *str = cJSON_malloc(len + 1);
+    if (str != NULL)
+    {
+        memcpy(str, text, len);
+        str[len] = '\0';
+    }
+    return str;
+}
+
+/**
+ * @brief  下一个字节是否为不定长容器的结束标记, 是则跳过
+ * @param  reader
+ * @param  indefinite
+ * @param  remaining    定长容器剩余元素数
+ * @return bool 容器是否结束
+ */
+static bool cbor_container_done(cbor_reader_t *reader, bool indefinite, uint64_t remaining)
+{
+    if (!indefinite)
+    {
+        return remaining == 0;
+    }
+    if (reader->pos < reader->len && reader->data[reader->pos] == CBOR_BREAK)
+    {
+        reader->pos++;
+        return true;
+    }
+    return false;
+}
+
+static cJSON *cbor_decode_item(cbor_reader_t *reader, uint8_t depth)
+{
+    uint8_t major, info;
+    uint64_t value;
+    if (depth > CBOR_DECODE_MAX_DEPTH)
+    {
+        return NULL;
+    }
+    while (true) // 跳过标签, 按被标记的数据项处理
+    {
+        if (!cbor_read_head(reader, &major, &info, &value))
+        {
+            return NULL;
+        }
+        if (major != CBOR_MAJOR_TAG)
+        {
+            break;
+        }
+        if (info == CBOR_INFO_INDEFINITE)
+        {
+            return NULL;
+        }
+    }
+    bool indefinite = info == CBOR_INFO_INDEFINITE;
+    switch (major)
+    {
+    case CBOR_MAJOR_UINT:
+    case CBOR_MAJOR_NEGINT:
+    {
+        if (indefinite)
+        {
+            return NULL;
+        }
+        return cJSON_CreateNumber(major == CBOR_MAJOR_UINT ? (double)value : -1.0 - (double)value);
+    }
+    case CBOR_MAJOR_TEXT:
+    {
+        if (indefinite || value > reader->len - reader->pos)
+        {
+            return NULL;
+        }
+        char *str = cbor_text_dup((const char *)&reader->data[reader->pos], value);
+        reader->pos += value;
+        cJSON *item = str != NULL ? cJSON_CreateStringReference(str) : NULL;
+        if (item == NULL)
+        {
+            cJSON_free(str);
+            return NULL;
+        }
+        item->type &= ~cJSON_IsReference; // 字符串归该节点所有, 随cJSON_Delete释放
+        return item;
+    }
+    case CBOR_MAJOR_ARRAY:
+    case CBOR_MAJOR_MAP:
+    {
+        cJSON *container = major == CBOR_MAJOR_ARRAY ? cJSON_CreateArray() : cJSON_CreateObject();
+        uint64_t remaining = value;
+        bool complete = false;
+        while (container != NULL)
+        {
+            if (cbor_container_done(reader, indefinite, remaining))
+            {
+                complete = true;
+                break;
+            }
+            const char *key = NULL;
+            size_t key_len = 0;
+            if (major == CBOR_MAJOR_MAP && (key = cbor_read_text(reader, &key_len)) == NULL)
+            {
+                break;
+            }
+            cJSON *child = cbor_decode_item(reader, depth + 1);
+            if (child == NULL)
+            {
+                break;
+            }
+            if (key != NULL)
+            {
+                child->string = cbor_text_dup(key, key_len); // 与cJSON_AddItemToObject相同, 键由节点持有
+                if (child->string == NULL)
+                {
+                    cJSON_Delete(child);
+                    break;
+                }
+            }
+            cJSON_AddItemToArray(container, child);
+            remaining--;
+        }
+        if (!complete)
+        {
+            cJSON_Delete(container);
+            return NULL;
+        }
+        return container;
+    }
+    case CBOR_MAJOR_SIMPLE:
+    {
+        switch (info)
+        {
+        case 20:
+            return cJSON_CreateFalse();
+        case 21:
+            return cJSON_CreateTrue();
+        case 22:
+        case 23:
+            return cJSON_CreateNull();
+        case 25:
+            return cJSON_CreateNumber(cbor_half_to_double((uint16_t)value));
+        case 26:
+        {
+            uint32_t bits = (uint32_t)value;
+            float single;
+            memcpy(&single, &bits, sizeof(single));
+            return cJSON_CreateNumber(single);
+        }
+        case 27:
+        {
+            double number;
+            memcpy(&number, &value, sizeof(number));
+            return cJSON_CreateNumber(number);
+        }
+        default:
+            return NULL;
+        }
+    }
+    default: // 字节串与不支持的类型
+        return NULL;
+    }
+}
+
+cJSON *cbor_decode_to_cjson(const uint8_t *data, size_t len, size_t *consumed)
+{
+    if (data == NULL || len == 0)
+    {
+        return NULL;
+    }
+    cbor_reader_t reader = {.data = data, .len = len, .pos = 0};
+    cJSON *root = cbor_decode_item(&reader, 0);
+    if (root != NULL && consumed == NULL && reader.pos != len)
+    {
+        cJSON_Delete(root);
+        return NULL;
+    }
+    if (consumed != NULL)
+    {
+        *consumed = root != NULL ? reader.pos : 0;
+    }
+    return root;
+}
@@ -0,0 +1,30 @@
+/**
+ * @file cbor_decode.h
+ * @brief CBOR解码为cJSON对象树
+ * @version 1.0
+ * @date 2024-06-24
+ *
+ * @copyright Copyright (c) 2024  雅马哈发动机（厦门）信息系统有限公司
+ *
+ */
+#ifndef _CBOR_DECODE_H_
+#define _CBOR_DECODE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "cJSON.h"
+
+#define CBOR_DECODE_MAX_DEPTH 16 ///< 最大嵌套层数
+
+/**
+ * @brief  将一个CBOR数据项解码为cJSON对象树, 结果与解析等价的JSON文本相同, 命令处理函数无需区分格式
+ *         支持: 整数、float16/32/64、UTF-8文本、数组与映射(定长与不定长)、true/false/null(undefined按null处理), 标签被忽略
+ *         不支持: 字节串、不定长文本、非文本的映射键(返回NULL)
+ * @param  data
+ * @param  len
+ * @param  consumed     输出实际解码的字节数; 为NULL时要求data恰好为一个完整数据项
+ * @return cJSON* 失败返回NULL, 使用后需 cJSON_Delete
+ */
+cJSON *cbor_decode_to_cjson(const uint8_t *data, size_t len, size_t *consumed);
+
+#endif // _CBOR_DECODE_H_
@@ -0,0 +1,480 @@
+/**
+ * @file journal.c
+ * @brief Flash中的追加式消息日志(按扇区循环使用, 确认后整体回收)
+ * @version 1.0
+ * @date 2024-06-28
+ *
+ * @copyright Copyright (c) 2024  雅马哈发动机（厦门）信息系统有限公司
+ *
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "journal.h"
+
+#define JOURNAL_SECTOR_MAGIC 0x4C4E524A // "JRNL"
+#define JOURNAL_RECORD_ENTRY 0xA5
+#define JOURNAL_RECORD_TRIM 0x5A
+#define JOURNAL_RECORD_ERASED 0xFF
+#define JOURNAL_ALIGN(len) (((len) + 3) & ~3u)
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t sector_seq;
+    uint32_t crc;
+    uint32_t reserved;
+} journal_sector_header_t;
+
+typedef struct
+{
+    uint8_t type; // JOURNAL_RECORD_*
+    uint8_t tag;
+    uint16_t len;
+    uint32_t seq; // 记录序号; 确认记录为确认序号
+    uint32_t crc; // 覆盖前8字节与数据
+} journal_record_header_t;
+
+_Static_assert(sizeof(journal_sector_header_t) == JOURNAL_SECTOR_HEADER_SIZE, "sector header size");
+_Static_assert(sizeof(journal_record_header_t) == JOURNAL_RECORD_HEADER_SIZE, "record header size");
+
+/**
+ * @brief  扇区内记录的遍历回调
+ * @return bool 返回false停止遍历
+ */
+typedef bool (*journal_visit_t)(journal_t *journal, uint32_t sector, const journal_record_header_t *header, const uint8_t *data, void *arg);
+
+static uint32_t journal_crc32(uint32_t crc, const uint8_t *data, size_t len)
+{
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++)
+    {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+static uint32_t journal_record_crc(const journal_record_header_t *header, const uint8_t *data)
+{
+    uint32_t crc = journal_crc32(0, (const uint8_t *)header, offsetof(journal_record_header_t, crc));
+    return header->len > 0 ? journal_crc32(crc, data, header->len) : crc;
+}
+
+static uint32_t journal_sector_header_crc(const journal_sector_header_t *header)
+{
+    return journal_crc32(0, (const uint8_t *)header, offsetof(journal_sector_header_t, crc));
+}
+
+/**
+ * @brief  读取扇区并遍历其中完整的记录
+ * @param  journal
+ * @param  sector
+ * @param  visit    可为NULL
+ * @param  arg
+ * @param  end      输出最后一条完整记录之后的偏移
+ * @param  torn     输出是否遇到残缺记录(写入中断)
+ * @return esp_err_t
+ */
+static esp_err_t journal_sector_walk(journal_t *journal, uint32_t sector, journal_visit_t visit, void *arg, uint32_t *end, bool *torn)
+{
+    uint8_t *buf = journal->scratch;
+    esp_err_t err = journal->flash.read(journal->flash.ctx, sector * JOURNAL_SECTOR_SIZE, buf, JOURNAL_SECTOR_SIZE);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    uint32_t offset = JOURNAL_SECTOR_HEADER_SIZE;
+    *torn = false;
+    while (offset + JOURNAL_RECORD_HEADER_SIZE <= JOURNAL_SECTOR_SIZE)
+    {
+        journal_record_header_t header;
+        memcpy(&header, buf + offset, sizeof(header));
+        if (header.type == JOURNAL_RECORD_ERASED)
+        {
+            static const uint8_t s_erased[JOURNAL_RECORD_HEADER_SIZE] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+            *torn = memcmp(&header, s_erased, sizeof(header)) != 0;
+            break;
+        }
+        uint32_t size = JOURNAL_ALIGN(JOURNAL_RECORD_HEADER_SIZE + header.len);
+        if ((header.type != JOURNAL_RECORD_ENTRY && header.type != JOURNAL_RECORD_TRIM) || offset + size > JOURNAL_SECTOR_SIZE ||
+            journal_record_crc(&header, buf + offset + JOURNAL_RECORD_HEADER_SIZE) != header.crc)
+        {
+            *torn = true;
+            break;
+        }
+        if (visit != NULL && !visit(journal, sector, &header, buf + offset + JOURNAL_RECORD_HEADER_SIZE, arg))
+        {
+            break;
+        }
+        offset += size;
+    }
+    *end = offset;
+    return ESP_OK;
+}
+
+/**
+ * @brief  打开时统计每条记录: 扇区最大序号、全局最大序号、确认序号
+ */
+static bool journal_scan_visit(journal_t *journal, uint32_t sector, const journal_record_header_t *header, const uint8_t *data, void *arg)
+{
+    uint32_t *max_seq = arg;
+    if (header->type == JOURNAL_RECORD_TRIM)
+    {
+        if (header->seq > journal->trim_seq)
+        {
+            journal->trim_seq = header->seq;
+        }
+        return true;
+    }
+    if (header->seq > journal->sector_last_seq[sector])
+    {
+        journal->sector_last_seq[sector] = header->seq;
+    }
+    if (header->seq > *max_seq)
+    {
+        *max_seq = header->seq;
+    }
+    return true;
+}
+
+/**
+ * @brief  读取扇区头
+ * @return bool 扇区头是否有效
+ */
+static bool journal_sector_header_read(journal_t *journal, uint32_t sector, uint32_t *sector_seq)
+{
+    journal_sector_header_t header;
+    if (journal->flash.read(journal->flash.ctx, sector * JOURNAL_SECTOR_SIZE, &header, sizeof(header)) != ESP_OK)
+    {
+        return false;
+    }
+    if (header.magic != JOURNAL_SECTOR_MAGIC || header.crc != journal_sector_header_crc(&header))
+    {
+        return false;
+    }
+    *sector_seq = header.sector_seq;
+    return true;
+}
+
+esp_err_t journal_open(journal_t *journal, const journal_flash_t *flash)
+{
+    memset(journal, 0, sizeof(journal_t));
+    if (flash->size < 2 * JOURNAL_SECTOR_SIZE || flash->size % JOURNAL_SECTOR_SIZE != 0)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    journal->flash = *flash;
+    journal->sector_count = flash->size / JOURNAL_SECTOR_SIZE;
+    journal->sector_last_seq = calloc(journal->sector_count, sizeof(uint32_t));
+    journal->batch = malloc(JOURNAL_SECTOR_SIZE);
+    journal->scratch = malloc(JOURNAL_SECTOR_SIZE);
+    if (journal->sector_last_seq == NULL || journal->batch == NULL || journal->scratch == NULL)
+    {
+        journal_close(journal);
+        return ESP_ERR_NO_MEM;
+    }
+
+    // 序号最大的有效扇区为当前写入扇区, 向前连续的有效扇区为仍在使用的扇区
+    bool found = false;
+    for (uint32_t sector = 0; sector < journal->sector_count; sector++)
+    {
+        uint32_t sector_seq;
+        if (journal_sector_header_read(journal, sector, &sector_seq) && (!found || sector_seq > journal->head_sector_seq))
+        {
+            found = true;
+            journal->head = sector;
+            journal->head_sector_seq = sector_seq;
+        }
+    }
+    if (!found)
+    {
+        journal->head = journal->sector_count - 1; // 第一次写入时使用扇区0
+        journal->head_offset = JOURNAL_SECTOR_SIZE;
+        journal->next_seq = 1;
+        return ESP_OK;
+    }
+    journal->tail = journal->head;
+    journal->used = 1;
+    while (journal->used < journal->sector_count)
+    {
+        uint32_t prev = (journal->tail + journal->sector_count - 1) % journal->sector_count;
+        uint32_t sector_seq;
+        if (!journal_sector_header_read(journal, prev, &sector_seq) || sector_seq != journal->head_sector_seq - journal->used)
+        {
+            break;
+        }
+        journal->tail = prev;
+        journal->used++;
+    }
+
+    uint32_t max_seq = 0;
+    for (uint32_t i = 0; i < journal->used; i++)
+    {
+        uint32_t sector = (journal->tail + i) % journal->sector_count;
+        uint32_t end;
+        bool torn;
+        esp_err_t err = journal_sector_walk(journal, sector, journal_scan_visit, &max_seq, &end, &torn);
+        if (err != ESP_OK)
+        {
+            journal_close(journal);
+            return err;
+        }
+        if (sector == journal->head)
+        {
+            journal->head_offset = torn ? JOURNAL_SECTOR_SIZE : end; // 残缺记录之后的空间无法确认是否已擦除,不再写入
+        }
+    }
+    journal->next_seq = (max_seq > journal->trim_seq ? max_seq : journal->trim_seq) + 1;
+    journal->durable_seq = journal->next_seq - 1;
+    journal->pending_trim_seq = journal->trim_seq;
+    return ESP_OK;
+}
+
+void journal_close(journal_t *journal)
+{
+    free(journal->sector_last_seq);
+    free(journal->batch);
+    free(journal->scratch);
+    journal->sector_last_seq = NULL;
+    journal->batch = NULL;
+    journal->scratch = NULL;
+}
+
+/**
+ * @brief  编码一条记录
+ * @return size_t 对齐后的长度
+ */
+static size_t journal_record_encode(uint8_t *buf, uint8_t type, uint8_t tag, uint32_t seq, const void *data, size_t len)
+{
+    journal_record_header_t header = {.type = type, .tag = tag, .len = len, .seq = seq};
+    header.crc = journal_record_crc(&header, data);
+    size_t size = JOURNAL_ALIGN(JOURNAL_RECORD_HEADER_SIZE + len);
+    memcpy(buf, &header, sizeof(header));
+    if (len > 0)
+    {
+        memcpy(buf + JOURNAL_RECORD_HEADER_SIZE, data, len);
+    }
+    memset(buf + JOURNAL_RECORD_HEADER_SIZE + len, 0xFF, size - JOURNAL_RECORD_HEADER_SIZE - len);
+    return size;
+}
+
+/**
+ * @brief  写入待写的确认序号(一条确认记录), 调用方保证当前扇区有空间
+ */
+static esp_err_t journal_trim_write(journal_t *journal)
+{
+    uint8_t record[JOURNAL_RECORD_HEADER_SIZE];
+    size_t size = journal_record_encode(record, JOURNAL_RECORD_TRIM, 0, journal->pending_trim_seq, NULL, 0);
+    esp_err_t err = journal->flash.write(journal->flash.ctx, journal->head * JOURNAL_SECTOR_SIZE + journal->head_offset, record, size);
+    if (err == ESP_OK)
+    {
+        journal->head_offset += size;
+        journal->trim_seq = journal->pending_trim_seq;
+    }
+    return err;
+}
+
+/**
+ * @brief  切换到下一个扇区: 所有扇区都在使用时回收最旧的扇区(其中的记录须已全部确认)
+ *         新扇区开头写入待写的确认序号, 旧扇区回收后重启仍能识别已确认的记录;
+ *         回收与写入确认序号之间掉电时, 重启后部分已确认的记录会被再次重放(至少一次)
+ */
+static esp_err_t journal_sector_advance(journal_t *journal)
+{
+    if (journal->used == journal->sector_count)
+    {
+        if (journal->sector_last_seq[journal->tail] > journal->pending_trim_seq)
+        {
+            return ESP_ERR_NO_MEM;
+        }
+        journal->tail = (journal->tail + 1) % journal->sector_count;
+        journal->used--;
+    }
+    uint32_t next = (journal->head + 1) % journal->sector_count;
+    esp_err_t err = journal->flash.erase(journal->flash.ctx, next * JOURNAL_SECTOR_SIZE, JOURNAL_SECTOR_SIZE);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    journal_sector_header_t header = {.magic = JOURNAL_SECTOR_MAGIC, .sector_seq = journal->head_sector_seq + 1, .reserved = UINT32_MAX};
+    header.crc = journal_sector_header_crc(&header);
+    err = journal->flash.write(journal->flash.ctx, next * JOURNAL_SECTOR_SIZE, &header, sizeof(header));
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    if (journal->used == 0)
+    {
+        journal->tail = next;
+    }
+    journal->used++;
+    journal->head = next;
+    journal->head_sector_seq++;
+    journal->head_offset = JOURNAL_SECTOR_HEADER_SIZE;
+    journal->sector_last_seq[next] = 0;
+    return journal->pending_trim_seq > 0 ? journal_trim_write(journal) : ESP_OK;
+}
+
+esp_err_t journal_append(journal_t *journal, uint8_t tag, const void *data, size_t len, uint32_t *seq)
+{
+    if (len > JOURNAL_ENTRY_MAX_LEN)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    size_t size = JOURNAL_ALIGN(JOURNAL_RECORD_HEADER_SIZE + len);
+    if (journal->batch_len + size > JOURNAL_SECTOR_SIZE)
+    {
+        esp_err_t err = journal_flush(journal);
+        if (journal->batch_len + size > JOURNAL_SECTOR_SIZE) // 写入失败, 批次中的记录保留
+        {
+            return err != ESP_OK ? err : ESP_ERR_NO_MEM;
+        }
+    }
+    *seq = journal->next_seq++;
+    journal->batch_len += journal_record_encode(journal->batch + journal->batch_len, JOURNAL_RECORD_ENTRY, tag, *seq, data, len);
+    return ESP_OK;
+}
+
+void journal_trim(journal_t *journal, uint32_t seq)
+{
+    if (seq > journal->pending_trim_seq)
+    {
+        journal->pending_trim_seq = seq;
+    }
+}
+
+bool journal_dirty(const journal_t *journal)
+{
+    return journal->batch_len > 0 || journal->pending_trim_seq > journal->trim_seq;
+}
+
+esp_err_t journal_flush(journal_t *journal)
+{
+    esp_err_t err = ESP_OK;
+    if (journal->pending_trim_seq > journal->trim_seq) // 先写确认序号,回收扇区时以其为准
+    {
+        if (journal->head_offset + JOURNAL_RECORD_HEADER_SIZE > JOURNAL_SECTOR_SIZE)
+        {
+            err = journal_sector_advance(journal); // 新扇区开头已写入确认序号
+        }
+        else
+        {
+            err = journal_trim_write(journal);
+        }
+    }
+    size_t offset = 0;
+    uint32_t last_seq = 0;
+    while (err == ESP_OK && offset < journal->batch_len)
+    {
+        // 当前扇区放得下的连续记录一次写入
+        size_t room = JOURNAL_SECTOR_SIZE - journal->head_offset;
+        size_t run = 0;
+        while (offset + run < journal->batch_len)
+        {
+            journal_record_header_t header;
+            memcpy(&header, journal->batch + offset + run, sizeof(header));
+            size_t size = JOURNAL_ALIGN(JOURNAL_RECORD_HEADER_SIZE + header.len);
+            if (run + size > room)
+            {
+                break;
+            }
+            run += size;
+            last_seq = header.seq;
+        }
+        if (run == 0)
+        {
+            err = journal_sector_advance(journal);
+            continue;
+        }
+        err = journal->flash.write(journal->flash.ctx, journal->head * JOURNAL_SECTOR_SIZE + journal->head_offset, journal->batch + offset, run);
+        if (err == ESP_OK)
+        {
+            journal->head_offset += run;
+            journal->sector_last_seq[journal->head] = last_seq;
+            offset += run;
+            journal->durable_seq = last_seq;
+        }
+    }
+    // 未写入的记录留在批次中, 下次刷新时重试
+    memmove(journal->batch, journal->batch + offset, journal->batch_len - offset);
+    journal->batch_len -= offset;
+    return err;
+}
+
+typedef struct
+{
+    uint32_t first_seq;
+    uint32_t last_seq;
+    journal_replay_cb_t cb;
+    void *arg;
+} journal_replay_ctx_t;
+
+static bool journal_replay_visit(journal_t *journal, uint32_t sector, const journal_record_header_t *header, const uint8_t *data, void *arg)
+{
+    journal_replay_ctx_t *ctx = arg;
+    if (header->type == JOURNAL_RECORD_ENTRY && header->seq > journal->pending_trim_seq && header->seq >= ctx->first_seq && header->seq <= ctx->last_seq)
+    {
+        ctx->cb(header->seq, header->tag, data, header->len, ctx->arg);
+    }
+    return header->seq <= ctx->last_seq || header->type == JOURNAL_RECORD_TRIM;
+}
+
+esp_err_t journal_replay(journal_t *journal, uint32_t first_seq, uint32_t last_seq, journal_replay_cb_t cb, void *arg)
+{
+    journal_replay_ctx_t ctx = {.first_seq = first_seq, .last_seq = last_seq, .cb = cb, .arg = arg};
+    for (uint32_t i = 0; i < journal->used; i++)
+    {
+        uint32_t sector = (journal->tail + i) % journal->sector_count;
+        if (journal->sector_last_seq[sector] < first_seq || journal->sector_last_seq[sector] <= journal->pending_trim_seq)
+        {
+            continue; // 扇区中没有需要重放的记录
+        }
+        uint32_t end;
+        bool torn;
+        esp_err_t err = journal_sector_walk(journal, sector, journal_replay_visit, &ctx, &end, &torn);
+        if (err != ESP_OK)
+        {
+            return err;
+        }
+    }
+    return ESP_OK;
+}
+
+#ifdef ESP_PLATFORM
+#include "esp_partition.h"
+
+static esp_err_t journal_partition_read(void *ctx, uint32_t offset, void *buf, size_t len)
+{
+    return esp_partition_read(ctx, offset, buf, len);
+}
+
+static esp_err_t journal_partition_write(void *ctx, uint32_t offset, const void *buf, size_t len)
+{
+    return esp_partition_write(ctx, offset, buf, len);
+}
+
+static esp_err_t journal_partition_erase(void *ctx, uint32_t offset, size_t len)
+{
+    return esp_partition_erase_range(ctx, offset, len);
+}
+
+esp_err_t journal_open_partition(journal_t *journal, const char *label)
+{
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    if (partition == NULL)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    journal_flash_t flash = {
+        .read = journal_partition_read,
+        .write = journal_partition_write,
+        .erase = journal_partition_erase,
+        .ctx = (void *)partition,
+        .size = partition->size - partition->size % JOURNAL_SECTOR_SIZE,
+    };
+    return journal_open(journal, &flash);
+}
+#endif
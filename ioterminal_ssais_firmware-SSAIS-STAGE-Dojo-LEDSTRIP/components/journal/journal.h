@@ -0,0 +1,147 @@
+/**
+ * @file journal.h
+ * @brief Flash中的追加式消息日志(按扇区循环使用, 确认后整体回收), 不依赖ESP-IDF时可在主机上编译
+ * @version 1.0
+ * @date 2024-06-28
+ *
+ * @copyright Copyright (c) 2024  雅马哈发动机（厦门）信息系统有限公司
+ *
+ */
+#ifndef _JOURNAL_H_
+#define _JOURNAL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#ifdef ESP_PLATFORM
+#include "esp_err.h"
+#else // 主机上编译(tools/journal_crash_check.c)
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NO_MEM 0x101
+#define ESP_ERR_INVALID_SIZE 0x104
+#define ESP_ERR_NOT_FOUND 0x105
+#endif
+
+#define JOURNAL_SECTOR_SIZE 4096       ///< 擦除单位, 日志区大小须为其整数倍且不少于2个扇区
+#define JOURNAL_SECTOR_HEADER_SIZE 16  ///< 扇区头: 魔数、扇区序号、CRC
+#define JOURNAL_RECORD_HEADER_SIZE 12  ///< 记录头: 类型、标签、长度、序号、CRC
+#define JOURNAL_ENTRY_MAX_LEN (JOURNAL_SECTOR_SIZE - JOURNAL_SECTOR_HEADER_SIZE - 2 * JOURNAL_RECORD_HEADER_SIZE) ///< 单条记录数据上限(扇区开头预留一条确认记录)
+
+/**
+ * @brief 存储介质操作, 偏移均相对日志区起始
+ *        写入只会把1改为0, 擦除后全部为0xFF(与NOR Flash一致)
+ */
+typedef struct
+{
+    esp_err_t (*read)(void *ctx, uint32_t offset, void *buf, size_t len);
+    esp_err_t (*write)(void *ctx, uint32_t offset, const void *buf, size_t len);
+    esp_err_t (*erase)(void *ctx, uint32_t offset, size_t len);
+    void *ctx;
+    uint32_t size; // 日志区大小
+} journal_flash_t;
+
+/**
+ * @brief 日志状态
+ *        扇区按环形顺序使用, [tail, head]为有效扇区; 记录写入前在RAM中攒批, journal_flush 时一次写入
+ *        确认序号(trim)单调递增, 不大于确认序号的记录视为已删除, 扇区内全部记录都被确认后才会被回收
+ */
+typedef struct
+{
+    journal_flash_t flash;
+    uint32_t sector_count;
+    uint32_t *sector_last_seq; // 各扇区中最大的记录序号, 用于判断能否回收
+    uint32_t tail;             // 最旧的有效扇区
+    uint32_t head;             // 当前写入的扇区
+    uint32_t used;             // 有效扇区数
+    uint32_t head_offset;      // 当前扇区写入偏移
+    uint32_t head_sector_seq;  // 当前扇区序号
+    uint32_t next_seq;         // 下一条记录的序号(从1开始)
+    uint32_t durable_seq;      // 已写入Flash的最大记录序号
+    uint32_t trim_seq;         // 已写入Flash的确认序号
+    uint32_t pending_trim_seq; // 等待写入的确认序号
+    uint8_t *batch;            // 待写入的记录(已编码)
+    size_t batch_len;
+    uint8_t *scratch; // 扇区读缓冲
+} journal_t;
+
+/**
+ * @brief  重放回调
+ * @param  seq
+ * @param  tag      追加时的标签
+ * @param  data
+ * @param  len
+ * @param  arg
+ */
+typedef void (*journal_replay_cb_t)(uint32_t seq, uint8_t tag, const uint8_t *data, size_t len, void *arg);
+
+/**
+ * @brief  打开日志区: 扫描所有扇区, 恢复写入位置与确认序号; 写入中断(掉电)的残缺记录被跳过, 所在扇区不再写入
+ * @param  journal
+ * @param  flash
+ * @return esp_err_t
+ */
+esp_err_t journal_open(journal_t *journal, const journal_flash_t *flash);
+
+/**
+ * @brief  释放日志占用的内存(不写入未刷新的记录)
+ * @param  journal
+ */
+void journal_close(journal_t *journal);
+
+/**
+ * @brief  追加一条记录到RAM批次, 批次放不下时先刷新
+ * @param  journal
+ * @param  tag
+ * @param  data
+ * @param  len      不超过JOURNAL_ENTRY_MAX_LEN
+ * @param  seq      输出记录序号
+ * @return esp_err_t 刷新失败且批次放不下时返回刷新的错误, 记录未追加
+ */
+esp_err_t journal_append(journal_t *journal, uint8_t tag, const void *data, size_t len, uint32_t *seq);
+
+/**
+ * @brief  确认序号不大于seq的全部记录, 下次刷新时写入
+ * @param  journal
+ * @param  seq
+ */
+void journal_trim(journal_t *journal, uint32_t seq);
+
+/**
+ * @brief  是否有未写入Flash的记录或确认序号
+ * @param  journal
+ * @return bool
+ */
+bool journal_dirty(const journal_t *journal);
+
+/**
+ * @brief  将批次写入Flash, 扇区写满时回收已全部确认的最旧扇区
+ *         写入失败或空间不足时未写入的记录保留在批次中(不计入durable_seq), 下次刷新时重试
+ * @param  journal
+ * @return esp_err_t 空间不足返回ESP_ERR_NO_MEM
+ */
+esp_err_t journal_flush(journal_t *journal);
+
+/**
+ * @brief  按写入顺序重放Flash中序号在[first_seq, last_seq]内且未确认的记录
+ * @param  journal
+ * @param  first_seq
+ * @param  last_seq
+ * @param  cb
+ * @param  arg
+ * @return esp_err_t
+ */
+esp_err_t journal_replay(journal_t *journal, uint32_t first_seq, uint32_t last_seq, journal_replay_cb_t cb, void *arg);
+
+#ifdef ESP_PLATFORM
+/**
+ * @brief  以分区表中的数据分区作为日志区打开
+ * @param  journal
+ * @param  label    分区名
+ * @return esp_err_t 未找到分区返回ESP_ERR_NOT_FOUND
+ */
+esp_err_t journal_open_partition(journal_t *journal, const char *label);
+#endif
+
+#endif // _JOURNAL_H_
@@ -0,0 +1,122 @@
+/**
+ * @file json_writer.h
+ * @brief 无堆内存申请的流式JSON生成器(可选CBOR输出)
+ * @version 1.0
+ * @date 2024-06-20
+ *
+ * @copyright Copyright (c) 2024  雅马哈发动机（厦门）信息系统有限公司
+ *
+ */
+#ifndef _JSON_WRITER_H_
+#define _JSON_WRITER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#define JSON_WRITER_MAX_DEPTH 8 ///< 最大嵌套层数
+
+/**
+ * @brief 输出格式
+ */
+typedef enum
+{
+    JSON_WRITER_FORMAT_JSON = 0, // JSON文本
+    JSON_WRITER_FORMAT_CBOR,     // CBOR(RFC 8949), 对象与数组使用不定长编码
+} json_writer_format_t;
+
+/**
+ * @brief JSON生成器状态, 直接写入调用方提供的缓冲区
+ *        缓冲区不足或嵌套错误时置错误标志, 之后的写入全部忽略, 由 json_writer_finish 返回错误
+ */
+typedef struct
+{
+    char *buf;                             // 输出缓冲区
+    size_t size;                           // 缓冲区大小
+    size_t len;                            // 已写入长度(不含结尾'\0')
+    uint8_t depth;                         // 当前嵌套层数
+    char container[JSON_WRITER_MAX_DEPTH]; // 各层容器类型 '{' 或 '['
+    bool has_item[JSON_WRITER_MAX_DEPTH];  // 各层是否已有元素(决定是否写入逗号)
+    bool expect_value;                     // 对象中已写入键, 等待值
+    json_writer_format_t format;           // 输出格式
+    esp_err_t err;                         // 第一个错误
+} json_writer_t;
+
+/**
+ * @brief  初始化JSON生成器
+ * @param  writer
+ * @param  buf      输出缓冲区
+ * @param  size     缓冲区大小
+ */
+void json_writer_init(json_writer_t *writer, char *buf, size_t size);
+
+/**
+ * @brief  初始化生成器并指定输出格式, 调用方式与JSON完全相同
+ *         CBOR: 整数值的浮点数按整数编码, 其余浮点数能无损表示为float32时使用float32
+ * @param  writer
+ * @param  buf      输出缓冲区
+ * @param  size     缓冲区大小
+ * @param  format
+ */
+void json_writer_init_format(json_writer_t *writer, char *buf, size_t size, json_writer_format_t format);
+
+void json_writer_object_begin(json_writer_t *writer);
+void json_writer_object_end(json_writer_t *writer);
+void json_writer_array_begin(json_writer_t *writer);
+void json_writer_array_end(json_writer_t *writer);
+
+/**
+ * @brief  写入对象的键(仅在对象中有效)
+ * @param  writer
+ * @param  key
+ */
+void json_writer_key(json_writer_t *writer, const char *key);
+
+/**
+ * @brief  写入字符串值, 按JSON规则转义引号、反斜杠与控制字符, UTF-8原样输出
+ * @param  writer
+ * @param  str      NULL时写入null
+ */
+void json_writer_string(json_writer_t *writer, const char *str);
+
+void json_writer_int(json_writer_t *writer, int64_t value);
+void json_writer_uint(json_writer_t *writer, uint64_t value);
+
+/**
+ * @brief  写入浮点数, 格式与cJSON一致(优先15位有效数字, 不能还原时17位; NaN/Inf写入null)
+ * @param  writer
+ * @param  value
+ */
+void json_writer_double(json_writer_t *writer, double value);
+void json_writer_bool(json_writer_t *writer, bool value);
+void json_writer_null(json_writer_t *writer);
+
+/**
+ * @brief  原样写入一段与输出格式一致的已编码数据(调用方保证其合法性)
+ * @param  writer
+ * @param  json
+ * @param  len
+ */
+void json_writer_raw(json_writer_t *writer, const char *json, size_t len);
+
+/**
+ * @brief  键值对便捷写入
+ */
+void json_writer_key_string(json_writer_t *writer, const char *key, const char *str);
+void json_writer_key_int(json_writer_t *writer, const char *key, int64_t value);
+void json_writer_key_uint(json_writer_t *writer, const char *key, uint64_t value);
+void json_writer_key_double(json_writer_t *writer, const char *key, double value);
+
+/**
+ * @brief  结束生成, 写入结尾'\0'(CBOR同样写入, 不计入长度)
+ * @param  writer
+ * @param  len      输出长度(不含'\0'), 可为NULL
+ * @return esp_err_t
+ *         ESP_OK                  成功
+ *         ESP_ERR_NO_MEM          缓冲区不足
+ *         ESP_ERR_INVALID_STATE   嵌套不完整或键值顺序错误
+ */
+esp_err_t json_writer_finish(json_writer_t *writer, size_t *len);
+
+#endif // _JSON_WRITER_H_
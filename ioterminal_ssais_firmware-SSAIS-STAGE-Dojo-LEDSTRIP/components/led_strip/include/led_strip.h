@@ -18,6 +18,11 @@
 extern "C" {
 #endif
 
+/**
+ * @brief Pass as `pixel_num` of `led_strip_refresh_range` to send up to the highest pixel changed since the last refresh
+ */
+#define LED_STRIP_REFRESH_DIRTY 0
+
 /**
  * @brief Set RGB for a specific pixel
  *
@@ -34,6 +39,24 @@ extern "C" {
  */
 esp_err_t led_strip_set_pixel(led_strip_handle_t strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue);
 
+/**
+ * @brief Set the same RGB for a range of pixels
+ *
+ * @note The first pixel is encoded once and copied to the rest of the range in the pixel buffer
+ *
+ * @param strip: LED strip
+ * @param index: index of the first pixel
+ * @param count: number of pixels, 0 does nothing
+ * @param red: red part of color
+ * @param green: green part of color
+ * @param blue: blue part of color
+ *
+ * @return
+ *      - ESP_OK: Set RGB for the pixels successfully
+ *      - ESP_ERR_INVALID_ARG: Set RGB for the pixels failed because of invalid parameters (e.g. range out of the strip)
+ */
+esp_err_t led_strip_fill(led_strip_handle_t strip, uint32_t index, uint32_t count, uint32_t red, uint32_t green, uint32_t blue);
+
 /**
  * @brief Set RGBW for a specific pixel
  *
@@ -84,6 +107,64 @@ esp_err_t led_strip_set_pixel_hsv(led_strip_handle_t strip, uint32_t index, uint
  */
 esp_err_t led_strip_refresh(led_strip_handle_t strip);
 
+/**
+ * @brief Refresh only the first `pixel_num` pixels of the strip
+ *
+ * @note WS2812-like pixels latch whatever they received and keep their old color otherwise,
+ *       so sending the prefix that contains every changed pixel is enough.
+ *       Falls back to `led_strip_refresh` for backends that cannot truncate a frame.
+ *
+ * @param strip: LED strip
+ * @param pixel_num: number of pixels to send, or LED_STRIP_REFRESH_DIRTY to send up to the highest changed pixel
+ *                   (nothing is sent when no pixel changed)
+ *
+ * @return
+ *      - ESP_OK: Refresh successfully
+ *      - ESP_FAIL: Refresh failed because some other error occurred
+ */
+esp_err_t led_strip_refresh_range(led_strip_handle_t strip, uint32_t pixel_num);
+
+/**
+ * @brief Start refreshing the first `pixel_num` pixels without waiting for the transmission
+ *
+ * @note The pixels are copied to a second buffer before this returns, so the next frame can be drawn
+ *       while the previous one is on the wire. Waits only if the previous frame is still being sent.
+ *       Backends without asynchronous support refresh synchronously.
+ *
+ * @param strip: LED strip
+ * @param pixel_num: number of pixels to send, or LED_STRIP_REFRESH_DIRTY to send up to the highest changed pixel
+ *
+ * @return
+ *      - ESP_OK: Refresh started successfully
+ *      - ESP_FAIL: Refresh failed because some other error occurred
+ */
+esp_err_t led_strip_refresh_async(led_strip_handle_t strip, uint32_t pixel_num);
+
+/**
+ * @brief Wait until the frame started by `led_strip_refresh_async` is completely sent
+ *
+ * @param strip: LED strip
+ * @param timeout_ms: timeout in milliseconds, -1 to wait forever
+ *
+ * @return
+ *      - ESP_OK: No frame in flight
+ *      - ESP_ERR_TIMEOUT: The frame is still being sent
+ */
+esp_err_t led_strip_wait_refresh_done(led_strip_handle_t strip, int timeout_ms);
+
+/**
+ * @brief Register the callback invoked (in ISR context) when a frame is completely sent
+ *
+ * @param strip: LED strip
+ * @param cb: callback, NULL to unregister
+ * @param user_ctx: user context passed to the callback
+ *
+ * @return
+ *      - ESP_OK: Register successfully
+ *      - ESP_ERR_NOT_SUPPORTED: The backend refreshes synchronously and has no completion event
+ */
+esp_err_t led_strip_register_refresh_done_cb(led_strip_handle_t strip, led_strip_refresh_done_cb_t cb, void *user_ctx);
+
 /**
  * @brief Clear LED strip (turn off all LEDs)
  *
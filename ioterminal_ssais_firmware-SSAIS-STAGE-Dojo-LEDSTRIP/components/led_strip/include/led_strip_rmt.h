@@ -48,6 +48,40 @@ typedef struct {
  */
 esp_err_t led_strip_new_rmt_device(const led_strip_config_t *led_config, const led_strip_rmt_config_t *rmt_config, led_strip_handle_t *ret_strip);
 
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+#define LED_STRIP_RMT_MAX_OUTPUTS 4 /*!< Maximum number of physical outputs one logical strip can span */
+
+/**
+ * @brief Split of one logical LED strip across several RMT TX channels
+ *
+ * @note Output n drives the logical pixels right after those of output n-1, so callers keep a single index space.
+ *       Only the first output uses DMA and `mem_block_symbols` from `led_strip_rmt_config_t`.
+ */
+typedef struct {
+    uint32_t output_num;                         /*!< Number of physical outputs, 1 ~ LED_STRIP_RMT_MAX_OUTPUTS */
+    int gpio_num[LED_STRIP_RMT_MAX_OUTPUTS];     /*!< Data GPIO of each output, `strip_gpio_num` of the LED config is not used */
+    uint32_t led_num[LED_STRIP_RMT_MAX_OUTPUTS]; /*!< Number of LEDs on each output, they must add up to `max_leds` */
+} led_strip_rmt_multi_config_t;
+
+/**
+ * @brief Create one logical LED strip driven by several RMT TX channels in parallel
+ *
+ * @note A refresh starts all outputs before waiting for any, so it takes as long as the longest output
+ *
+ * @param led_config LED strip configuration, `max_leds` is the total of all outputs
+ * @param rmt_config RMT specific configuration
+ * @param multi_config Split of the strip across outputs
+ * @param ret_strip Returned LED strip handle
+ * @return
+ *      - ESP_OK: create LED strip handle successfully
+ *      - ESP_ERR_INVALID_ARG: create LED strip handle failed because of invalid argument
+ *      - ESP_ERR_NO_MEM: create LED strip handle failed because of out of memory
+ *      - ESP_FAIL: create LED strip handle failed because some other error
+ */
+esp_err_t led_strip_new_rmt_multi_device(const led_strip_config_t *led_config, const led_strip_rmt_config_t *rmt_config,
+                                         const led_strip_rmt_multi_config_t *multi_config, led_strip_handle_t *ret_strip);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
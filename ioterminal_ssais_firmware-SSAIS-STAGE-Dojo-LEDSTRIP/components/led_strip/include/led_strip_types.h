@@ -6,6 +6,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <stdbool.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -38,6 +39,17 @@ typedef enum {
  */
 typedef struct led_strip_t *led_strip_handle_t;
 
+/**
+ * @brief Callback invoked when a frame started by `led_strip_refresh_async` is completely sent
+ *
+ * @note Runs in ISR context for backends that transmit asynchronously, keep it short and ISR safe
+ *
+ * @param strip: LED strip
+ * @param user_ctx: user context passed to `led_strip_register_refresh_done_cb`
+ * @return Whether a high priority task has been woken up by this callback
+ */
+typedef bool (*led_strip_refresh_done_cb_t)(led_strip_handle_t strip, void *user_ctx);
+
 /**
  * @brief LED Strip Configuration
  */
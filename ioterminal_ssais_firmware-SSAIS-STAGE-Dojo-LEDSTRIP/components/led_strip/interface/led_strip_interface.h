@@ -6,7 +6,9 @@
 #pragma once
 
 #include <stdint.h>
+#include <string.h>
 #include "esp_err.h"
+#include "led_strip_types.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -51,6 +53,24 @@ struct led_strip_t {
      */
     esp_err_t (*set_pixel_rgbw)(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue, uint32_t white);
 
+    /**
+     * @brief Set the same RGB for a range of pixels
+     *
+     * @note Optional, `led_strip_fill` falls back to `set_pixel` for each pixel when it is NULL
+     *
+     * @param strip: LED strip
+     * @param index: index of the first pixel
+     * @param count: number of pixels
+     * @param red: red part of color
+     * @param green: green part of color
+     * @param blue: blue part of color
+     *
+     * @return
+     *      - ESP_OK: Set RGB for the pixels successfully
+     *      - ESP_ERR_INVALID_ARG: Set RGB for the pixels failed because of invalid parameters
+     */
+    esp_err_t (*fill)(led_strip_t *strip, uint32_t index, uint32_t count, uint32_t red, uint32_t green, uint32_t blue);
+
     /**
      * @brief Refresh memory colors to LEDs
      *
@@ -66,6 +86,62 @@ struct led_strip_t {
      */
     esp_err_t (*refresh)(led_strip_t *strip);
 
+    /**
+     * @brief Refresh only the first `pixel_num` pixels to LEDs
+     *
+     * @note Optional, `led_strip_refresh_range` falls back to `refresh` when it is NULL
+     *
+     * @param strip: LED strip
+     * @param pixel_num: number of pixels to send, LED_STRIP_REFRESH_DIRTY for up to the highest changed pixel
+     *
+     * @return
+     *      - ESP_OK: Refresh successfully
+     *      - ESP_FAIL: Refresh failed because some other error occurred
+     */
+    esp_err_t (*refresh_range)(led_strip_t *strip, uint32_t pixel_num);
+
+    /**
+     * @brief Start sending the first `pixel_num` pixels and return without waiting for the wire
+     *
+     * @note Optional, `led_strip_refresh_async` falls back to `refresh_range` when it is NULL
+     *
+     * @param strip: LED strip
+     * @param pixel_num: number of pixels to send, LED_STRIP_REFRESH_DIRTY for up to the highest changed pixel
+     *
+     * @return
+     *      - ESP_OK: Refresh started successfully
+     *      - ESP_FAIL: Refresh failed because some other error occurred
+     */
+    esp_err_t (*refresh_async)(led_strip_t *strip, uint32_t pixel_num);
+
+    /**
+     * @brief Wait until the frame started by `refresh_async` is completely sent
+     *
+     * @note Optional, `led_strip_wait_refresh_done` returns immediately when it is NULL
+     *
+     * @param strip: LED strip
+     * @param timeout_ms: timeout in milliseconds, -1 to wait forever
+     *
+     * @return
+     *      - ESP_OK: No frame in flight
+     *      - ESP_ERR_TIMEOUT: The frame is still being sent
+     */
+    esp_err_t (*wait_refresh_done)(led_strip_t *strip, int timeout_ms);
+
+    /**
+     * @brief Register the callback invoked when a frame is completely sent
+     *
+     * @note Optional, `led_strip_register_refresh_done_cb` returns ESP_ERR_NOT_SUPPORTED when it is NULL
+     *
+     * @param strip: LED strip
+     * @param cb: callback, NULL to unregister
+     * @param user_ctx: user context passed to the callback
+     *
+     * @return
+     *      - ESP_OK: Register successfully
+     */
+    esp_err_t (*register_refresh_done_cb)(led_strip_t *strip, led_strip_refresh_done_cb_t cb, void *user_ctx);
+
     /**
      * @brief Clear LED strip (turn off all LEDs)
      *
@@ -90,6 +166,21 @@ struct led_strip_t {
     esp_err_t (*del)(led_strip_t *strip);
 };
 
+/**
+ * @brief Repeat the first `pattern_len` bytes of `buf` until `total_len` bytes are filled
+ *
+ * @note Copies double in size each round, so filling N pixels takes log2(N) memcpy calls
+ */
+static inline void led_strip_fill_pattern(uint8_t *buf, size_t pattern_len, size_t total_len)
+{
+    size_t done = pattern_len;
+    while (done < total_len) {
+        size_t len = (total_len - done) < done ? (total_len - done) : done;
+        memcpy(buf + done, buf, len);
+        done += len;
+    }
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -16,6 +16,21 @@ esp_err_t led_strip_set_pixel(led_strip_handle_t strip, uint32_t index, uint32_t
     return strip->set_pixel(strip, index, red, green, blue);
 }
 
+esp_err_t led_strip_fill(led_strip_handle_t strip, uint32_t index, uint32_t count, uint32_t red, uint32_t green, uint32_t blue)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    if (count == 0) {
+        return ESP_OK;
+    }
+    if (strip->fill) {
+        return strip->fill(strip, index, count, red, green, blue);
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        ESP_RETURN_ON_ERROR(strip->set_pixel(strip, index + i, red, green, blue), TAG, "set pixel failed");
+    }
+    return ESP_OK;
+}
+
 esp_err_t led_strip_set_pixel_hsv(led_strip_handle_t strip, uint32_t index, uint16_t hue, uint8_t saturation, uint8_t value)
 {
     ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
@@ -81,6 +96,40 @@ esp_err_t led_strip_refresh(led_strip_handle_t strip)
     return strip->refresh(strip);
 }
 
+esp_err_t led_strip_refresh_async(led_strip_handle_t strip, uint32_t pixel_num)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    if (strip->refresh_async) {
+        return strip->refresh_async(strip, pixel_num);
+    }
+    return led_strip_refresh_range(strip, pixel_num);
+}
+
+esp_err_t led_strip_wait_refresh_done(led_strip_handle_t strip, int timeout_ms)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    if (strip->wait_refresh_done) {
+        return strip->wait_refresh_done(strip, timeout_ms);
+    }
+    return ESP_OK;
+}
+
+esp_err_t led_strip_register_refresh_done_cb(led_strip_handle_t strip, led_strip_refresh_done_cb_t cb, void *user_ctx)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ESP_RETURN_ON_FALSE(strip->register_refresh_done_cb, ESP_ERR_NOT_SUPPORTED, TAG, "refresh done callback not supported");
+    return strip->register_refresh_done_cb(strip, cb, user_ctx);
+}
+
+esp_err_t led_strip_refresh_range(led_strip_handle_t strip, uint32_t pixel_num)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    if (strip->refresh_range) {
+        return strip->refresh_range(strip, pixel_num);
+    }
+    return strip->refresh(strip);
+}
+
 esp_err_t led_strip_clear(led_strip_handle_t strip)
 {
     ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
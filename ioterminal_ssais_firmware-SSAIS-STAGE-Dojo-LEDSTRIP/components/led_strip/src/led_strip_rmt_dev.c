@@ -5,9 +5,12 @@
  */
 #include <stdlib.h>
 #include <string.h>
+#include <inttypes.h>
 #include <sys/cdefs.h>
 #include "esp_log.h"
 #include "esp_check.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "driver/rmt_tx.h"
 #include "led_strip.h"
 #include "led_strip_interface.h"
@@ -25,42 +28,97 @@
 static const char *TAG = "led_strip_rmt";
 
 typedef struct {
-    led_strip_t base;
     rmt_channel_handle_t rmt_chan;
     rmt_encoder_handle_t strip_encoder;
+    uint32_t start;   // first logical pixel driven by this output
+    uint32_t led_num; // number of pixels on this output
+} led_strip_rmt_output_t;
+
+typedef struct {
+    led_strip_t base;
+    uint32_t output_num;
+    led_strip_rmt_output_t output[LED_STRIP_RMT_MAX_OUTPUTS];
     uint32_t strip_len;
+    uint32_t dirty_len; // pixels [0, dirty_len) may differ from what the strip has latched
+    portMUX_TYPE dirty_lock; // guards dirty_len, drawing tasks and the refresh may run on different cores
     uint8_t bytes_per_pixel;
     uint8_t pixel_format;
-    uint8_t pixel_buf[];
+    uint8_t *tx_buf;                    // snapshot being shifted out, pixel_buf can be redrawn meanwhile
+    SemaphoreHandle_t done_sem;         // available while no frame is in flight
+    uint32_t pending_outputs;           // outputs of the in-flight frame that have not finished yet
+    led_strip_refresh_done_cb_t done_cb;
+    void *done_ctx;
+    uint8_t pixel_buf[];                // followed by the same amount of memory for tx_buf
 } led_strip_rmt_obj;
 
+static void led_strip_rmt_mark_dirty(led_strip_rmt_obj *rmt_strip, uint32_t end)
+{
+    portENTER_CRITICAL(&rmt_strip->dirty_lock);
+    if (end > rmt_strip->dirty_len) {
+        rmt_strip->dirty_len = end;
+    }
+    portEXIT_CRITICAL(&rmt_strip->dirty_lock);
+}
+
+// Returns how many pixels to send and clears the dirty mark before they are read. A pixel drawn from another
+// task meanwhile marks itself again and goes out with the next refresh instead of being lost
+static uint32_t led_strip_rmt_claim_dirty(led_strip_rmt_obj *rmt_strip, uint32_t pixel_num)
+{
+    portENTER_CRITICAL(&rmt_strip->dirty_lock);
+    if (pixel_num == LED_STRIP_REFRESH_DIRTY) {
+        pixel_num = rmt_strip->dirty_len;
+    }
+    if (pixel_num > rmt_strip->strip_len) {
+        pixel_num = rmt_strip->strip_len;
+    }
+    if (pixel_num >= rmt_strip->dirty_len) {
+        rmt_strip->dirty_len = 0;
+    }
+    portEXIT_CRITICAL(&rmt_strip->dirty_lock);
+    return pixel_num;
+}
+
+// Only a pixel whose bytes actually change raises the dirty mark, so rewriting unchanged pixels keeps refreshes short
+static void led_strip_rmt_write_pixel(led_strip_rmt_obj *rmt_strip, uint32_t index, const uint8_t *pixel)
+{
+    uint8_t *buf = rmt_strip->pixel_buf + index * rmt_strip->bytes_per_pixel;
+    if (memcmp(buf, pixel, rmt_strip->bytes_per_pixel) != 0) {
+        memcpy(buf, pixel, rmt_strip->bytes_per_pixel);
+        led_strip_rmt_mark_dirty(rmt_strip, index + 1);
+    }
+}
+
 static esp_err_t led_strip_rmt_set_pixel(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue)
 {
     led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
     ESP_RETURN_ON_FALSE(index < rmt_strip->strip_len, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
-    uint32_t start = index * rmt_strip->bytes_per_pixel;
+    uint8_t pixel[4] = {0};
     // In thr order of GRB, as LED strip like WS2812 sends out pixels in this order
     switch (rmt_strip->pixel_format)
     {
-    case LED_PIXEL_FORMAT_GRB :
-            rmt_strip->pixel_buf[start + 0] = green & 0xFF;
-            rmt_strip->pixel_buf[start + 1] = red & 0xFF;
-            rmt_strip->pixel_buf[start + 2] = blue & 0xFF;
-        break;
     case LED_PIXEL_FORMAT_RGB :
-            rmt_strip->pixel_buf[start + 0] = red & 0xFF;
-            rmt_strip->pixel_buf[start + 1] = green & 0xFF;
-            rmt_strip->pixel_buf[start + 2] = blue & 0xFF;
+            pixel[0] = red & 0xFF;
+            pixel[1] = green & 0xFF;
+            pixel[2] = blue & 0xFF;
         break;
+    case LED_PIXEL_FORMAT_GRB :
     default:
-            rmt_strip->pixel_buf[start + 0] = green & 0xFF;
-            rmt_strip->pixel_buf[start + 1] = red & 0xFF;
-            rmt_strip->pixel_buf[start + 2] = blue & 0xFF;
+            pixel[0] = green & 0xFF;
+            pixel[1] = red & 0xFF;
+            pixel[2] = blue & 0xFF;
         break;
-    } 
-    if (rmt_strip->bytes_per_pixel > 3) {
-        rmt_strip->pixel_buf[start + 3] = 0;
     }
+    led_strip_rmt_write_pixel(rmt_strip, index, pixel);
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_rmt_fill(led_strip_t *strip, uint32_t index, uint32_t count, uint32_t red, uint32_t green, uint32_t blue)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    ESP_RETURN_ON_FALSE(index < rmt_strip->strip_len && count <= rmt_strip->strip_len - index, ESP_ERR_INVALID_ARG, TAG, "range out of maximum number of LEDs");
+    led_strip_rmt_set_pixel(strip, index, red, green, blue);
+    led_strip_fill_pattern(rmt_strip->pixel_buf + index * rmt_strip->bytes_per_pixel, rmt_strip->bytes_per_pixel, count * rmt_strip->bytes_per_pixel);
+    led_strip_rmt_mark_dirty(rmt_strip, index + count);
     return ESP_OK;
 }
 
@@ -69,30 +127,103 @@ static esp_err_t led_strip_rmt_set_pixel_rgbw(led_strip_t *strip, uint32_t index
     led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
     ESP_RETURN_ON_FALSE(index < rmt_strip->strip_len, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
     ESP_RETURN_ON_FALSE(rmt_strip->bytes_per_pixel == 4, ESP_ERR_INVALID_ARG, TAG, "wrong LED pixel format, expected 4 bytes per pixel");
-    uint8_t *buf_start = rmt_strip->pixel_buf + index * 4;
     // SK6812 component order is GRBW
-    *buf_start = green & 0xFF;
-    *++buf_start = red & 0xFF;
-    *++buf_start = blue & 0xFF;
-    *++buf_start = white & 0xFF;
+    uint8_t pixel[4] = {green & 0xFF, red & 0xFF, blue & 0xFF, white & 0xFF};
+    led_strip_rmt_write_pixel(rmt_strip, index, pixel);
     return ESP_OK;
 }
 
-static esp_err_t led_strip_rmt_refresh(led_strip_t *strip)
+// Called from ISR context once per output, the frame is on the strip when the last output finishes
+static bool led_strip_rmt_trans_done(rmt_channel_handle_t tx_chan, const rmt_tx_done_event_data_t *edata, void *user_ctx)
+{
+    led_strip_rmt_obj *rmt_strip = (led_strip_rmt_obj *)user_ctx;
+    if (__atomic_sub_fetch(&rmt_strip->pending_outputs, 1, __ATOMIC_ACQ_REL) != 0) {
+        return false;
+    }
+    bool need_yield = false;
+    led_strip_refresh_done_cb_t done_cb = rmt_strip->done_cb;
+    if (done_cb) {
+        need_yield = done_cb(&rmt_strip->base, rmt_strip->done_ctx);
+    }
+    BaseType_t task_woken = pdFALSE;
+    xSemaphoreGiveFromISR(rmt_strip->done_sem, &task_woken);
+    return need_yield || task_woken == pdTRUE;
+}
+
+static esp_err_t led_strip_rmt_refresh_async(led_strip_t *strip, uint32_t pixel_num)
 {
     led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
     rmt_transmit_config_t tx_conf = {
         .loop_count = 0,
     };
+    pixel_num = led_strip_rmt_claim_dirty(rmt_strip, pixel_num);
+    if (pixel_num == 0) {
+        return ESP_OK;
+    }
 
-    ESP_RETURN_ON_ERROR(rmt_enable(rmt_strip->rmt_chan), TAG, "enable RMT channel failed");
-    ESP_RETURN_ON_ERROR(rmt_transmit(rmt_strip->rmt_chan, rmt_strip->strip_encoder, rmt_strip->pixel_buf,
-                                     rmt_strip->strip_len * rmt_strip->bytes_per_pixel, &tx_conf), TAG, "transmit pixels by RMT failed");
-    ESP_RETURN_ON_ERROR(rmt_tx_wait_all_done(rmt_strip->rmt_chan, -1), TAG, "flush RMT channel failed");
-    ESP_RETURN_ON_ERROR(rmt_disable(rmt_strip->rmt_chan), TAG, "disable RMT channel failed");
+    // tx_buf is reused, so the previous frame has to be out before taking the next snapshot
+    xSemaphoreTake(rmt_strip->done_sem, portMAX_DELAY);
+    memcpy(rmt_strip->tx_buf, rmt_strip->pixel_buf, pixel_num * rmt_strip->bytes_per_pixel);
+    uint32_t output_num = 0;
+    while (output_num < rmt_strip->output_num && rmt_strip->output[output_num].start < pixel_num) {
+        output_num++;
+    }
+    rmt_strip->pending_outputs = output_num;
+
+    esp_err_t ret = ESP_OK;
+    // Start every output that holds part of the range, they shift out concurrently
+    for (uint32_t i = 0; i < output_num; i++) {
+        led_strip_rmt_output_t *output = &rmt_strip->output[i];
+        uint32_t len = pixel_num - output->start;
+        if (len > output->led_num) {
+            len = output->led_num;
+        }
+        ret = rmt_transmit(output->rmt_chan, output->strip_encoder, rmt_strip->tx_buf + output->start * rmt_strip->bytes_per_pixel,
+                           len * rmt_strip->bytes_per_pixel, &tx_conf);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "transmit pixels by RMT output %"PRIu32" failed", i);
+            led_strip_rmt_mark_dirty(rmt_strip, pixel_num); // not on the strip, send again with the next refresh
+            // the outputs that were not started will never report, release the frame once the started ones are done
+            if (__atomic_sub_fetch(&rmt_strip->pending_outputs, output_num - i, __ATOMIC_ACQ_REL) == 0) {
+                xSemaphoreGive(rmt_strip->done_sem);
+            }
+            break;
+        }
+    }
+    return ret;
+}
+
+static esp_err_t led_strip_rmt_wait_refresh_done(led_strip_t *strip, int timeout_ms)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    TickType_t ticks = timeout_ms < 0 ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+    ESP_RETURN_ON_FALSE(xSemaphoreTake(rmt_strip->done_sem, ticks) == pdTRUE, ESP_ERR_TIMEOUT, TAG, "wait refresh done timeout");
+    xSemaphoreGive(rmt_strip->done_sem);
     return ESP_OK;
 }
 
+static esp_err_t led_strip_rmt_register_refresh_done_cb(led_strip_t *strip, led_strip_refresh_done_cb_t cb, void *user_ctx)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    // keep the ISR from seeing the new callback with the old context
+    rmt_strip->done_cb = NULL;
+    rmt_strip->done_ctx = user_ctx;
+    __atomic_store_n(&rmt_strip->done_cb, cb, __ATOMIC_RELEASE);
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_rmt_refresh_range(led_strip_t *strip, uint32_t pixel_num)
+{
+    ESP_RETURN_ON_ERROR(led_strip_rmt_refresh_async(strip, pixel_num), TAG, "refresh failed");
+    return led_strip_rmt_wait_refresh_done(strip, -1);
+}
+
+static esp_err_t led_strip_rmt_refresh(led_strip_t *strip)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    return led_strip_rmt_refresh_range(strip, rmt_strip->strip_len);
+}
+
 static esp_err_t led_strip_rmt_clear(led_strip_t *strip)
 {
     led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
@@ -101,21 +232,48 @@ static esp_err_t led_strip_rmt_clear(led_strip_t *strip)
     return led_strip_rmt_refresh(strip);
 }
 
+static void led_strip_rmt_del_outputs(led_strip_rmt_obj *rmt_strip)
+{
+    for (uint32_t i = 0; i < LED_STRIP_RMT_MAX_OUTPUTS; i++) {
+        if (rmt_strip->output[i].rmt_chan) {
+            rmt_disable(rmt_strip->output[i].rmt_chan);
+            rmt_del_channel(rmt_strip->output[i].rmt_chan);
+        }
+        if (rmt_strip->output[i].strip_encoder) {
+            rmt_del_encoder(rmt_strip->output[i].strip_encoder);
+        }
+    }
+}
+
 static esp_err_t led_strip_rmt_del(led_strip_t *strip)
 {
     led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
-    ESP_RETURN_ON_ERROR(rmt_del_channel(rmt_strip->rmt_chan), TAG, "delete RMT channel failed");
-    ESP_RETURN_ON_ERROR(rmt_del_encoder(rmt_strip->strip_encoder), TAG, "delete strip encoder failed");
+    ESP_RETURN_ON_ERROR(led_strip_rmt_wait_refresh_done(strip, -1), TAG, "wait refresh done failed");
+    for (uint32_t i = 0; i < rmt_strip->output_num; i++) {
+        ESP_RETURN_ON_ERROR(rmt_disable(rmt_strip->output[i].rmt_chan), TAG, "disable RMT channel failed");
+        ESP_RETURN_ON_ERROR(rmt_del_channel(rmt_strip->output[i].rmt_chan), TAG, "delete RMT channel failed");
+        ESP_RETURN_ON_ERROR(rmt_del_encoder(rmt_strip->output[i].strip_encoder), TAG, "delete strip encoder failed");
+    }
+    vSemaphoreDelete(rmt_strip->done_sem);
     free(rmt_strip);
     return ESP_OK;
 }
 
-esp_err_t led_strip_new_rmt_device(const led_strip_config_t *led_config, const led_strip_rmt_config_t *rmt_config, led_strip_handle_t *ret_strip)
+esp_err_t led_strip_new_rmt_multi_device(const led_strip_config_t *led_config, const led_strip_rmt_config_t *rmt_config,
+                                         const led_strip_rmt_multi_config_t *multi_config, led_strip_handle_t *ret_strip)
 {
     led_strip_rmt_obj *rmt_strip = NULL;
     esp_err_t ret = ESP_OK;
-    ESP_GOTO_ON_FALSE(led_config && rmt_config && ret_strip, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
+    ESP_GOTO_ON_FALSE(led_config && rmt_config && multi_config && ret_strip, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
     ESP_GOTO_ON_FALSE(led_config->led_pixel_format < LED_PIXEL_FORMAT_INVALID, ESP_ERR_INVALID_ARG, err, TAG, "invalid led_pixel_format");
+    ESP_GOTO_ON_FALSE(multi_config->output_num > 0 && multi_config->output_num <= LED_STRIP_RMT_MAX_OUTPUTS, ESP_ERR_INVALID_ARG, err, TAG,
+                      "invalid output_num");
+    uint32_t total_leds = 0;
+    for (uint32_t i = 0; i < multi_config->output_num; i++) {
+        ESP_GOTO_ON_FALSE(multi_config->led_num[i] > 0 || multi_config->output_num == 1, ESP_ERR_INVALID_ARG, err, TAG, "output %"PRIu32" has no LEDs", i);
+        total_leds += multi_config->led_num[i];
+    }
+    ESP_GOTO_ON_FALSE(total_leds == led_config->max_leds, ESP_ERR_INVALID_ARG, err, TAG, "LEDs of all outputs must add up to max_leds");
     uint8_t bytes_per_pixel = 3;
     if (led_config->led_pixel_format == LED_PIXEL_FORMAT_GRBW) {
         bytes_per_pixel = 4;
@@ -127,8 +285,13 @@ esp_err_t led_strip_new_rmt_device(const led_strip_config_t *led_config, const l
     } else {
         assert(false);
     }
-    rmt_strip = calloc(1, sizeof(led_strip_rmt_obj) + led_config->max_leds * bytes_per_pixel);
+    rmt_strip = calloc(1, sizeof(led_strip_rmt_obj) + 2 * led_config->max_leds * bytes_per_pixel);
     ESP_GOTO_ON_FALSE(rmt_strip, ESP_ERR_NO_MEM, err, TAG, "no mem for rmt strip");
+    rmt_strip->tx_buf = rmt_strip->pixel_buf + led_config->max_leds * bytes_per_pixel;
+    portMUX_INITIALIZE(&rmt_strip->dirty_lock);
+    rmt_strip->done_sem = xSemaphoreCreateBinary();
+    ESP_GOTO_ON_FALSE(rmt_strip->done_sem, ESP_ERR_NO_MEM, err, TAG, "no mem for refresh done semaphore");
+    xSemaphoreGive(rmt_strip->done_sem);
     uint32_t resolution = rmt_config->resolution_hz ? rmt_config->resolution_hz : LED_STRIP_RMT_DEFAULT_RESOLUTION;
 
     // for backward compatibility, if the user does not set the clk_src, use the default value
@@ -141,29 +304,51 @@ esp_err_t led_strip_new_rmt_device(const led_strip_config_t *led_config, const l
     if (rmt_config->mem_block_symbols) {
         mem_block_symbols = rmt_config->mem_block_symbols;
     }
-    rmt_tx_channel_config_t rmt_chan_config = {
-        .clk_src = clk_src,
-        .gpio_num = led_config->strip_gpio_num,
-        .mem_block_symbols = mem_block_symbols,
-        .resolution_hz = resolution,
-        .trans_queue_depth = LED_STRIP_RMT_DEFAULT_TRANS_QUEUE_SIZE,
-        .flags.with_dma = rmt_config->flags.with_dma,
-        .flags.invert_out = led_config->flags.invert_out,
-    };
-    ESP_GOTO_ON_ERROR(rmt_new_tx_channel(&rmt_chan_config, &rmt_strip->rmt_chan), err, TAG, "create RMT TX channel failed");
-
     led_strip_encoder_config_t strip_encoder_conf = {
         .resolution = resolution,
         .led_model = led_config->led_model
     };
-    ESP_GOTO_ON_ERROR(rmt_new_led_strip_encoder(&strip_encoder_conf, &rmt_strip->strip_encoder), err, TAG, "create LED strip encoder failed");
-
+    uint32_t start = 0;
+    for (uint32_t i = 0; i < multi_config->output_num; i++) {
+        // Only the first output gets the DMA channel and the configured memory size (a target usually has a single
+        // DMA capable TX channel), the others fall back to one memory block refilled by the encoder
+        rmt_tx_channel_config_t rmt_chan_config = {
+            .clk_src = clk_src,
+            .gpio_num = multi_config->gpio_num[i],
+            .mem_block_symbols = i == 0 ? mem_block_symbols : LED_STRIP_RMT_DEFAULT_MEM_BLOCK_SYMBOLS,
+            .resolution_hz = resolution,
+            .trans_queue_depth = LED_STRIP_RMT_DEFAULT_TRANS_QUEUE_SIZE,
+            .flags.with_dma = i == 0 ? rmt_config->flags.with_dma : 0,
+            .flags.invert_out = led_config->flags.invert_out,
+        };
+        ESP_GOTO_ON_ERROR(rmt_new_tx_channel(&rmt_chan_config, &rmt_strip->output[i].rmt_chan), err, TAG,
+                          "create RMT TX channel for output %"PRIu32" failed", i);
+        // the encoder keeps the state of one transaction, so each output needs its own
+        ESP_GOTO_ON_ERROR(rmt_new_led_strip_encoder(&strip_encoder_conf, &rmt_strip->output[i].strip_encoder), err, TAG,
+                          "create LED strip encoder failed");
+        rmt_tx_event_callbacks_t cbs = {
+            .on_trans_done = led_strip_rmt_trans_done,
+        };
+        ESP_GOTO_ON_ERROR(rmt_tx_register_event_callbacks(rmt_strip->output[i].rmt_chan, &cbs, rmt_strip), err, TAG,
+                          "register RMT TX callback failed");
+        // channels stay enabled for the lifetime of the strip, so a refresh can be started from any context
+        ESP_GOTO_ON_ERROR(rmt_enable(rmt_strip->output[i].rmt_chan), err, TAG, "enable RMT channel failed");
+        rmt_strip->output[i].start = start;
+        rmt_strip->output[i].led_num = multi_config->led_num[i];
+        start += multi_config->led_num[i];
+    }
 
+    rmt_strip->output_num = multi_config->output_num;
     rmt_strip->bytes_per_pixel = bytes_per_pixel;
     rmt_strip->strip_len = led_config->max_leds;
     rmt_strip->pixel_format = led_config->led_pixel_format;
     rmt_strip->base.set_pixel = led_strip_rmt_set_pixel;
     rmt_strip->base.set_pixel_rgbw = led_strip_rmt_set_pixel_rgbw;
+    rmt_strip->base.fill = led_strip_rmt_fill;
+    rmt_strip->base.refresh_range = led_strip_rmt_refresh_range;
+    rmt_strip->base.refresh_async = led_strip_rmt_refresh_async;
+    rmt_strip->base.wait_refresh_done = led_strip_rmt_wait_refresh_done;
+    rmt_strip->base.register_refresh_done_cb = led_strip_rmt_register_refresh_done_cb;
     rmt_strip->base.refresh = led_strip_rmt_refresh;
     rmt_strip->base.clear = led_strip_rmt_clear;
     rmt_strip->base.del = led_strip_rmt_del;
@@ -172,13 +357,22 @@ esp_err_t led_strip_new_rmt_device(const led_strip_config_t *led_config, const l
     return ESP_OK;
 err:
     if (rmt_strip) {
-        if (rmt_strip->rmt_chan) {
-            rmt_del_channel(rmt_strip->rmt_chan);
-        }
-        if (rmt_strip->strip_encoder) {
-            rmt_del_encoder(rmt_strip->strip_encoder);
+        led_strip_rmt_del_outputs(rmt_strip);
+        if (rmt_strip->done_sem) {
+            vSemaphoreDelete(rmt_strip->done_sem);
         }
         free(rmt_strip);
     }
     return ret;
 }
+
+esp_err_t led_strip_new_rmt_device(const led_strip_config_t *led_config, const led_strip_rmt_config_t *rmt_config, led_strip_handle_t *ret_strip)
+{
+    ESP_RETURN_ON_FALSE(led_config, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    led_strip_rmt_multi_config_t multi_config = {
+        .output_num = 1,
+        .gpio_num = {led_config->strip_gpio_num},
+        .led_num = {led_config->max_leds},
+    };
+    return led_strip_new_rmt_multi_device(led_config, rmt_config, &multi_config, ret_strip);
+}
@@ -8,6 +8,7 @@
 #include <sys/cdefs.h>
 #include "esp_log.h"
 #include "esp_check.h"
+#include "freertos/FreeRTOS.h"
 #include "driver/rmt.h"
 #include "led_strip.h"
 #include "led_strip_interface.h"
@@ -42,10 +43,39 @@ typedef struct {
     led_strip_t base;
     rmt_channel_t rmt_channel;
     uint32_t strip_len;
+    uint32_t dirty_len; // pixels [0, dirty_len) may differ from what the strip has latched
+    portMUX_TYPE dirty_lock; // guards dirty_len, drawing tasks and the refresh may run on different cores
     uint8_t bytes_per_pixel;
     uint8_t buffer[0];
 } led_strip_rmt_obj;
 
+static void led_strip_rmt_mark_dirty(led_strip_rmt_obj *rmt_strip, uint32_t end)
+{
+    portENTER_CRITICAL(&rmt_strip->dirty_lock);
+    if (end > rmt_strip->dirty_len) {
+        rmt_strip->dirty_len = end;
+    }
+    portEXIT_CRITICAL(&rmt_strip->dirty_lock);
+}
+
+// Returns how many pixels to send and clears the dirty mark before they are read. A pixel drawn from another
+// task meanwhile marks itself again and goes out with the next refresh instead of being lost
+static uint32_t led_strip_rmt_claim_dirty(led_strip_rmt_obj *rmt_strip, uint32_t pixel_num)
+{
+    portENTER_CRITICAL(&rmt_strip->dirty_lock);
+    if (pixel_num == LED_STRIP_REFRESH_DIRTY) {
+        pixel_num = rmt_strip->dirty_len;
+    }
+    if (pixel_num > rmt_strip->strip_len) {
+        pixel_num = rmt_strip->strip_len;
+    }
+    if (pixel_num >= rmt_strip->dirty_len) {
+        rmt_strip->dirty_len = 0;
+    }
+    portEXIT_CRITICAL(&rmt_strip->dirty_lock);
+    return pixel_num;
+}
+
 static void IRAM_ATTR ws2812_rmt_adapter(const void *src, rmt_item32_t *dest, size_t src_size,
         size_t wanted_num, size_t *translated_size, size_t *item_num)
 {
@@ -82,26 +112,50 @@ static esp_err_t led_strip_rmt_set_pixel(led_strip_t *strip, uint32_t index, uin
 {
     led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
     ESP_RETURN_ON_FALSE(index < rmt_strip->strip_len, ESP_ERR_INVALID_ARG, TAG, "index out of the maximum number of leds");
-    uint32_t start = index * rmt_strip->bytes_per_pixel;
+    uint8_t *buf = rmt_strip->buffer + index * rmt_strip->bytes_per_pixel;
     // In thr order of GRB
-    rmt_strip->buffer[start + 0] = green & 0xFF;
-    rmt_strip->buffer[start + 1] = red & 0xFF;
-    rmt_strip->buffer[start + 2] = blue & 0xFF;
-    if (rmt_strip->bytes_per_pixel > 3) {
-        rmt_strip->buffer[start + 3] = 0;
+    uint8_t pixel[4] = {green & 0xFF, red & 0xFF, blue & 0xFF, 0};
+    // Only a pixel whose bytes actually change raises the dirty mark
+    if (memcmp(buf, pixel, rmt_strip->bytes_per_pixel) != 0) {
+        memcpy(buf, pixel, rmt_strip->bytes_per_pixel);
+        led_strip_rmt_mark_dirty(rmt_strip, index + 1);
     }
     return ESP_OK;
 }
 
-static esp_err_t led_strip_rmt_refresh(led_strip_t *strip)
+static esp_err_t led_strip_rmt_fill(led_strip_t *strip, uint32_t index, uint32_t count, uint32_t red, uint32_t green, uint32_t blue)
 {
     led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
-    ESP_RETURN_ON_ERROR(rmt_write_sample(rmt_strip->rmt_channel, rmt_strip->buffer, rmt_strip->strip_len * rmt_strip->bytes_per_pixel, true), TAG,
-                        "transmit RMT samples failed");
+    ESP_RETURN_ON_FALSE(index < rmt_strip->strip_len && count <= rmt_strip->strip_len - index, ESP_ERR_INVALID_ARG, TAG, "range out of the maximum number of leds");
+    led_strip_rmt_set_pixel(strip, index, red, green, blue);
+    led_strip_fill_pattern(rmt_strip->buffer + index * rmt_strip->bytes_per_pixel, rmt_strip->bytes_per_pixel, count * rmt_strip->bytes_per_pixel);
+    led_strip_rmt_mark_dirty(rmt_strip, index + count);
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_rmt_refresh_range(led_strip_t *strip, uint32_t pixel_num)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    pixel_num = led_strip_rmt_claim_dirty(rmt_strip, pixel_num);
+    if (pixel_num == 0) {
+        return ESP_OK;
+    }
+    esp_err_t ret = rmt_write_sample(rmt_strip->rmt_channel, rmt_strip->buffer, pixel_num * rmt_strip->bytes_per_pixel, true);
+    if (ret != ESP_OK) {
+        led_strip_rmt_mark_dirty(rmt_strip, pixel_num); // not on the strip, send again with the next refresh
+        ESP_LOGE(TAG, "transmit RMT samples failed");
+        return ret;
+    }
     vTaskDelay(pdMS_TO_TICKS(LED_STRIP_RESET_MS));
     return ESP_OK;
 }
 
+static esp_err_t led_strip_rmt_refresh(led_strip_t *strip)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    return led_strip_rmt_refresh_range(strip, rmt_strip->strip_len);
+}
+
 static esp_err_t led_strip_rmt_clear(led_strip_t *strip)
 {
     led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
@@ -138,6 +192,7 @@ esp_err_t led_strip_new_rmt_device(const led_strip_config_t *led_config, const l
     // allocate memory for led_strip object
     rmt_strip = calloc(1, sizeof(led_strip_rmt_obj) + led_config->max_leds * bytes_per_pixel);
     ESP_RETURN_ON_FALSE(rmt_strip, ESP_ERR_NO_MEM, TAG, "request memory for les_strip failed");
+    portMUX_INITIALIZE(&rmt_strip->dirty_lock);
 
     // install RMT channel driver
     rmt_config_t config = RMT_DEFAULT_CONFIG_TX(led_config->strip_gpio_num, dev_config->rmt_channel);
@@ -179,7 +234,9 @@ esp_err_t led_strip_new_rmt_device(const led_strip_config_t *led_config, const l
     rmt_strip->rmt_channel = (rmt_channel_t)dev_config->rmt_channel;
     rmt_strip->strip_len = led_config->max_leds;
     rmt_strip->base.set_pixel = led_strip_rmt_set_pixel;
+    rmt_strip->base.fill = led_strip_rmt_fill;
     rmt_strip->base.refresh = led_strip_rmt_refresh;
+    rmt_strip->base.refresh_range = led_strip_rmt_refresh_range;
     rmt_strip->base.clear = led_strip_rmt_clear;
     rmt_strip->base.del = led_strip_rmt_del;
 
@@ -5,10 +5,12 @@
  */
 #include <stdlib.h>
 #include <string.h>
+#include <stdbool.h>
 #include <sys/cdefs.h>
 #include "esp_log.h"
 #include "esp_check.h"
 #include "esp_rom_gpio.h"
+#include "freertos/FreeRTOS.h"
 #include "soc/spi_periph.h"
 #include "led_strip.h"
 #include "led_strip_interface.h"
@@ -16,18 +18,27 @@
 
 #define LED_STRIP_SPI_DEFAULT_RESOLUTION (2.5 * 1000 * 1000) // 2.5MHz resolution
 #define LED_STRIP_SPI_DEFAULT_TRANS_QUEUE_SIZE 4
+#define LED_STRIP_SPI_TRANS_MAX_PIXELS 256 // pixels per queued transaction
 
 #define SPI_BYTES_PER_COLOR_BYTE 3
 #define SPI_BITS_PER_COLOR_BYTE (SPI_BYTES_PER_COLOR_BYTE * 8)
 
 static const char *TAG = "led_strip_spi";
 
+// SPI pattern of every color byte value, filled once so encoding a pixel is three table copies
+static uint8_t s_spi_pattern_lut[256][SPI_BYTES_PER_COLOR_BYTE];
+static bool s_spi_pattern_lut_ready = false;
+
 typedef struct {
     led_strip_t base;
     spi_host_device_t spi_host;
     spi_device_handle_t spi_device;
+    spi_transaction_t trans[LED_STRIP_SPI_DEFAULT_TRANS_QUEUE_SIZE]; // must stay valid until the driver returns them
     uint32_t strip_len;
+    uint32_t dirty_len; // pixels [0, dirty_len) may differ from what the strip has latched
+    portMUX_TYPE dirty_lock; // guards dirty_len, drawing tasks and the refresh may run on different cores
     uint8_t bytes_per_pixel;
+    uint8_t pixel_format;
     uint8_t pixel_buf[];
 } led_strip_spi_obj;
 
@@ -47,19 +58,88 @@ static void __led_strip_spi_bit(uint8_t data, uint8_t *buf)
     *(buf + 0) |= data & BIT(7) ? BIT(7) | BIT(6) : BIT(7);
 }
 
+static void led_strip_spi_pattern_lut_init(void)
+{
+    if (s_spi_pattern_lut_ready) {
+        return;
+    }
+    memset(s_spi_pattern_lut, 0, sizeof(s_spi_pattern_lut));
+    for (int data = 0; data < 256; data++) {
+        __led_strip_spi_bit(data, s_spi_pattern_lut[data]);
+    }
+    s_spi_pattern_lut_ready = true;
+}
+
+static inline void led_strip_spi_encode(uint8_t data, uint8_t *buf)
+{
+    memcpy(buf, s_spi_pattern_lut[data], SPI_BYTES_PER_COLOR_BYTE);
+}
+
+static void led_strip_spi_mark_dirty(led_strip_spi_obj *spi_strip, uint32_t end)
+{
+    portENTER_CRITICAL(&spi_strip->dirty_lock);
+    if (end > spi_strip->dirty_len) {
+        spi_strip->dirty_len = end;
+    }
+    portEXIT_CRITICAL(&spi_strip->dirty_lock);
+}
+
+// Returns how many pixels to send and clears the dirty mark before they are read. A pixel drawn from another
+// task meanwhile marks itself again and goes out with the next refresh instead of being lost
+static uint32_t led_strip_spi_claim_dirty(led_strip_spi_obj *spi_strip, uint32_t pixel_num)
+{
+    portENTER_CRITICAL(&spi_strip->dirty_lock);
+    if (pixel_num == LED_STRIP_REFRESH_DIRTY) {
+        pixel_num = spi_strip->dirty_len;
+    }
+    if (pixel_num > spi_strip->strip_len) {
+        pixel_num = spi_strip->strip_len;
+    }
+    if (pixel_num >= spi_strip->dirty_len) {
+        spi_strip->dirty_len = 0;
+    }
+    portEXIT_CRITICAL(&spi_strip->dirty_lock);
+    return pixel_num;
+}
+
+// Only a pixel whose encoded bits actually change raises the dirty mark
+static void led_strip_spi_write_pixel(led_strip_spi_obj *spi_strip, uint32_t index, const uint8_t *pixel)
+{
+    uint32_t pixel_size = spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE;
+    uint8_t *buf = spi_strip->pixel_buf + index * pixel_size;
+    if (memcmp(buf, pixel, pixel_size) != 0) {
+        memcpy(buf, pixel, pixel_size);
+        led_strip_spi_mark_dirty(spi_strip, index + 1);
+    }
+}
+
 static esp_err_t led_strip_spi_set_pixel(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue)
 {
     led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
     ESP_RETURN_ON_FALSE(index < spi_strip->strip_len, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
     // LED_PIXEL_FORMAT_GRB takes 72bits(9bytes)
-    uint32_t start = index * spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE;
-    memset(spi_strip->pixel_buf + start, 0, spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE);
-    __led_strip_spi_bit(green, &spi_strip->pixel_buf[start]);
-    __led_strip_spi_bit(red, &spi_strip->pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE]);
-    __led_strip_spi_bit(blue, &spi_strip->pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE * 2]);
-    if (spi_strip->bytes_per_pixel > 3) {
-        __led_strip_spi_bit(0, &spi_strip->pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE * 3]);
+    uint8_t pixel[4 * SPI_BYTES_PER_COLOR_BYTE];
+    if (spi_strip->pixel_format == LED_PIXEL_FORMAT_RGB) {
+        led_strip_spi_encode(red & 0xFF, &pixel[0]);
+        led_strip_spi_encode(green & 0xFF, &pixel[SPI_BYTES_PER_COLOR_BYTE]);
+    } else {
+        led_strip_spi_encode(green & 0xFF, &pixel[0]);
+        led_strip_spi_encode(red & 0xFF, &pixel[SPI_BYTES_PER_COLOR_BYTE]);
     }
+    led_strip_spi_encode(blue & 0xFF, &pixel[SPI_BYTES_PER_COLOR_BYTE * 2]);
+    led_strip_spi_encode(0, &pixel[SPI_BYTES_PER_COLOR_BYTE * 3]);
+    led_strip_spi_write_pixel(spi_strip, index, pixel);
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_spi_fill(led_strip_t *strip, uint32_t index, uint32_t count, uint32_t red, uint32_t green, uint32_t blue)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    ESP_RETURN_ON_FALSE(index < spi_strip->strip_len && count <= spi_strip->strip_len - index, ESP_ERR_INVALID_ARG, TAG, "range out of maximum number of LEDs");
+    uint32_t pixel_size = spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE;
+    led_strip_spi_set_pixel(strip, index, red, green, blue);
+    led_strip_fill_pattern(spi_strip->pixel_buf + index * pixel_size, pixel_size, count * pixel_size);
+    led_strip_spi_mark_dirty(spi_strip, index + count);
     return ESP_OK;
 }
 
@@ -69,40 +149,80 @@ static esp_err_t led_strip_spi_set_pixel_rgbw(led_strip_t *strip, uint32_t index
     ESP_RETURN_ON_FALSE(index < spi_strip->strip_len, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
     ESP_RETURN_ON_FALSE(spi_strip->bytes_per_pixel == 4, ESP_ERR_INVALID_ARG, TAG, "wrong LED pixel format, expected 4 bytes per pixel");
     // LED_PIXEL_FORMAT_GRBW takes 96bits(12bytes)
-    uint32_t start = index * spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE;
     // SK6812 component order is GRBW
-    memset(spi_strip->pixel_buf + start, 0, spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE);
-    __led_strip_spi_bit(green, &spi_strip->pixel_buf[start]);
-    __led_strip_spi_bit(red, &spi_strip->pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE]);
-    __led_strip_spi_bit(blue, &spi_strip->pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE * 2]);
-    __led_strip_spi_bit(white, &spi_strip->pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE * 3]);
+    uint8_t pixel[4 * SPI_BYTES_PER_COLOR_BYTE];
+    led_strip_spi_encode(green & 0xFF, &pixel[0]);
+    led_strip_spi_encode(red & 0xFF, &pixel[SPI_BYTES_PER_COLOR_BYTE]);
+    led_strip_spi_encode(blue & 0xFF, &pixel[SPI_BYTES_PER_COLOR_BYTE * 2]);
+    led_strip_spi_encode(white & 0xFF, &pixel[SPI_BYTES_PER_COLOR_BYTE * 3]);
+    led_strip_spi_write_pixel(spi_strip, index, pixel);
 
     return ESP_OK;
 }
 
-static esp_err_t led_strip_spi_refresh(led_strip_t *strip)
+static esp_err_t led_strip_spi_refresh_range(led_strip_t *strip, uint32_t pixel_num)
 {
     led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
-    spi_transaction_t tx_conf;
-    memset(&tx_conf, 0, sizeof(tx_conf));
+    pixel_num = led_strip_spi_claim_dirty(spi_strip, pixel_num);
+    if (pixel_num == 0) {
+        return ESP_OK;
+    }
+
+    // The frame goes out as a train of queued DMA transactions. Keeping the queue full means the next chunk is
+    // started from the ISR right after the previous one, a gap far below the reset time of the LEDs
+    uint32_t pixel_size = spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE;
+    uint32_t sent = 0;
+    uint32_t queued = 0;
+    uint32_t done = 0;
+    esp_err_t ret = ESP_OK;
+    while (done < queued || (ret == ESP_OK && sent < pixel_num)) {
+        if (ret == ESP_OK && sent < pixel_num && queued - done < LED_STRIP_SPI_DEFAULT_TRANS_QUEUE_SIZE) {
+            uint32_t len = pixel_num - sent;
+            if (len > LED_STRIP_SPI_TRANS_MAX_PIXELS) {
+                len = LED_STRIP_SPI_TRANS_MAX_PIXELS;
+            }
+            spi_transaction_t *trans = &spi_strip->trans[queued % LED_STRIP_SPI_DEFAULT_TRANS_QUEUE_SIZE];
+            memset(trans, 0, sizeof(spi_transaction_t));
+            trans->length = len * pixel_size * 8;
+            trans->tx_buffer = spi_strip->pixel_buf + sent * pixel_size;
+            ret = spi_device_queue_trans(spi_strip->spi_device, trans, portMAX_DELAY);
+            if (ret != ESP_OK) {
+                ESP_LOGE(TAG, "queue pixels to SPI failed");
+                continue;
+            }
+            sent += len;
+            queued++;
+            continue;
+        }
+        spi_transaction_t *result = NULL;
+        esp_err_t wait_ret = spi_device_get_trans_result(spi_strip->spi_device, &result, portMAX_DELAY);
+        if (wait_ret != ESP_OK) {
+            ESP_LOGE(TAG, "transmit pixels by SPI failed");
+            led_strip_spi_mark_dirty(spi_strip, pixel_num);
+            return wait_ret;
+        }
+        done++;
+    }
+    if (ret != ESP_OK) {
+        led_strip_spi_mark_dirty(spi_strip, pixel_num); // not on the strip, send again with the next refresh
+    }
 
-    tx_conf.length = spi_strip->strip_len * spi_strip->bytes_per_pixel * SPI_BITS_PER_COLOR_BYTE;
-    tx_conf.tx_buffer = spi_strip->pixel_buf;
-    tx_conf.rx_buffer = NULL;
-    ESP_RETURN_ON_ERROR(spi_device_transmit(spi_strip->spi_device, &tx_conf), TAG, "transmit pixels by SPI failed");
+    return ret;
+}
 
-    return ESP_OK;
+static esp_err_t led_strip_spi_refresh(led_strip_t *strip)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    return led_strip_spi_refresh_range(strip, spi_strip->strip_len);
 }
 
 static esp_err_t led_strip_spi_clear(led_strip_t *strip)
 {
     led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
     //Write zero to turn off all leds
-    memset(spi_strip->pixel_buf, 0, spi_strip->strip_len * spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE);
-    uint8_t *buf = spi_strip->pixel_buf;
-    for (int index = 0; index < spi_strip->strip_len * spi_strip->bytes_per_pixel; index++) {
-        __led_strip_spi_bit(0, buf);
-        buf += SPI_BYTES_PER_COLOR_BYTE;
+    if (spi_strip->strip_len) {
+        led_strip_spi_encode(0, spi_strip->pixel_buf);
+        led_strip_fill_pattern(spi_strip->pixel_buf, SPI_BYTES_PER_COLOR_BYTE, spi_strip->strip_len * spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE);
     }
 
     return led_strip_spi_refresh(strip);
@@ -130,9 +250,12 @@ esp_err_t led_strip_new_spi_device(const led_strip_config_t *led_config, const l
         bytes_per_pixel = 4;
     } else if (led_config->led_pixel_format == LED_PIXEL_FORMAT_GRB) {
         bytes_per_pixel = 3;
+    } else if (led_config->led_pixel_format == LED_PIXEL_FORMAT_RGB) {
+        bytes_per_pixel = 3;
     } else {
         assert(false);
     }
+    led_strip_spi_pattern_lut_init();
     uint32_t mem_caps = MALLOC_CAP_DEFAULT;
     if (spi_config->flags.with_dma) {
         // DMA buffer must be placed in internal SRAM
@@ -141,6 +264,7 @@ esp_err_t led_strip_new_spi_device(const led_strip_config_t *led_config, const l
     spi_strip = heap_caps_calloc(1, sizeof(led_strip_spi_obj) + led_config->max_leds * bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE, mem_caps);
 
     ESP_GOTO_ON_FALSE(spi_strip, ESP_ERR_NO_MEM, err, TAG, "no mem for spi strip");
+    portMUX_INITIALIZE(&spi_strip->dirty_lock);
 
     spi_strip->spi_host = spi_config->spi_bus;
     // for backward compatibility, if the user does not set the clk_src, use the default value
@@ -156,7 +280,8 @@ esp_err_t led_strip_new_spi_device(const led_strip_config_t *led_config, const l
         .sclk_io_num = -1,
         .quadwp_io_num = -1,
         .quadhd_io_num = -1,
-        .max_transfer_sz = led_config->max_leds * bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE,
+        // a frame is split into transactions of at most LED_STRIP_SPI_TRANS_MAX_PIXELS, which bounds the DMA descriptors
+        .max_transfer_sz = LED_STRIP_SPI_TRANS_MAX_PIXELS * bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE,
     };
     ESP_GOTO_ON_ERROR(spi_bus_initialize(spi_strip->spi_host, &spi_bus_cfg, spi_config->flags.with_dma ? SPI_DMA_CH_AUTO : SPI_DMA_DISABLED), err, TAG, "create SPI bus failed");
 
@@ -188,10 +313,13 @@ esp_err_t led_strip_new_spi_device(const led_strip_config_t *led_config, const l
                       TAG, "unsupported clock resolution:%dKHz", clock_resolution_khz);
 
     spi_strip->bytes_per_pixel = bytes_per_pixel;
+    spi_strip->pixel_format = led_config->led_pixel_format;
     spi_strip->strip_len = led_config->max_leds;
     spi_strip->base.set_pixel = led_strip_spi_set_pixel;
     spi_strip->base.set_pixel_rgbw = led_strip_spi_set_pixel_rgbw;
+    spi_strip->base.fill = led_strip_spi_fill;
     spi_strip->base.refresh = led_strip_spi_refresh;
+    spi_strip->base.refresh_range = led_strip_spi_refresh_range;
     spi_strip->base.clear = led_strip_spi_clear;
     spi_strip->base.del = led_strip_spi_del;
 
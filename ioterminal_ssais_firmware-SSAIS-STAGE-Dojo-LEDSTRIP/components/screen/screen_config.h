@@ -28,6 +28,7 @@ typedef enum // 屏幕设置页面
     SCREEN_MESSAGE_DIALOG_PAGE,         // 消息对话框界面
     SCREEN_CHECK_DIALOG_PAGE,           // 重启对话框界面
     SCREEN_OTA_DIALOG_PAGE,             // OTA对话框界面
+    SCREEN_METRICS_INFO_PAGE,           // 运行指标界面
     SCREEN_SET_PAGE_MAX,                // 系统设置页面最大值
 } screenSystemSetPage_t;
 
@@ -181,6 +182,17 @@ typedef enum // 屏幕设置页面
 #define SCREEN_OTA_DAILOG_INFO_TEXT 8
 #define SCREEN_OTA_DAILOG_PROGRESS 3
 
+// 运行指标界面
+#define SCREEN_METRICS_RECV_QUEUE_TEXT 2  // MQTT接收队列 当前/最高
+#define SCREEN_METRICS_PUB_QUEUE_TEXT 3   // MQTT发送队列 当前/最高
+#define SCREEN_METRICS_BOX_QUEUE_TEXT 4   // 库位数据队列 当前/最高
+#define SCREEN_METRICS_SCREEN_RING_TEXT 5 // 串口屏缓冲区 当前/最高
+#define SCREEN_METRICS_CMD_TEXT 6         // MQTT命令 成功/失败/丢弃
+#define SCREEN_METRICS_CMD_LATENCY_TEXT 7 // MQTT命令耗时 p50/p99
+#define SCREEN_METRICS_FRAME_TIME_TEXT 8  // 灯效帧耗时 p50/p99
+#define SCREEN_METRICS_HEAP_TEXT 9        // 内部RAM/PSRAM剩余
+#define SCREEN_METRICS_RESET_BUTTON 10    // 重置统计窗口
+
 // 通知类型
 #define NOTIFY_TOUCH_PRESS 0X01       // 触摸屏按下通知
 #define NOTIFY_TOUCH_RELEASE 0X03     // 触摸屏松开通知
@@ -13,6 +13,7 @@
 #include "sdkconfig.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "trace.h"
 
 #define TX_8(P1) SEND_DATA((P1)&0xFF)        //发送单个字节
 #define TX_8N(P, N) SendNU8((uint8_t *)P, N) //发送N个字节
@@ -94,6 +95,7 @@ void END_CMD()
     uint16_t crc16 = _crc16;
     TX_16(crc16); //发送CRC16
     TX_32(0XFFFCFFFF);
+    TRACE_EMIT(TRACE_EVENT_SCREEN_FRAME_OUT, 0, 0);
 }
 
 #else                               // NO CRC16
@@ -101,7 +103,12 @@ void END_CMD()
 extern void sendChar(uint8_t t);
 #define SEND_DATA(P) sendChar(P)    //发送一个字节
 #define BEGIN_CMD() TX_8(0XEE)      //帧头
-#define END_CMD() TX_32(0XFFFCFFFF) //帧尾
+#define END_CMD()                                       \
+    do                                                  \
+    {                                                   \
+        TX_32(0XFFFCFFFF);                              \
+        TRACE_EMIT(TRACE_EVENT_SCREEN_FRAME_OUT, 0, 0); \
+    } while (0) //帧尾
 
 #endif
 
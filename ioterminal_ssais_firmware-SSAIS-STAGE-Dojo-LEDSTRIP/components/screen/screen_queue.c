@@ -69,6 +69,14 @@ static qsize queue_size()
 {
     return ((que._head + QUEUE_MAX_SIZE - que._tail) % QUEUE_MAX_SIZE);
 }
+
+/*!
+ *  \brief  获取指令队列中未处理的字节数
+ */
+qsize queue_get_size(void)
+{
+    return queue_size();
+}
 /*!
  *  \brief  从指令队列中取出一条完整的指令
  *  \param  cmd 指令接收缓存区
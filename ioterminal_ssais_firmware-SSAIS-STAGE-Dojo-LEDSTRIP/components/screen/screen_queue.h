@@ -33,4 +33,9 @@ extern void queue_push(qdata _data);
  */
 extern qsize queue_find_cmd(qdata *cmd, qsize buf_len);
 
+/*!
+ *  \brief  获取指令队列中未处理的字节数
+ */
+extern qsize queue_get_size(void);
+
 #endif
\ No newline at end of file
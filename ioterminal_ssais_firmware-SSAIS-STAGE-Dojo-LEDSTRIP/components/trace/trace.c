@@ -0,0 +1,200 @@
+/**
+ * @file trace.c
+ * @brief 二进制事件跟踪环形缓冲区
+ * @version 1.0
+ * @date 2024-06-12
+ *
+ * @copyright Copyright (c) 2024  雅马哈发动机（厦门）信息系统有限公司
+ *
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "trace.h"
+
+static const char *TAG = "TRACE";
+
+#if CONFIG_TRACE_ENABLE
+
+_Static_assert((CONFIG_TRACE_RING_RECORDS & (CONFIG_TRACE_RING_RECORDS - 1)) == 0, "CONFIG_TRACE_RING_RECORDS must be a power of two");
+
+trace_record_t *g_trace_ring = NULL;
+uint32_t g_trace_head = 0;
+volatile bool g_trace_enabled = false;
+
+esp_err_t trace_init(void)
+{
+    if (g_trace_ring != NULL)
+    {
+        return ESP_OK;
+    }
+    g_trace_ring = heap_caps_calloc(CONFIG_TRACE_RING_RECORDS, sizeof(trace_record_t), MALLOC_CAP_SPIRAM);
+    if (g_trace_ring == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to allocate trace ring (%d records)", CONFIG_TRACE_RING_RECORDS);
+        return ESP_ERR_NO_MEM;
+    }
+    g_trace_head = 0;
+    g_trace_enabled = true;
+    ESP_LOGI(TAG, "Trace ring ready, %d records", CONFIG_TRACE_RING_RECORDS);
+    return ESP_OK;
+}
+
+void trace_clear(void)
+{
+    bool enabled = g_trace_enabled;
+    g_trace_enabled = false;
+    g_trace_head = 0;
+    if (g_trace_ring != NULL)
+    {
+        memset(g_trace_ring, 0, CONFIG_TRACE_RING_RECORDS * sizeof(trace_record_t));
+    }
+    g_trace_enabled = enabled;
+}
+
+/**
+ * @brief  获取全部任务的状态, 任务表按当前任务数量分配(PSRAM)
+ *         获取期间新建的任务超出余量时 uxTaskGetSystemState 返回0, 重新按新的任务数量获取
+ * @param  task_count   输出任务数量
+ * @return TaskStatus_t* 任务表, 失败时返回NULL
+ */
+static TaskStatus_t *trace_task_status_get(uint32_t *task_count)
+{
+    *task_count = 0;
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+    for (int retry = 0; retry < TRACE_DUMP_TASK_RETRY; retry++)
+    {
+        UBaseType_t capacity = uxTaskGetNumberOfTasks() + TRACE_DUMP_TASK_SLACK;
+        TaskStatus_t *task_status = heap_caps_malloc(capacity * sizeof(TaskStatus_t), MALLOC_CAP_SPIRAM);
+        if (task_status == NULL)
+        {
+            ESP_LOGW(TAG, "No memory for task table, %d tasks not exported", (int)capacity);
+            return NULL;
+        }
+        *task_count = uxTaskGetSystemState(task_status, capacity, NULL);
+        if (*task_count != 0)
+        {
+            return task_status;
+        }
+        free(task_status);
+    }
+    ESP_LOGW(TAG, "Task count keeps changing, task table not exported");
+#endif
+    return NULL;
+}
+
+/**
+ * @brief  生成导出数据流的文件头与任务表
+ * @param  record_count
+ * @param  header_len   输出文件头长度
+ * @return uint8_t* 文件头(PSRAM), 失败时返回NULL
+ */
+static uint8_t *trace_dump_header(uint32_t record_count, size_t *header_len)
+{
+    uint32_t task_count = 0;
+    TaskStatus_t *task_status = trace_task_status_get(&task_count);
+    uint8_t *header = heap_caps_malloc(12 + task_count * (4 + TRACE_TASK_NAME_LEN), MALLOC_CAP_SPIRAM);
+    if (header == NULL)
+    {
+        free(task_status);
+        return NULL;
+    }
+    size_t len = 12;
+    for (uint32_t i = 0; i < task_count; i++)
+    {
+        uint32_t handle = (uint32_t)(uintptr_t)task_status[i].xHandle;
+        memcpy(&header[len], &handle, sizeof(handle));
+        memset(&header[len + 4], 0, TRACE_TASK_NAME_LEN);
+        strncpy((char *)&header[len + 4], task_status[i].pcTaskName, TRACE_TASK_NAME_LEN - 1);
+        len += 4 + TRACE_TASK_NAME_LEN;
+    }
+    free(task_status);
+    memcpy(&header[0], TRACE_DUMP_MAGIC, 4);
+    memcpy(&header[4], &record_count, sizeof(record_count));
+    memcpy(&header[8], &task_count, sizeof(task_count));
+    *header_len = len;
+    return header;
+}
+
+esp_err_t trace_dump(size_t chunk_size, trace_dump_cb_t cb, void *ctx)
+{
+    if (g_trace_ring == NULL || cb == NULL || chunk_size == 0)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint8_t *chunk = heap_caps_malloc(chunk_size, MALLOC_CAP_SPIRAM);
+    if (chunk == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    bool enabled = g_trace_enabled;
+    g_trace_enabled = false; // 导出期间暂停记录, 保证快照一致
+    vTaskDelay(1);           // 等待其他核心上正在写入的记录完成
+    uint32_t head = g_trace_head;
+    uint32_t record_count = head < CONFIG_TRACE_RING_RECORDS ? head : CONFIG_TRACE_RING_RECORDS;
+    uint32_t first = head - record_count;
+    size_t header_len = 0;
+    uint8_t *header = trace_dump_header(record_count, &header_len);
+    if (header == NULL)
+    {
+        g_trace_enabled = enabled;
+        free(chunk);
+        return ESP_ERR_NO_MEM;
+    }
+    size_t total = header_len + record_count * sizeof(trace_record_t);
+
+    esp_err_t err = ESP_OK;
+    size_t offset = 0;
+    while (offset < total && err == ESP_OK)
+    {
+        size_t len = 0;
+        while (len < chunk_size && offset + len < total)
+        {
+            size_t pos = offset + len;
+            size_t copy;
+            if (pos < header_len)
+            {
+                copy = header_len - pos;
+                copy = copy < chunk_size - len ? copy : chunk_size - len;
+                memcpy(&chunk[len], &header[pos], copy);
+            }
+            else
+            {
+                size_t record_pos = pos - header_len;
+                uint32_t index = (first + record_pos / sizeof(trace_record_t)) & (CONFIG_TRACE_RING_RECORDS - 1);
+                size_t byte = record_pos % sizeof(trace_record_t);
+                copy = sizeof(trace_record_t) - byte;
+                copy = copy < chunk_size - len ? copy : chunk_size - len;
+                memcpy(&chunk[len], (uint8_t *)&g_trace_ring[index] + byte, copy);
+            }
+            len += copy;
+        }
+        err = cb(chunk, len, offset, total, ctx);
+        offset += len;
+    }
+    g_trace_enabled = enabled;
+    free(header);
+    free(chunk);
+    return err;
+}
+
+#else
+
+esp_err_t trace_init(void)
+{
+    return ESP_OK;
+}
+
+void trace_clear(void)
+{
+}
+
+esp_err_t trace_dump(size_t chunk_size, trace_dump_cb_t cb, void *ctx)
+{
+    ESP_LOGW(TAG, "Trace is disabled in menuconfig");
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif
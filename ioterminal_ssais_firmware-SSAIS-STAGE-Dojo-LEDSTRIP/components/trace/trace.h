@@ -0,0 +1,136 @@
+/**
+ * @file trace.h
+ * @brief 二进制事件跟踪环形缓冲区
+ * @version 1.0
+ * @date 2024-06-12
+ *
+ * @copyright Copyright (c) 2024  雅马哈发动机（厦门）信息系统有限公司
+ *
+ */
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define TRACE_DUMP_MAGIC "TRC1"   ///< 导出数据流的文件头标识
+#define TRACE_TASK_NAME_LEN 16    ///< 导出任务表中的任务名长度
+#define TRACE_DUMP_TASK_SLACK 4   ///< 按当前任务数量分配任务表时预留的余量(获取期间新建的任务)
+#define TRACE_DUMP_TASK_RETRY 3   ///< 新建任务超出余量时重新获取任务表的次数
+
+/**
+ * @brief 跟踪事件ID, 与 tools/trace_to_chrome.py 中的定义保持一致
+ */
+typedef enum
+{
+    TRACE_EVENT_NONE = 0,
+    TRACE_EVENT_MQTT_RECV,             // 收到MQTT消息 arg0:长度
+    TRACE_EVENT_MQTT_DISPATCH_BEGIN,   // MQTT命令处理开始 arg0:control_type arg1:cmd_type
+    TRACE_EVENT_MQTT_DISPATCH_END,     // MQTT命令处理结束 arg0:control_type arg1:esp_err_t
+    TRACE_EVENT_ORDER_STATE,           // 订单状态变化 arg0:trace_order_state_t arg1:订单号
+    TRACE_EVENT_STRIP_REFRESH_BEGIN,   // 灯带刷新开始
+    TRACE_EVENT_STRIP_REFRESH_END,     // 灯带提交一帧结束 arg1:持锁耗时(微秒), 发送在后台进行
+    TRACE_EVENT_SCREEN_FRAME_IN,       // 收到串口屏指令帧 arg0:长度 arg1:指令类型
+    TRACE_EVENT_SCREEN_FRAME_OUT,      // 向串口屏发送指令帧
+    TRACE_EVENT_SCREEN_TOUCH,          // 串口屏控件触发处理 arg0:画面ID arg1:控件ID
+    TRACE_EVENT_MAX,
+} trace_event_id_t;
+
+/**
+ * @brief TRACE_EVENT_ORDER_STATE 的状态参数
+ */
+typedef enum
+{
+    TRACE_ORDER_ADDED = 1, // 新订单
+    TRACE_ORDER_COMPLETED, // 订单取货完成
+    TRACE_ORDER_KILLED,    // 订单被结束
+    TRACE_ORDER_DROPPED,   // 订单数据错误被删除
+    TRACE_ORDER_CLEARED,   // 全部订单被清除
+} trace_order_state_t;
+
+/**
+ * @brief 跟踪记录, 16字节
+ */
+typedef struct
+{
+    uint32_t timestamp; // esp_timer 微秒(低32位)
+    uint32_t task;      // 任务句柄
+    uint16_t event;     // trace_event_id_t
+    uint16_t arg0;
+    uint32_t arg1;
+} trace_record_t;
+
+/**
+ * @brief  导出数据回调
+ * @param  data     导出数据
+ * @param  len      数据长度
+ * @param  offset   该段数据在整个导出数据流中的偏移
+ * @param  total    整个导出数据流的长度
+ * @param  ctx      用户参数
+ * @return esp_err_t 返回错误时停止导出
+ */
+typedef esp_err_t (*trace_dump_cb_t)(const uint8_t *data, size_t len, size_t offset, size_t total, void *ctx);
+
+#if CONFIG_TRACE_ENABLE
+
+extern trace_record_t *g_trace_ring;
+extern uint32_t g_trace_head;
+extern volatile bool g_trace_enabled;
+
+/**
+ * @brief  写入一条跟踪记录(无锁, 可在任意任务中调用)
+ * @param  event
+ * @param  arg0
+ * @param  arg1
+ */
+static inline void trace_emit(uint16_t event, uint16_t arg0, uint32_t arg1)
+{
+    if (!g_trace_enabled)
+    {
+        return;
+    }
+    uint32_t index = __atomic_fetch_add(&g_trace_head, 1, __ATOMIC_RELAXED) & (CONFIG_TRACE_RING_RECORDS - 1);
+    trace_record_t *record = &g_trace_ring[index];
+    record->timestamp = (uint32_t)esp_timer_get_time();
+    record->task = (uint32_t)(uintptr_t)xTaskGetCurrentTaskHandle();
+    record->event = event;
+    record->arg0 = arg0;
+    record->arg1 = arg1;
+}
+
+#define TRACE_EMIT(event, arg0, arg1) trace_emit((event), (uint16_t)(arg0), (uint32_t)(arg1))
+
+#else
+
+#define TRACE_EMIT(event, arg0, arg1) ((void)0)
+
+#endif
+
+/**
+ * @brief  初始化跟踪环形缓冲区(PSRAM)
+ * @return esp_err_t
+ */
+esp_err_t trace_init(void);
+
+/**
+ * @brief  清空跟踪记录
+ */
+void trace_clear(void);
+
+/**
+ * @brief  导出跟踪记录, 导出期间暂停记录
+ *         数据流: "TRC1" | 记录数(u32) | 任务数(u32) | 任务表{句柄(u32), 名称[16]} | 记录(从旧到新)
+ * @param  chunk_size   每次回调的最大字节数
+ * @param  cb
+ * @param  ctx
+ * @return esp_err_t
+ */
+esp_err_t trace_dump(size_t chunk_size, trace_dump_cb_t cb, void *ctx);
+
+#endif // _TRACE_H_
@@ -14,15 +14,27 @@
 #include "data_type.h"
 
 #define LED_STRIP_INDICATION_MAX_ORDER_BOX_SIZE 256          ///< 灯带亮灯指示一次订单下发能承载的最大物料
-#define LED_STRIP_INDICATION_MAX_ORDERS 4                    ///< 灯带多订单指示 最大支持订单数量
+#define LED_STRIP_INDICATION_MAX_ORDERS 32                   ///< 灯带多订单指示 最大支持订单数量(不超过127)
+#define LED_STRIP_INDICATION_ORDER_BUCKETS 64                ///< 订单名哈希桶数量(2的幂)
+#define LED_STRIP_INDICATION_OWNER_POOL_SIZE 2048            ///< 所有库位共享的订单占用信息数量(PSRAM)
+#define LED_STRIP_OWNER_NONE 0xFFFF                          ///< 占用信息链表结束
 #define LED_STRIP_INDICATION_ORDER_STR_MAXSIZE 32            ///< 订单字符串最大值
 #define LED_STRIP_INDICATION_STORAGE_LOCATION_STR_MAXSIZE 32 ///< 灯带库位字符串最大值
-#define LED_STRIP_INDICATION_BOX_LIST_ITEM_SIZE 4            ///< 灯带库位数据负载的长度  [ 库位,起始灯珠,结尾灯珠,灭灯寿命 ]
+#define LED_STRIP_INDICATION_BOX_LIST_ITEM_SIZE 4            ///< 灯带库位数据负载的长度  [ 库位,起始灯珠,结尾灯珠,灭灯寿命 ], 批量下发时可追加颜色
+#define LED_STRIP_PICKUP_LIST_ITEM_SIZE 3                    ///< 批量取货完成数据负载的长度  [ 订单,库位,取物次数 ]
 
 #define LED_STRIP_INDICATION_LED_LOCATE_TIMEOUT 3000 ///< 灯珠定位的时候显示残留的时间 （毫秒）
 #define LED_STRIP_BOX_LOCATION_CHECK_LIST_ITEM_SIZE 2 ///< LED_BOX_LOCATION_CHECK库位数据负载的长度  [起始灯珠,结尾灯珠]
 #define LED_STRIP_BOX_LOCATION_CHECK_TIMEOUT 20000 ///< 亮灯库位确认时候显示残留的时间（毫秒）
 
+#define PICK_WAVE_BENCHMARK_DEFAULT_BOX_NUM 256         ///< 拣货波次性能测试默认库位数量
+#define PICK_WAVE_BENCHMARK_DEFAULT_ORDER_NUM 4         ///< 拣货波次性能测试默认订单数量
+#define PICK_WAVE_BENCHMARK_MAX_BOXES_PER_ORDER 128     ///< 单条下发订单命令最多携带的库位（受MQTT_RECEIVE_DATA_MAX_LEN限制）
+#define PICK_WAVE_BENCHMARK_RENDER_TIMEOUT 2000         ///< 等待灯带指示任务完成一次处理的超时时间（毫秒）
+#define PICK_WAVE_BENCHMARK_MSG_MAX_LEN 768             ///< 测试结果消息最大长度
+#define PICK_WAVE_BENCHMARK_REFRESH_ROUNDS 20           ///< 全部订单亮灯后整条灯带刷新的测量次数
+#define PICK_WAVE_BENCHMARK_TASK_STACK_SIZE 16384      ///< 性能测试任务栈大小(与MQTT任务相同, 命令在测试任务中执行)
+
 /**
  * @brief 订单对库位的占用信息
  */
@@ -30,26 +42,37 @@ typedef struct _orderBoxInfo
 {
     uint16_t orderNo;         // 订单到达顺序
     uint16_t takeTimes;       // 库位取物次数
-    uint16_t ownerStartLedId; // 订单占用的起始灯珠
+    uint16_t ownerStartLedId; // 订单占用的起始灯珠, 0表示未分配(库位的订单多于灯珠,等待前面的订单完成)
     uint16_t ownerEndLedId;   // 订单占用的起始灯珠
-    uint32_t color;           // 指示颜色
+    uint32_t color;           // 指示颜色, 下发订单时已按亮度换算为直接写入灯带的RGB
+    uint16_t next;            // 同一库位的下一个订单(按到达顺序), 空闲时为空闲链表的下一项
+    uint8_t orderSlot;        // 订单在订单表中的位置
 } OrderBoxInfo_t;
 
 /**
  * @brief 库位的基础数据
+ *        库位的订单占用信息保存在g_ledStripOwnerPool中, 按订单到达顺序链接
  */
 typedef struct _BoxData
 {
     char storageLocation[LED_STRIP_INDICATION_STORAGE_LOCATION_STR_MAXSIZE];
     uint16_t startLedId;
     uint16_t endLedId;
-    bool isBoxOrderChanged;                                       // 用户数据是否发生变化
-    OrderBoxInfo_t orderBoxInfo[LED_STRIP_INDICATION_MAX_ORDERS]; // 库位的订单数据
+    bool isBoxOrderChanged; // 用户数据是否发生变化
+    uint8_t ownerCount;     // 占用库位的订单数量
+    uint16_t ownerHead;     // 第一个占用库位的订单, LED_STRIP_OWNER_NONE表示无
 } BoxData_t;
 
 extern QueueHandle_t g_ledStripBoxDataQueueHandler;
 extern SemaphoreHandle_t g_ledStripBoxDataSemphHandle;
+extern SemaphoreHandle_t g_ledStripOrderMutexHandle;
+extern OrderBoxInfo_t *g_ledStripOwnerPool;
+extern esp_err_t ledStripOrderTableInit();
 extern esp_err_t queryResiduesOrder();
 extern esp_err_t ledStripKillAllOrder();
+extern uint8_t getExecutingOrderCount();
+extern uint32_t getLedStripIndicationPassCount();
+extern esp_err_t pickWaveBenchmarkRun(cJSON *data);
+extern bool pickWaveBenchmarkBusy(void);
 
 #endif //_BUSINESS_H_
\ No newline at end of file
@@ -32,11 +32,13 @@
 #include "esp_eth_mac.h"
 #include "esp_sntp.h"
 #include "esp_https_ota.h"
+#include "esp_timer.h"
 // RTOS
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
 #include "freertos/event_groups.h"
+#include "freertos/ringbuf.h"
 #include <sys/time.h>
 // Network
 #include <sys/socket.h>
@@ -74,6 +76,10 @@
 #include "data_type.h"
 #include "business.h"
 #include "mqtt_cmd_type.h"
+#include "metrics.h"
+#include "trace.h"
+#include "json_writer.h"
+#include "cbor_decode.h"
 
 // 宏定义
 #define FIRMWARE_VERSION "V0.0.2" // 固件版本名
@@ -26,10 +26,10 @@
 #define MAX_CONFIG_LEN 2048
 // MQTT CONFIG
 #define MQTT_RECEIVE_QUEUE_LEN 24 // Mqtt 接收数据队列长度
-#define MQTT_PUBISH_QUEUE_LEN 10  // Mqtt 发送数据队列长度
+#define MQTT_PUBLISH_BEST_EFFORT_RING_SIZE (16 * 1024) // Mqtt 尽力发送通道环形缓冲区字节数(PSRAM),内联消息最大约为其一半
+#define MQTT_PUBLISH_CHUNK_SIZE (8 * 1024) // 超过该长度的外部数据分段发布到 发布主题/chunk/<编号>/<段号>/<段数>
 #define MQTT_TOPIC_MAX_LEN 128
 #define MQTT_RECEIVE_DATA_MAX_LEN 4096
-#define MQTT_PUBLISH_DATA_MAX_LEN 1024
 
 typedef enum
 {
@@ -77,13 +77,25 @@ typedef struct _MqttReceiveData
     uint8_t topicLen;
     char topic[MQTT_TOPIC_MAX_LEN];
     uint16_t dataLen;
+    uint8_t format; // MqttWireFormat_t, 由接收主题决定
     char data[MQTT_RECEIVE_DATA_MAX_LEN];
 } MqttReceiveData_t;
-typedef struct _MqttPublishData
+// MQTT发送通道
+typedef enum
 {
-    uint16_t dataLen;
-    char data[MQTT_PUBLISH_DATA_MAX_LEN];
-} MqttPublishData_t;
+    MQTT_PUB_LANE_CRITICAL = 0, // 关键消息(业务命令回显与业务上报),断线期间保存,重连后按序限速补发
+    MQTT_PUB_LANE_BEST_EFFORT,  // 尽力发送的状态消息,缓冲区满时丢弃最旧的消息
+    MQTT_PUB_LANE_MAX,
+} MqttPubLane_t;
+typedef struct _MqttPubRecord
+{
+    int64_t enqueueTime; // 入队时间(微秒),用于统计发布延迟
+    uint32_t dataLen;
+    char *extData; // 非NULL时数据位于外部缓冲区,由MQTT任务发送完成后释放
+    uint32_t journalSeq; // 关键消息在Flash日志中的序号,0表示未写入日志
+    uint8_t flags;       // MQTT_PUB_FLAG_*
+    char data[];         // 内联数据(extData为NULL时有效)
+} MqttPubRecord_t;
 typedef struct _DioInputData
 {
     uint8_t inputPort; // 输入口
@@ -11,16 +11,10 @@
 #define _LEDSTRIP_H_
 
 #include "common.h"
+#include "ledstrip_color.h"
+#include "metrics.h"
 
-#define LEDSTRIP_REFRESH                                                       \
-    do                                                                         \
-    {                                                                          \
-        if (xSemaphoreTake(g_ledstripRmtHandleMetex, portMAX_DELAY) == pdTRUE) \
-        {                                                                      \
-            led_strip_refresh(g_ledstripRmtHandle);                            \
-            xSemaphoreGive(g_ledstripRmtHandleMetex);                          \
-        }                                                                      \
-    } while (0)
+#define LEDSTRIP_REFRESH ledStripRefreshRequest() // 由渲染任务提交, 不等待发送
 
 #define LEDSTRIP_CLEAR                                                         \
     do                                                                         \
@@ -33,5 +27,7 @@
     } while (0)
 
 extern led_strip_handle_t LedStripInit(LedstripConfigData_t ledstripConfigData);
+extern void ledStripRefreshRequest(void);
+extern esp_err_t ledStripRefreshFlush(uint32_t timeoutMs);
 
 #endif // _LEDSTRIP_H_
\ No newline at end of file
@@ -0,0 +1,22 @@
+/**
+ * @file ledstrip_color.h
+ * @brief 灯带颜色亮度换算头文件(不依赖ESP-IDF,可在主机上编译)
+ * @version 1.0
+ * @date 2024-07-08
+ *
+ * @copyright Copyright (c) 2024  雅马哈发动机（厦门）信息系统有限公司
+ *
+ */
+#ifndef _LEDSTRIP_COLOR_H_
+#define _LEDSTRIP_COLOR_H_
+
+#include <stdint.h>
+
+#define LEDSTRIP_COLOR_RED(color) (((color) >> 16) & 0xFF)  ///< 0xRRGGBB 取红色分量
+#define LEDSTRIP_COLOR_GREEN(color) (((color) >> 8) & 0xFF) ///< 0xRRGGBB 取绿色分量
+#define LEDSTRIP_COLOR_BLUE(color) ((color) & 0xFF)         ///< 0xRRGGBB 取蓝色分量
+
+extern void ledStripColorLutInit(void);
+extern uint32_t ledStripColorScale(uint32_t color, uint8_t brightness);
+
+#endif // _LEDSTRIP_COLOR_H_
@@ -12,8 +12,10 @@
 #define LED_STRIP_EFFECT_MANAGER_H
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <esp_err.h>
 #include "cJSON.h"
+#include "ledstrip_timeline.h"
 
 /**
  * @brief 灯带效果类型枚举
@@ -32,9 +34,19 @@ typedef enum
     LED_EFFECT_RANDOM_TWINKLE, // 顺序跑马闪烁颜色
     LED_EFFECT_RANDOM_TWINKLE2, // 顺序跑马随机切换颜色
     LED_EFFECT_COMET,          // 彗星
+    LED_EFFECT_SEQUENCE,       // 顺序点亮(按时间逐个累加, 全部点亮后结束)
+    LED_EFFECT_TIMELINE,       // 关键帧时间线(上传后在设备上按时间执行)
     LED_EFFECT_MAX
 } led_strip_effect_type_t;
 
+#define LED_SEQUENCE_DEFAULT_LEDS_PER_SEC 100 // 未指定速度时顺序点亮的速度(灯珠/秒)
+
+/**
+ * @brief 效果结束回调
+ * @param completed true: 效果按设定完成; false: 被停止或被新的效果替换
+ */
+typedef void (*led_strip_effect_end_cb_t)(bool completed);
+
 /**
  * @brief 灯带效果参数结构体
  */
@@ -48,11 +60,15 @@ typedef struct
     uint32_t color2;                     // 辅助颜色(用于渐变等效果)
     uint16_t speed;                      // 速度(毫秒)
     uint8_t cycles;                      // 循环次数(0表示无限循环)
+    float leds_per_sec;                  // 顺序点亮速度(灯珠/秒)
+    const LedStripTimeline_t *timeline;  // 编译后的时间线(仅关键帧时间线), 启动时拷贝
+    uint16_t crossfade_ms;               // 从正在运行的效果交叉渐变到本效果的时间(毫秒), 0表示直接切换
+    led_strip_effect_end_cb_t end_cb;    // 效果结束回调(可为NULL), 在效果任务或停止效果的任务中执行
 } led_strip_effect_params_t;
 
 /**
  * @brief 运行灯带效果
- * 只支持一个效果，如果有效果正在运行，将会停止并释放旧效果
+ * 只支持一个效果，如果有效果正在运行，在下一帧切换到新效果(可交叉渐变)，效果任务常驻不重建
  *
  * @param params 效果参数
  * @return esp_err_t
@@ -60,9 +76,18 @@ typedef struct
 esp_err_t led_strip_effect_run(const led_strip_effect_params_t *params);
 
 /**
- * @brief 停止当前正在运行的灯带效果
+ * @brief 检查效果参数是否有效(灯珠范围、速度等), 不启动效果
+ * 调用者需要在启动效果前改变其他状态(如清空订单)时先检查
  *
- * @return esp_err_t
+ * @param params 效果参数
+ * @return esp_err_t 参数无效返回ESP_ERR_INVALID_ARG
+ */
+esp_err_t led_strip_effect_check(const led_strip_effect_params_t *params);
+
+/**
+ * @brief 停止当前正在运行的灯带效果, 等待效果任务清空灯带
+ *
+ * @return esp_err_t 等待效果任务超时返回ESP_ERR_TIMEOUT, 此时调用者不应绘制灯带
  */
 esp_err_t led_strip_effect_stop(void);
 
@@ -81,6 +106,13 @@ bool led_strip_effect_is_running(void);
  */
 esp_err_t ledEffect(cJSON *data);
 
+/**
+ * @brief 上传并执行关键帧时间线
+ * param data cJSON数据对象
+ * @return esp_err_t
+ */
+esp_err_t ledTimeline(cJSON *data);
+
 /**
  * @brief 灯带顺序跑马 携带颜色和亮度
  * param data cJSON数据对象
@@ -0,0 +1,104 @@
+/**
+ * @file ledstrip_timeline.h
+ * @brief 灯带关键帧时间线头文件(不依赖ESP-IDF,可在主机上编译)
+ * @version 1.0
+ * @date 2024-07-22
+ *
+ * @copyright Copyright (c) 2024  雅马哈发动机（厦门）信息系统有限公司
+ *
+ */
+#ifndef _LEDSTRIP_TIMELINE_H_
+#define _LEDSTRIP_TIMELINE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define LEDSTRIP_TIMELINE_MAX_KEYFRAMES 64        ///< 一条时间线最多的关键帧数量
+#define LEDSTRIP_TIMELINE_DEFAULT_BLINK_PERIOD 500 ///< 闪烁未指定周期时的默认周期(毫秒)
+
+/**
+ * @brief 关键帧效果
+ */
+typedef enum
+{
+    LEDSTRIP_TIMELINE_EFFECT_SOLID = 0, // 常亮
+    LEDSTRIP_TIMELINE_EFFECT_FADE,      // 从同一段上一个关键帧的颜色(没有则为灭)渐变到本帧颜色
+    LEDSTRIP_TIMELINE_EFFECT_WIPE,      // 从起始灯珠逐颗点亮到结尾灯珠
+    LEDSTRIP_TIMELINE_EFFECT_BLINK,     // 按周期闪烁
+    LEDSTRIP_TIMELINE_EFFECT_MAX,
+} LedStripTimelineEffect_t;
+
+/**
+ * @brief 缓动曲线(渐变与逐颗点亮的进度)
+ */
+typedef enum
+{
+    LEDSTRIP_TIMELINE_EASING_LINEAR = 0, // 匀速
+    LEDSTRIP_TIMELINE_EASING_IN,         // 先慢后快
+    LEDSTRIP_TIMELINE_EASING_OUT,        // 先快后慢
+    LEDSTRIP_TIMELINE_EASING_IN_OUT,     // 两头慢中间快
+    LEDSTRIP_TIMELINE_EASING_MAX,
+} LedStripTimelineEasing_t;
+
+/**
+ * @brief 编译结果
+ */
+typedef enum
+{
+    LEDSTRIP_TIMELINE_OK = 0,
+    LEDSTRIP_TIMELINE_ERR_SIZE,     // 没有关键帧或超过最大数量
+    LEDSTRIP_TIMELINE_ERR_RANGE,    // 灯珠范围错误
+    LEDSTRIP_TIMELINE_ERR_EFFECT,   // 效果或缓动曲线不支持
+    LEDSTRIP_TIMELINE_ERR_DURATION, // 持续时间为0或时间溢出
+} LedStripTimelineResult_t;
+
+/**
+ * @brief 关键帧(上传格式)
+ */
+typedef struct _LedStripKeyframe
+{
+    uint32_t atMs;       // 开始时间(毫秒, 相对时间线开始)
+    uint32_t durationMs; // 持续时间(毫秒)
+    uint16_t startLed;   // 起始灯珠, 从1开始
+    uint16_t endLed;     // 结尾灯珠
+    uint32_t color;      // 0xRRGGBB
+    uint8_t effect;      // LedStripTimelineEffect_t
+    uint8_t easing;      // LedStripTimelineEasing_t
+    uint16_t periodMs;   // 闪烁周期(毫秒), 0使用默认值
+} LedStripKeyframe_t;
+
+/**
+ * @brief 指令(编译后的关键帧, 按开始时间排序, 颜色已按亮度换算)
+ */
+typedef struct _LedStripTimelineInstr
+{
+    uint32_t startMs;
+    uint32_t endMs;
+    uint16_t index; // 起始灯珠, 从0开始
+    uint16_t count;
+    uint16_t periodMs;
+    uint8_t effect;
+    uint8_t easing;
+    uint8_t from[3]; // 渐变起始颜色 R,G,B
+    uint8_t to[3];   // 目标颜色 R,G,B
+} LedStripTimelineInstr_t;
+
+typedef struct _LedStripTimeline
+{
+    LedStripTimelineInstr_t instr[LEDSTRIP_TIMELINE_MAX_KEYFRAMES];
+    uint16_t instrNum;
+    uint8_t loop;      // 播放次数, 0表示无限循环
+    uint32_t lengthMs; // 一轮的时长(最后一个关键帧结束的时间)
+} LedStripTimeline_t;
+
+/**
+ * @brief 写入一段连续灯珠(0基索引)
+ */
+typedef void (*LedStripTimelineFill_t)(void *ctx, uint16_t index, uint16_t count, uint8_t red, uint8_t green, uint8_t blue);
+
+extern LedStripTimelineResult_t ledStripTimelineCompile(const LedStripKeyframe_t *keyframe, size_t keyframeNum, uint16_t ledNum,
+                                                        uint8_t brightness, uint8_t loop, LedStripTimeline_t *timeline, size_t *errIndex);
+extern bool ledStripTimelineRender(const LedStripTimeline_t *timeline, uint32_t elapsedMs, LedStripTimelineFill_t fill, void *ctx);
+
+#endif // _LEDSTRIP_TIMELINE_H_
@@ -0,0 +1,178 @@
+/**
+ * @file metrics.h
+ * @brief 运行指标统计头文件
+ * @version 1.0
+ * @date 2024-06-05
+ *
+ * @copyright Copyright (c) 2024  雅马哈发动机（厦门）信息系统有限公司
+ *
+ */
+#ifndef _METRICS_H_
+#define _METRICS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "json_writer.h"
+
+#define METRICS_HISTOGRAM_BUCKETS 20 ///< 直方图桶数量, 第n个桶统计[2^(n-1), 2^n)微秒, 最后一个桶统计剩余所有
+#define METRICS_TASK_MAX_NUM 24      ///< CPU占用统计最多记录的任务数量
+#define METRICS_TELEMETRY_TOPIC_SUFFIX "/telemetry" ///< 遥测主题 = 发布主题 + 后缀
+#define METRICS_SNAPSHOT_MAX_LEN 2048               ///< 遥测快照的最大长度
+
+/**
+ * @brief 计数器(单调递增)
+ */
+typedef enum
+{
+    METRICS_COUNTER_MQTT_CMD_OK = 0,       // MQTT命令执行成功
+    METRICS_COUNTER_MQTT_CMD_FAILED,       // MQTT命令执行失败
+    METRICS_COUNTER_MQTT_RECV_DROPPED,     // 接收队列满丢弃的命令
+    METRICS_COUNTER_MQTT_PUBLISHED,        // 发布的MQTT报文(合并后)
+    METRICS_COUNTER_LEDSTRIP_INDICATION,   // 灯带指示处理次数
+    METRICS_COUNTER_MQTT_PUB_DROPPED,      // 发送缓冲区满丢弃的消息
+    METRICS_COUNTER_MQTT_PUB_HEAP_ALLOC,   // 发布路径的堆内存申请(超出内联长度的消息)
+    METRICS_COUNTER_MQTT_PUB_CHUNKS,       // 分段发布的数据段
+    METRICS_COUNTER_MQTT_PUB_EVENTS,       // 出站消息(合并前)
+    METRICS_COUNTER_MQTT_PUB_BYTES,        // 发布的负载字节数
+    METRICS_COUNTER_MQTT_PUB_REPLAYED,     // 重连后补发的关键消息
+    METRICS_COUNTER_MQTT_JOURNAL_FLUSHES,  // 关键消息日志写入Flash的次数
+    METRICS_COUNTER_MQTT_JOURNAL_BACKLOG,  // 关键通道满时只写入日志、稍后从日志放入通道的消息
+    METRICS_COUNTER_MQTT_CMD_DEDUP_HIT,    // msg_id已执行过而跳过的重复命令
+    METRICS_COUNTER_MQTT_CMD_DEDUP_MISS,   // 带msg_id且执行的命令(含失败后的重试)
+    METRICS_COUNTER_EFFECT_TASK_CREATE,    // 灯效任务创建次数(常驻任务, 正常为1)
+    METRICS_COUNTER_EFFECT_FRAME_DROP,     // 灯效帧循环落后而跳过的帧
+    METRICS_COUNTER_MAX,
+} MetricsCounterId_t;
+
+/**
+ * @brief 计量值(当前值与统计窗口内的最高水位)
+ */
+typedef enum
+{
+    METRICS_GAUGE_MQTT_RECV_QUEUE = 0, // MQTT接收队列深度
+    METRICS_GAUGE_MQTT_PUB_QUEUE,      // MQTT发送缓冲区待发送消息数(全部通道)
+    METRICS_GAUGE_MQTT_PUB_CRITICAL,   // MQTT关键通道待发送消息数(断线期间保存的消息)
+    METRICS_GAUGE_BOX_DATA_QUEUE,      // 库位数据队列深度
+    METRICS_GAUGE_SCREEN_RING,         // 串口屏指令缓冲区字节数
+    METRICS_GAUGE_EFFECT_FRAME_PERIOD, // 灯效帧周期(毫秒, 按灯珠数量确定)
+    METRICS_GAUGE_MAX,
+} MetricsGaugeId_t;
+
+/**
+ * @brief 直方图(微秒, 按2的幂分桶)
+ */
+typedef enum
+{
+    METRICS_HISTOGRAM_MQTT_CMD_LATENCY = 0, // MQTT命令处理耗时
+    METRICS_HISTOGRAM_LEDSTRIP_INDICATION,  // 灯带指示一次处理耗时
+    METRICS_HISTOGRAM_EFFECT_FRAME_TIME,    // 灯效一帧的计算与刷新耗时
+    METRICS_HISTOGRAM_MQTT_PUB_LATENCY,     // 消息从入队到发布的延迟
+    METRICS_HISTOGRAM_STRIP_REFRESH,        // 灯带一次刷新(只发送到最后一个变化的灯珠)的耗时
+    METRICS_HISTOGRAM_STRIP_LOCK,           // 灯带刷新持有互斥锁的耗时(提交一帧)
+    METRICS_HISTOGRAM_EFFECT_SWITCH,        // 灯效参数从提交到第一帧生效的延迟
+    METRICS_HISTOGRAM_EFFECT_RENDER,        // 灯效一帧的画面计算耗时(不含写入灯带)
+    METRICS_HISTOGRAM_EFFECT_JITTER,        // 灯效帧开始时间与计划时间的偏差
+    METRICS_HISTOGRAM_MAX,
+} MetricsHistogramId_t;
+
+typedef struct _MetricsHistogram
+{
+    uint32_t bucket[METRICS_HISTOGRAM_BUCKETS];
+    uint32_t count; // 窗口内样本数
+    uint32_t max;   // 窗口内最大值
+} MetricsHistogram_t;
+
+/**
+ * @brief 统计窗口(计量值最高水位与直方图), 采样点写入当前窗口, 开始新窗口时切换到另一个
+ */
+typedef struct _MetricsWindow
+{
+    uint32_t highWater[METRICS_GAUGE_MAX]; // 窗口内计量值的最高水位
+    MetricsHistogram_t histogram[METRICS_HISTOGRAM_MAX];
+} MetricsWindow_t;
+
+typedef struct _MetricsRegistry
+{
+    uint32_t counter[METRICS_COUNTER_MAX];
+    uint32_t gauge[METRICS_GAUGE_MAX]; // 计量值当前值
+    MetricsWindow_t window[2];
+    uint32_t active; // 当前窗口
+} MetricsRegistry_t;
+
+extern MetricsRegistry_t g_metricsRegistry;
+
+/**
+ * @brief  当前统计窗口
+ * @return MetricsWindow_t*
+ */
+static inline MetricsWindow_t *metricsWindowCurrent(void)
+{
+    return &g_metricsRegistry.window[__atomic_load_n(&g_metricsRegistry.active, __ATOMIC_ACQUIRE)];
+}
+
+/**
+ * @brief  原子地更新最大值, 多个任务同时写入时保留较大的值
+ * @param  max
+ * @param  value
+ */
+static inline void metricsAtomicMax(uint32_t *max, uint32_t value)
+{
+    uint32_t _current = __atomic_load_n(max, __ATOMIC_RELAXED);
+    while (value > _current && !__atomic_compare_exchange_n(max, &_current, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+}
+
+/**
+ * @brief  计数器加1
+ * @param  id
+ */
+static inline void metricsCounterInc(MetricsCounterId_t id)
+{
+    __atomic_fetch_add(&g_metricsRegistry.counter[id], 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief  计数器加n
+ * @param  id
+ * @param  n
+ */
+static inline void metricsCounterAdd(MetricsCounterId_t id, uint32_t n)
+{
+    __atomic_fetch_add(&g_metricsRegistry.counter[id], n, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief  更新计量值,同时记录最高水位
+ * @param  id
+ * @param  value
+ */
+static inline void metricsGaugeSet(MetricsGaugeId_t id, uint32_t value)
+{
+    __atomic_store_n(&g_metricsRegistry.gauge[id], value, __ATOMIC_RELAXED);
+    metricsAtomicMax(&metricsWindowCurrent()->highWater[id], value);
+}
+
+/**
+ * @brief  记录一个直方图样本
+ * @param  id
+ * @param  us   微秒
+ */
+static inline void metricsHistogramRecord(MetricsHistogramId_t id, uint32_t us)
+{
+    MetricsHistogram_t *_histogram = &metricsWindowCurrent()->histogram[id];
+    uint32_t _bucket = us ? 32 - __builtin_clz(us) : 0;
+    if (_bucket >= METRICS_HISTOGRAM_BUCKETS)
+    {
+        _bucket = METRICS_HISTOGRAM_BUCKETS - 1;
+    }
+    __atomic_fetch_add(&_histogram->bucket[_bucket], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&_histogram->count, 1, __ATOMIC_RELAXED);
+    metricsAtomicMax(&_histogram->max, us);
+}
+
+extern uint32_t metricsHistogramPercentile(const MetricsHistogram_t *histogram, uint8_t percent);
+extern void metricsWindowSwap(MetricsWindow_t *closed);
+extern void metricsSnapshotWrite(json_writer_t *writer);
+
+#endif // _METRICS_H_
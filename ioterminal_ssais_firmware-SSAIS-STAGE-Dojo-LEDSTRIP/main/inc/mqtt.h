@@ -11,6 +11,9 @@
 
 #include "common.h"
 #include "cJSON.h"
+#include "json_writer.h"
+#include "journal.h"
+#include "mqtt_cmd_cache.h"
 
 // MQTT 状态定义
 typedef enum
@@ -45,6 +48,94 @@ typedef enum
 #define MQTT_CONTROL_TYPE_MINNUM_CLASSIFY_BUSINESS 200
 #define MQTT_CONTROL_TYPE_MAXNUM_CLASSIFY_BUSINESS 249
 
+// MQTT任务调度
+#define MQTT_TASK_IDLE_WAKE_MS 100 // 无收发事件时的最长等待时间(遥测上报、状态检查)
+#define MQTT_TASK_RECV_BUDGET 4    // 每次唤醒最多处理的接收命令数
+#define MQTT_TASK_PUB_BUDGET 16    // 每次唤醒最多发布的消息数(分段发布时每段计一条)
+#define MQTT_CHUNK_TOPIC_SUFFIX "/chunk" // 分段发布主题 = 发布主题 + 后缀 + /<编号>/<段号>/<段数>
+#define MQTT_COALESCE_MAX_EVENTS 32      // 一个合并信封最多包含的消息数
+#define MQTT_STATUS_MSG_MAX_LEN 512      // 固定格式状态消息的最大长度(栈上生成)
+#define MQTT_CBOR_TOPIC_SUFFIX "/cbor"   // CBOR格式的命令主题 = 订阅主题 + 后缀, 回显与状态消息主题 = 发布主题 + 后缀
+
+// 发送环形缓冲区记录标志
+#define MQTT_PUB_FLAG_URGENT 0x01 // 延迟敏感消息,不参与合并立即发送
+#define MQTT_PUB_FLAG_CBOR 0x02   // CBOR格式,从CBOR主题发布
+#define MQTT_PUB_FLAG_CRITICAL 0x04 // 关键消息,进入关键通道
+#define MQTT_PUB_FLAG_TELEMETRY 0x08 // 遥测快照,从遥测主题发布,不参与合并
+#define MQTT_PUB_REPLAY_BURST 4             // 重连补发的令牌桶容量(条)
+#define MQTT_PUB_BEST_EFFORT_EVICT_MAX 8    // 尽力通道一次发送最多丢弃的旧消息数
+#define MQTT_JOURNAL_PARTITION_LABEL "journal" // 关键消息Flash日志分区
+#define MQTT_JOURNAL_INFLIGHT_MAX 32          // 等待PUBACK的日志报文最大数量
+#define MQTT_CMD_ACK_MAX_LEN 128               // 命令回执的最大长度(栈上生成)
+#define MQTT_CMD_CACHE_BUCKETS (CONFIG_MQTT_CMD_DEDUP_CACHE_SIZE * 2 + 1) // msg_id缓存哈希桶数量
+#define MQTT_CBOR_ARRAY_INDEFINITE ((char)0x9F) // CBOR合并信封: 不定长数组开始
+#define MQTT_CBOR_BREAK ((char)0xFF)            // CBOR合并信封: 不定长数组结束
+
+// MQTT消息格式
+typedef enum
+{
+    MQTT_WIRE_FORMAT_JSON = 0,
+    MQTT_WIRE_FORMAT_CBOR,
+} MqttWireFormat_t;
+
+// 出站消息合并: 窗口内的回显与状态消息拼接为一个数组发布(JSON数组或CBOR不定长数组)
+typedef struct
+{
+    char *buf;                                     // 信封缓冲区(PSRAM)
+    size_t len;                                    // 已写入长度
+    uint16_t count;                                // 已合并的消息数
+    MqttWireFormat_t format;                       // 信封内消息的格式
+    int64_t windowStart;                           // 第一条消息加入的时间(微秒)
+    int64_t enqueueTime[MQTT_COALESCE_MAX_EVENTS]; // 各消息入队时间,发送时统计延迟
+    uint32_t journalSeq[MQTT_COALESCE_MAX_EVENTS]; // 各消息的日志序号,0表示未写入日志
+} MqttCoalesce_t;
+
+// 日志报文状态
+typedef enum
+{
+    MQTT_JOURNAL_INFLIGHT_FREE = 0, // 空闲
+    MQTT_JOURNAL_INFLIGHT_SENT,     // 已发布,等待PUBACK
+    MQTT_JOURNAL_INFLIGHT_ACKED,    // 已收到PUBACK,等待MQTT任务确认日志
+    MQTT_JOURNAL_INFLIGHT_LOST,     // 发布失败或被客户端丢弃,等待从日志重新入队
+    MQTT_JOURNAL_INFLIGHT_REQUEUED, // 已从日志重新入队,等待重新发布
+} MqttJournalInflightState_t;
+
+// 包含日志消息的报文,收到PUBACK后其中的消息才能从日志中确认
+typedef struct
+{
+    MqttJournalInflightState_t state;
+    int msgId;          // esp_mqtt_client_publish返回的报文ID
+    uint32_t firstSeq;  // 报文中最小的日志序号
+    uint32_t lastSeq;   // 报文中最大的日志序号
+    uint16_t remaining; // MQTT_JOURNAL_INFLIGHT_REQUEUED: 尚未重新发布的消息数
+} MqttJournalInflight_t;
+
+// 从日志放入关键通道的进度
+typedef struct
+{
+    uint32_t fullSeq;      // 通道已满时第一条未放入的日志序号,0表示全部放入
+    uint32_t ownerLastSeq; // 计入重新入队报文的最大日志序号
+    uint16_t ownerCount;   // 放入的消息中属于重新入队报文的数量
+    uint16_t count;        // 放入的消息数
+} MqttJournalFeed_t;
+
+// 解析出的命令,由msg_id缓存决定是否执行
+typedef struct
+{
+    uint16_t controlType;
+    uint16_t cmdType;
+    cJSON *data;
+} MqttCmdExecCtx_t;
+
+// 命令解析结果,用于回执
+typedef struct
+{
+    uint16_t controlType;            // 0表示未能解析
+    uint16_t cmdType;
+    bool duplicate;                  // msg_id已执行过,本次未执行
+    char msgId[MQTT_CMD_ID_MAX_LEN]; // 空字符串表示命令不带msg_id
+} MqttCmdInfo_t;
+
 // MQTT命令类型范围定义与处理结构体
 typedef struct
 {
@@ -65,6 +156,15 @@ extern esp_err_t mqttSetBusinessHandle(uint16_t mqttContorType, uint16_t mqttCmd
 extern MqttState_t getMqttState();
 extern void switchMqttState(MqttState_t mqttState);
 extern esp_mqtt_client_handle_t mqttInit(MqttConfigData_t *mqttConfigData);
+extern esp_err_t mqttCmdRecvHandle(MqttReceiveData_t *mqttRecvData);
+extern void mqttTaskWake();
+extern esp_err_t mqttJournalInit();
+extern esp_err_t mqttPubRingSend(const char *data, size_t dataLen, uint8_t flags);
+extern void mqttPubWriterInit(json_writer_t *writer, char *buf, size_t size);
+extern esp_err_t mqttPubWriterSend(json_writer_t *writer, uint8_t flags);
+extern void mqttCmdTopicSubscribe(MqttConfigData_t *mqttConfigData);
+extern void mqttCmdTopicUnsubscribe(MqttConfigData_t *mqttConfigData);
+extern esp_err_t mqttPubRingSendExternal(char *data, size_t dataLen, uint8_t flags);
 extern void mqttEventHandler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data);
 extern void mqttDefaultTopicPubStrMsg(uint16_t controlType, uint16_t notifyType, const char *jsonObjName, const char *str);
 extern void mqttDefaultTopicPubNumMsg(uint16_t controlType, uint16_t notifyType, const char *jsonObjName, uint32_t num);
@@ -0,0 +1,50 @@
+/**
+ * @file mqtt_cmd_cache.h
+ * @brief 已执行命令的msg_id缓存头文件(不依赖ESP-IDF,可在主机上编译)
+ * @version 1.0
+ * @date 2024-07-29
+ *
+ * @copyright Copyright (c) 2024  雅马哈发动机（厦门）信息系统有限公司
+ *
+ */
+#ifndef _MQTT_CMD_CACHE_H_
+#define _MQTT_CMD_CACHE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MQTT_CMD_ID_MAX_LEN 48 // msg_id最大长度(含结束符),超长的ID不参与去重
+
+// 缓存项: 按哈希桶链接用于查找,按使用顺序双向链接用于淘汰(均为数组下标,-1表示无)
+typedef struct _MqttCmdCacheEntry
+{
+    char msgId[MQTT_CMD_ID_MAX_LEN];
+    uint32_t hash;
+    int16_t bucketNext; // 同一哈希桶的下一项
+    int16_t lruPrev;    // 较新使用的一项
+    int16_t lruNext;    // 较早使用的一项
+} MqttCmdCacheEntry_t;
+
+// 只记录执行成功的命令,执行失败的命令可用同一msg_id重试
+typedef struct _MqttCmdCache
+{
+    MqttCmdCacheEntry_t *entry; // 调用者提供,为NULL时不去重
+    int16_t *bucket;            // 调用者提供
+    uint16_t capacity;
+    uint16_t bucketNum;
+    uint16_t count;
+    int16_t lruHead; // 最近使用
+    int16_t lruTail; // 最久未使用,缓存满时淘汰
+    uint32_t hit;    // msg_id重复而跳过的命令
+    uint32_t miss;   // 带msg_id且执行的命令
+} MqttCmdCache_t;
+
+/**
+ * @brief 执行一条命令,返回esp_err_t(0为成功)
+ */
+typedef int (*MqttCmdExec_t)(void *ctx);
+
+extern void mqttCmdCacheInit(MqttCmdCache_t *cache, MqttCmdCacheEntry_t *entry, uint16_t capacity, int16_t *bucket, uint16_t bucketNum);
+extern int mqttCmdCacheExecute(MqttCmdCache_t *cache, const char *msgId, MqttCmdExec_t exec, void *ctx, bool *duplicate);
+
+#endif // _MQTT_CMD_CACHE_H_
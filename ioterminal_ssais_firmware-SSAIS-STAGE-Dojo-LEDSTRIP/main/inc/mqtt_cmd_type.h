@@ -34,30 +34,45 @@
 #define NOTIFY_FIRMWARE_VERSION 4                ///< 回复固件版本
 #define MQTT_CONTROL_TYPE_MQTT_STATE 153         ///< MQTT状态
 #define NOTIFY_MQTT_OFFLINE_RECONNECTION_COUNT 2 ///< MQTT掉线重连次数报告
+#define TEST_PUB_LANES 3                         ///< 发送通道断线补发测试
+#define NOTIFY_PUB_LANE_TEST 3                   ///< 发送通道测试消息
 #define MQTT_CONTROL_TYPE_NETWORK_STATE 154      ///< 网络状态
 #define NOTIFY_NETWORK_IP_ADDR 1                 ///< 报告IP地址
+#define MQTT_CONTROL_TYPE_SYSTEM_TELEMETRY 155   ///< 运行指标遥测
+#define NOTIFY_TELEMETRY_SNAPSHOT 1              ///< 周期上报运行指标快照
+#define MQTT_CONTROL_TYPE_SYSTEM_TRACE 156       ///< 事件跟踪
+#define DUMP_TRACE_TO_MQTT 1                     ///< 从跟踪主题导出跟踪记录
+#define DUMP_TRACE_TO_UART 2                     ///< 从调试串口导出跟踪记录
+#define CLEAR_TRACE 3                            ///< 清空跟踪记录
 
 // business_type 命令类型定义
 #define MQTT_CONTROL_TYPE_BUSINESS_ORDER_MANAGE 212           ///< 下发灯带拣货指示订单
 #define PLACE_NEW_ORDER 1                                     ///< 下发新订单
 #define PLACE_NEW_ORDER_BY_NODE_RED 2                         ///< 影子系统下发新订单
 #define QUERY_RESIDUES_ORDER 3                                ///< 查询残留订单
+#define PLACE_NEW_ORDER_BULK 4                                ///< 批量下发订单
 #define NOTIFY_RESIDUES_ORDER 2                               ///< 回复残留订单
 #define MQTT_CONTROL_TYPE_BUSINESS_PICKUP_COMPLETED 213       ///< 下发灯带拣货完成通知
 #define PICKUP_COMPLETED 1                                    ///< 拣货完成
+#define PICKUP_COMPLETED_BULK 2                               ///< 批量拣货完成
 #define MQTT_CONTROL_TYPE_BUSINESS_END_PICKUP_INSTRUCTION 214 ///< 结束指示灯带全灭
 #define END_PICKUP_INSTRUCTION 1                              ///< 结束指示
 #define END_PICKUP_INSTRUCTION_BY_NODE_RED 2
 #define END_ALL_ORDER_BY_DOJO_DEMO_PURPOSE 3 ///< 结束所有订单（用于演示）
+#define END_PICKUP_INSTRUCTION_BULK 4        ///< 批量结束指示
 #define MQTT_CONTROL_TYPE_BUSINESS_LEDSTRIP_DEBUG 215 ///< 灯带调试
 #define LED_LOCATE 1                                  ///< 定位灯珠
 #define LED_SEQUENCE 2                                ///< 灯珠顺序跑马
 #define LED_BOX_LOCATION_CHECK 3                      ///< 亮灯库位确认
+#define MQTT_CONTROL_TYPE_BUSINESS_BENCHMARK 216      ///< 业务性能测试
+#define PICK_WAVE_BENCHMARK 1                         ///< 拣货波次性能测试
+#define NOTIFY_PICK_WAVE_BENCHMARK_RESULT 1           ///< 回复拣货波次性能测试结果
 
 #define MQTT_CONTROL_TYPE_BUSINESS_LEDSTRIP_OPERATE 232 ///< 灯带操作相关
 #define LED_SEQUENCE_RUN 1                              ///< 设置跑马灯
 #define LED_EFFECT_RUN 2                                ///< 灯效操作
 #define LED_SET_COLOR_AND_BRIGHTNESS 3                  ///< 设置灯带颜色和亮度
 #define LED_LIGHT_OFF 4                                 ///< 灯带熄灭
+#define LED_TIMELINE_RUN 5                              ///< 执行关键帧时间线
 
 #endif // _MQTT_CMD_TYPE_H_
\ No newline at end of file
@@ -64,5 +64,6 @@ extern esp_err_t projectSetHandle(uint16_t controlId, uint8_t param[256], uint16
 extern esp_err_t ssaisLedstripHandle(uint16_t controlId, uint8_t param[256], uint16_t size);
 extern esp_err_t messageDialogHandle(uint16_t controlId, uint8_t param[256], uint16_t size);
 extern esp_err_t checkDialogHandle(uint16_t controlId, uint8_t param[256], uint16_t size);
+extern esp_err_t metricsInfoHandle(uint16_t controlId, uint8_t param[256], uint16_t size);
 
 #endif //_SCREEN_H_
\ No newline at end of file
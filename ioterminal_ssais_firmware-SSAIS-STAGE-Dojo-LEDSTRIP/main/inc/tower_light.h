@@ -0,0 +1,72 @@
+/**
+ * @file tower_light.h
+ * @brief 三色灯(警示灯)控制器头文件(不依赖ESP-IDF,可在主机上编译)
+ * @version 1.0
+ * @date 2024-07-29
+ *
+ * @copyright Copyright (c) 2024  雅马哈发动机（厦门）信息系统有限公司
+ *
+ */
+#ifndef _TOWER_LIGHT_H_
+#define _TOWER_LIGHT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TOWER_LIGHT_TICK_MS 50  ///< 闪烁定时器周期, 图案的最小时间单位
+#define TOWER_LIGHT_SLOT_NUM 32 ///< 一个闪烁周期的时间单位数量(32 × 50ms = 1.6s)
+
+/**
+ * @brief 通道(与硬件引脚顺序一致)
+ */
+typedef enum
+{
+    TOWER_LIGHT_CHANNEL_BEEP = 0, // 蜂鸣或者蓝色
+    TOWER_LIGHT_CHANNEL_RED,
+    TOWER_LIGHT_CHANNEL_YELLOW,
+    TOWER_LIGHT_CHANNEL_GREEN,
+    TOWER_LIGHT_CHANNEL_MAX,
+} TowerLightChannel_t;
+
+/**
+ * @brief 单个通道的图案, 所有通道共用一个闪烁周期和相位
+ */
+typedef enum
+{
+    TOWER_LIGHT_PATTERN_OFF = 0,        // 灭
+    TOWER_LIGHT_PATTERN_ON,             // 常亮
+    TOWER_LIGHT_PATTERN_SLOW_BLINK,     // 慢闪(亮800ms 灭800ms)
+    TOWER_LIGHT_PATTERN_SLOW_BLINK_INV, // 慢闪, 与慢闪交替(灭800ms 亮800ms)
+    TOWER_LIGHT_PATTERN_FAST_BLINK,     // 快闪(亮200ms 灭200ms)
+    TOWER_LIGHT_PATTERN_DOUBLE_FLASH,   // 双闪(亮150ms 灭150ms 亮150ms 灭1150ms)
+    TOWER_LIGHT_PATTERN_MAX,
+} TowerLightPattern_t;
+
+/**
+ * @brief 整个三色灯的状态, 各通道图案可任意组合
+ */
+typedef struct _TowerLightState
+{
+    uint8_t pattern[TOWER_LIGHT_CHANNEL_MAX]; // TowerLightPattern_t
+} TowerLightState_t;
+
+/**
+ * @brief 写入一个通道的输出
+ */
+typedef void (*TowerLightWrite_t)(void *ctx, uint8_t channel, bool on);
+
+typedef struct _TowerLight
+{
+    TowerLightState_t state; // 当前状态
+    uint32_t epochMs;        // 闪烁相位起点(从没有通道闪烁变为有通道闪烁的时间)
+    uint8_t output;          // 各通道当前输出, 第n位为通道n
+    TowerLightWrite_t write;
+    void *ctx;
+} TowerLight_t;
+
+extern void towerLightInit(TowerLight_t *light, TowerLightWrite_t write, void *ctx);
+extern uint8_t towerLightSet(TowerLight_t *light, const TowerLightState_t *state, uint32_t nowMs);
+extern uint8_t towerLightTick(TowerLight_t *light, uint32_t nowMs);
+extern bool towerLightIsBlinking(const TowerLight_t *light);
+
+#endif // _TOWER_LIGHT_H_
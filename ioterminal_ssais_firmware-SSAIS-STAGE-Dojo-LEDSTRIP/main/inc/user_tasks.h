@@ -13,6 +13,7 @@
 #include "common.h"
 
 // RTOS TASK
+#define LEDSTRIP_RENDER_TASK_PRIVILEGE                  13
 #define MQTT_TASK_PRIVILEGE                             12
 #define LEDSTRIP_INDICATION_TASK_PRIVILEGE              11
 #define SCREEN_TASK_PRIVILEGE                           11
@@ -21,7 +22,7 @@
 #define NETWORK_TASK_PRIVILEGE                          1
 
 extern QueueHandle_t g_mqttRecvDataQueueHandler;    // MQTT 数据接收队列
-extern QueueHandle_t g_mqttPubDataQueueHandler;     // MQTT 数据发送队列
+extern RingbufHandle_t g_mqttPubRingHandle[];       // MQTT 数据发送环形缓冲区(按MqttPubLane_t分通道)
 extern QueueHandle_t g_dioInpDataQueueHandler;      // DIO 输入数据接收队列
 
 extern void screenCmdRecvTask(void *pvParameters);
@@ -29,6 +30,7 @@ extern void networkTask(void *pvParameters);
 extern void mqttTask(void *pvParameters);
 extern void modbusTask(void *pvParameters);
 extern void ledStripIndicationTask(void *pvParameters);
+extern void ledStripRenderTask(void *pvParameters);
 extern void otaTask(void *pvParameters);
 
 #endif // _USER_TASKS_H_
@@ -0,0 +1,560 @@
+/**
+ * @file pickWaveBenchmark.c
+ * @brief 拣货波次端到端性能测试
+ * @version 1.0
+ * @date 2024-06-03
+ *
+ * @copyright Copyright (c) 2024  雅马哈发动机（厦门）信息系统有限公司
+ *
+ */
+#include <stdarg.h>
+#include "user_tasks.h"
+
+static char *TAG = "PICK_WAVE_BENCHMARK";
+
+/**
+ * @brief 性能测试统计数据
+ */
+typedef struct _PickWaveBenchmarkStat
+{
+    uint32_t *latencyUs;     // 每条命令从下发到写入灯带的耗时
+    uint16_t cmdCount;       // 已执行的命令数量
+    uint16_t cmdMaxCount;    // 命令数量上限
+    int64_t totalUs;         // 所有命令耗时总和
+    int64_t lightsOnUs;      // 全部订单从下发到亮灯完成的耗时
+    uint32_t refreshAvgUs;   // 整条灯带刷新的平均耗时
+    uint32_t refreshMaxUs;   // 整条灯带刷新的最大耗时
+    size_t psramBootFree;    // 测试开始前PSRAM剩余
+    size_t psramMinFree;     // 测试期间PSRAM最小剩余
+    size_t internalBootFree; // 测试开始前内部RAM剩余
+    size_t internalMinFree;  // 测试期间内部RAM最小剩余
+} PickWaveBenchmarkStat_t;
+
+/**
+ * @brief 性能测试参数
+ */
+typedef struct _PickWaveBenchmarkArgs
+{
+    uint16_t boxNum;  // 库位数量
+    uint8_t orderNum; // 订单数量
+    uint16_t ledSpan; // 每个库位占用的灯珠
+    bool bulk;        // 使用批量命令
+} PickWaveBenchmarkArgs_t;
+
+static volatile bool s_benchmarkRunning = false;           // 性能测试任务已创建且尚未结束
+static volatile TaskHandle_t s_benchmarkTaskHandle = NULL; // 性能测试任务, 由任务自身写入
+static uint32_t s_cjsonMallocCount = 0;                    // 测试期间测试任务的cJSON申请内存次数
+static uint32_t s_cjsonMallocBytes = 0;                    // 测试期间测试任务的cJSON申请内存字节数
+
+/**
+ * @brief  统计分配次数的cJSON内存申请钩子
+ *         钩子是全局的, 只统计测试任务自身的申请, 其他任务(MQTT接收、屏幕等)的申请不计入
+ * @param  size
+ * @return void*
+ */
+static void *benchmarkCjsonMalloc(size_t size)
+{
+    if (xTaskGetCurrentTaskHandle() == s_benchmarkTaskHandle)
+    {
+        s_cjsonMallocCount++;
+        s_cjsonMallocBytes += size;
+    }
+    return malloc(size);
+}
+
+/**
+ * @brief  cJSON内存释放钩子
+ * @param  ptr
+ */
+static void benchmarkCjsonFree(void *ptr)
+{
+    free(ptr);
+}
+
+/**
+ * @brief  uint32_t 升序比较
+ */
+static int latencyCompare(const void *a, const void *b)
+{
+    uint32_t _a = *(const uint32_t *)a;
+    uint32_t _b = *(const uint32_t *)b;
+    return (_a > _b) - (_a < _b);
+}
+
+/**
+ * @brief  执行一条脚本命令并记录耗时
+ * @param  cmd          脚本命令
+ * @param  waitRender   是否等待灯带指示任务完成处理(下发订单的亮灯在指示任务中完成)
+ * @param  stat         统计数据
+ * @return esp_err_t
+ */
+static esp_err_t benchmarkDispatch(MqttReceiveData_t *cmd, bool waitRender, PickWaveBenchmarkStat_t *stat)
+{
+    if (stat->cmdCount >= stat->cmdMaxCount)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    cmd->dataLen = strlen(cmd->data);
+    uint32_t _passCount = getLedStripIndicationPassCount();
+    int64_t _startTime = esp_timer_get_time();
+    esp_err_t err = mqttCmdRecvHandle(cmd);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Benchmark command failed [%s]", esp_err_to_name(err));
+        return err;
+    }
+    if (waitRender)
+    {
+        TickType_t _waitStart = xTaskGetTickCount();
+        while (getLedStripIndicationPassCount() == _passCount) // 等待灯带指示任务处理完成
+        {
+            if (xTaskGetTickCount() - _waitStart > pdMS_TO_TICKS(PICK_WAVE_BENCHMARK_RENDER_TIMEOUT))
+            {
+                ESP_LOGE(TAG, "Waiting for ledStripIndicationTask timeout");
+                return ESP_ERR_TIMEOUT;
+            }
+            vTaskDelay(1);
+        }
+        if (ledStripRefreshFlush(PICK_WAVE_BENCHMARK_RENDER_TIMEOUT) != ESP_OK) // 刷新在后台发送, 等待灯珠实际点亮
+        {
+            ESP_LOGE(TAG, "Waiting for ledstrip refresh timeout");
+            return ESP_ERR_TIMEOUT;
+        }
+    }
+    int64_t _latency = esp_timer_get_time() - _startTime;
+    stat->latencyUs[stat->cmdCount++] = (uint32_t)_latency;
+    stat->totalUs += _latency;
+
+    size_t _psramFree = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    size_t _internalFree = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    if (_psramFree < stat->psramMinFree)
+    {
+        stat->psramMinFree = _psramFree;
+    }
+    if (_internalFree < stat->internalMinFree)
+    {
+        stat->internalMinFree = _internalFree;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief  测量整条灯带的刷新耗时(不受脏区截断影响), 用于对比RMT与SPI后端
+ * @param  stat
+ */
+static void benchmarkFullRefresh(PickWaveBenchmarkStat_t *stat)
+{
+    int64_t _totalUs = 0;
+    for (size_t i = 0; i < PICK_WAVE_BENCHMARK_REFRESH_ROUNDS; i++)
+    {
+        if (xSemaphoreTake(g_ledstripRmtHandleMetex, portMAX_DELAY) != pdTRUE)
+        {
+            continue;
+        }
+        led_strip_wait_refresh_done(g_ledstripRmtHandle, -1); // 不计入渲染任务尚未发送完的上一帧
+        int64_t _startTime = esp_timer_get_time();
+        led_strip_refresh(g_ledstripRmtHandle);
+        uint32_t _us = esp_timer_get_time() - _startTime;
+        xSemaphoreGive(g_ledstripRmtHandleMetex);
+        _totalUs += _us;
+        if (_us > stat->refreshMaxUs)
+        {
+            stat->refreshMaxUs = _us;
+        }
+    }
+    stat->refreshAvgUs = _totalUs / PICK_WAVE_BENCHMARK_REFRESH_ROUNDS;
+}
+
+/**
+ * @brief  向脚本命令追加格式化内容
+ * @param  buf
+ * @param  len  当前长度
+ * @param  fmt
+ * @return int  追加后的长度, 超出MQTT_RECEIVE_DATA_MAX_LEN时返回MQTT_RECEIVE_DATA_MAX_LEN
+ */
+static int benchmarkAppend(char *buf, int len, const char *fmt, ...)
+{
+    if (len >= MQTT_RECEIVE_DATA_MAX_LEN)
+    {
+        return MQTT_RECEIVE_DATA_MAX_LEN;
+    }
+    va_list _args;
+    va_start(_args, fmt);
+    int _n = vsnprintf(buf + len, MQTT_RECEIVE_DATA_MAX_LEN - len, fmt, _args);
+    va_end(_args);
+    return (_n < 0 || len + _n >= MQTT_RECEIVE_DATA_MAX_LEN) ? MQTT_RECEIVE_DATA_MAX_LEN : len + _n;
+}
+
+/**
+ * @brief  批量下发订单: 订单依次追加到批量下发命令(212-4),命令放不下时先执行已追加的订单
+ * @param  cmd
+ * @param  boxNum
+ * @param  orderNum
+ * @param  ledSpan      每个库位占用的灯珠
+ * @param  orderColor
+ * @param  colorNum
+ * @param  stat
+ * @return esp_err_t
+ */
+static esp_err_t benchmarkPlaceBulk(MqttReceiveData_t *cmd, uint16_t boxNum, uint8_t orderNum, uint16_t ledSpan,
+                                    const uint32_t *orderColor, size_t colorNum, PickWaveBenchmarkStat_t *stat)
+{
+    const int _tailLen = sizeof("]}}") - 1;
+    int _headLen = 0;
+    int _len = 0;
+    for (size_t k = 0; k < orderNum;)
+    {
+        if (_len == 0)
+        {
+            _len = _headLen = benchmarkAppend(cmd->data, 0, "{\"control_type\":%d,\"cmd_type\":%d,\"data\":{\"time_stamp\":%lu,\"order_list\":[",
+                                              MQTT_CONTROL_TYPE_BUSINESS_ORDER_MANAGE, PLACE_NEW_ORDER_BULK, esp_log_timestamp());
+        }
+        int _mark = _len;
+        _len = benchmarkAppend(cmd->data, _len, "%s{\"order\":\"BENCH_%d\",\"color\":%lu,\"box_list\":[",
+                               _len == _headLen ? "" : ",", k, orderColor[k % colorNum]);
+        for (size_t i = k; i < boxNum; i += orderNum)
+        {
+            _len = benchmarkAppend(cmd->data, _len, "%s[\"BM%03d\",%d,%d,1]", i == k ? "" : ",", i, i * ledSpan + 1, (i + 1) * ledSpan);
+        }
+        _len = benchmarkAppend(cmd->data, _len, "]}");
+        if (_len + _tailLen < MQTT_RECEIVE_DATA_MAX_LEN) // 订单放入当前命令
+        {
+            k++;
+            continue;
+        }
+        if (_mark == _headLen)
+        {
+            ESP_LOGE(TAG, "Order BENCH_%d exceeds %d bytes", k, MQTT_RECEIVE_DATA_MAX_LEN);
+            return ESP_ERR_INVALID_SIZE;
+        }
+        benchmarkAppend(cmd->data, _mark, "]}}"); // 当前命令放不下,先执行已追加的订单
+        esp_err_t err = benchmarkDispatch(cmd, true, stat);
+        if (err != ESP_OK)
+        {
+            return err;
+        }
+        _len = 0;
+    }
+    benchmarkAppend(cmd->data, _len, "]}}");
+    return benchmarkDispatch(cmd, true, stat);
+}
+
+/**
+ * @brief  批量取货完成: 取货记录依次追加到批量取货完成命令(213-2),命令放不下时先执行
+ *         最后一个订单只取货一半库位
+ * @param  cmd
+ * @param  boxNum
+ * @param  orderNum
+ * @param  stat
+ * @return esp_err_t
+ */
+static esp_err_t benchmarkPickupBulk(MqttReceiveData_t *cmd, uint16_t boxNum, uint8_t orderNum, PickWaveBenchmarkStat_t *stat)
+{
+    const int _tailLen = sizeof("]}}") - 1;
+    int _headLen = 0;
+    int _len = 0;
+    for (size_t i = 0; i < boxNum;)
+    {
+        uint8_t _order = i % orderNum;
+        if (_order == orderNum - 1 && i >= boxNum / 2)
+        {
+            i++;
+            continue;
+        }
+        if (_len == 0)
+        {
+            _len = _headLen = benchmarkAppend(cmd->data, 0, "{\"control_type\":%d,\"cmd_type\":%d,\"data\":{\"pickup_list\":[",
+                                              MQTT_CONTROL_TYPE_BUSINESS_PICKUP_COMPLETED, PICKUP_COMPLETED_BULK);
+        }
+        int _mark = _len;
+        _len = benchmarkAppend(cmd->data, _len, "%s[\"BENCH_%d\",\"BM%03d\",1]", _len == _headLen ? "" : ",", _order, i);
+        if (_len + _tailLen < MQTT_RECEIVE_DATA_MAX_LEN)
+        {
+            i++;
+            continue;
+        }
+        benchmarkAppend(cmd->data, _mark, "]}}");
+        esp_err_t err = benchmarkDispatch(cmd, false, stat);
+        if (err != ESP_OK)
+        {
+            return err;
+        }
+        _len = 0;
+    }
+    if (_len == 0)
+    {
+        return ESP_OK;
+    }
+    benchmarkAppend(cmd->data, _len, "]}}");
+    return benchmarkDispatch(cmd, false, stat);
+}
+
+/**
+ * @brief  发布性能测试结果
+ * @param  boxNum
+ * @param  orderNum
+ * @param  bulk
+ * @param  stat
+ */
+static void pickWaveBenchmarkReport(uint16_t boxNum, uint8_t orderNum, bool bulk, PickWaveBenchmarkStat_t *stat)
+{
+    qsort(stat->latencyUs, stat->cmdCount, sizeof(uint32_t), latencyCompare);
+    uint32_t _p50 = stat->latencyUs[(stat->cmdCount - 1) * 50 / 100];
+    uint32_t _p99 = stat->latencyUs[(stat->cmdCount - 1) * 99 / 100];
+    uint32_t _max = stat->latencyUs[stat->cmdCount - 1];
+    double _cmdsPerSec = stat->totalUs > 0 ? (double)stat->cmdCount * 1000000.0 / (double)stat->totalUs : 0;
+
+    char _msg[PICK_WAVE_BENCHMARK_MSG_MAX_LEN];
+    json_writer_t _writer;
+    size_t _len;
+    json_writer_init(&_writer, _msg, sizeof(_msg));
+    json_writer_object_begin(&_writer);
+    json_writer_key_int(&_writer, "control_type", MQTT_CONTROL_TYPE_BUSINESS_BENCHMARK);
+    json_writer_key_int(&_writer, "notify_type", NOTIFY_PICK_WAVE_BENCHMARK_RESULT);
+    json_writer_key(&_writer, "data");
+    json_writer_object_begin(&_writer);
+    json_writer_key_string(&_writer, "version", FIRMWARE_VERSION);
+    json_writer_key_int(&_writer, "led_num", g_nvsData.DeviceConfigData.ledstripConfigData.ledNum);
+    json_writer_key_int(&_writer, "box_num", boxNum);
+    json_writer_key_int(&_writer, "order_num", orderNum);
+    json_writer_key(&_writer, "bulk");
+    json_writer_bool(&_writer, bulk);
+    json_writer_key_int(&_writer, "lights_on_us", stat->lightsOnUs);
+#if CONFIG_LED_STRIP_BACKEND_SPI
+    json_writer_key_string(&_writer, "backend", "spi");
+#else
+    json_writer_key_string(&_writer, "backend", "rmt");
+    json_writer_key_uint(&_writer, "rmt_mem_symbols", CONFIG_LED_STRIP_RMT_MEM_BLOCK_SYMBOLS);
+    json_writer_key(&_writer, "rmt_dma");
+#if CONFIG_LED_STRIP_RMT_WITH_DMA
+    json_writer_bool(&_writer, true);
+#else
+    json_writer_bool(&_writer, false);
+#endif
+#endif
+    json_writer_key_uint(&_writer, "refresh_us", stat->refreshAvgUs);
+    json_writer_key_uint(&_writer, "refresh_max_us", stat->refreshMaxUs);
+    json_writer_key_uint(&_writer, "cmd_count", stat->cmdCount);
+    json_writer_key_int(&_writer, "total_us", stat->totalUs);
+    json_writer_key_double(&_writer, "cmds_per_sec", _cmdsPerSec);
+    json_writer_key_uint(&_writer, "p50_us", _p50);
+    json_writer_key_uint(&_writer, "p99_us", _p99);
+    json_writer_key_uint(&_writer, "max_us", _max);
+    json_writer_key_double(&_writer, "alloc_per_cmd", (double)s_cjsonMallocCount / stat->cmdCount);
+    json_writer_key_double(&_writer, "alloc_bytes_per_cmd", (double)s_cjsonMallocBytes / stat->cmdCount);
+    json_writer_key_int(&_writer, "psram_peak_bytes", stat->psramBootFree - stat->psramMinFree);
+    json_writer_key_int(&_writer, "internal_peak_bytes", stat->internalBootFree - stat->internalMinFree);
+    json_writer_key_uint(&_writer, "internal_free_bytes", stat->internalBootFree); // 包含灯带驱动在内的常驻占用之后的剩余
+    json_writer_key_uint(&_writer, "psram_min_free_bytes", heap_caps_get_minimum_free_size(MALLOC_CAP_SPIRAM));
+    json_writer_object_end(&_writer);
+    json_writer_object_end(&_writer);
+    if (json_writer_finish(&_writer, &_len) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Benchmark result message too long");
+        return;
+    }
+    ESP_LOGI(TAG, "%s", _msg); // 串口同样输出结果，方便无网络时采集
+    mqttPubRingSend(_msg, _len, 0); // 经尽力通道从发布主题发布,固定使用JSON
+}
+
+/**
+ * @brief  拣货波次端到端性能测试任务, 测试结束后上报结果并删除自身
+ * @param  arg  PickWaveBenchmarkArgs_t, 由任务释放
+ */
+static void pickWaveBenchmarkTask(void *arg)
+{
+    PickWaveBenchmarkArgs_t _args = *(PickWaveBenchmarkArgs_t *)arg;
+    free(arg);
+    s_benchmarkTaskHandle = xTaskGetCurrentTaskHandle();
+
+    uint32_t _orderColor[] = {
+        g_nvsData.projectConfigData.ledStripIndicationConfigData.colorGreen,
+        g_nvsData.projectConfigData.ledStripIndicationConfigData.colorYellow,
+        g_nvsData.projectConfigData.ledStripIndicationConfigData.colorRed,
+        g_nvsData.projectConfigData.ledStripIndicationConfigData.colorBlue,
+    };
+    PickWaveBenchmarkStat_t _stat = {0};
+    _stat.cmdMaxCount = _args.orderNum + _args.boxNum + 1;
+    _stat.latencyUs = heap_caps_malloc(_stat.cmdMaxCount * sizeof(uint32_t), MALLOC_CAP_SPIRAM);
+    MqttReceiveData_t *_cmd = heap_caps_calloc(1, sizeof(MqttReceiveData_t), MALLOC_CAP_SPIRAM);
+    esp_err_t err = ESP_OK;
+    if (_stat.latencyUs == NULL || _cmd == NULL)
+    {
+        ESP_LOGE(TAG, "No memory for benchmark");
+        err = ESP_ERR_NO_MEM;
+    }
+    _stat.psramBootFree = _stat.psramMinFree = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    _stat.internalBootFree = _stat.internalMinFree = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    ESP_LOGW(TAG, "Pick wave benchmark start. box_num = %d order_num = %d led_span = %d bulk = %d", _args.boxNum, _args.orderNum, _args.ledSpan, _args.bulk);
+
+    s_cjsonMallocCount = 0;
+    s_cjsonMallocBytes = 0;
+    cJSON_Hooks _hooks = {.malloc_fn = benchmarkCjsonMalloc, .free_fn = benchmarkCjsonFree};
+    cJSON_InitHooks(&_hooks);
+
+    // 下发订单,订单交错占用库位(库位i属于订单 i % orderNum),覆盖队列轮转查找
+    if (_args.bulk && err == ESP_OK)
+    {
+        err = benchmarkPlaceBulk(_cmd, _args.boxNum, _args.orderNum, _args.ledSpan, _orderColor, sizeof(_orderColor) / sizeof(_orderColor[0]), &_stat);
+    }
+    for (size_t k = 0; k < _args.orderNum && err == ESP_OK && !_args.bulk; k++)
+    {
+        int _len = snprintf(_cmd->data, MQTT_RECEIVE_DATA_MAX_LEN,
+                            "{\"control_type\":%d,\"cmd_type\":%d,\"data\":{\"time_stamp\":%lu,\"color\":%lu,\"order\":\"BENCH_%d\",\"box_list\":[",
+                            MQTT_CONTROL_TYPE_BUSINESS_ORDER_MANAGE, PLACE_NEW_ORDER, esp_log_timestamp(), _orderColor[k % (sizeof(_orderColor) / sizeof(_orderColor[0]))], k);
+        for (size_t i = k; i < _args.boxNum && _len < MQTT_RECEIVE_DATA_MAX_LEN; i += _args.orderNum)
+        {
+            _len += snprintf(_cmd->data + _len, MQTT_RECEIVE_DATA_MAX_LEN - _len, "%s[\"BM%03d\",%d,%d,1]",
+                             i == k ? "" : ",", i, i * _args.ledSpan + 1, (i + 1) * _args.ledSpan);
+        }
+        if (_len < MQTT_RECEIVE_DATA_MAX_LEN)
+        {
+            _len += snprintf(_cmd->data + _len, MQTT_RECEIVE_DATA_MAX_LEN - _len, "]}}");
+        }
+        if (_len >= MQTT_RECEIVE_DATA_MAX_LEN)
+        {
+            ESP_LOGE(TAG, "Order BENCH_%d exceeds %d bytes", k, MQTT_RECEIVE_DATA_MAX_LEN);
+            err = ESP_ERR_INVALID_SIZE;
+            break;
+        }
+        err = benchmarkDispatch(_cmd, true, &_stat);
+    }
+    _stat.lightsOnUs = _stat.totalUs;
+    if (err == ESP_OK)
+    {
+        benchmarkFullRefresh(&_stat);
+    }
+    // 取货完成,最后一个订单只取一半库位,剩余库位由结束指示熄灭
+    if (_args.bulk && err == ESP_OK)
+    {
+        err = benchmarkPickupBulk(_cmd, _args.boxNum, _args.orderNum, &_stat);
+    }
+    for (size_t i = 0; i < _args.boxNum && err == ESP_OK && !_args.bulk; i++)
+    {
+        uint8_t _order = i % _args.orderNum;
+        if (_order == _args.orderNum - 1 && i >= _args.boxNum / 2)
+        {
+            continue;
+        }
+        snprintf(_cmd->data, MQTT_RECEIVE_DATA_MAX_LEN,
+                 "{\"control_type\":%d,\"cmd_type\":%d,\"data\":{\"order\":\"BENCH_%d\",\"box\":\"BM%03d\",\"times\":1}}",
+                 MQTT_CONTROL_TYPE_BUSINESS_PICKUP_COMPLETED, PICKUP_COMPLETED, _order, i);
+        err = benchmarkDispatch(_cmd, false, &_stat);
+    }
+    // 结束指示
+    if (err == ESP_OK && getExecutingOrderCount() != 0)
+    {
+        snprintf(_cmd->data, MQTT_RECEIVE_DATA_MAX_LEN,
+                 _args.bulk ? "{\"control_type\":%d,\"cmd_type\":%d,\"data\":{\"order_list\":[\"BENCH_%d\"]}}"
+                            : "{\"control_type\":%d,\"cmd_type\":%d,\"data\":{\"order\":\"BENCH_%d\"}}",
+                 MQTT_CONTROL_TYPE_BUSINESS_END_PICKUP_INSTRUCTION, _args.bulk ? END_PICKUP_INSTRUCTION_BULK : END_PICKUP_INSTRUCTION, _args.orderNum - 1);
+        err = benchmarkDispatch(_cmd, false, &_stat);
+    }
+
+    cJSON_InitHooks(NULL);
+    if (err != ESP_OK) // 测试失败,清除测试残留订单
+    {
+        ESP_LOGE(TAG, "Pick wave benchmark aborted after %d commands [%s]", _stat.cmdCount, esp_err_to_name(err));
+        ledStripKillAllOrder();
+        LEDSTRIP_REFRESH;
+    }
+    else
+    {
+        pickWaveBenchmarkReport(_args.boxNum, _args.orderNum, _args.bulk, &_stat);
+    }
+    free(_stat.latencyUs);
+    free(_cmd);
+    s_benchmarkTaskHandle = NULL;
+    s_benchmarkRunning = false;
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief  当前任务是否因性能测试运行中而不能执行业务命令(测试任务自身除外)
+ * @return true
+ * @return false
+ */
+bool pickWaveBenchmarkBusy(void)
+{
+    return s_benchmarkRunning && s_benchmarkTaskHandle != xTaskGetCurrentTaskHandle();
+}
+
+/**
+ * @brief  启动拣货波次端到端性能测试
+ *         测试在独立任务中通过mqttCmdRecvHandle依次执行脚本化的下发订单(212)、取货完成(213)、结束指示(214)命令，
+ *         统计吞吐量、命令到灯带写入的延迟、全部订单亮灯耗时、cJSON内存申请次数与PSRAM峰值占用，结果以JSON上报。
+ *         bulk为true时改用批量命令，用于对比大订单的亮灯延迟。
+ *         仅允许在没有执行中订单时运行，测试期间MQTT任务照常运行，但拒绝其他来源的订单(212-215)与灯带操作(232)命令。
+ * @param  data  {"box_num":256,"order_num":4,"bulk":false} 字段均可省略
+ * @return esp_err_t 参数错误、已有测试在运行或者任务创建失败时返回错误, 测试结果通过通知上报
+ */
+esp_err_t pickWaveBenchmarkRun(cJSON *data)
+{
+    uint16_t _boxNum = PICK_WAVE_BENCHMARK_DEFAULT_BOX_NUM;
+    uint8_t _orderNum = PICK_WAVE_BENCHMARK_DEFAULT_ORDER_NUM;
+    cJSON *_boxNumJson = cJSON_GetObjectItem(data, "box_num");
+    cJSON *_orderNumJson = cJSON_GetObjectItem(data, "order_num");
+    bool _bulk = cJSON_IsTrue(cJSON_GetObjectItem(data, "bulk"));
+    if (_boxNumJson != NULL) // 先检查范围再转换,负数、NaN(非数字)与过大的值转换为整数是未定义行为
+    {
+        double _value = cJSON_GetNumberValue(_boxNumJson);
+        if (!(_value >= 1 && _value <= LED_STRIP_INDICATION_MAX_ORDER_BOX_SIZE))
+        {
+            ESP_LOGE(TAG, "box_num out of range [1, %d]", LED_STRIP_INDICATION_MAX_ORDER_BOX_SIZE);
+            return ESP_ERR_INVALID_ARG;
+        }
+        _boxNum = _value;
+    }
+    if (_orderNumJson != NULL)
+    {
+        double _value = cJSON_GetNumberValue(_orderNumJson);
+        if (!(_value >= 1 && _value <= LED_STRIP_INDICATION_MAX_ORDERS))
+        {
+            ESP_LOGE(TAG, "order_num out of range [1, %d]", LED_STRIP_INDICATION_MAX_ORDERS);
+            return ESP_ERR_INVALID_ARG;
+        }
+        _orderNum = _value;
+    }
+    uint16_t _ledNum = g_nvsData.DeviceConfigData.ledstripConfigData.ledNum;
+    if (_orderNum > _boxNum)
+    {
+        ESP_LOGE(TAG, "box_num = %d is less than order_num = %d", _boxNum, _orderNum);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if ((_boxNum + _orderNum - 1) / _orderNum > PICK_WAVE_BENCHMARK_MAX_BOXES_PER_ORDER || _ledNum / _boxNum == 0)
+    {
+        ESP_LOGE(TAG, "box_num = %d can not be placed on %d leds with %d orders", _boxNum, _ledNum, _orderNum);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_benchmarkRunning)
+    {
+        ESP_LOGE(TAG, "Pick wave benchmark is already running");
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (getExecutingOrderCount() != 0) // 避免破坏现场订单
+    {
+        ESP_LOGE(TAG, "There are still %d orders executing", getExecutingOrderCount());
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    PickWaveBenchmarkArgs_t *_args = malloc(sizeof(PickWaveBenchmarkArgs_t));
+    if (_args == NULL)
+    {
+        ESP_LOGE(TAG, "No memory for benchmark");
+        return ESP_ERR_NO_MEM;
+    }
+    _args->boxNum = _boxNum;
+    _args->orderNum = _orderNum;
+    _args->ledSpan = _ledNum / _boxNum;
+    _args->bulk = _bulk;
+    s_benchmarkRunning = true; // 任务开始运行前就拒绝其他业务命令
+    if (xTaskCreate(pickWaveBenchmarkTask, "benchmarkTask", PICK_WAVE_BENCHMARK_TASK_STACK_SIZE, _args,
+                    MQTT_TASK_PRIVILEGE | portPRIVILEGE_BIT, NULL) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Create benchmark task failed");
+        s_benchmarkRunning = false;
+        free(_args);
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
@@ -16,8 +16,32 @@ static char *TAG = "MQTT";
 static uint16_t s_mqttConnectRetry = 0, s_mqttMaximumRetry = 0;
 static MqttState_t s_mqttState = MQTT_DISCONNECT;
 static MqttState_t s_lastMqttState = MQTT_DISCONNECT;
+static TaskHandle_t s_mqttTaskHandle = NULL; // 收发队列有数据时通知该任务
 QueueHandle_t g_mqttRecvDataQueueHandler; // MQTT 数据接收队列
-QueueHandle_t g_mqttPubDataQueueHandler;  // MQTT 数据发送队列
+RingbufHandle_t g_mqttPubRingHandle[MQTT_PUB_LANE_MAX]; // MQTT 数据发送环形缓冲区(变长记录),按通道区分
+static MqttCoalesce_t s_mqttCoalesce = {0}; // 出站消息合并缓冲,仅在MQTT任务中访问
+static MqttWireFormat_t s_mqttStatusFormat = MQTT_WIRE_FORMAT_JSON; // 状态消息格式,跟随最近一次收到的命令
+static char s_mqttCborPubTopic[MQTT_TOPIC_MAX_LEN + sizeof(MQTT_CBOR_TOPIC_SUFFIX)] = {0}; // CBOR消息发布主题
+static char s_mqttTelemetryTopic[MQTT_TOPIC_MAX_LEN + sizeof(METRICS_TELEMETRY_TOPIC_SUFFIX)] = {0}; // 遥测快照发布主题
+static int64_t s_mqttReadyTime = 0;      // 最近一次进入MQTT_READY的时间,此前入队的关键消息按补发限速
+static bool s_mqttReplayPending = false; // 关键通道中还有断线期间保存的消息
+static int64_t s_mqttReplayCredit = 0;   // 补发令牌(每条消息消耗1000000)
+static int64_t s_mqttReplayRefillTime = 0;
+static journal_t s_mqttJournal = {0};               // 关键消息Flash日志,未打开时batch为NULL
+static SemaphoreHandle_t s_mqttJournalMutex = NULL; // 保护日志与日志报文表
+static MqttJournalInflight_t s_mqttJournalInflight[MQTT_JOURNAL_INFLIGHT_MAX] = {0};
+static uint32_t s_mqttJournalPublishedSeq = 0; // 已发布的最大日志序号
+static int64_t s_mqttJournalDirtyTime = 0;     // 日志中最早一条未写入Flash的数据产生的时间
+static uint32_t s_mqttJournalBacklogSeq = 0;     // 只在日志中、等待放入关键通道的第一条消息的日志序号,0表示没有
+static uint32_t s_mqttJournalBacklogLastSeq = 0; // 等待放入关键通道的最后一条消息的日志序号
+static int s_mqttJournalBacklogOwner = -1;       // 等待放入的消息所属的重新入队报文(日志报文表下标),-1表示新消息
+static uint32_t s_mqttJournalPendingSeq = 0;     // 重新入队报文的消息放入期间只写入日志的第一条新消息,0表示没有
+static uint32_t s_mqttJournalPendingLastSeq = 0;
+static MqttPubRecord_t *s_mqttPubHeldRecord = NULL; // 已从关键通道取出、等待写入Flash的消息,仅在MQTT任务中访问
+#if CONFIG_MQTT_CMD_DEDUP_CACHE_SIZE > 0
+static MqttCmdCache_t s_mqttCmdCache = {0}; // 已执行命令的msg_id缓存(缓存项在PSRAM中,首次使用时申请),仅在MQTT任务中访问
+static int16_t s_mqttCmdCacheBucket[MQTT_CMD_CACHE_BUCKETS];
+#endif
 static mqtt_cmd_handle_t s_sysSetPageHandle[MQTT_CONTROL_TYPE_CLASSIFY_MAX] = {
     [MQTT_CONTROL_TYPE_CLASSIFY_SCREEN_CONTROL] = {.mqttControlTypeClassify = MQTT_CONTROL_TYPE_CLASSIFY_SCREEN_CONTROL,
                                                    .minClassifyNum = MQTT_CONTROL_TYPE_MINNUM_CLASSIFY_SCREEN_CONTROL,
@@ -60,7 +84,858 @@ void switchMqttState(MqttState_t mqttState)
         s_lastMqttState = s_mqttState;
         s_mqttState = mqttState;
         // ESP_LOGI(TAG, "MqttState %d -> %d", s_lastMqttState, s_mqttState);
+        if (mqttState == MQTT_READY) // 连接就绪后立即发送积压的消息
+        {
+            s_mqttReadyTime = esp_timer_get_time();
+            mqttTaskWake();
+        }
+    }
+}
+
+/**
+ * @brief  唤醒MQTT任务处理收发队列
+ */
+void mqttTaskWake()
+{
+    if (s_mqttTaskHandle != NULL)
+    {
+        xTaskNotifyGive(s_mqttTaskHandle);
+    }
+}
+
+/**
+ * @brief  消息所属的发送通道
+ * @param  flags
+ * @return MqttPubLane_t
+ */
+static MqttPubLane_t mqttPubLaneOf(uint8_t flags)
+{
+    return (flags & MQTT_PUB_FLAG_CRITICAL) ? MQTT_PUB_LANE_CRITICAL : MQTT_PUB_LANE_BEST_EFFORT;
+}
+
+/**
+ * @brief  在发送通道中申请一条记录
+ *         关键通道满时等待MQTT任务发送(在MQTT任务中调用时不等待);尽力通道不等待,丢弃最旧的消息腾出空间
+ * @param  flags
+ * @param  itemSize
+ * @return MqttPubRecord_t* 失败返回NULL
+ */
+static MqttPubRecord_t *mqttPubRecordAcquire(uint8_t flags, size_t itemSize)
+{
+    RingbufHandle_t _ring = g_mqttPubRingHandle[mqttPubLaneOf(flags)];
+    MqttPubRecord_t *_record = NULL;
+    if (flags & MQTT_PUB_FLAG_CRITICAL)
+    {
+        TickType_t _waitTicks = xTaskGetCurrentTaskHandle() == s_mqttTaskHandle ? 0 : pdMS_TO_TICKS(100);
+        return xRingbufferSendAcquire(_ring, (void **)&_record, itemSize, _waitTicks) == pdTRUE ? _record : NULL;
+    }
+    for (size_t i = 0; i <= MQTT_PUB_BEST_EFFORT_EVICT_MAX; i++)
+    {
+        if (xRingbufferSendAcquire(_ring, (void **)&_record, itemSize, 0) == pdTRUE)
+        {
+            return _record;
+        }
+        size_t _oldestSize = 0;
+        MqttPubRecord_t *_oldest = xRingbufferReceive(_ring, &_oldestSize, 0);
+        if (_oldest == NULL)
+        {
+            break;
+        }
+        free(_oldest->extData);
+        vRingbufferReturnItem(_ring, _oldest);
+        metricsCounterInc(METRICS_COUNTER_MQTT_PUB_DROPPED);
+    }
+    return NULL;
+}
+
+/**
+ * @brief  Flash日志是否可用
+ * @return bool
+ */
+static bool mqttJournalOpened()
+{
+    return s_mqttJournal.batch != NULL;
+}
+
+/**
+ * @brief  将关键消息追加到日志批次,由MQTT任务按周期写入Flash(调用方持有日志锁)
+ * @param  data
+ * @param  dataLen
+ * @param  flags
+ * @return uint32_t 日志序号,未写入日志返回0
+ */
+static uint32_t mqttJournalAppend(const char *data, size_t dataLen, uint8_t flags)
+{
+    uint32_t _seq = 0;
+    if (dataLen > JOURNAL_ENTRY_MAX_LEN)
+    {
+        ESP_LOGW(TAG, "Critical message is too long for the journal (%u bytes), kept in RAM only", dataLen);
+        return 0;
+    }
+    if (!journal_dirty(&s_mqttJournal))
+    {
+        s_mqttJournalDirtyTime = esp_timer_get_time();
+    }
+    esp_err_t err = journal_append(&s_mqttJournal, flags, data, dataLen, &_seq);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Journal write failed [%s]", esp_err_to_name(err));
+    }
+    return _seq;
+}
+
+/**
+ * @brief  将关键消息写入日志并放入关键通道(日志锁内不等待通道空间)
+ *         通道已满或日志中还有等待放入的消息时只写入日志,由MQTT任务在通道有空间时按顺序放入,保持日志序号与通道中的顺序一致
+ * @param  data
+ * @param  dataLen
+ * @param  extData  外部数据(所有权移交),为NULL时复制data到记录中
+ * @param  flags
+ * @return bool 已写入日志(未写入时由调用方按仅保存在RAM中的消息入队)
+ */
+static bool mqttPubRingPutJournaled(const char *data, size_t dataLen, char *extData, uint8_t flags)
+{
+    RingbufHandle_t _ring = g_mqttPubRingHandle[MQTT_PUB_LANE_CRITICAL];
+    MqttPubRecord_t *_record = NULL;
+    xSemaphoreTake(s_mqttJournalMutex, portMAX_DELAY);
+    if ((s_mqttJournalBacklogSeq == 0 || (s_mqttJournalBacklogOwner >= 0 && s_mqttJournalPendingSeq == 0)) &&
+        xRingbufferSendAcquire(_ring, (void **)&_record, sizeof(MqttPubRecord_t) + (extData != NULL ? 0 : dataLen), 0) == pdTRUE)
+    {
+        _record->enqueueTime = esp_timer_get_time();
+        _record->dataLen = dataLen;
+        _record->extData = extData;
+        _record->journalSeq = mqttJournalAppend(data, dataLen, flags);
+        _record->flags = flags;
+        if (extData == NULL)
+        {
+            memcpy(_record->data, data, dataLen);
+        }
+        xRingbufferSendComplete(_ring, _record);
+        xSemaphoreGive(s_mqttJournalMutex);
+        return true;
+    }
+    uint32_t _seq = mqttJournalAppend(data, dataLen, flags);
+    if (_seq != 0)
+    {
+        if (s_mqttJournalBacklogSeq == 0)
+        {
+            s_mqttJournalBacklogSeq = _seq;
+            s_mqttJournalBacklogLastSeq = _seq;
+        }
+        else if (s_mqttJournalBacklogOwner < 0)
+        {
+            s_mqttJournalBacklogLastSeq = _seq;
+        }
+        else // 重新入队报文的消息之后再放入
+        {
+            s_mqttJournalPendingSeq = s_mqttJournalPendingSeq == 0 ? _seq : s_mqttJournalPendingSeq;
+            s_mqttJournalPendingLastSeq = _seq;
+        }
+        metricsCounterInc(METRICS_COUNTER_MQTT_JOURNAL_BACKLOG);
+    }
+    xSemaphoreGive(s_mqttJournalMutex);
+    if (_seq != 0)
+    {
+        free(extData);
+    }
+    return _seq != 0;
+}
+
+/**
+ * @brief  将消息放入发送通道并唤醒MQTT任务
+ *         关键消息先写入日志;未写入日志的消息在通道满时等待(不持有日志锁),尽力通道丢弃最旧的消息
+ * @param  data
+ * @param  dataLen
+ * @param  extData  外部数据(所有权移交),为NULL时复制data到记录中
+ * @param  flags
+ * @return esp_err_t
+ */
+static esp_err_t mqttPubRingPut(const char *data, size_t dataLen, char *extData, uint8_t flags)
+{
+    if ((flags & MQTT_PUB_FLAG_CRITICAL) && mqttJournalOpened() && dataLen <= JOURNAL_ENTRY_MAX_LEN &&
+        mqttPubRingPutJournaled(data, dataLen, extData, flags))
+    {
+        mqttTaskWake();
+        return ESP_OK;
+    }
+    MqttPubRecord_t *_record = mqttPubRecordAcquire(flags, sizeof(MqttPubRecord_t) + (extData != NULL ? 0 : dataLen));
+    if (_record == NULL)
+    {
+        metricsCounterInc(METRICS_COUNTER_MQTT_PUB_DROPPED);
+        ESP_LOGE(TAG, "MQTT publish lane %d is full, message dropped (%u bytes)", mqttPubLaneOf(flags), dataLen);
+        free(extData);
+        return ESP_ERR_TIMEOUT;
+    }
+    _record->enqueueTime = esp_timer_get_time();
+    _record->dataLen = dataLen;
+    _record->extData = extData;
+    _record->journalSeq = 0;
+    _record->flags = flags;
+    if (extData == NULL)
+    {
+        memcpy(_record->data, data, dataLen);
+    }
+    xRingbufferSendComplete(g_mqttPubRingHandle[mqttPubLaneOf(flags)], _record);
+    mqttTaskWake();
+    return ESP_OK;
+}
+
+/**
+ * @brief  将消息复制到发送环形缓冲区并唤醒MQTT任务
+ *         消息直接写入缓冲区内的变长记录,不申请堆内存;超出单条记录上限时复制到PSRAM后按外部数据发送
+ * @param  data
+ * @param  dataLen
+ * @param  flags    MQTT_PUB_FLAG_*, MQTT_PUB_FLAG_CRITICAL的消息进入关键通道
+ * @return esp_err_t
+ */
+esp_err_t mqttPubRingSend(const char *data, size_t dataLen, uint8_t flags)
+{
+    if (sizeof(MqttPubRecord_t) + dataLen > xRingbufferGetMaxItemSize(g_mqttPubRingHandle[mqttPubLaneOf(flags)]))
+    {
+        char *_extData = heap_caps_malloc(dataLen, MALLOC_CAP_SPIRAM);
+        if (_extData == NULL)
+        {
+            metricsCounterInc(METRICS_COUNTER_MQTT_PUB_DROPPED);
+            ESP_LOGE(TAG, "No memory for MQTT publish data, message dropped (%u bytes)", dataLen);
+            return ESP_ERR_NO_MEM;
+        }
+        metricsCounterInc(METRICS_COUNTER_MQTT_PUB_HEAP_ALLOC);
+        memcpy(_extData, data, dataLen);
+        return mqttPubRingSendExternal(_extData, dataLen, flags);
+    }
+    return mqttPubRingPut(data, dataLen, NULL, flags);
+}
+
+/**
+ * @brief  将外部缓冲区的消息按引用放入发送环形缓冲区并唤醒MQTT任务
+ *         缓冲区所有权移交给MQTT任务,发送完成(或失败)后以free释放,可直接传入cJSON_PrintUnformatted的结果;
+ *         超过MQTT_PUBLISH_CHUNK_SIZE的数据分段发布
+ * @param  data     heap_caps_malloc/malloc申请的缓冲区
+ * @param  dataLen
+ * @param  flags    MQTT_PUB_FLAG_*
+ * @return esp_err_t
+ */
+esp_err_t mqttPubRingSendExternal(char *data, size_t dataLen, uint8_t flags)
+{
+    return mqttPubRingPut(data, dataLen, data, flags);
+}
+
+/**
+ * @brief  按当前协商的格式(JSON或CBOR)初始化状态消息生成器
+ * @param  writer
+ * @param  buf
+ * @param  size
+ */
+void mqttPubWriterInit(json_writer_t *writer, char *buf, size_t size)
+{
+    json_writer_init_format(writer, buf, size, s_mqttStatusFormat == MQTT_WIRE_FORMAT_CBOR ? JSON_WRITER_FORMAT_CBOR : JSON_WRITER_FORMAT_JSON);
+}
+
+/**
+ * @brief  结束生成并将消息放入发送环形缓冲区
+ * @param  writer   mqttPubWriterInit初始化的生成器
+ * @param  flags    MQTT_PUB_FLAG_URGENT / MQTT_PUB_FLAG_CRITICAL, 格式标志按生成器自动设置
+ * @return esp_err_t
+ */
+esp_err_t mqttPubWriterSend(json_writer_t *writer, uint8_t flags)
+{
+    size_t _len;
+    esp_err_t err = json_writer_finish(writer, &_len);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to build status message [%s], dropped", esp_err_to_name(err));
+        return err;
+    }
+    if (writer->format == JSON_WRITER_FORMAT_CBOR)
+    {
+        flags |= MQTT_PUB_FLAG_CBOR;
+    }
+    return mqttPubRingSend(writer->buf, _len, flags);
+}
+
+/**
+ * @brief  订阅命令主题,启用CBOR时在同一个订阅请求中同时订阅 订阅主题/cbor
+ * @param  mqttConfigData
+ */
+void mqttCmdTopicSubscribe(MqttConfigData_t *mqttConfigData)
+{
+#if CONFIG_MQTT_CBOR_ENABLE
+    char _cborTopic[MQTT_TOPIC_MAX_LEN + sizeof(MQTT_CBOR_TOPIC_SUFFIX)];
+    snprintf(_cborTopic, sizeof(_cborTopic), "%s%s", mqttConfigData->subTopic, MQTT_CBOR_TOPIC_SUFFIX);
+    esp_mqtt_topic_t _topics[] = {
+        {.filter = mqttConfigData->subTopic, .qos = mqttConfigData->subQos},
+        {.filter = _cborTopic, .qos = mqttConfigData->subQos},
+    };
+    esp_mqtt_client_subscribe_multiple(g_mqttClientHandle, _topics, sizeof(_topics) / sizeof(_topics[0]));
+#else
+    esp_mqtt_client_subscribe(g_mqttClientHandle, mqttConfigData->subTopic, mqttConfigData->subQos);
+#endif
+}
+
+/**
+ * @brief  取消订阅命令主题
+ * @param  mqttConfigData
+ */
+void mqttCmdTopicUnsubscribe(MqttConfigData_t *mqttConfigData)
+{
+    esp_mqtt_client_unsubscribe(g_mqttClientHandle, mqttConfigData->subTopic);
+#if CONFIG_MQTT_CBOR_ENABLE
+    char _cborTopic[MQTT_TOPIC_MAX_LEN + sizeof(MQTT_CBOR_TOPIC_SUFFIX)];
+    snprintf(_cborTopic, sizeof(_cborTopic), "%s%s", mqttConfigData->subTopic, MQTT_CBOR_TOPIC_SUFFIX);
+    esp_mqtt_client_unsubscribe(g_mqttClientHandle, _cborTopic);
+#endif
+}
+
+/**
+ * @brief  发送通道中待发送的消息数
+ * @param  lane
+ * @return UBaseType_t
+ */
+static UBaseType_t mqttPubRingWaiting(MqttPubLane_t lane)
+{
+    UBaseType_t _itemsWaiting = 0;
+    vRingbufferGetInfo(g_mqttPubRingHandle[lane], NULL, NULL, NULL, NULL, &_itemsWaiting);
+    return _itemsWaiting;
+}
+
+/**
+ * @brief  按消息类型确定发送标志
+ *         复位与OTA状态发出后设备可能立即重启,不能在合并窗口中等待;业务消息(200-249)为关键消息,断线期间保存
+ * @param  controlType
+ * @return uint8_t MQTT_PUB_FLAG_*
+ */
+static uint8_t mqttPubFlagsOf(uint16_t controlType)
+{
+    uint8_t _flags = 0;
+    if (controlType == MQTT_CONTROL_TYPE_SYSTEM_REBOOT || controlType == MQTT_CONTROL_TYPE_SYSTEM_OTA)
+    {
+        _flags |= MQTT_PUB_FLAG_URGENT;
+    }
+    if (controlType >= MQTT_CONTROL_TYPE_MINNUM_CLASSIFY_BUSINESS && controlType <= MQTT_CONTROL_TYPE_MAXNUM_CLASSIFY_BUSINESS)
+    {
+        _flags |= MQTT_PUB_FLAG_CRITICAL;
+    }
+    return _flags;
+}
+
+/**
+ * @brief  重连后开始补发断线期间保存的关键消息,令牌桶填满以便立即补发一小批
+ */
+static void mqttReplayStart()
+{
+    UBaseType_t _backlog = mqttPubRingWaiting(MQTT_PUB_LANE_CRITICAL);
+    s_mqttReplayPending = _backlog > 0;
+    s_mqttReplayCredit = MQTT_PUB_REPLAY_BURST * 1000000LL;
+    s_mqttReplayRefillTime = esp_timer_get_time();
+    if (s_mqttReplayPending)
+    {
+        ESP_LOGI(TAG, "Replaying %u stored critical messages at %d/s", _backlog, CONFIG_MQTT_REPLAY_RATE);
+    }
+}
+
+/**
+ * @brief  取一个补发令牌
+ * @return bool 令牌不足时返回false
+ */
+static bool mqttReplayTokenTake()
+{
+    int64_t _now = esp_timer_get_time();
+    s_mqttReplayCredit += (_now - s_mqttReplayRefillTime) * CONFIG_MQTT_REPLAY_RATE;
+    s_mqttReplayRefillTime = _now;
+    if (s_mqttReplayCredit > MQTT_PUB_REPLAY_BURST * 1000000LL)
+    {
+        s_mqttReplayCredit = MQTT_PUB_REPLAY_BURST * 1000000LL;
+    }
+    if (s_mqttReplayCredit < 1000000)
+    {
+        return false;
+    }
+    s_mqttReplayCredit -= 1000000;
+    return true;
+}
+
+/**
+ * @brief  发布一个MQTT报文并统计报文数与字节数
+ * @param  topic
+ * @param  data
+ * @param  dataLen
+ * @param  pubQos
+ * @return int 报文ID(QoS0为0),失败返回负数
+ */
+static int mqttPublish(const char *topic, const char *data, size_t dataLen, int pubQos)
+{
+    ESP_LOGD(TAG, "MQTT Publish. Topic: %s  Len: %u", topic, dataLen); // 负载可能为CBOR,不打印内容
+    int _msgId = esp_mqtt_client_publish(g_mqttClientHandle, topic, data, dataLen, pubQos, 0);
+    metricsCounterInc(METRICS_COUNTER_MQTT_PUBLISHED);
+    metricsCounterAdd(METRICS_COUNTER_MQTT_PUB_BYTES, dataLen);
+    return _msgId;
+}
+
+/**
+ * @brief  登记包含日志消息的报文,收到PUBACK前其中的消息不从日志中确认
+ *         发布失败的报文按丢失处理,由MQTT任务从日志重新入队
+ * @param  msgId
+ * @param  journalSeq   报文中各消息的日志序号(0表示未写入日志)
+ * @param  count
+ */
+static void mqttJournalTrack(int msgId, const uint32_t *journalSeq, size_t count)
+{
+    uint32_t _firstSeq = UINT32_MAX, _lastSeq = 0;
+    xSemaphoreTake(s_mqttJournalMutex, portMAX_DELAY);
+    for (size_t i = 0; i < count; i++)
+    {
+        if (journalSeq[i] == 0)
+        {
+            continue;
+        }
+        _firstSeq = journalSeq[i] < _firstSeq ? journalSeq[i] : _firstSeq;
+        _lastSeq = journalSeq[i] > _lastSeq ? journalSeq[i] : _lastSeq;
+        for (size_t j = 0; j < MQTT_JOURNAL_INFLIGHT_MAX; j++) // 重新入队的消息已重新发布
+        {
+            MqttJournalInflight_t *_inflight = &s_mqttJournalInflight[j];
+            if (_inflight->state == MQTT_JOURNAL_INFLIGHT_REQUEUED && journalSeq[i] >= _inflight->firstSeq && journalSeq[i] <= _inflight->lastSeq &&
+                _inflight->remaining > 0 && --_inflight->remaining == 0 && (int)j != s_mqttJournalBacklogOwner) // 还有消息在日志中等待放入时不释放
+            {
+                _inflight->state = MQTT_JOURNAL_INFLIGHT_FREE;
+            }
+        }
+    }
+    size_t i = 0;
+    for (; i < MQTT_JOURNAL_INFLIGHT_MAX && s_mqttJournalInflight[i].state != MQTT_JOURNAL_INFLIGHT_FREE; i++)
+    {
+    }
+    if (i < MQTT_JOURNAL_INFLIGHT_MAX)
+    {
+        s_mqttJournalInflight[i] = (MqttJournalInflight_t){
+            .state = msgId < 0 ? MQTT_JOURNAL_INFLIGHT_LOST : MQTT_JOURNAL_INFLIGHT_SENT,
+            .msgId = msgId,
+            .firstSeq = _firstSeq,
+            .lastSeq = _lastSeq,
+        };
+    }
+    else // 发布前已检查空位,不应出现
+    {
+        ESP_LOGE(TAG, "Journal inflight table is full, messages %lu-%lu are not tracked", _firstSeq, _lastSeq);
+    }
+    if (_lastSeq > s_mqttJournalPublishedSeq)
+    {
+        s_mqttJournalPublishedSeq = _lastSeq;
+    }
+    xSemaphoreGive(s_mqttJournalMutex);
+}
+
+/**
+ * @brief  发布报文,其中包含日志消息时至少使用QoS1,以便收到PUBACK后从日志中确认
+ * @param  topic
+ * @param  data
+ * @param  dataLen
+ * @param  pubQos
+ * @param  journalSeq   报文中各消息的日志序号
+ * @param  count
+ */
+static void mqttPublishJournaled(const char *topic, const char *data, size_t dataLen, int pubQos, const uint32_t *journalSeq, size_t count)
+{
+    bool _journaled = false;
+    for (size_t i = 0; i < count && !_journaled; i++)
+    {
+        _journaled = journalSeq[i] != 0;
+    }
+    if (!_journaled)
+    {
+        mqttPublish(topic, data, dataLen, pubQos);
+        return;
+    }
+    mqttJournalTrack(mqttPublish(topic, data, dataLen, pubQos > 0 ? pubQos : 1), journalSeq, count);
+}
+
+/**
+ * @brief  消息格式对应的发布主题
+ * @param  pubTopic
+ * @param  format
+ * @return const char*
+ */
+static const char *mqttPubTopicOf(const char *pubTopic, MqttWireFormat_t format)
+{
+    return format == MQTT_WIRE_FORMAT_CBOR ? s_mqttCborPubTopic : pubTopic;
+}
+
+/**
+ * @brief  发送合并缓冲中的消息
+ *         仅有一条消息时不加数组信封,与未合并时的格式一致
+ * @param  pubTopic
+ * @param  pubQos
+ */
+static void mqttCoalesceFlush(const char *pubTopic, int pubQos)
+{
+    MqttCoalesce_t *_coalesce = &s_mqttCoalesce;
+    if (_coalesce->count == 0)
+    {
+        return;
+    }
+    const char *_topic = mqttPubTopicOf(pubTopic, _coalesce->format);
+    if (_coalesce->count == 1)
+    {
+        mqttPublishJournaled(_topic, _coalesce->buf + 1, _coalesce->len - 1, pubQos, _coalesce->journalSeq, 1);
+    }
+    else
+    {
+        _coalesce->buf[_coalesce->len++] = _coalesce->format == MQTT_WIRE_FORMAT_CBOR ? MQTT_CBOR_BREAK : ']';
+        mqttPublishJournaled(_topic, _coalesce->buf, _coalesce->len, pubQos, _coalesce->journalSeq, _coalesce->count);
+    }
+    int64_t _now = esp_timer_get_time();
+    for (size_t i = 0; i < _coalesce->count; i++)
+    {
+        metricsHistogramRecord(METRICS_HISTOGRAM_MQTT_PUB_LATENCY, _now - _coalesce->enqueueTime[i]);
+    }
+    _coalesce->len = 0;
+    _coalesce->count = 0;
+}
+
+/**
+ * @brief  将一条消息加入合并缓冲
+ *         缓冲放不下或消息格式与缓冲中的不同时先发送已合并的消息;关闭合并或单条消息超过字节预算时直接发布
+ * @param  data
+ * @param  dataLen
+ * @param  enqueueTime
+ * @param  journalSeq   日志序号,0表示未写入日志
+ * @param  format
+ * @param  pubTopic
+ * @param  pubQos
+ */
+static void mqttCoalesceAppend(const char *data, size_t dataLen, int64_t enqueueTime, uint32_t journalSeq, MqttWireFormat_t format, const char *pubTopic, int pubQos)
+{
+    MqttCoalesce_t *_coalesce = &s_mqttCoalesce;
+    metricsCounterInc(METRICS_COUNTER_MQTT_PUB_EVENTS);
+    if (CONFIG_MQTT_COALESCE_WINDOW_MS == 0 || _coalesce->buf == NULL || dataLen + 2 > CONFIG_MQTT_COALESCE_MAX_BYTES)
+    {
+        mqttCoalesceFlush(pubTopic, pubQos); // 保持发送顺序
+        mqttPublishJournaled(mqttPubTopicOf(pubTopic, format), data, dataLen, pubQos, &journalSeq, 1);
+        metricsHistogramRecord(METRICS_HISTOGRAM_MQTT_PUB_LATENCY, esp_timer_get_time() - enqueueTime);
+        return;
+    }
+    if (_coalesce->len + dataLen + 2 > CONFIG_MQTT_COALESCE_MAX_BYTES || _coalesce->count >= MQTT_COALESCE_MAX_EVENTS ||
+        (_coalesce->count > 0 && _coalesce->format != format))
+    {
+        mqttCoalesceFlush(pubTopic, pubQos);
+    }
+    if (_coalesce->count == 0)
+    {
+        _coalesce->windowStart = esp_timer_get_time();
+        _coalesce->format = format;
+        _coalesce->buf[_coalesce->len++] = format == MQTT_WIRE_FORMAT_CBOR ? MQTT_CBOR_ARRAY_INDEFINITE : '[';
+    }
+    else if (format == MQTT_WIRE_FORMAT_JSON) // CBOR数组元素之间没有分隔符
+    {
+        _coalesce->buf[_coalesce->len++] = ',';
+    }
+    memcpy(_coalesce->buf + _coalesce->len, data, dataLen);
+    _coalesce->len += dataLen;
+    _coalesce->journalSeq[_coalesce->count] = journalSeq;
+    _coalesce->enqueueTime[_coalesce->count++] = enqueueTime;
+}
+
+/**
+ * @brief  合并窗口剩余时间
+ * @return TickType_t 合并缓冲为空时返回空闲等待时间
+ */
+static TickType_t mqttCoalesceWaitTicks()
+{
+    if (s_mqttCoalesce.count == 0)
+    {
+        return pdMS_TO_TICKS(MQTT_TASK_IDLE_WAKE_MS);
+    }
+    int64_t _elapsedMs = (esp_timer_get_time() - s_mqttCoalesce.windowStart) / 1000;
+    if (_elapsedMs >= CONFIG_MQTT_COALESCE_WINDOW_MS)
+    {
+        return 0;
+    }
+    TickType_t _ticks = pdMS_TO_TICKS(CONFIG_MQTT_COALESCE_WINDOW_MS - _elapsedMs);
+    return _ticks > 0 ? _ticks : 1;
+}
+
+/**
+ * @brief  将日志中重放的关键消息放入关键通道,沿用原日志序号
+ *         通道放不下时记录该序号,其后的消息也不再放入(保持顺序),留在日志中等待下次放入
+ * @param  seq
+ * @param  tag      写入日志时的MQTT_PUB_FLAG_*
+ * @param  data
+ * @param  len
+ * @param  arg      MqttJournalFeed_t*
+ */
+static void mqttJournalReplayCb(uint32_t seq, uint8_t tag, const uint8_t *data, size_t len, void *arg)
+{
+    MqttJournalFeed_t *_feed = arg;
+    uint8_t _flags = tag | MQTT_PUB_FLAG_CRITICAL;
+    MqttPubRecord_t *_record = NULL;
+    if (_feed->fullSeq != 0)
+    {
+        return;
+    }
+    if (xRingbufferSendAcquire(g_mqttPubRingHandle[MQTT_PUB_LANE_CRITICAL], (void **)&_record, sizeof(MqttPubRecord_t) + len, 0) != pdTRUE)
+    {
+        _feed->fullSeq = seq;
+        return;
+    }
+    _record->enqueueTime = esp_timer_get_time();
+    _record->dataLen = len;
+    _record->extData = NULL;
+    _record->journalSeq = seq;
+    _record->flags = _flags;
+    memcpy(_record->data, data, len);
+    xRingbufferSendComplete(g_mqttPubRingHandle[MQTT_PUB_LANE_CRITICAL], _record);
+    _feed->count++;
+    _feed->ownerCount += seq <= _feed->ownerLastSeq;
+}
+
+/**
+ * @brief  将只在日志中的消息按顺序放入关键通道,只放入已写入Flash的部分;通道满时停在第一条放不下的消息,下次继续(调用方持有日志锁)
+ *         重新入队报文的消息全部放入后继续放入期间只写入日志的新消息;报文在其消息全部重新发布后释放
+ * @return uint16_t 放入的消息数
+ */
+static uint16_t mqttJournalBacklogFeed()
+{
+    uint16_t _count = 0;
+    while (s_mqttJournalBacklogSeq != 0 && s_mqttJournalBacklogSeq <= s_mqttJournal.durable_seq)
+    {
+        MqttJournalInflight_t *_owner = s_mqttJournalBacklogOwner >= 0 ? &s_mqttJournalInflight[s_mqttJournalBacklogOwner] : NULL;
+        uint32_t _lastSeq = s_mqttJournalBacklogLastSeq < s_mqttJournal.durable_seq ? s_mqttJournalBacklogLastSeq : s_mqttJournal.durable_seq;
+        MqttJournalFeed_t _feed = {.ownerLastSeq = _owner != NULL ? _owner->lastSeq : 0};
+        journal_replay(&s_mqttJournal, s_mqttJournalBacklogSeq, _lastSeq, mqttJournalReplayCb, &_feed);
+        _count += _feed.count;
+        if (_owner != NULL)
+        {
+            _owner->remaining += _feed.ownerCount;
+        }
+        if (_feed.fullSeq != 0 || _lastSeq < s_mqttJournalBacklogLastSeq)
+        {
+            s_mqttJournalBacklogSeq = _feed.fullSeq != 0 ? _feed.fullSeq : _lastSeq + 1;
+            break;
+        }
+        if (_owner != NULL && _owner->remaining == 0)
+        {
+            _owner->state = MQTT_JOURNAL_INFLIGHT_FREE;
+        }
+        s_mqttJournalBacklogSeq = s_mqttJournalPendingSeq;
+        s_mqttJournalBacklogLastSeq = s_mqttJournalPendingLastSeq;
+        s_mqttJournalBacklogOwner = -1;
+        s_mqttJournalPendingSeq = 0;
+    }
+    return _count;
+}
+
+/**
+ * @brief  打开关键消息Flash日志,将上次运行中未收到PUBACK的消息恢复到关键通道(在发送通道创建后调用)
+ *         通道放不下的消息留在日志中,由MQTT任务在通道有空间时继续放入
+ * @return esp_err_t
+ */
+esp_err_t mqttJournalInit()
+{
+#if CONFIG_MQTT_JOURNAL_ENABLE
+    s_mqttJournalMutex = xSemaphoreCreateMutex();
+    esp_err_t err = journal_open_partition(&s_mqttJournal, MQTT_JOURNAL_PARTITION_LABEL);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to open journal partition [%s], critical messages are kept in RAM only", esp_err_to_name(err));
+        return err;
+    }
+    xSemaphoreTake(s_mqttJournalMutex, portMAX_DELAY);
+    s_mqttJournalPublishedSeq = s_mqttJournal.trim_seq;
+    if (s_mqttJournal.next_seq - 1 > s_mqttJournal.trim_seq)
+    {
+        s_mqttJournalBacklogSeq = s_mqttJournal.trim_seq + 1;
+        s_mqttJournalBacklogLastSeq = s_mqttJournal.next_seq - 1;
+    }
+    uint16_t _count = mqttJournalBacklogFeed();
+    ESP_LOGI(TAG, "Journal opened: %u unacknowledged critical messages restored, next seq %lu%s", _count, s_mqttJournal.next_seq,
+             s_mqttJournalBacklogSeq != 0 ? ", the rest wait in the journal" : "");
+    xSemaphoreGive(s_mqttJournalMutex);
+#endif
+    return ESP_OK;
+}
+
+/**
+ * @brief  报文的发布结果(在MQTT事件循环中调用)
+ * @param  msgId
+ * @param  delivered    true: 收到PUBACK; false: 客户端丢弃了超时未确认的报文
+ */
+static void mqttJournalPubResult(int msgId, bool delivered)
+{
+    if (!mqttJournalOpened())
+    {
+        return;
+    }
+    xSemaphoreTake(s_mqttJournalMutex, portMAX_DELAY);
+    for (size_t i = 0; i < MQTT_JOURNAL_INFLIGHT_MAX; i++)
+    {
+        if (s_mqttJournalInflight[i].state == MQTT_JOURNAL_INFLIGHT_SENT && s_mqttJournalInflight[i].msgId == msgId)
+        {
+            s_mqttJournalInflight[i].state = delivered ? MQTT_JOURNAL_INFLIGHT_ACKED : MQTT_JOURNAL_INFLIGHT_LOST;
+            break;
+        }
+    }
+    xSemaphoreGive(s_mqttJournalMutex);
+    mqttTaskWake();
+}
+
+/**
+ * @brief  写入日志批次(调用方持有日志锁)
+ *         失败时未写入的消息留在批次中,不能发送,一个写入周期后重试
+ * @return esp_err_t
+ */
+static esp_err_t mqttJournalFlush()
+{
+    esp_err_t err = journal_flush(&s_mqttJournal);
+    metricsCounterInc(METRICS_COUNTER_MQTT_JOURNAL_FLUSHES);
+    if (err != ESP_OK)
+    {
+        s_mqttJournalDirtyTime = esp_timer_get_time();
+        ESP_LOGE(TAG, "Journal flush failed [%s], %lu critical messages wait in RAM", esp_err_to_name(err),
+                 s_mqttJournal.next_seq - 1 - s_mqttJournal.durable_seq);
+    }
+    return err;
+}
+
+/**
+ * @brief  维护日志: 只在日志中的消息放入关键通道,丢失的报文从日志重新入队,按已确认的报文推进确认序号,到达写入周期时将批次写入Flash
+ *         确认序号 = 所有未确认报文与只在日志中的消息中最小的日志序号 - 1,都没有时为已发布的最大日志序号
+ *         只在日志中的消息全部放入通道后才处理下一个丢失的报文
+ */
+static void mqttJournalService()
+{
+    if (!mqttJournalOpened())
+    {
+        return;
+    }
+    xSemaphoreTake(s_mqttJournalMutex, portMAX_DELAY);
+    mqttJournalBacklogFeed();
+    uint32_t _trimSeq = s_mqttJournalPublishedSeq;
+    for (size_t i = 0; i < MQTT_JOURNAL_INFLIGHT_MAX; i++)
+    {
+        MqttJournalInflight_t *_inflight = &s_mqttJournalInflight[i];
+        if (_inflight->state == MQTT_JOURNAL_INFLIGHT_ACKED)
+        {
+            _inflight->state = MQTT_JOURNAL_INFLIGHT_FREE;
+        }
+        else if (_inflight->state == MQTT_JOURNAL_INFLIGHT_LOST && s_mqttJournalBacklogSeq == 0)
+        {
+            _inflight->state = MQTT_JOURNAL_INFLIGHT_REQUEUED;
+            _inflight->remaining = 0;
+            s_mqttJournalBacklogSeq = _inflight->firstSeq;
+            s_mqttJournalBacklogLastSeq = _inflight->lastSeq;
+            s_mqttJournalBacklogOwner = i;
+            uint16_t _count = mqttJournalBacklogFeed();
+            ESP_LOGW(TAG, "MQTT message %d was not acknowledged, %u journal messages requeued%s", _inflight->msgId, _count,
+                     s_mqttJournalBacklogSeq != 0 ? ", the rest wait in the journal" : "");
+        }
+        if (_inflight->state != MQTT_JOURNAL_INFLIGHT_FREE && _inflight->firstSeq - 1 < _trimSeq)
+        {
+            _trimSeq = _inflight->firstSeq - 1;
+        }
+    }
+    if (s_mqttJournalBacklogSeq != 0 && s_mqttJournalBacklogSeq - 1 < _trimSeq)
+    {
+        _trimSeq = s_mqttJournalBacklogSeq - 1;
+    }
+    if (!journal_dirty(&s_mqttJournal))
+    {
+        s_mqttJournalDirtyTime = esp_timer_get_time();
+    }
+    journal_trim(&s_mqttJournal, _trimSeq);
+    if (journal_dirty(&s_mqttJournal) && esp_timer_get_time() - s_mqttJournalDirtyTime >= CONFIG_MQTT_JOURNAL_FLUSH_MS * 1000LL)
+    {
+        mqttJournalFlush();
+    }
+    xSemaphoreGive(s_mqttJournalMutex);
+}
+
+/**
+ * @brief  消息是否已写入Flash(未写入日志的消息视为已写入)
+ * @param  journalSeq
+ * @return bool
+ */
+static bool mqttJournalIsDurable(uint32_t journalSeq)
+{
+    if (journalSeq == 0 || !mqttJournalOpened())
+    {
+        return true;
+    }
+    xSemaphoreTake(s_mqttJournalMutex, portMAX_DELAY);
+    bool _durable = journalSeq <= s_mqttJournal.durable_seq;
+    xSemaphoreGive(s_mqttJournalMutex);
+    return _durable;
+}
+
+/**
+ * @brief  关键通道能否发送: 日志报文表有空位,且等待写入Flash的消息已写入(批次按周期写入,限制Flash写入频率;写入失败时一直等待)
+ * @return bool
+ */
+static bool mqttJournalPubReady()
+{
+    if (!mqttJournalOpened())
+    {
+        return true;
+    }
+    size_t _free = 0;
+    xSemaphoreTake(s_mqttJournalMutex, portMAX_DELAY);
+    for (size_t i = 0; i < MQTT_JOURNAL_INFLIGHT_MAX; i++)
+    {
+        _free += s_mqttJournalInflight[i].state == MQTT_JOURNAL_INFLIGHT_FREE;
+    }
+    xSemaphoreGive(s_mqttJournalMutex);
+    return _free >= 2 && (s_mqttPubHeldRecord == NULL || mqttJournalIsDurable(s_mqttPubHeldRecord->journalSeq)); // 合并缓冲与本条消息各可能占用一个
+}
+
+/**
+ * @brief  只在日志中的消息能否放入关键通道(通道已空,消息已写入Flash)
+ * @return bool
+ */
+static bool mqttJournalBacklogReady()
+{
+    if (!mqttJournalOpened() || mqttPubRingWaiting(MQTT_PUB_LANE_CRITICAL) > 0)
+    {
+        return false;
     }
+    xSemaphoreTake(s_mqttJournalMutex, portMAX_DELAY);
+    bool _ready = s_mqttJournalBacklogSeq != 0 && s_mqttJournalBacklogSeq <= s_mqttJournal.durable_seq;
+    xSemaphoreGive(s_mqttJournalMutex);
+    return _ready;
+}
+
+/**
+ * @brief  日志批次到达写入周期的剩余时间
+ * @return TickType_t 没有待写入的数据时返回空闲等待时间
+ */
+static TickType_t mqttJournalWaitTicks()
+{
+    if (!mqttJournalOpened() || !journal_dirty(&s_mqttJournal))
+    {
+        return pdMS_TO_TICKS(MQTT_TASK_IDLE_WAKE_MS);
+    }
+    int64_t _elapsedMs = (esp_timer_get_time() - s_mqttJournalDirtyTime) / 1000;
+    if (_elapsedMs >= CONFIG_MQTT_JOURNAL_FLUSH_MS)
+    {
+        return 0;
+    }
+    TickType_t _ticks = pdMS_TO_TICKS(CONFIG_MQTT_JOURNAL_FLUSH_MS - _elapsedMs);
+    return _ticks > 0 ? _ticks : 1;
+}
+
+/**
+ * @brief  MQTT任务下一次等待的时间: 合并窗口剩余时间,补发中不超过一个令牌间隔
+ * @return TickType_t
+ */
+static TickType_t mqttTaskWaitTicks()
+{
+    TickType_t _ticks = mqttCoalesceWaitTicks();
+    TickType_t _journalTicks = mqttJournalWaitTicks();
+    _ticks = _journalTicks < _ticks ? _journalTicks : _ticks;
+    if (s_mqttReplayPending && getMqttState() == MQTT_READY)
+    {
+        TickType_t _replayTicks = pdMS_TO_TICKS(1000 / CONFIG_MQTT_REPLAY_RATE);
+        _replayTicks = _replayTicks > 0 ? _replayTicks : 1;
+        _ticks = _replayTicks < _ticks ? _replayTicks : _ticks;
+    }
+    return _ticks;
 }
 
 /**
@@ -96,6 +971,24 @@ esp_mqtt_client_handle_t mqttInit(MqttConfigData_t *mqttConfigData)
     return clientHandle;
 }
 
+/**
+ * @brief  根据接收主题判断消息格式, 订阅主题/cbor 上的消息为CBOR
+ * @param  topic
+ * @param  topicLen
+ * @return MqttWireFormat_t
+ */
+static MqttWireFormat_t mqttTopicWireFormat(const char *topic, size_t topicLen)
+{
+#if CONFIG_MQTT_CBOR_ENABLE
+    size_t _suffixLen = strlen(MQTT_CBOR_TOPIC_SUFFIX);
+    if (topicLen > _suffixLen && memcmp(topic + topicLen - _suffixLen, MQTT_CBOR_TOPIC_SUFFIX, _suffixLen) == 0)
+    {
+        return MQTT_WIRE_FORMAT_CBOR;
+    }
+#endif
+    return MQTT_WIRE_FORMAT_JSON;
+}
+
 /**
  * @brief Event handler registered to receive MQTT events
  *
@@ -152,6 +1045,14 @@ void mqttEventHandler(void *handler_args, esp_event_base_t base, int32_t event_i
     case MQTT_EVENT_PUBLISHED:
     {
         ESP_LOGI(TAG, "MQTT_EVENT_PUBLISHED, msg_id=%d", event->msg_id);
+        mqttJournalPubResult(event->msg_id, true);
+        break;
+    }
+
+    case MQTT_EVENT_DELETED: // 超时未确认的报文被客户端丢弃
+    {
+        ESP_LOGW(TAG, "MQTT_EVENT_DELETED, msg_id=%d", event->msg_id);
+        mqttJournalPubResult(event->msg_id, false);
         break;
     }
 
@@ -175,12 +1076,20 @@ void mqttEventHandler(void *handler_args, esp_event_base_t base, int32_t event_i
             _mqttRecvData.dataLen = event->total_data_len; // 复制数据长度
             _mqttRecvData.topicLen = event->topic_len;
             memcpy(_mqttRecvData.topic, event->topic, event->topic_len); // 复制接收到的主题
+            _mqttRecvData.format = mqttTopicWireFormat(event->topic, event->topic_len);
         }
         memcpy(_mqttRecvData.data + event->current_data_offset, event->data, event->data_len); // 复制接收到的数据
         if ((event->current_data_offset + event->data_len) == event->total_data_len)           // 最后一个事件处理完成
         {
             _mqttRecvData.data[event->total_data_len] = '\0';
-            xQueueSend(g_mqttRecvDataQueueHandler, &_mqttRecvData, pdMS_TO_TICKS(100));
+            TRACE_EMIT(TRACE_EVENT_MQTT_RECV, event->total_data_len, 0);
+            if (xQueueSend(g_mqttRecvDataQueueHandler, &_mqttRecvData, pdMS_TO_TICKS(100)) != pdTRUE)
+            {
+                metricsCounterInc(METRICS_COUNTER_MQTT_RECV_DROPPED);
+                ESP_LOGE(TAG, "MQTT receive queue is full, command dropped");
+            }
+            mqttTaskWake();
+            metricsGaugeSet(METRICS_GAUGE_MQTT_RECV_QUEUE, uxQueueMessagesWaiting(g_mqttRecvDataQueueHandler));
             memset(&_mqttRecvData, 0, sizeof(_mqttRecvData));
             break;
         }
@@ -217,11 +1126,83 @@ void mqttEventHandler(void *handler_args, esp_event_base_t base, int32_t event_i
 }
 
 /**
- * @brief  处理接收的MQTT命令
+ * @brief  打印接收的命令内容, CBOR以十六进制打印
  * @param  mqttRecvData
+ * @param  level
+ */
+static void mqttRecvDataLog(MqttReceiveData_t *mqttRecvData, esp_log_level_t level)
+{
+    if (mqttRecvData->format == MQTT_WIRE_FORMAT_CBOR)
+    {
+        ESP_LOG_BUFFER_HEX_LEVEL(TAG, mqttRecvData->data, mqttRecvData->dataLen, level);
+    }
+    else
+    {
+        ESP_LOG_LEVEL(level, TAG, "\n%.*s", mqttRecvData->dataLen, mqttRecvData->data);
+    }
+}
+
+/**
+ * @brief  读取命令的msg_id(字符串或数字),数字转换为字符串
+ * @param  jsonData
+ * @param  msgId    输出
+ * @param  size
+ * @return bool     命令不带msg_id或msg_id过长时返回false
+ */
+static bool mqttCmdMsgIdGet(cJSON *jsonData, char *msgId, size_t size)
+{
+    cJSON *_msgIdJson = cJSON_GetObjectItem(jsonData, "msg_id");
+    int _len = -1;
+    if (cJSON_IsString(_msgIdJson))
+    {
+        _len = snprintf(msgId, size, "%s", cJSON_GetStringValue(_msgIdJson));
+    }
+    else if (cJSON_IsNumber(_msgIdJson))
+    {
+        _len = snprintf(msgId, size, "%.17g", cJSON_GetNumberValue(_msgIdJson));
+    }
+    if (_len <= 0)
+    {
+        return false;
+    }
+    if ((size_t)_len >= size)
+    {
+        ESP_LOGW(TAG, "msg_id is longer than %d, duplicate check skipped", MQTT_CMD_ID_MAX_LEN - 1);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief  按control_type分类执行命令
+ * @param  ctx  MqttCmdExecCtx_t*
+ * @return int  esp_err_t
+ */
+static int mqttCmdExecute(void *ctx)
+{
+    MqttCmdExecCtx_t *_cmd = ctx;
+    esp_err_t err = ESP_FAIL;
+    for (size_t i = 0; i < MQTT_CONTROL_TYPE_CLASSIFY_MAX; i++)
+    {
+        if ((_cmd->controlType >= s_sysSetPageHandle[i].minClassifyNum) && (_cmd->controlType <= s_sysSetPageHandle[i].maxClassifyNum))
+        {
+            TRACE_EMIT(TRACE_EVENT_MQTT_DISPATCH_BEGIN, _cmd->controlType, _cmd->cmdType);
+            err = s_sysSetPageHandle[i].mqtt_cmd_handle(_cmd->controlType, _cmd->cmdType, _cmd->data);
+            TRACE_EMIT(TRACE_EVENT_MQTT_DISPATCH_END, _cmd->controlType, err);
+            break;
+        }
+    }
+    return err;
+}
+
+/**
+ * @brief  解析并执行接收的MQTT命令
+ *         带msg_id的命令已执行成功过时不再执行,直接返回成功;执行失败的命令不记录,可用同一msg_id重试
+ * @param  mqttRecvData
+ * @param  info         输出解析到的命令信息
  * @return esp_err_t
  */
-esp_err_t mqttCmdRecvHandle(MqttReceiveData_t *mqttRecvData)
+static esp_err_t mqttCmdDispatch(MqttReceiveData_t *mqttRecvData, MqttCmdInfo_t *info)
 {
     cJSON *jsonData = NULL;
     cJSON *controlTypeJson = NULL;
@@ -230,11 +1211,18 @@ esp_err_t mqttCmdRecvHandle(MqttReceiveData_t *mqttRecvData)
     uint16_t _mqttContorType;
     uint16_t _mqttCmdType;
     esp_err_t err;
-    jsonData = cJSON_Parse(mqttRecvData->data); // 解析JSON失败
-    if (jsonData == NULL)
+    if (mqttRecvData->format == MQTT_WIRE_FORMAT_CBOR) // CBOR解码为与JSON相同的对象树,命令处理不区分格式
+    {
+        jsonData = cbor_decode_to_cjson((const uint8_t *)mqttRecvData->data, mqttRecvData->dataLen, NULL);
+    }
+    else
     {
-        ESP_LOGE(TAG, "JSON parse failed. MQTT data revice is wrong JSON format");
-        ESP_LOGE(TAG, "\n%.*s", mqttRecvData->dataLen, mqttRecvData->data);
+        jsonData = cJSON_Parse(mqttRecvData->data);
+    }
+    if (jsonData == NULL) // 解析失败
+    {
+        ESP_LOGE(TAG, "%s parse failed. MQTT data revice is wrong format", mqttRecvData->format == MQTT_WIRE_FORMAT_CBOR ? "CBOR" : "JSON");
+        mqttRecvDataLog(mqttRecvData, ESP_LOG_ERROR);
         cJSON_Delete(jsonData);
         return ESP_FAIL;
     }
@@ -242,42 +1230,107 @@ esp_err_t mqttCmdRecvHandle(MqttReceiveData_t *mqttRecvData)
     if (controlTypeJson == NULL)
     {
         ESP_LOGE(TAG, "JSON Parse failed. Unable to obtain [ control_type ]");
-        ESP_LOGE(TAG, "\n%.*s", mqttRecvData->dataLen, mqttRecvData->data);
+        mqttRecvDataLog(mqttRecvData, ESP_LOG_ERROR);
         cJSON_Delete(jsonData);
         return ESP_FAIL;
     }
     _mqttContorType = cJSON_GetNumberValue(controlTypeJson);
+    info->controlType = _mqttContorType;
+    if (!mqttCmdMsgIdGet(jsonData, info->msgId, sizeof(info->msgId)))
+    {
+        info->msgId[0] = '\0';
+    }
 
     cmdTypeJson = cJSON_GetObjectItem(jsonData, "cmd_type"); // JSON字段没有包含 cmd_type
     if (cmdTypeJson == NULL)
     {
         ESP_LOGE(TAG, "JSON Parse failed. Unable to obtain [ cmd_type ]");
-        ESP_LOGE(TAG, "\n%.*s", mqttRecvData->dataLen, mqttRecvData->data);
+        mqttRecvDataLog(mqttRecvData, ESP_LOG_ERROR);
         cJSON_Delete(jsonData);
         return ESP_FAIL;
     }
     _mqttCmdType = cJSON_GetNumberValue(cmdTypeJson);
+    info->cmdType = _mqttCmdType;
 
     dataPayloadJson = cJSON_GetObjectItem(jsonData, "data"); // JSON字段没有包含 data
     if (dataPayloadJson == NULL)
     {
         ESP_LOGE(TAG, "JSON Parse failed. Unable to obtain [ data ]");
-        ESP_LOGE(TAG, "\n%.*s", mqttRecvData->dataLen, mqttRecvData->data);
+        mqttRecvDataLog(mqttRecvData, ESP_LOG_ERROR);
         cJSON_Delete(jsonData);
         return ESP_FAIL;
     }
-    for (size_t i = 0; i < MQTT_CONTROL_TYPE_CLASSIFY_MAX; i++)
+    MqttCmdExecCtx_t _cmd = {.controlType = _mqttContorType, .cmdType = _mqttCmdType, .data = dataPayloadJson};
+#if CONFIG_MQTT_CMD_DEDUP_CACHE_SIZE > 0
+    if (info->msgId[0] != '\0' && s_mqttCmdCache.entry == NULL) // 首次使用时申请
     {
-        if ((_mqttContorType >= s_sysSetPageHandle[i].minClassifyNum) && (_mqttContorType <= s_sysSetPageHandle[i].maxClassifyNum))
+        MqttCmdCacheEntry_t *_entry = heap_caps_malloc(CONFIG_MQTT_CMD_DEDUP_CACHE_SIZE * sizeof(MqttCmdCacheEntry_t), MALLOC_CAP_SPIRAM);
+        if (_entry == NULL)
         {
-            err = s_sysSetPageHandle[i].mqtt_cmd_handle(_mqttContorType, _mqttCmdType, dataPayloadJson);
-            cJSON_Delete(jsonData);
-            return err;
+            ESP_LOGE(TAG, "msg_id cache malloc failed");
         }
+        mqttCmdCacheInit(&s_mqttCmdCache, _entry, CONFIG_MQTT_CMD_DEDUP_CACHE_SIZE, s_mqttCmdCacheBucket, MQTT_CMD_CACHE_BUCKETS);
+    }
+    err = mqttCmdCacheExecute(&s_mqttCmdCache, info->msgId, mqttCmdExecute, &_cmd, &info->duplicate);
+    if (info->duplicate) // 重复下发(如WMS重试),未执行
+    {
+        metricsCounterInc(METRICS_COUNTER_MQTT_CMD_DEDUP_HIT);
+        ESP_LOGW(TAG, "Duplicate command [ %s ] skipped", info->msgId);
+    }
+    else if (info->msgId[0] != '\0' && s_mqttCmdCache.entry != NULL)
+    {
+        metricsCounterInc(METRICS_COUNTER_MQTT_CMD_DEDUP_MISS);
     }
+#else
+    err = mqttCmdExecute(&_cmd);
+#endif
     cJSON_Delete(jsonData);
-    return ESP_FAIL;
+    return err;
+}
+
+/**
+ * @brief  处理接收的MQTT命令
+ * @param  mqttRecvData
+ * @return esp_err_t
+ */
+esp_err_t mqttCmdRecvHandle(MqttReceiveData_t *mqttRecvData)
+{
+    MqttCmdInfo_t _info = {0};
+    return mqttCmdDispatch(mqttRecvData, &_info);
+}
+
+#if !CONFIG_MQTT_CMD_ACK_FULL_ECHO
+/**
+ * @brief  发送命令回执(执行成功与失败都发送)
+ *         {"control_type":命令类型,"cmd_type":命令编号,"msg_id":"命令ID","status":错误码,"us":耗时,"dup":true}
+ *         msg_id仅在命令带msg_id时存在, dup仅在重复命令时存在
+ * @param  info
+ * @param  status   命令执行结果
+ * @param  cmdTime  命令处理耗时(微秒)
+ */
+static void mqttCmdAckSend(const MqttCmdInfo_t *info, esp_err_t status, uint32_t cmdTime)
+{
+    char _msg[MQTT_CMD_ACK_MAX_LEN];
+    json_writer_t _writer;
+    mqttPubWriterInit(&_writer, _msg, sizeof(_msg));
+    json_writer_object_begin(&_writer);
+    json_writer_key_int(&_writer, "control_type", info->controlType);
+    json_writer_key_int(&_writer, "cmd_type", info->cmdType);
+    if (info->msgId[0] != '\0')
+    {
+        json_writer_key_string(&_writer, "msg_id", info->msgId);
+    }
+    json_writer_key_int(&_writer, "status", status);
+    json_writer_key_uint(&_writer, "us", cmdTime);
+    if (info->duplicate)
+    {
+        json_writer_key(&_writer, "dup");
+        json_writer_bool(&_writer, true);
+    }
+    json_writer_object_end(&_writer);
+    mqttPubWriterSend(&_writer, mqttPubFlagsOf(info->controlType));
 }
+#endif
 
 /**
  * @brief  从默认主题发布MQTT字符消息
@@ -288,22 +1341,18 @@ esp_err_t mqttCmdRecvHandle(MqttReceiveData_t *mqttRecvData)
  */
 void mqttDefaultTopicPubStrMsg(uint16_t controlType, uint16_t notifyType, const char *jsonObjName, const char *str)
 {
-    MqttPublishData_t _mqttPubData;
-    cJSON *msgBuff = NULL;
-    msgBuff = cJSON_CreateObject();
-    cJSON_AddNumberToObject(msgBuff, "control_type", controlType);
-    cJSON_AddNumberToObject(msgBuff, "notify_type", notifyType);
-    cJSON *data = NULL;
-    data = cJSON_CreateObject();
-    cJSON_AddStringToObject(data, jsonObjName, str);
-    cJSON_AddItemToObject(msgBuff, "data", data);
-    char *jsonStr = NULL;
-    jsonStr = cJSON_PrintUnformatted(msgBuff);
-    _mqttPubData.dataLen = strlen(jsonStr);
-    strcpy(_mqttPubData.data, jsonStr);
-    xQueueSend(g_mqttPubDataQueueHandler, &_mqttPubData, pdMS_TO_TICKS(100));
-    cJSON_free(jsonStr);
-    cJSON_Delete(msgBuff);
+    char _msg[MQTT_STATUS_MSG_MAX_LEN];
+    json_writer_t _writer;
+    mqttPubWriterInit(&_writer, _msg, sizeof(_msg));
+    json_writer_object_begin(&_writer);
+    json_writer_key_int(&_writer, "control_type", controlType);
+    json_writer_key_int(&_writer, "notify_type", notifyType);
+    json_writer_key(&_writer, "data");
+    json_writer_object_begin(&_writer);
+    json_writer_key_string(&_writer, jsonObjName, str);
+    json_writer_object_end(&_writer);
+    json_writer_object_end(&_writer);
+    mqttPubWriterSend(&_writer, mqttPubFlagsOf(controlType));
 }
 
 /**
@@ -315,67 +1364,285 @@ void mqttDefaultTopicPubStrMsg(uint16_t controlType, uint16_t notifyType, const
  */
 void mqttDefaultTopicPubNumMsg(uint16_t controlType, uint16_t notifyType, const char *jsonObjName, uint32_t num)
 {
-    MqttPublishData_t _mqttPubData;
-    cJSON *msgBuff = NULL;
-    msgBuff = cJSON_CreateObject();
-    cJSON_AddNumberToObject(msgBuff, "control_type", controlType);
-    cJSON_AddNumberToObject(msgBuff, "notify_type", notifyType);
-    cJSON *data = NULL;
-    data = cJSON_CreateObject();
-    cJSON_AddNumberToObject(data, jsonObjName, num);
-    cJSON_AddItemToObject(msgBuff, "data", data);
-    char *jsonStr = NULL;
-    jsonStr = cJSON_PrintUnformatted(msgBuff);
-    _mqttPubData.dataLen = strlen(jsonStr);
-    strcpy(_mqttPubData.data, jsonStr);
-    xQueueSend(g_mqttPubDataQueueHandler, &_mqttPubData, pdMS_TO_TICKS(100));
-    cJSON_free(jsonStr);
-    cJSON_Delete(msgBuff);
+    char _msg[MQTT_STATUS_MSG_MAX_LEN];
+    json_writer_t _writer;
+    mqttPubWriterInit(&_writer, _msg, sizeof(_msg));
+    json_writer_object_begin(&_writer);
+    json_writer_key_int(&_writer, "control_type", controlType);
+    json_writer_key_int(&_writer, "notify_type", notifyType);
+    json_writer_key(&_writer, "data");
+    json_writer_object_begin(&_writer);
+    json_writer_key_uint(&_writer, jsonObjName, num);
+    json_writer_object_end(&_writer);
+    json_writer_object_end(&_writer);
+    mqttPubWriterSend(&_writer, mqttPubFlagsOf(controlType));
+}
+
+/**
+ * @brief  到达上报周期时生成运行指标快照,放入尽力通道后从遥测主题发布(固定使用JSON)
+ */
+static void mqttTelemetryPublish()
+{
+    static uint32_t s_lastPublishTime = 0;
+    static char s_snapshot[METRICS_SNAPSHOT_MAX_LEN]; // 仅在MQTT任务中生成
+    if (CONFIG_METRICS_PUBLISH_INTERVAL_SEC == 0 || esp_log_timestamp() - s_lastPublishTime < CONFIG_METRICS_PUBLISH_INTERVAL_SEC * 1000)
+    {
+        return;
+    }
+    s_lastPublishTime = esp_log_timestamp();
+    json_writer_t _writer;
+    size_t _len;
+    json_writer_init(&_writer, s_snapshot, sizeof(s_snapshot));
+    metricsSnapshotWrite(&_writer);
+    if (json_writer_finish(&_writer, &_len) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Telemetry snapshot is longer than %d bytes, dropped", METRICS_SNAPSHOT_MAX_LEN);
+        return;
+    }
+    mqttPubRingSend(s_snapshot, _len, MQTT_PUB_FLAG_TELEMETRY);
+}
+
+/**
+ * @brief  执行一条接收的MQTT命令,成功时从发布主题回显
+ *         业务命令的回显进入关键通道,与断线期间保存的消息保持顺序;其他回显仅在连接就绪时直接加入合并缓冲
+ * @param  mqttRecvData
+ * @param  pubTopic
+ * @param  pubQos
+ */
+static void mqttRecvDataProcess(MqttReceiveData_t *mqttRecvData, const char *pubTopic, int pubQos)
+{
+    s_mqttStatusFormat = mqttRecvData->format; // 命令执行中产生的状态消息使用与命令相同的格式
+    MqttCmdInfo_t _info = {0};
+    int64_t cmdStartTime = esp_timer_get_time();
+    esp_err_t err = mqttCmdDispatch(mqttRecvData, &_info);
+    uint32_t _cmdTime = esp_timer_get_time() - cmdStartTime;
+    if (!_info.duplicate) // 重复命令未执行,不计入命令统计
+    {
+        metricsHistogramRecord(METRICS_HISTOGRAM_MQTT_CMD_LATENCY, _cmdTime);
+        metricsCounterInc(err == ESP_OK ? METRICS_COUNTER_MQTT_CMD_OK : METRICS_COUNTER_MQTT_CMD_FAILED);
+        ESP_ERROR_CHECK_WITHOUT_ABORT(err);
+    }
+    if (err != ESP_OK && !_info.duplicate) // 打印执行失败的命令
+    {
+        ESP_LOGW(TAG, "Failed command. Topic: %.*s", mqttRecvData->topicLen, mqttRecvData->topic);
+        mqttRecvDataLog(mqttRecvData, ESP_LOG_WARN);
+    }
+#if CONFIG_MQTT_CMD_ACK_FULL_ECHO
+    if (err == ESP_OK) // MQTT命令执行成功(或重复命令)，将命令从另外的Topic回显
+    {
+        uint8_t _flags = mqttPubFlagsOf(_info.controlType) | (mqttRecvData->format == MQTT_WIRE_FORMAT_CBOR ? MQTT_PUB_FLAG_CBOR : 0);
+        if (_flags & MQTT_PUB_FLAG_CRITICAL)
+        {
+            mqttPubRingSend(mqttRecvData->data, mqttRecvData->dataLen, _flags);
+        }
+        else if (getMqttState() == MQTT_READY)
+        {
+            mqttCoalesceAppend(mqttRecvData->data, mqttRecvData->dataLen, esp_timer_get_time(), 0, mqttRecvData->format, pubTopic, pubQos);
+        }
+    }
+#else
+    if (_info.controlType != 0) // 发送回执,与状态消息一同在合并窗口内合并发布
+    {
+        mqttCmdAckSend(&_info, err, _cmdTime);
+    }
+#endif
+}
+
+/**
+ * @brief  补发结束(关键通道已空或遇到重连后入队的消息),退还本次预取的令牌
+ */
+static void mqttReplayFinish()
+{
+    s_mqttReplayPending = false;
+    s_mqttReplayCredit += 1000000;
+}
+
+/**
+ * @brief  按配额发送环形缓冲区中的消息,先关键通道后尽力通道
+ *         关键通道中重连前保存的消息按令牌桶限速补发,令牌不足时先发送尽力通道中的实时消息;
+ *         内联消息与不超过MQTT_PUBLISH_CHUNK_SIZE的外部数据加入合并缓冲(延迟敏感消息与遥测快照直接发布);更大的外部数据从记录中取出后
+ *         每次发布一段到 发布主题/chunk/<编号>/<段号>/<段数>(CBOR消息的发布主题带CBOR后缀),剩余的段在后续唤醒中继续发送;
+ *         关键消息写入Flash后才开始分段,最后一段收到PUBACK后从日志中确认
+ * @param  pubTopic
+ * @param  pubQos
+ * @return bool 是否还有可立即发送的消息(限速等待中的补发消息与等待写入Flash的关键消息不计)
+ */
+static bool mqttPubRingProcess(const char *pubTopic, int pubQos)
+{
+    static char *s_chunkData = NULL; // 正在分段发布的外部数据
+    static size_t s_chunkDataLen = 0;
+    static uint32_t s_chunkIndex = 0, s_chunkCount = 0, s_chunkId = 0;
+    static int64_t s_chunkEnqueueTime = 0;
+    static uint32_t s_chunkJournalSeq = 0; // 分段发布的消息的日志序号,0表示未写入日志
+    static MqttWireFormat_t s_chunkFormat = MQTT_WIRE_FORMAT_JSON;
+    static char s_chunkTopic[MQTT_TOPIC_MAX_LEN + 32] = {0};
+    size_t _published = 0;
+    size_t _lane = MQTT_PUB_LANE_CRITICAL;
+    while (_published < MQTT_TASK_PUB_BUDGET)
+    {
+        if (s_chunkData != NULL)
+        {
+            size_t _offset = s_chunkIndex * MQTT_PUBLISH_CHUNK_SIZE;
+            size_t _len = s_chunkDataLen - _offset < MQTT_PUBLISH_CHUNK_SIZE ? s_chunkDataLen - _offset : MQTT_PUBLISH_CHUNK_SIZE;
+            snprintf(s_chunkTopic, sizeof(s_chunkTopic), "%s%s/%lu/%lu/%lu", mqttPubTopicOf(pubTopic, s_chunkFormat), MQTT_CHUNK_TOPIC_SUFFIX, s_chunkId,
+                     s_chunkIndex, s_chunkCount);
+            metricsCounterInc(METRICS_COUNTER_MQTT_PUB_CHUNKS);
+            _published++;
+            if (++s_chunkIndex < s_chunkCount) // 日志消息的各段都用QoS1以上发布,最后一段收到PUBACK后从日志中确认
+            {
+                mqttPublish(s_chunkTopic, s_chunkData + _offset, _len, s_chunkJournalSeq != 0 && pubQos == 0 ? 1 : pubQos);
+            }
+            else
+            {
+                mqttPublishJournaled(s_chunkTopic, s_chunkData + _offset, _len, pubQos, &s_chunkJournalSeq, 1);
+                metricsHistogramRecord(METRICS_HISTOGRAM_MQTT_PUB_LATENCY, esp_timer_get_time() - s_chunkEnqueueTime);
+                metricsCounterInc(METRICS_COUNTER_MQTT_PUB_EVENTS);
+                free(s_chunkData);
+                s_chunkData = NULL;
+            }
+            continue;
+        }
+        if (_lane >= MQTT_PUB_LANE_MAX)
+        {
+            break;
+        }
+        if (_lane == MQTT_PUB_LANE_CRITICAL && !mqttJournalPubReady())
+        {
+            _lane++; // 等待日志写入Flash或PUBACK
+            continue;
+        }
+        bool _held = _lane == MQTT_PUB_LANE_CRITICAL && s_mqttPubHeldRecord != NULL;
+        bool _replay = _lane == MQTT_PUB_LANE_CRITICAL && s_mqttReplayPending && !_held;
+        if (_replay && !mqttReplayTokenTake())
+        {
+            _lane++; // 补发限速
+            continue;
+        }
+        RingbufHandle_t _ring = g_mqttPubRingHandle[_lane];
+        size_t _itemSize = 0;
+        MqttPubRecord_t *_record = _held ? s_mqttPubHeldRecord : xRingbufferReceive(_ring, &_itemSize, 0);
+        s_mqttPubHeldRecord = NULL;
+        if (_record == NULL)
+        {
+            if (_replay)
+            {
+                mqttReplayFinish();
+            }
+            _lane++;
+            continue;
+        }
+        if (_replay)
+        {
+            if (_record->enqueueTime >= s_mqttReadyTime)
+            {
+                mqttReplayFinish();
+            }
+            else
+            {
+                metricsCounterInc(METRICS_COUNTER_MQTT_PUB_REPLAYED);
+            }
+        }
+        if (!mqttJournalIsDurable(_record->journalSeq)) // 检查后才入队的消息,写入Flash后再发送
+        {
+            s_mqttPubHeldRecord = _record;
+            _lane++;
+            continue;
+        }
+        MqttWireFormat_t _format = (_record->flags & MQTT_PUB_FLAG_CBOR) ? MQTT_WIRE_FORMAT_CBOR : MQTT_WIRE_FORMAT_JSON;
+        if (_record->extData != NULL && _record->dataLen > MQTT_PUBLISH_CHUNK_SIZE)
+        {
+            mqttCoalesceFlush(pubTopic, pubQos); // 保持发送顺序
+            s_chunkData = _record->extData;
+            s_chunkDataLen = _record->dataLen;
+            s_chunkEnqueueTime = _record->enqueueTime;
+            s_chunkJournalSeq = _record->journalSeq;
+            s_chunkFormat = _format;
+            s_chunkIndex = 0;
+            s_chunkCount = (_record->dataLen + MQTT_PUBLISH_CHUNK_SIZE - 1) / MQTT_PUBLISH_CHUNK_SIZE;
+            s_chunkId++;
+            ESP_LOGD(TAG, "MQTT chunked publish %lu: %lu bytes, %lu chunks", s_chunkId, _record->dataLen, s_chunkCount);
+            vRingbufferReturnItem(_ring, _record); // 数据已转移,记录立即归还
+            continue;
+        }
+        const char *_data = _record->extData != NULL ? _record->extData : _record->data;
+        if (_record->flags & (MQTT_PUB_FLAG_URGENT | MQTT_PUB_FLAG_TELEMETRY))
+        {
+            mqttCoalesceFlush(pubTopic, pubQos); // 保持发送顺序
+            const char *_topic = (_record->flags & MQTT_PUB_FLAG_TELEMETRY) ? s_mqttTelemetryTopic : mqttPubTopicOf(pubTopic, _format);
+            mqttPublishJournaled(_topic, _data, _record->dataLen, pubQos, &_record->journalSeq, 1);
+            metricsCounterInc(METRICS_COUNTER_MQTT_PUB_EVENTS);
+            metricsHistogramRecord(METRICS_HISTOGRAM_MQTT_PUB_LATENCY, esp_timer_get_time() - _record->enqueueTime);
+        }
+        else
+        {
+            mqttCoalesceAppend(_data, _record->dataLen, _record->enqueueTime, _record->journalSeq, _format, pubTopic, pubQos);
+        }
+        _published++;
+        free(_record->extData);
+        vRingbufferReturnItem(_ring, _record);
+    }
+    return s_chunkData != NULL || mqttPubRingWaiting(MQTT_PUB_LANE_BEST_EFFORT) > 0 || mqttJournalBacklogReady() ||
+           (!s_mqttReplayPending && (mqttPubRingWaiting(MQTT_PUB_LANE_CRITICAL) > 0 || s_mqttPubHeldRecord != NULL) && mqttJournalPubReady());
 }
 
 /**
  * @brief MQTT TASK
+ *        由收发队列的任务通知唤醒,每次唤醒按配额处理接收命令并发送积压的消息,
+ *        配额用完仍有数据时重新通知自身,避免单一方向长时间占用任务;
+ *        断线期间关键通道保存消息,重连后限速补发;关键消息同时写入Flash日志,收到PUBACK后确认
  * @param  pvParameters
  */
 void mqttTask(void *pvParameters)
 {
     MqttReceiveData_t mqttRecvData;
-    MqttPublishData_t mqttPubData;
     static char pubTopic[MQTT_TOPIC_MAX_LEN] = {0};
     static int pubQos;
+    bool _pubPending = false;
+    int64_t _readyTime = 0;
     pubQos = g_nvsData.networkConfigData.mqttConfigData.pubQos;
     strcpy(pubTopic, g_nvsData.networkConfigData.mqttConfigData.pubTopic);
-    esp_err_t err;
+    snprintf(s_mqttTelemetryTopic, sizeof(s_mqttTelemetryTopic), "%s%s", pubTopic, METRICS_TELEMETRY_TOPIC_SUFFIX);
+    snprintf(s_mqttCborPubTopic, sizeof(s_mqttCborPubTopic), "%s%s", pubTopic, MQTT_CBOR_TOPIC_SUFFIX);
+    s_mqttCoalesce.buf = heap_caps_malloc(CONFIG_MQTT_COALESCE_MAX_BYTES, MALLOC_CAP_SPIRAM);
+    if (s_mqttCoalesce.buf == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to allocate coalesce buffer, messages are published one by one");
+    }
+    s_mqttTaskHandle = xTaskGetCurrentTaskHandle();
     for (;;)
     {
-        if (xQueueReceive(g_mqttRecvDataQueueHandler, &mqttRecvData, pdMS_TO_TICKS(10)) == pdTRUE)
+        ulTaskNotifyTake(pdTRUE, mqttTaskWaitTicks());
+        metricsGaugeSet(METRICS_GAUGE_MQTT_PUB_QUEUE, mqttPubRingWaiting(MQTT_PUB_LANE_CRITICAL) + mqttPubRingWaiting(MQTT_PUB_LANE_BEST_EFFORT));
+        metricsGaugeSet(METRICS_GAUGE_MQTT_PUB_CRITICAL, mqttPubRingWaiting(MQTT_PUB_LANE_CRITICAL));
+        for (size_t i = 0; i < MQTT_TASK_RECV_BUDGET; i++)
         {
-
-            err = mqttCmdRecvHandle(&mqttRecvData);
-            ESP_ERROR_CHECK_WITHOUT_ABORT(err);
-            if (err == ESP_OK && (getMqttState() == MQTT_READY)) // MQTT命令执行成功，将命令从另外的Topic回显
-            {
-                esp_mqtt_client_publish(g_mqttClientHandle, pubTopic, mqttRecvData.data, mqttRecvData.dataLen, pubQos, 0);
-                // ESP_LOGI(TAG, "MQTT Publish. Topic: %.*s", strlen(pubTopic), pubTopic);
-                // ESP_LOGI(TAG, "MQTT Publish Data:\n%.*s", mqttRecvData.dataLen, mqttRecvData.data);
-            }
-            else // 打印执行失败的命令
+            if (xQueueReceive(g_mqttRecvDataQueueHandler, &mqttRecvData, 0) != pdTRUE)
             {
-                ESP_LOGW(TAG, "Failed command. Topic: %.*s", mqttRecvData.topicLen, mqttRecvData.topic);
-                ESP_LOGW(TAG, "Failed command Data:\n%.*s", mqttRecvData.dataLen, mqttRecvData.data);
+                break;
             }
+            mqttRecvDataProcess(&mqttRecvData, pubTopic, pubQos);
         }
+        mqttJournalService(); // 断线期间也按周期写入Flash
+        _pubPending = false;
         if (getMqttState() == MQTT_READY)
         {
-            if (xQueueReceive(g_mqttPubDataQueueHandler, &mqttPubData, pdMS_TO_TICKS(10)) == pdTRUE) // 处理队列中的发送任务
+            if (_readyTime != s_mqttReadyTime) // 重新连接
             {
-                ESP_LOGI(TAG, "MQTT Publish. Topic: %.*s", strlen(pubTopic), pubTopic);
-                ESP_LOGI(TAG, "MQTT Publish Data:\n%.*s", mqttPubData.dataLen, mqttPubData.data);
-                esp_mqtt_client_publish(g_mqttClientHandle, pubTopic, mqttPubData.data, mqttPubData.dataLen, pubQos, 0);
+                _readyTime = s_mqttReadyTime;
+                mqttReplayStart();
             }
-            vTaskDelay(pdMS_TO_TICKS(1));
+            _pubPending = mqttPubRingProcess(pubTopic, pubQos);
+            if (mqttCoalesceWaitTicks() == 0) // 合并窗口到期
+            {
+                mqttCoalesceFlush(pubTopic, pubQos);
+            }
+            mqttTelemetryPublish();
+        }
+        if (uxQueueMessagesWaiting(g_mqttRecvDataQueueHandler) > 0 || _pubPending)
+        {
+            xTaskNotifyGive(s_mqttTaskHandle); // 配额用完仍有积压,让出CPU后继续处理
+            taskYIELD();
         }
-        vTaskDelay(pdMS_TO_TICKS(1));
     }
     vTaskDelete(NULL);
 }
@@ -0,0 +1,180 @@
+/**
+ * @file mqtt_cmd_cache.c
+ * @brief 已执行命令的msg_id缓存: 哈希桶查找, 按最久未使用淘汰
+ *        带msg_id的命令执行成功后记录, 再次收到相同msg_id时不再执行; 执行失败不记录, 外部系统可用同一msg_id重试
+ *        存储由调用者提供, 可在主机上回放
+ * @version 1.0
+ * @date 2024-07-29
+ *
+ * @copyright Copyright (c) 2024  雅马哈发动机（厦门）信息系统有限公司
+ *
+ */
+#include <string.h>
+#include "mqtt_cmd_cache.h"
+
+/**
+ * @brief  FNV-1a哈希
+ * @param  msgId
+ * @return uint32_t
+ */
+static uint32_t mqttCmdMsgIdHash(const char *msgId)
+{
+    uint32_t _hash = 2166136261UL;
+    while (*msgId)
+    {
+        _hash = (_hash ^ (uint8_t)*msgId++) * 16777619UL;
+    }
+    return _hash;
+}
+
+/**
+ * @brief  将缓存项移出使用顺序链表
+ * @param  cache
+ * @param  index
+ */
+static void mqttCmdCacheLruUnlink(MqttCmdCache_t *cache, int16_t index)
+{
+    MqttCmdCacheEntry_t *_entry = &cache->entry[index];
+    if (_entry->lruPrev >= 0)
+    {
+        cache->entry[_entry->lruPrev].lruNext = _entry->lruNext;
+    }
+    else
+    {
+        cache->lruHead = _entry->lruNext;
+    }
+    if (_entry->lruNext >= 0)
+    {
+        cache->entry[_entry->lruNext].lruPrev = _entry->lruPrev;
+    }
+    else
+    {
+        cache->lruTail = _entry->lruPrev;
+    }
+}
+
+/**
+ * @brief  将缓存项放到使用顺序链表头部(最近使用)
+ * @param  cache
+ * @param  index
+ */
+static void mqttCmdCacheLruPush(MqttCmdCache_t *cache, int16_t index)
+{
+    MqttCmdCacheEntry_t *_entry = &cache->entry[index];
+    _entry->lruPrev = -1;
+    _entry->lruNext = cache->lruHead;
+    if (cache->lruHead >= 0)
+    {
+        cache->entry[cache->lruHead].lruPrev = index;
+    }
+    cache->lruHead = index;
+    if (cache->lruTail < 0)
+    {
+        cache->lruTail = index;
+    }
+}
+
+/**
+ * @brief  查找已执行的msg_id,找到时更新为最近使用
+ * @param  cache
+ * @param  msgId
+ * @param  hash
+ * @return bool
+ */
+static bool mqttCmdCacheLookup(MqttCmdCache_t *cache, const char *msgId, uint32_t hash)
+{
+    for (int16_t i = cache->bucket[hash % cache->bucketNum]; i >= 0; i = cache->entry[i].bucketNext)
+    {
+        if (cache->entry[i].hash == hash && strcmp(cache->entry[i].msgId, msgId) == 0)
+        {
+            mqttCmdCacheLruUnlink(cache, i);
+            mqttCmdCacheLruPush(cache, i);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief  记录执行成功的msg_id,缓存满时淘汰最久未使用的一项
+ * @param  cache
+ * @param  msgId
+ * @param  hash
+ */
+static void mqttCmdCacheInsert(MqttCmdCache_t *cache, const char *msgId, uint32_t hash)
+{
+    int16_t _index;
+    if (cache->count < cache->capacity)
+    {
+        _index = cache->count++;
+    }
+    else // 淘汰最久未使用的一项,并从其哈希桶中移除
+    {
+        _index = cache->lruTail;
+        mqttCmdCacheLruUnlink(cache, _index);
+        int16_t *_link = &cache->bucket[cache->entry[_index].hash % cache->bucketNum];
+        while (*_link != _index)
+        {
+            _link = &cache->entry[*_link].bucketNext;
+        }
+        *_link = cache->entry[_index].bucketNext;
+    }
+    MqttCmdCacheEntry_t *_entry = &cache->entry[_index];
+    strcpy(_entry->msgId, msgId);
+    _entry->hash = hash;
+    _entry->bucketNext = cache->bucket[hash % cache->bucketNum];
+    cache->bucket[hash % cache->bucketNum] = _index;
+    mqttCmdCacheLruPush(cache, _index);
+}
+
+/**
+ * @brief  初始化缓存
+ * @param  cache
+ * @param  entry        缓存项数组,为NULL时不去重(申请失败)
+ * @param  capacity     缓存项数量
+ * @param  bucket       哈希桶数组
+ * @param  bucketNum    哈希桶数量
+ */
+void mqttCmdCacheInit(MqttCmdCache_t *cache, MqttCmdCacheEntry_t *entry, uint16_t capacity, int16_t *bucket, uint16_t bucketNum)
+{
+    memset(cache, 0, sizeof(MqttCmdCache_t));
+    cache->entry = entry;
+    cache->capacity = capacity;
+    cache->bucket = bucket;
+    cache->bucketNum = bucketNum;
+    cache->lruHead = -1;
+    cache->lruTail = -1;
+    memset(bucket, 0xFF, bucketNum * sizeof(int16_t));
+}
+
+/**
+ * @brief  执行一条命令,带msg_id的命令已执行成功过时不再执行,直接返回成功
+ * @param  cache
+ * @param  msgId        空字符串表示命令不带msg_id,每次都执行
+ * @param  exec
+ * @param  ctx
+ * @param  duplicate    输出msg_id是否已执行过(本次未执行)
+ * @return int          esp_err_t
+ */
+int mqttCmdCacheExecute(MqttCmdCache_t *cache, const char *msgId, MqttCmdExec_t exec, void *ctx, bool *duplicate)
+{
+    *duplicate = false;
+    if (msgId[0] == '\0' || cache->entry == NULL)
+    {
+        return exec(ctx);
+    }
+    uint32_t _hash = mqttCmdMsgIdHash(msgId);
+    if (mqttCmdCacheLookup(cache, msgId, _hash)) // 重复下发(如WMS重试)
+    {
+        cache->hit++;
+        *duplicate = true;
+        return 0;
+    }
+    cache->miss++;
+    int _err = exec(ctx);
+    if (_err == 0) // 执行失败不记录,重试时再次执行
+    {
+        mqttCmdCacheInsert(cache, msgId, _hash);
+    }
+    return _err;
+}
@@ -12,8 +12,14 @@
 #include "ledstrip_effect_manager.h"
 
 static char *TAG = "MQTT_BUSSINESS_CMD";
+
+// 残留订单消息最大长度: 固定部分 + 每个订单(名称按两倍预留转义空间)
+#define RESIDUES_ORDER_MSG_MAX_LEN (128 + LED_STRIP_INDICATION_MAX_ORDERS * (LED_STRIP_INDICATION_ORDER_STR_MAXSIZE * 2 + 48))
+
 QueueHandle_t g_ledStripBoxDataQueueHandler;    // 灯带指示物料，物料位置信息
 SemaphoreHandle_t g_ledStripBoxDataSemphHandle; // 灯带重新处理亮灯信号量
+SemaphoreHandle_t g_ledStripOrderMutexHandle;   // 订单表、库位队列与占用信息互斥(订单命令与灯带指示任务)
+OrderBoxInfo_t *g_ledStripOwnerPool = NULL;     // 库位的订单占用信息(PSRAM),按库位链接
 /**
  * @brief 订单残留库位状态记录结构体
  */
@@ -23,10 +29,14 @@ typedef struct _OrderState
     uint32_t color;                                         // 订单的库位颜色
     char orderName[LED_STRIP_INDICATION_ORDER_STR_MAXSIZE]; // 订单名称
     uint64_t timeStamp;                                     // 订单提交时间戳
-    uint16_t orderNo;                                       // 订单到达的先后顺序
+    uint16_t orderNo;                                       // 订单到达的先后顺序, 0表示空闲
+    int8_t bucketNext;                                      // 同一哈希桶的下一个订单, -1表示结束
 } OrderState_t;
 
-static OrderState_t s_orderState[LED_STRIP_INDICATION_MAX_ORDERS] = {0};
+static OrderState_t *s_orderState = NULL;                          // 订单表(PSRAM)
+static int8_t s_orderBucket[LED_STRIP_INDICATION_ORDER_BUCKETS];   // 订单名哈希桶, -1表示空
+static uint16_t s_ownerFreeHead = LED_STRIP_OWNER_NONE;            // 空闲的占用信息链表
+static uint16_t s_ownerFreeCount = 0;                              // 空闲的占用信息数量
 static uint8_t s_executingOrderCount = 0; // 系统执行中的订单计数
 static uint16_t s_orderNoIncremental = 0; // 递增的订单数（系统开机直至目前执行过的订单数）
 
@@ -36,6 +46,216 @@ static uint8_t s_btightness;                             // 初始化的亮度
 static bool s_allowOrderOverwriteLocation;               // 是否允许库位覆盖
 char _orderName[LED_STRIP_INDICATION_ORDER_STR_MAXSIZE]; // 订单名称
 
+/**
+ * @brief  清空订单表与占用信息(调用者同时清空库位队列)
+ */
+static void orderTableReset()
+{
+    memset(s_orderState, 0, LED_STRIP_INDICATION_MAX_ORDERS * sizeof(OrderState_t));
+    memset(s_orderBucket, 0xFF, sizeof(s_orderBucket));
+    for (size_t i = 0; i < LED_STRIP_INDICATION_OWNER_POOL_SIZE; i++)
+    {
+        g_ledStripOwnerPool[i].orderNo = 0;
+        g_ledStripOwnerPool[i].next = (i + 1 < LED_STRIP_INDICATION_OWNER_POOL_SIZE) ? i + 1 : LED_STRIP_OWNER_NONE;
+    }
+    s_ownerFreeHead = 0;
+    s_ownerFreeCount = LED_STRIP_INDICATION_OWNER_POOL_SIZE;
+    s_executingOrderCount = 0;
+}
+
+/**
+ * @brief  申请订单表与库位占用信息(PSRAM)
+ * @return esp_err_t
+ */
+esp_err_t ledStripOrderTableInit()
+{
+    s_orderState = heap_caps_calloc(LED_STRIP_INDICATION_MAX_ORDERS, sizeof(OrderState_t), MALLOC_CAP_SPIRAM);
+    g_ledStripOwnerPool = heap_caps_calloc(LED_STRIP_INDICATION_OWNER_POOL_SIZE, sizeof(OrderBoxInfo_t), MALLOC_CAP_SPIRAM);
+    g_ledStripOrderMutexHandle = xSemaphoreCreateMutex();
+    if (s_orderState == NULL || g_ledStripOwnerPool == NULL || g_ledStripOrderMutexHandle == NULL)
+    {
+        ESP_LOGE(TAG, "Order table malloc failed");
+        return ESP_ERR_NO_MEM;
+    }
+    orderTableReset();
+    return ESP_OK;
+}
+
+/**
+ * @brief  订单名、库位名的哈希值(FNV-1a)
+ * @param  name
+ * @return uint32_t
+ */
+static uint32_t nameHash(const char *name)
+{
+    uint32_t _hash = 2166136261UL;
+    while (*name)
+    {
+        _hash = (_hash ^ (uint8_t)*name++) * 16777619UL;
+    }
+    return _hash;
+}
+
+/**
+ * @brief  订单名所在的哈希桶
+ * @param  orderName
+ * @return uint8_t
+ */
+static uint8_t orderNameBucket(const char *orderName)
+{
+    return nameHash(orderName) & (LED_STRIP_INDICATION_ORDER_BUCKETS - 1);
+}
+
+/**
+ * @brief  按订单名查找执行中的订单
+ * @param  orderName
+ * @return OrderState_t* 不存在返回NULL
+ */
+static OrderState_t *orderStateFind(const char *orderName)
+{
+    for (int8_t i = s_orderBucket[orderNameBucket(orderName)]; i >= 0; i = s_orderState[i].bucketNext)
+    {
+        if (strcmp(orderName, s_orderState[i].orderName) == 0)
+        {
+            return &s_orderState[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief  添加新订单并赋予到达顺序(调用者确认订单表未满)
+ * @param  orderName
+ * @param  timeStamp
+ * @param  color
+ * @return OrderState_t*
+ */
+static OrderState_t *orderStateAdd(const char *orderName, uint64_t timeStamp, uint32_t color)
+{
+    for (size_t i = 0; i < LED_STRIP_INDICATION_MAX_ORDERS; i++)
+    {
+        if (s_orderState[i].orderNo == 0) // 找到空闲的位置
+        {
+            s_executingOrderCount++;            // 执行中的订单加1
+            if (s_orderNoIncremental == 0xFFFF) // 累计订单超过uint16_t 归零计数
+            {
+                s_orderNoIncremental = 0;
+            }
+            s_orderNoIncremental++;
+            s_orderState[i].orderNo = s_orderNoIncremental; // 赋予订单到达顺序
+            strcpy(s_orderState[i].orderName, orderName);
+            s_orderState[i].timeStamp = timeStamp;
+            s_orderState[i].color = color;
+            s_orderState[i].residueBoxCount = 0;
+            uint8_t _bucket = orderNameBucket(orderName);
+            s_orderState[i].bucketNext = s_orderBucket[_bucket];
+            s_orderBucket[_bucket] = i;
+            return &s_orderState[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief  删除订单
+ * @param  orderState
+ */
+static void orderStateRemove(OrderState_t *orderState)
+{
+    int8_t _slot = orderState - s_orderState;
+    int8_t *_link = &s_orderBucket[orderNameBucket(orderState->orderName)];
+    while (*_link != _slot)
+    {
+        _link = &s_orderState[*_link].bucketNext;
+    }
+    *_link = orderState->bucketNext;
+    memset(orderState, 0, sizeof(OrderState_t));
+    s_executingOrderCount--;
+}
+
+/**
+ * @brief  查找库位中指定订单的占用信息
+ * @param  boxData
+ * @param  orderNo
+ * @return OrderBoxInfo_t* 不存在返回NULL
+ */
+static OrderBoxInfo_t *boxOwnerFind(const BoxData_t *boxData, uint16_t orderNo)
+{
+    for (uint16_t i = boxData->ownerHead; i != LED_STRIP_OWNER_NONE; i = g_ledStripOwnerPool[i].next)
+    {
+        if (g_ledStripOwnerPool[i].orderNo == orderNo)
+        {
+            return &g_ledStripOwnerPool[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief  订单占用库位,追加到库位订单链表尾部
+ * @param  boxData
+ * @param  orderBoxInfo
+ * @return bool 占用信息已用完返回false
+ */
+static bool boxOwnerAdd(BoxData_t *boxData, const OrderBoxInfo_t *orderBoxInfo)
+{
+    uint16_t _index = s_ownerFreeHead;
+    if (_index == LED_STRIP_OWNER_NONE)
+    {
+        return false;
+    }
+    s_ownerFreeHead = g_ledStripOwnerPool[_index].next;
+    s_ownerFreeCount--;
+    g_ledStripOwnerPool[_index] = *orderBoxInfo;
+    g_ledStripOwnerPool[_index].ownerStartLedId = 0; // 由灯带指示任务分配灯珠
+    g_ledStripOwnerPool[_index].ownerEndLedId = 0;
+    g_ledStripOwnerPool[_index].next = LED_STRIP_OWNER_NONE;
+    uint16_t *_link = &boxData->ownerHead;
+    while (*_link != LED_STRIP_OWNER_NONE)
+    {
+        _link = &g_ledStripOwnerPool[*_link].next;
+    }
+    *_link = _index;
+    boxData->ownerCount++;
+    return true;
+}
+
+/**
+ * @brief  清除订单对库位的占用并熄灭其灯珠(需要调用者刷新灯带)
+ *         库位有未分配灯珠的订单时标记库位变化,由灯带指示任务重新分配
+ * @param  boxData
+ * @param  orderNo
+ * @return bool 库位中没有该订单返回false
+ */
+static bool boxOwnerRemove(BoxData_t *boxData, uint16_t orderNo)
+{
+    for (uint16_t *_link = &boxData->ownerHead; *_link != LED_STRIP_OWNER_NONE; _link = &g_ledStripOwnerPool[*_link].next)
+    {
+        OrderBoxInfo_t *_owner = &g_ledStripOwnerPool[*_link];
+        if (_owner->orderNo != orderNo)
+        {
+            continue;
+        }
+        if (_owner->ownerStartLedId != 0)
+        {
+            led_strip_fill(g_ledstripRmtHandle, _owner->ownerStartLedId - 1, _owner->ownerEndLedId - _owner->ownerStartLedId + 1, 0, 0, 0);
+        }
+        if (boxData->ownerCount > boxData->endLedId - boxData->startLedId + 1)
+        {
+            boxData->isBoxOrderChanged = true;
+        }
+        uint16_t _index = *_link;
+        *_link = _owner->next;
+        _owner->orderNo = 0;
+        _owner->next = s_ownerFreeHead;
+        s_ownerFreeHead = _index;
+        s_ownerFreeCount++;
+        boxData->ownerCount--;
+        return true;
+    }
+    return false;
+}
+
 /**
  * @brief 同步订单三色灯数据
  */
@@ -74,6 +294,128 @@ static void alarmLedSync(void)
     alarmLedStateSet(alarmLedState);
 }
 
+/**
+ * @brief  获取执行中的订单数量
+ * @return uint8_t
+ */
+uint8_t getExecutingOrderCount()
+{
+    return s_executingOrderCount;
+}
+
+/**
+ * @brief  清空库位队列与全部订单
+ * @return bool 清空前没有库位返回false
+ */
+static bool ledStripOrderClear()
+{
+    if (uxQueueMessagesWaiting(g_ledStripBoxDataQueueHandler) == 0)
+    {
+        return false;
+    }
+    xQueueReset(g_ledStripBoxDataQueueHandler);
+    orderTableReset();
+    TRACE_EMIT(TRACE_EVENT_ORDER_STATE, TRACE_ORDER_CLEARED, 0);
+    alarmLedSync();
+    return true;
+}
+
+/**
+ * @brief  删除订单及其全部库位占用(下发的订单数据有误时回退)
+ * @param  orderState
+ */
+static void ledStripOrderDrop(OrderState_t *orderState)
+{
+    uint16_t _orderNo = orderState->orderNo;
+    UBaseType_t _queueLen = uxQueueMessagesWaiting(g_ledStripBoxDataQueueHandler);
+    for (size_t j = 0; j < _queueLen; j++) // 遍历链表查找已有元素
+    {
+        BoxData_t _boxDataDelete;
+        if (xQueueReceive(g_ledStripBoxDataQueueHandler, &_boxDataDelete, 0) != pdPASS)
+        {
+            continue;
+        }
+        if (boxOwnerRemove(&_boxDataDelete, _orderNo) && _boxDataDelete.ownerCount == 0) // 该库位没有其他订单,数据不放回队列
+        {
+            ESP_LOGW(TAG, "Box[\"%s\"] Delete", _boxDataDelete.storageLocation);
+            continue;
+        }
+        xQueueSendToBack(g_ledStripBoxDataQueueHandler, &_boxDataDelete, 0);
+    }
+    TRACE_EMIT(TRACE_EVENT_ORDER_STATE, TRACE_ORDER_DROPPED, _orderNo);
+    ESP_LOGE(TAG, "Order [%s] data incorrect. Delete! [%d] orders remaining", orderState->orderName, s_executingOrderCount - 1);
+    orderStateRemove(orderState);
+}
+
+/**
+ * @brief  将订单写入库位: 库位已存在时更新或追加订单占用并重新分配灯珠, 不存在时新建库位
+ * @param  boxData      库位数据(新建库位时写入队列)
+ * @param  orderBoxInfo 订单对库位的占用信息
+ * @param  orderState
+ * @return esp_err_t
+ */
+static esp_err_t ledStripBoxOrderPut(BoxData_t *boxData, const OrderBoxInfo_t *orderBoxInfo, OrderState_t *orderState)
+{
+    UBaseType_t _queueLen = uxQueueMessagesWaiting(g_ledStripBoxDataQueueHandler);
+    BoxData_t _searchBoxData;              // 查找的目标数据
+    for (size_t j = 0; j < _queueLen; j++) // 遍历链表查找已有元素
+    {
+        if (xQueueReceive(g_ledStripBoxDataQueueHandler, &_searchBoxData, 0) != pdPASS)
+        {
+            continue;
+        }
+        if (strcmp(boxData->storageLocation, _searchBoxData.storageLocation) != 0)
+        {
+            // 元素不符合条件，放回队列尾部 继续查找
+            xQueueSendToBack(g_ledStripBoxDataQueueHandler, &_searchBoxData, 0);
+            continue;
+        }
+        OrderBoxInfo_t *_owner = boxOwnerFind(&_searchBoxData, orderBoxInfo->orderNo);
+        if (_owner != NULL) // 库位已有该订单,更新占用信息
+        {
+            ESP_LOGE(TAG, "Order[%s] Order No = [%d] Box[%s] info changed", orderState->orderName, orderBoxInfo->orderNo, boxData->storageLocation);
+            _owner->takeTimes = orderBoxInfo->takeTimes;
+            _owner->color = orderBoxInfo->color;
+        }
+        else if (boxOwnerAdd(&_searchBoxData, orderBoxInfo))
+        {
+            ESP_LOGI(TAG, "Box[%s] Add a new order [%s]", boxData->storageLocation, orderState->orderName);
+            orderState->residueBoxCount++;
+        }
+        else
+        {
+            ESP_LOGE(TAG, "Box[%s] order [%s] exceeds %d owner entries", boxData->storageLocation, orderState->orderName, LED_STRIP_INDICATION_OWNER_POOL_SIZE);
+            xQueueSendToBack(g_ledStripBoxDataQueueHandler, &_searchBoxData, 0);
+            return ESP_ERR_NO_MEM;
+        }
+        // 订单的库位发生覆盖,需要把旧的(当前亮着的)库位熄灭 (会影响所有订单的库位)
+        led_strip_fill(g_ledstripRmtHandle, _searchBoxData.startLedId - 1, _searchBoxData.endLedId - _searchBoxData.startLedId + 1, 0, 0, 0);
+        // 重新赋值库位数据
+        _searchBoxData.startLedId = boxData->startLedId;
+        _searchBoxData.endLedId = boxData->endLedId;
+        _searchBoxData.isBoxOrderChanged = true;
+        xQueueSendToBack(g_ledStripBoxDataQueueHandler, &_searchBoxData, 0);
+        return ESP_OK;
+    }
+    // 遍历完成未找到相等的库位，库位写入队列
+    boxData->ownerHead = LED_STRIP_OWNER_NONE;
+    boxData->ownerCount = 0;
+    boxData->isBoxOrderChanged = true;
+    if (!boxOwnerAdd(boxData, orderBoxInfo))
+    {
+        ESP_LOGE(TAG, "Box[%s] order [%s] exceeds %d owner entries", boxData->storageLocation, orderState->orderName, LED_STRIP_INDICATION_OWNER_POOL_SIZE);
+        return ESP_ERR_NO_MEM;
+    }
+    if (xQueueSend(g_ledStripBoxDataQueueHandler, boxData, 0) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Box[%s] exceeds %d storage locations", boxData->storageLocation, LED_STRIP_INDICATION_MAX_ORDER_BOX_SIZE);
+        boxOwnerRemove(boxData, orderBoxInfo->orderNo);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    orderState->residueBoxCount++;
+    return ESP_OK;
+}
+
 /**
  * @brief  处理下发新订单命令
  * @param  data
@@ -93,7 +435,8 @@ esp_err_t ledStripPlaceNewOrder(cJSON *data)
     strcpy(_orderName, cJSON_GetStringValue(_orderJson));
     uint64_t _timeStamp = 0;
     _timeStamp = cJSON_GetNumberValue(_timeStampJson);
-    _orderBoxInfo.color = cJSON_GetNumberValue(_colorJson);
+    uint32_t _orderColor = cJSON_GetNumberValue(_colorJson);
+    _orderBoxInfo.color = ledStripColorScale(_orderColor, s_btightness); // 亮度换算只在下发时执行一次
 
     int boxListJsonSize = cJSON_GetArraySize(_boxListJson);
     if (boxListJsonSize <= 0) // 库位列表是空的
@@ -101,486 +444,816 @@ esp_err_t ledStripPlaceNewOrder(cJSON *data)
         ESP_LOGE(TAG, "The storage location is empty");
         return ESP_ERR_INVALID_ARG;
     }
-    if (cJSON_GetArraySize(cJSON_GetArrayItem(_boxListJson, 0)) != LED_STRIP_INDICATION_BOX_LIST_ITEM_SIZE) // 库位信息长度不一致
+    if (cJSON_GetArraySize(cJSON_GetArrayItem(_boxListJson, 0)) != LED_STRIP_INDICATION_BOX_LIST_ITEM_SIZE) // 库位信息长度不一致
+    {
+        ESP_LOGE(TAG, "Storage location information error");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    OrderState_t *_orderState = orderStateFind(_orderName); // 查找当前订单是否已经存在
+    if (_orderState != NULL)
+    {
+        if (!s_allowOrderOverwriteLocation) // 是否允许覆盖库位
+        {
+            ESP_LOGE(TAG, "The system does not allow orders to overwrite storage locations");
+            ESP_LOGE(TAG, "The order [%s] still has residual [%d] storage locations", _orderState->orderName, _orderState->residueBoxCount);
+            return ESP_ERR_INVALID_STATE;
+        }
+    }
+    else // 订单不存在，尝试添加新订单
+    {
+        if (s_executingOrderCount >= LED_STRIP_INDICATION_MAX_ORDERS) // 订单已经排满了
+        {
+            ESP_LOGE(TAG, "s_executingOrderCount = %d Exceeding the number of orders", s_executingOrderCount);
+            return ESP_ERR_INVALID_SIZE;
+        }
+        _orderState = orderStateAdd(_orderName, _timeStamp, _orderColor);
+        ESP_LOGW(TAG, "s_orderState add a new order [%s],order No = [%d]", _orderState->orderName, _orderState->orderNo);
+        TRACE_EMIT(TRACE_EVENT_ORDER_STATE, TRACE_ORDER_ADDED, _orderState->orderNo);
+    }
+    _orderBoxInfo.orderNo = _orderState->orderNo;
+    _orderBoxInfo.orderSlot = _orderState - s_orderState;
+
+    BoxData_t _boxdataTemp = {0};
+    for (size_t i = 0; i < boxListJsonSize; i++) // 挨个取出库位数据，存入队列
+    {
+        cJSON *_boxItemJson = cJSON_GetArrayItem(_boxListJson, i);
+        strcpy(_boxdataTemp.storageLocation, cJSON_GetStringValue(cJSON_GetArrayItem(_boxItemJson, 0))); // 获取库位
+        _boxdataTemp.startLedId = cJSON_GetNumberValue(cJSON_GetArrayItem(_boxItemJson, 1));             // 获取起始灯珠
+        _boxdataTemp.endLedId = cJSON_GetNumberValue(cJSON_GetArrayItem(_boxItemJson, 2));               // 获取结尾灯珠
+        _orderBoxInfo.takeTimes = cJSON_GetNumberValue(cJSON_GetArrayItem(_boxItemJson, 3));             // 获取灭灯寿命
+        ESP_LOGI(TAG, "Get Order BoxList[%d] = [\"%s\",%d,%d,%d]", i, _boxdataTemp.storageLocation, _boxdataTemp.startLedId, _boxdataTemp.endLedId, _orderBoxInfo.takeTimes);
+        esp_err_t err = ESP_OK;
+        if (_boxdataTemp.endLedId < _boxdataTemp.startLedId || _boxdataTemp.startLedId == 0 || _boxdataTemp.endLedId > s_initLednum) // 错误库位灯珠数据过滤
+        {
+            ESP_LOGE(TAG, "The number of leds in BoxList[%d] is incorrect", i);
+            err = ESP_ERR_INVALID_ARG;
+        }
+        else
+        {
+            err = ledStripBoxOrderPut(&_boxdataTemp, &_orderBoxInfo, _orderState);
+        }
+        if (err != ESP_OK) // 清除未出错之前已经写入的库位数据与订单状态
+        {
+            ledStripOrderDrop(_orderState);
+            alarmLedSync();
+            LEDSTRIP_REFRESH;
+            return err;
+        }
+    }
+    alarmLedSync();
+    xSemaphoreGive(g_ledStripBoxDataSemphHandle); // 库位数据变化,释放信号量处理亮灯
+    return ESP_OK;
+}
+
+/**
+ * @brief  查询残留订单
+ * @return esp_err_t
+ */
+esp_err_t queryResiduesOrder()
+{
+    char *_msg = heap_caps_malloc(RESIDUES_ORDER_MSG_MAX_LEN, MALLOC_CAP_SPIRAM);
+    if (_msg == NULL)
+    {
+        ESP_LOGE(TAG, "Residues order message malloc failed");
+        return ESP_ERR_NO_MEM;
+    }
+    json_writer_t _writer;
+    mqttPubWriterInit(&_writer, _msg, RESIDUES_ORDER_MSG_MAX_LEN);
+    json_writer_object_begin(&_writer);
+    json_writer_key_int(&_writer, "control_type", MQTT_CONTROL_TYPE_BUSINESS_ORDER_MANAGE);
+    json_writer_key_int(&_writer, "notify_type", NOTIFY_RESIDUES_ORDER);
+    json_writer_key(&_writer, "data");
+    json_writer_object_begin(&_writer);
+    json_writer_key(&_writer, "order_list");
+    json_writer_array_begin(&_writer);
+    for (size_t i = 0; i < LED_STRIP_INDICATION_MAX_ORDERS; i++)
+    {
+        if (s_orderState[i].residueBoxCount > 0)
+        {
+            json_writer_array_begin(&_writer);
+            json_writer_string(&_writer, s_orderState[i].orderName);
+            json_writer_int(&_writer, s_orderState[i].residueBoxCount);
+            json_writer_uint(&_writer, s_orderState[i].timeStamp);
+            json_writer_int(&_writer, s_orderState[i].color);
+            json_writer_array_end(&_writer);
+        }
+    }
+    json_writer_array_end(&_writer);
+    json_writer_object_end(&_writer);
+    json_writer_object_end(&_writer);
+    esp_err_t err = mqttPubWriterSend(&_writer, MQTT_PUB_FLAG_CRITICAL);
+    free(_msg);
+    return err;
+}
+
+/**
+ * @brief  取货完成
+ * @param  data
+ * @return esp_err_t
+ */
+esp_err_t ledStripPickupCompleted(cJSON *data)
+{
+    cJSON *_orderJson = getJSONobj(data, "order");
+    cJSON *_boxJson = getJSONobj(data, "box");
+    cJSON *_times = getJSONobj(data, "times");
+    if (_boxJson == NULL || _orderJson == NULL || _times == NULL)
+    {
+        return ESP_FAIL;
+    }
+    strcpy(_orderName, cJSON_GetStringValue(_orderJson));
+    OrderState_t *_orderState = orderStateFind(_orderName);
+    uint16_t _orderNoForSerch = _orderState != NULL ? _orderState->orderNo : 0; // 用来搜索的订单顺序
+
+    char _storageLocation[LED_STRIP_INDICATION_STORAGE_LOCATION_STR_MAXSIZE] = {0};
+    strcpy(_storageLocation, cJSON_GetStringValue(_boxJson));
+    uint16_t deductTakeTimes = cJSON_GetNumberValue(_times); // 本次扣除的取物次数
+    UBaseType_t _queueLen = uxQueueMessagesWaiting(g_ledStripBoxDataQueueHandler);
+    if (_queueLen == 0 || _orderState == NULL) // 订单全部完成,或该订单无效
+    {
+        ESP_LOGE(TAG, "Order [%s] Order No = [%d] have been completed", _orderName, _orderNoForSerch);
+        return ESP_FAIL;
+    }
+    BoxData_t _searchBoxData = {0};        // 查找的目标数据
+    for (size_t i = 0; i < _queueLen; i++) // 遍历链表查找已有元素
+    {
+        // 从队列中接收元素
+        if (xQueueReceive(g_ledStripBoxDataQueueHandler, &_searchBoxData, 0) != pdPASS)
+        {
+            continue;
+        }
+        if (strcmp(_storageLocation, _searchBoxData.storageLocation) != 0)
+        {
+            // 库位不符合条件，放回队列尾部 继续查找
+            xQueueSendToBack(g_ledStripBoxDataQueueHandler, &_searchBoxData, 0);
+            continue;
+        }
+        OrderBoxInfo_t *_owner = boxOwnerFind(&_searchBoxData, _orderNoForSerch); // 查找该库位的订单，相同则更新取货次数数据
+        if (_owner == NULL)
+        {
+            // 库位匹配但找不到目标订单,库位放回队列尾部
+            ESP_LOGE(TAG, "Box [%s],Not have order [%s] No. = [%d] exists", _storageLocation, _orderName, _orderNoForSerch);
+            xQueueSendToBack(g_ledStripBoxDataQueueHandler, &_searchBoxData, 0);
+            return ESP_ERR_NOT_FOUND;
+        }
+        if (_owner->takeTimes > deductTakeTimes) // 该订单还有剩余取货次数，扣减取货寿命
+        {
+            _owner->takeTimes -= deductTakeTimes;
+            ESP_LOGI(TAG, "Order [%s] Box [%s] changed.take times deduct [%d] residue [%d]", _orderName, _storageLocation, deductTakeTimes, _owner->takeTimes);
+            xQueueSendToBack(g_ledStripBoxDataQueueHandler, &_searchBoxData, 0);
+            return ESP_OK;
+        }
+        // 订单的该库位取货完成,执行灭灯,订单数据归零
+        ESP_LOGI(TAG, "Order [%s] Box [%s] kill", _orderName, _storageLocation);
+        boxOwnerRemove(&_searchBoxData, _orderNoForSerch);
+        LEDSTRIP_REFRESH;
+        if (_orderState->residueBoxCount >= 1) // 订单残留指示减1个库位
+        {
+            _orderState->residueBoxCount--;
+            if (_orderState->residueBoxCount == 0) // 订单的所有库位取货完毕了,订单已经完成，订单数据归零
+            {
+                TRACE_EMIT(TRACE_EVENT_ORDER_STATE, TRACE_ORDER_COMPLETED, _orderNoForSerch);
+                orderStateRemove(_orderState);
+                ESP_LOGW(TAG, "Order [%s] completed. [%d] orders remaining", _orderName, s_executingOrderCount);
+                alarmLedSync();
+            }
+        }
+        if (_searchBoxData.ownerCount != 0) // 还有其他订单未完成,数据放回队列
+        {
+            xQueueSendToBack(g_ledStripBoxDataQueueHandler, &_searchBoxData, 0);
+            if (_searchBoxData.isBoxOrderChanged) // 等待中的订单分配到灯珠
+            {
+                xSemaphoreGive(g_ledStripBoxDataSemphHandle);
+            }
+        }
+        return ESP_OK;
+    }
+    // 队列中没有该库位
+    ESP_LOGE(TAG, "Box [%s],Not in queue", _storageLocation);
+    return ESP_ERR_NOT_FOUND;
+}
+
+/**
+ * @brief  结束取货指示
+ * @param  data
+ * @return esp_err_t
+ */
+esp_err_t ledStripEndPickupInstruction(cJSON *data)
+{
+    cJSON *_orderJson = getJSONobj(data, "order");
+    if (_orderJson == NULL)
+    {
+        return ESP_FAIL;
+    }
+    strcpy(_orderName, cJSON_GetStringValue(_orderJson));
+    OrderState_t *_orderState = orderStateFind(_orderName);
+    UBaseType_t _queueLen = uxQueueMessagesWaiting(g_ledStripBoxDataQueueHandler);
+    if (_queueLen == 0 || _orderState == NULL) // 订单全部完成,或该订单无效
+    {
+        ESP_LOGE(TAG, "Order [%s] has been completed", _orderName);
+        return ESP_FAIL;
+    }
+    uint16_t _orderNoForSerch = _orderState->orderNo;
+    bool _isBoxOrderChanged = false;       // 有等待中的订单分配到灯珠
+    BoxData_t _searchBoxData = {0};        // 查找的目标数据
+    for (size_t i = 0; i < _queueLen; i++) // 遍历链表查找已有元素,熄灭灯带
+    {
+        // 从队列中接收元素,清除相等订单的库位灯带占用信息
+        if (xQueueReceive(g_ledStripBoxDataQueueHandler, &_searchBoxData, 0) == pdPASS)
+        {
+            boxOwnerRemove(&_searchBoxData, _orderNoForSerch);
+            if (_searchBoxData.ownerCount != 0) // 所有订单已经取货完成的库位数据不放回队列
+            {
+                _isBoxOrderChanged |= _searchBoxData.isBoxOrderChanged;
+                xQueueSendToBack(g_ledStripBoxDataQueueHandler, &_searchBoxData, 0);
+            }
+        }
+    }
+    LEDSTRIP_REFRESH;
+    // 清除三色灯状态
+    TRACE_EMIT(TRACE_EVENT_ORDER_STATE, TRACE_ORDER_KILLED, _orderNoForSerch);
+    orderStateRemove(_orderState);
+    ESP_LOGW(TAG, "Order [%s] kill. [%d] orders remaining", _orderName, s_executingOrderCount);
+    alarmLedSync();
+    if (_isBoxOrderChanged)
+    {
+        xSemaphoreGive(g_ledStripBoxDataSemphHandle);
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief 批量命令中库位条目的处理状态
+ */
+typedef enum
+{
+    BULK_BOX_NEW = 0,  // 队列中没有该库位
+    BULK_BOX_EXISTING, // 队列中已有该库位(取货命令:库位中有该订单)
+    BULK_BOX_COUNTED,  // 新库位已计数(同名条目只计一次)
+    BULK_BOX_DONE,     // 已写入队列
+} BulkBoxState_t;
+
+/**
+ * @brief 批量命令中的一个库位条目
+ */
+typedef struct _BulkBoxItem
+{
+    const char *storageLocation; // 库位名(指向命令JSON,命令处理期间有效)
+    uint16_t startLedId;
+    uint16_t endLedId;
+    uint16_t takeTimes; // 下发订单:灭灯寿命; 取货完成:扣除的取物次数
+    uint32_t color;
+    uint16_t orderNo;   // 取货完成命令的订单到达顺序
+    uint8_t orderIndex; // 下发订单:命令中的订单序号; 取货完成:订单在订单表中的位置
+    uint8_t state;      // BulkBoxState_t
+    int16_t next;       // 同一哈希桶的下一个条目(按命令中的顺序), -1表示结束
+} BulkBoxItem_t;
+
+/**
+ * @brief 批量命令的库位条目表,按库位名哈希,一次遍历库位队列即可匹配全部条目
+ */
+typedef struct _BulkBoxTable
+{
+    BulkBoxItem_t *item;
+    int16_t *bucket;
+    uint16_t count;
+    uint16_t mask;
+} BulkBoxTable_t;
+
+/**
+ * @brief  申请库位条目表(PSRAM)
+ * @param  table
+ * @param  capacity 条目数量上限
+ * @return esp_err_t
+ */
+static esp_err_t bulkBoxTableCreate(BulkBoxTable_t *table, uint16_t capacity)
+{
+    uint16_t _bucketNum = 16;
+    while (_bucketNum < capacity)
+    {
+        _bucketNum <<= 1;
+    }
+    table->item = heap_caps_malloc(capacity * sizeof(BulkBoxItem_t) + _bucketNum * sizeof(int16_t), MALLOC_CAP_SPIRAM);
+    if (table->item == NULL)
+    {
+        ESP_LOGE(TAG, "Bulk box table malloc failed");
+        return ESP_ERR_NO_MEM;
+    }
+    table->bucket = (int16_t *)(table->item + capacity);
+    table->count = 0;
+    table->mask = _bucketNum - 1;
+    return ESP_OK;
+}
+
+/**
+ * @brief  全部条目写入后建立哈希链,同名条目按命令中的顺序链接
+ * @param  table
+ */
+static void bulkBoxTableIndex(BulkBoxTable_t *table)
+{
+    memset(table->bucket, 0xFF, (table->mask + 1) * sizeof(int16_t));
+    for (int16_t i = table->count - 1; i >= 0; i--)
+    {
+        int16_t *_head = &table->bucket[nameHash(table->item[i].storageLocation) & table->mask];
+        table->item[i].next = *_head;
+        *_head = i;
+    }
+}
+
+/**
+ * @brief  查找库位名相同的下一个条目
+ * @param  table
+ * @param  storageLocation
+ * @param  from     上一个条目, -1表示从头查找
+ * @return int16_t  不存在返回-1
+ */
+static int16_t bulkBoxTableNext(const BulkBoxTable_t *table, const char *storageLocation, int16_t from)
+{
+    int16_t i = from < 0 ? table->bucket[nameHash(storageLocation) & table->mask] : table->item[from].next;
+    for (; i >= 0; i = table->item[i].next)
+    {
+        if (strcmp(storageLocation, table->item[i].storageLocation) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief  读取字符串字段并检查长度
+ * @param  json
+ * @param  maxSize  含结束符
+ * @return const char* 不是字符串或过长返回NULL
+ */
+static const char *bulkStringGet(cJSON *json, size_t maxSize)
+{
+    const char *_str = cJSON_GetStringValue(json);
+    if (_str == NULL || _str[0] == '\0' || strlen(_str) >= maxSize)
+    {
+        return NULL;
+    }
+    return _str;
+}
+
+/**
+ * @brief  检查数组中[first, size)的元素都是数字
+ * @param  arrayJson
+ * @param  first
+ * @param  size
+ * @return bool
+ */
+static bool bulkNumbersCheck(cJSON *arrayJson, int first, int size)
+{
+    for (int i = first; i < size; i++)
+    {
+        if (!cJSON_IsNumber(cJSON_GetArrayItem(arrayJson, i)))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief  订单写入库位条目: 库位已有该订单时更新占用信息, 否则追加占用(容量已在校验时确认)
+ * @param  boxData
+ * @param  item
+ * @param  orderState
+ */
+static void bulkBoxOwnerPut(BoxData_t *boxData, const BulkBoxItem_t *item, OrderState_t *orderState)
+{
+    OrderBoxInfo_t *_owner = boxOwnerFind(boxData, orderState->orderNo);
+    if (_owner != NULL)
+    {
+        _owner->takeTimes = item->takeTimes;
+        _owner->color = item->color;
+        return;
+    }
+    OrderBoxInfo_t _orderBoxInfo = {
+        .orderNo = orderState->orderNo,
+        .takeTimes = item->takeTimes,
+        .color = item->color,
+        .orderSlot = orderState - s_orderState,
+    };
+    if (boxOwnerAdd(boxData, &_orderBoxInfo))
+    {
+        orderState->residueBoxCount++;
+    }
+}
+
+/**
+ * @brief  批量下发订单: 一条命令携带多个订单及其库位
+ *         先校验整条命令(格式、灯珠范围、订单数量、占用信息与库位队列容量),任一项失败整条命令不生效;
+ *         校验通过后遍历两次库位队列写入全部库位,只触发一次灯带指示处理
+ * @param  data {"time_stamp":..,"order_list":[{"order":"A","color":..,"box_list":[["库位",起始灯珠,结尾灯珠,灭灯寿命(,颜色)],..]},..]}
+ * @return esp_err_t
+ */
+esp_err_t ledStripPlaceNewOrderBulk(cJSON *data)
+{
+    cJSON *_timeStampJson = getJSONobj(data, "time_stamp");
+    cJSON *_orderListJson = getJSONobj(data, "order_list");
+    if (_timeStampJson == NULL || _orderListJson == NULL)
+    {
+        return ESP_FAIL;
+    }
+    uint64_t _timeStamp = cJSON_GetNumberValue(_timeStampJson);
+    int _orderNum = cJSON_GetArraySize(_orderListJson);
+    if (_orderNum <= 0 || _orderNum > LED_STRIP_INDICATION_MAX_ORDERS)
+    {
+        ESP_LOGE(TAG, "Bulk order_list size = %d out of range", _orderNum);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // 校验订单
+    const char *_orderNameList[LED_STRIP_INDICATION_MAX_ORDERS];
+    uint32_t _orderColor[LED_STRIP_INDICATION_MAX_ORDERS];
+    cJSON *_boxListJson[LED_STRIP_INDICATION_MAX_ORDERS];
+    OrderState_t *_orderState[LED_STRIP_INDICATION_MAX_ORDERS];
+    uint8_t _newOrderNum = 0;
+    int _boxNum = 0;
+    int k = 0;
+    cJSON *_orderItemJson = NULL;
+    cJSON_ArrayForEach(_orderItemJson, _orderListJson)
+    {
+        cJSON *_colorJson = cJSON_GetObjectItem(_orderItemJson, "color");
+        _orderNameList[k] = bulkStringGet(cJSON_GetObjectItem(_orderItemJson, "order"), LED_STRIP_INDICATION_ORDER_STR_MAXSIZE);
+        _boxListJson[k] = cJSON_GetObjectItem(_orderItemJson, "box_list");
+        if (_orderNameList[k] == NULL || !cJSON_IsNumber(_colorJson) || cJSON_GetArraySize(_boxListJson[k]) <= 0)
+        {
+            ESP_LOGE(TAG, "Bulk order_list[%d] information error", k);
+            return ESP_ERR_INVALID_ARG;
+        }
+        for (int i = 0; i < k; i++)
+        {
+            if (strcmp(_orderNameList[i], _orderNameList[k]) == 0)
+            {
+                ESP_LOGE(TAG, "Bulk order [%s] repeated", _orderNameList[k]);
+                return ESP_ERR_INVALID_ARG;
+            }
+        }
+        _orderColor[k] = cJSON_GetNumberValue(_colorJson);
+        _orderState[k] = orderStateFind(_orderNameList[k]);
+        if (_orderState[k] == NULL)
+        {
+            _newOrderNum++;
+        }
+        else if (!s_allowOrderOverwriteLocation) // 是否允许覆盖库位
+        {
+            ESP_LOGE(TAG, "The system does not allow orders to overwrite storage locations");
+            ESP_LOGE(TAG, "The order [%s] still has residual [%d] storage locations", _orderState[k]->orderName, _orderState[k]->residueBoxCount);
+            return ESP_ERR_INVALID_STATE;
+        }
+        _boxNum += cJSON_GetArraySize(_boxListJson[k]);
+        k++;
+    }
+    if (s_executingOrderCount + _newOrderNum > LED_STRIP_INDICATION_MAX_ORDERS) // 订单已经排满了
+    {
+        ESP_LOGE(TAG, "s_executingOrderCount = %d + %d Exceeding the number of orders", s_executingOrderCount, _newOrderNum);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (_boxNum > s_ownerFreeCount) // 按全部为新增占用估算
     {
-        ESP_LOGE(TAG, "Storage location information error");
-        return ESP_ERR_INVALID_ARG;
+        ESP_LOGE(TAG, "Bulk %d boxes exceed %d free owner entries", _boxNum, s_ownerFreeCount);
+        return ESP_ERR_NO_MEM;
     }
 
-    bool _isOrderExist = false;
-    for (size_t i = 0; i < LED_STRIP_INDICATION_MAX_ORDERS; i++) // 查找当前订单是否已经存在
+    // 校验库位
+    BulkBoxTable_t _table;
+    esp_err_t err = bulkBoxTableCreate(&_table, _boxNum);
+    if (err != ESP_OK)
     {
-        if (strcmp(_orderName, s_orderState[i].orderName) == 0)
+        return err;
+    }
+    for (k = 0; k < _orderNum; k++)
+    {
+        uint32_t _boxColor = ledStripColorScale(_orderColor[k], s_btightness); // 亮度换算只在下发时执行一次
+        cJSON *_boxItemJson = NULL;
+        cJSON_ArrayForEach(_boxItemJson, _boxListJson[k])
         {
-            _isOrderExist = true;
-            if (!s_allowOrderOverwriteLocation) // 是否允许覆盖库位
+            BulkBoxItem_t *_item = &_table.item[_table.count];
+            int _itemSize = cJSON_GetArraySize(_boxItemJson);
+            _item->storageLocation = bulkStringGet(cJSON_GetArrayItem(_boxItemJson, 0), LED_STRIP_INDICATION_STORAGE_LOCATION_STR_MAXSIZE);
+            _item->startLedId = cJSON_GetNumberValue(cJSON_GetArrayItem(_boxItemJson, 1));
+            _item->endLedId = cJSON_GetNumberValue(cJSON_GetArrayItem(_boxItemJson, 2));
+            _item->takeTimes = cJSON_GetNumberValue(cJSON_GetArrayItem(_boxItemJson, 3));
+            _item->color = _itemSize > LED_STRIP_INDICATION_BOX_LIST_ITEM_SIZE ? ledStripColorScale(cJSON_GetNumberValue(cJSON_GetArrayItem(_boxItemJson, 4)), s_btightness) : _boxColor;
+            _item->orderIndex = k;
+            _item->state = BULK_BOX_NEW;
+            if (_item->storageLocation == NULL || _itemSize < LED_STRIP_INDICATION_BOX_LIST_ITEM_SIZE || _itemSize > LED_STRIP_INDICATION_BOX_LIST_ITEM_SIZE + 1 || !bulkNumbersCheck(_boxItemJson, 1, _itemSize) ||
+                _item->endLedId < _item->startLedId || _item->startLedId == 0 || _item->endLedId > s_initLednum) // 错误库位灯珠数据过滤
             {
-                ESP_LOGE(TAG, "The system does not allow orders to overwrite storage locations");
-                ESP_LOGE(TAG, "The order [%s] still has residual [%d] storage locations", s_orderState[i].orderName, s_orderState[i].residueBoxCount);
-                return ESP_ERR_INVALID_STATE;
+                ESP_LOGE(TAG, "Bulk order [%s] BoxList item %d is incorrect", _orderNameList[k], _table.count);
+                free(_table.item);
+                return ESP_ERR_INVALID_ARG;
             }
+            _table.count++;
         }
     }
+    bulkBoxTableIndex(&_table);
 
-    if (!_isOrderExist) // 订单不存在，尝试添加新订单
+    // 第一次遍历库位队列: 标记已存在的库位,统计需要新建的库位
+    UBaseType_t _queueLen = uxQueueMessagesWaiting(g_ledStripBoxDataQueueHandler);
+    BoxData_t _searchBoxData;
+    for (size_t j = 0; j < _queueLen; j++)
     {
-        if (s_executingOrderCount >= LED_STRIP_INDICATION_MAX_ORDERS) // 订单已经排满了
+        if (xQueueReceive(g_ledStripBoxDataQueueHandler, &_searchBoxData, 0) != pdPASS)
         {
-            ESP_LOGE(TAG, "s_executingOrderCount = %d Exceeding the number of orders", s_executingOrderCount);
-            return ESP_ERR_INVALID_SIZE;
+            continue;
         }
-        else
+        for (int16_t i = bulkBoxTableNext(&_table, _searchBoxData.storageLocation, -1); i >= 0; i = bulkBoxTableNext(&_table, _searchBoxData.storageLocation, i))
         {
-            for (size_t i = 0; i < LED_STRIP_INDICATION_MAX_ORDERS; i++)
-            {
-                if (s_orderState[i].orderNo == 0) // 找到空闲的位置
-                {
-                    s_executingOrderCount++;            // 执行中的订单加1
-                    if (s_orderNoIncremental == 0xFFFF) // 累计订单超过uint16_t 归零计数
-                    {
-                        s_orderNoIncremental = 0;
-                    }
-                    s_orderNoIncremental++;
-                    s_orderState[i].orderNo = s_orderNoIncremental; // 赋予订单到达顺序
-                    _orderBoxInfo.orderNo = s_orderNoIncremental;
-                    strcpy(s_orderState[i].orderName, _orderName);
-                    s_orderState[i].timeStamp = _timeStamp;
-                    s_orderState[i].color = _orderBoxInfo.color;
-                    ESP_LOGW(TAG, "s_orderState add a new order [%s],order No = [%d]", s_orderState[i].orderName, s_orderState[i].orderNo);
-                    break;
-                }
-            }
+            _table.item[i].state = BULK_BOX_EXISTING;
         }
+        xQueueSendToBack(g_ledStripBoxDataQueueHandler, &_searchBoxData, 0);
     }
-    char _StorageLocationStr[LED_STRIP_INDICATION_STORAGE_LOCATION_STR_MAXSIZE]; // 库位索引
-    uint16_t _startLedId = 0;
-    uint16_t _endledId = 0;
-    uint16_t _takeTimes = 0;
-    BoxData_t _boxdataTemp = {0};
-
-    for (size_t i = 0; i < boxListJsonSize; i++) // 挨个取出库位数据，存入队列
+    UBaseType_t _newBoxNum = 0;
+    for (int16_t i = 0; i < _table.count; i++)
     {
-        strcpy(_StorageLocationStr, cJSON_GetStringValue(cJSON_GetArrayItem(cJSON_GetArrayItem(_boxListJson, i), 0))); // 获取库位
-        _startLedId = cJSON_GetNumberValue(cJSON_GetArrayItem(cJSON_GetArrayItem(_boxListJson, i), 1));                // 获取起始灯珠
-        _endledId = cJSON_GetNumberValue(cJSON_GetArrayItem(cJSON_GetArrayItem(_boxListJson, i), 2));                  // 获取结尾灯珠
-        _takeTimes = cJSON_GetNumberValue(cJSON_GetArrayItem(cJSON_GetArrayItem(_boxListJson, i), 3));                 // 获取灭灯寿命
-        _orderBoxInfo.takeTimes = _takeTimes;                                                                          // 获得到订单的每一项
-        strcpy(_boxdataTemp.storageLocation, _StorageLocationStr);
-        _boxdataTemp.startLedId = _startLedId;
-        _boxdataTemp.endLedId = _endledId;
-        ESP_LOGI(TAG, "Get Order BoxList[%d] = [\"%s\",%d,%d,%d]", i, _StorageLocationStr, _startLedId, _endledId, _takeTimes);
-        if (_endledId < _startLedId || _endledId > s_initLednum) // 错误库位灯珠数据过滤
+        if (_table.item[i].state != BULK_BOX_NEW)
         {
-            ESP_LOGE(TAG, "The number of leds in BoxList[%d] is incorrect", i);
-            // 清除未出错之前已经塞入的库位的数据,无法使用计数倒回查找,因为插入的算法已经将队列打散
-
-            UBaseType_t _queueLen = uxQueueMessagesWaiting(g_ledStripBoxDataQueueHandler);
-            if (_queueLen == 0) // 队列空的 直接删除订单,无需删除库位
-            {
-                goto DELETE_ORDER;
-            }
+            continue;
+        }
+        _newBoxNum++;
+        for (int16_t n = i; n >= 0; n = bulkBoxTableNext(&_table, _table.item[i].storageLocation, n))
+        {
+            _table.item[n].state = BULK_BOX_COUNTED;
+        }
+    }
+    if (_newBoxNum > uxQueueSpacesAvailable(g_ledStripBoxDataQueueHandler))
+    {
+        ESP_LOGE(TAG, "Bulk %d new boxes exceed %d storage locations", _newBoxNum, LED_STRIP_INDICATION_MAX_ORDER_BOX_SIZE);
+        free(_table.item);
+        return ESP_ERR_INVALID_SIZE;
+    }
 
-            for (size_t j = 0; j < _queueLen; j++) // 遍历链表查找已有元素
-            {
-                BoxData_t _boxDataDelete;
-                xQueueReceive(g_ledStripBoxDataQueueHandler, &_boxDataDelete, 0);
-                for (size_t k = 0; k < LED_STRIP_INDICATION_MAX_ORDERS; k++)
-                {
-                    if (_boxDataDelete.orderBoxInfo[k].orderNo == s_orderNoIncremental)
-                    {
-                        memset(&_boxDataDelete.orderBoxInfo[k], 0, sizeof(OrderBoxInfo_t)); // 该库位清空订单占用数据
-                        bool isAllOrderDone = true;                                         // 所有订单取货完成
-                        for (size_t x = 0; x < LED_STRIP_INDICATION_MAX_ORDERS; x++)
-                        {
-                            if (_boxDataDelete.orderBoxInfo[x].orderNo != 0)
-                            {
-                                isAllOrderDone = false;
-                            }
-                        }
-                        if (isAllOrderDone) // 该库位的订单已经全部取货完成,数据不放回队列
-                        {
-                            ESP_LOGW(TAG, "Box[\"%s\"] Delete", _boxDataDelete.storageLocation);
-                        }
-                        else // 还有其他订单未完成,数据放回队列
-                        {
-                            ESP_LOGW(TAG, "Box[\"%s\"] Delete order [%s] ", _boxDataDelete.storageLocation, _orderName);
-                            xQueueSendToBack(g_ledStripBoxDataQueueHandler, &_boxDataDelete, 0);
-                        }
-                        break;
-                    }
-                    if (k == LED_STRIP_INDICATION_MAX_ORDERS - 1) // 订单中没有匹配的库位，放回队列
-                    {
-                        xQueueSendToBack(g_ledStripBoxDataQueueHandler, &_boxDataDelete, 0);
-                    }
-                }
-            }
-        DELETE_ORDER:
-            // 清除订单状态
-            for (size_t j = 0; j < LED_STRIP_INDICATION_MAX_ORDERS; j++)
-            {
-                if (s_orderState[j].orderNo == s_orderNoIncremental) // 删除订单状态
-                {
-                    memset(&s_orderState[j], 0, sizeof(OrderState_t));
-                    s_executingOrderCount--;
-                    ESP_LOGE(TAG, "Order [%s] data incorrect. Delete! [%d] orders remaining", _orderName, s_executingOrderCount);
-                    break;
-                }
-            }
-            return ESP_ERR_INVALID_ARG;
+    // 校验通过,添加新订单
+    for (k = 0; k < _orderNum; k++)
+    {
+        if (_orderState[k] == NULL)
+        {
+            _orderState[k] = orderStateAdd(_orderNameList[k], _timeStamp, _orderColor[k]);
+            TRACE_EMIT(TRACE_EVENT_ORDER_STATE, TRACE_ORDER_ADDED, _orderState[k]->orderNo);
         }
+    }
 
-        // printf("Storage Location = %s\nStart LED ID = %d\nEnd LED ID = %d\nTake Times = %d\n", _StorageLocationStr, _startLedId, _endledId, _takeTimes);
-        UBaseType_t _queueLen = uxQueueMessagesWaiting(g_ledStripBoxDataQueueHandler);
-        if (_queueLen == 0) // 队列空的 塞入第一个库位
+    // 第二次遍历库位队列: 更新已存在的库位
+    for (size_t j = 0; j < _queueLen; j++)
+    {
+        if (xQueueReceive(g_ledStripBoxDataQueueHandler, &_searchBoxData, 0) != pdPASS)
         {
-            ESP_LOGI(TAG, "Box List is empty. Insert Fist Box [%s]", _StorageLocationStr);
-            for (size_t j = 0; j < LED_STRIP_INDICATION_MAX_ORDERS; j++)
-            {
-                if (s_orderState[j].orderNo == _orderBoxInfo.orderNo)
-                {
-                    s_orderState[j].residueBoxCount++;
-                }
-            }
-            _boxdataTemp.isBoxOrderChanged = true;
-            memcpy(&_boxdataTemp.orderBoxInfo[0], &_orderBoxInfo, sizeof(OrderBoxInfo_t)); // 第一个订单占用库位
-            xQueueSend(g_ledStripBoxDataQueueHandler, &_boxdataTemp, 0);
+            continue;
         }
-        else //  队列非空  寻找库位元素是否已经存在，存在则合并，不存在则写入
+        int16_t i = bulkBoxTableNext(&_table, _searchBoxData.storageLocation, -1);
+        if (i >= 0)
         {
-            BoxData_t _searchBoxData = {0};        // 查找的目标数据
-            for (size_t j = 0; j < _queueLen; j++) // 遍历链表查找已有元素
-            {
-                // 从队列中接收元素
-                if (xQueueReceive(g_ledStripBoxDataQueueHandler, &_searchBoxData, 0) == pdPASS)
-                {
-                    // ESP_LOGI(TAG, "_searchBoxData.storageLocation = %s", _searchBoxData.storageLocation);
-                    if (strcmp(_boxdataTemp.storageLocation, _searchBoxData.storageLocation) == 0) // 找到相等的库位
-                    {
-                        // ESP_LOGI(TAG, "Matching storage location found");
-                        bool _isBoxOrderChanged = false;
-                        for (size_t k = 0; k < LED_STRIP_INDICATION_MAX_ORDERS; k++) // 先查找该库位相同的订单，相同则写入更新
-                        {
-                            if (_searchBoxData.orderBoxInfo[k].orderNo == _orderBoxInfo.orderNo)
-                            {
-                                ESP_LOGE(TAG, "Order[%s] Order No = [%d] Box[%s] info changed", _orderName, _orderBoxInfo.orderNo, _boxdataTemp.storageLocation);
-                                _isBoxOrderChanged = true;
-                                // 订单的库位发生覆盖,需要把旧的(当前亮着的)库位熄灭 (会影响所有订单的库位)
-                                for (size_t x = _searchBoxData.startLedId; x <= _searchBoxData.endLedId; x++)
-                                {
-                                    led_strip_set_pixel(g_ledstripRmtHandle, x - 1, 0, 0, 0);
-                                }
-                                // 重新赋值库位数据
-                                _searchBoxData.startLedId = _boxdataTemp.startLedId;
-                                _searchBoxData.endLedId = _boxdataTemp.endLedId;
-                                _searchBoxData.isBoxOrderChanged = _isBoxOrderChanged;
-                                memcpy(&_searchBoxData.orderBoxInfo[k], &_orderBoxInfo, sizeof(OrderBoxInfo_t));
-                                xQueueSend(g_ledStripBoxDataQueueHandler, &_searchBoxData, 0);
-                                break;
-                            }
-                        }
-                        if (!_isBoxOrderChanged) // 无相同订单再查找该库位是否有剩余订单空间
-                        {
-                            for (size_t k = 0; k < LED_STRIP_INDICATION_MAX_ORDERS; k++)
-                            {
-                                if (_searchBoxData.orderBoxInfo[k].orderNo == 0)
-                                {
-                                    ESP_LOGI(TAG, "Box[%s] Add a new order [%s]", _boxdataTemp.storageLocation, _orderName);
-                                    for (size_t x = 0; x < LED_STRIP_INDICATION_MAX_ORDERS; x++)
-                                    {
-                                        if (s_orderState[x].orderNo == _orderBoxInfo.orderNo)
-                                        {
-                                            s_orderState[x].residueBoxCount++;
-                                        }
-                                    }
-                                    _isBoxOrderChanged = true;
-                                    // 订单的库位发生覆盖,需要把旧的(当前亮着的)库位熄灭 (会影响所有订单的库位)
-                                    for (size_t x = _searchBoxData.startLedId; x <= _searchBoxData.endLedId; x++)
-                                    {
-                                        led_strip_set_pixel(g_ledstripRmtHandle, x - 1, 0, 0, 0);
-                                    }
-                                    // 重新赋值库位数据
-                                    _searchBoxData.startLedId = _boxdataTemp.startLedId;
-                                    _searchBoxData.endLedId = _boxdataTemp.endLedId;
-                                    _searchBoxData.isBoxOrderChanged = _isBoxOrderChanged;
-                                    memcpy(&_searchBoxData.orderBoxInfo[k], &_orderBoxInfo, sizeof(OrderBoxInfo_t));
-                                    xQueueSend(g_ledStripBoxDataQueueHandler, &_searchBoxData, 0);
-                                    break;
-                                }
-                            }
-                        }
-                        if (_isBoxOrderChanged)
-                        {
-                            goto FIND_EQUAL;
-                        }
-                        else // 库位中已占用的订单不匹配，且库位没剩余的订单空间。
-                        {
-                            ESP_LOGE(TAG, "The number of orders exceeds the limit");
-                            return ESP_ERR_INVALID_SIZE;
-                        }
-                    }
-                    else
-                    {
-                        // 元素不符合条件，放回队列尾部 继续查找
-                        xQueueSendToBack(g_ledStripBoxDataQueueHandler, &_searchBoxData, 0);
-                    }
-                }
-            }
-            // 遍历完成未找到相等的库位，库位写入队列
-            // ESP_LOGI(TAG, "The Box [%s] is new. Add to the queue", _boxdataTemp.storageLocation);
-            for (size_t j = 0; j < LED_STRIP_INDICATION_MAX_ORDERS; j++)
+            // 库位发生覆盖,熄灭旧的(当前亮着的)库位,由灯带指示任务重新分配灯珠
+            led_strip_fill(g_ledstripRmtHandle, _searchBoxData.startLedId - 1, _searchBoxData.endLedId - _searchBoxData.startLedId + 1, 0, 0, 0);
+            for (; i >= 0; i = bulkBoxTableNext(&_table, _searchBoxData.storageLocation, i))
             {
-                if (s_orderState[j].orderNo == _orderBoxInfo.orderNo)
-                {
-                    s_orderState[j].residueBoxCount++;
-                }
+                bulkBoxOwnerPut(&_searchBoxData, &_table.item[i], _orderState[_table.item[i].orderIndex]);
+                _searchBoxData.startLedId = _table.item[i].startLedId;
+                _searchBoxData.endLedId = _table.item[i].endLedId;
             }
-            _boxdataTemp.isBoxOrderChanged = true;
-            memcpy(&_boxdataTemp.orderBoxInfo[0], &_orderBoxInfo, sizeof(OrderBoxInfo_t)); // 占用第一个订单位置
-            xQueueSend(g_ledStripBoxDataQueueHandler, &_boxdataTemp, 0);
-        FIND_EQUAL:
+            _searchBoxData.isBoxOrderChanged = true;
         }
+        xQueueSendToBack(g_ledStripBoxDataQueueHandler, &_searchBoxData, 0);
     }
-    alarmLedSync();
-    xSemaphoreGive(g_ledStripBoxDataSemphHandle); // 库位数据变化,释放信号量处理亮灯
-    return ESP_OK;
-}
-
-/**
- * @brief  查询残留订单
- * @return esp_err_t
- */
-esp_err_t queryResiduesOrder()
-{
-    MqttPublishData_t _mqttPubData;
-    cJSON *msgBuff = NULL;
-    msgBuff = cJSON_CreateObject();
-    cJSON_AddNumberToObject(msgBuff, "control_type", MQTT_CONTROL_TYPE_BUSINESS_ORDER_MANAGE);
-    cJSON_AddNumberToObject(msgBuff, "notify_type", NOTIFY_RESIDUES_ORDER);
-    cJSON *data = NULL;
-    data = cJSON_CreateObject();
-    cJSON *orderList = NULL;
-    orderList = cJSON_CreateArray();
-    cJSON *orderInfoArray = NULL;
 
-    for (size_t i = 0; i < LED_STRIP_INDICATION_MAX_ORDERS; i++)
+    // 新建库位,同名条目合并为一个库位
+    for (int16_t i = 0; i < _table.count; i++)
     {
-        orderInfoArray = cJSON_CreateArray();
-        if (s_orderState[i].residueBoxCount > 0)
+        if (_table.item[i].state != BULK_BOX_COUNTED)
         {
-
-            cJSON_AddItemToArray(orderInfoArray, cJSON_CreateString(s_orderState[i].orderName));
-            cJSON_AddItemToArray(orderInfoArray, cJSON_CreateNumber(s_orderState[i].residueBoxCount));
-            cJSON_AddItemToArray(orderInfoArray, cJSON_CreateNumber(s_orderState[i].timeStamp));
-            cJSON_AddItemToArray(orderInfoArray, cJSON_CreateNumber(s_orderState[i].color));
-            cJSON_AddItemToArray(orderList, orderInfoArray);
+            continue;
+        }
+        BoxData_t _boxData = {0};
+        strcpy(_boxData.storageLocation, _table.item[i].storageLocation);
+        _boxData.ownerHead = LED_STRIP_OWNER_NONE;
+        _boxData.isBoxOrderChanged = true;
+        for (int16_t n = i; n >= 0; n = bulkBoxTableNext(&_table, _boxData.storageLocation, n))
+        {
+            bulkBoxOwnerPut(&_boxData, &_table.item[n], _orderState[_table.item[n].orderIndex]);
+            _boxData.startLedId = _table.item[n].startLedId;
+            _boxData.endLedId = _table.item[n].endLedId;
+            _table.item[n].state = BULK_BOX_DONE;
         }
+        xQueueSend(g_ledStripBoxDataQueueHandler, &_boxData, 0);
     }
-    cJSON_AddItemToObject(data, "order_list", orderList);
-    cJSON_AddItemToObject(msgBuff, "data", data);
-    char *jsonStr = NULL;
-    jsonStr = cJSON_PrintUnformatted(msgBuff);
-    _mqttPubData.dataLen = strlen(jsonStr);
-    strcpy(_mqttPubData.data, jsonStr);
-    xQueueSend(g_mqttPubDataQueueHandler, &_mqttPubData, pdMS_TO_TICKS(100));
-    cJSON_free(jsonStr);
-    cJSON_Delete(msgBuff);
+    ESP_LOGW(TAG, "Bulk place %d orders %d boxes (%d new). [%d] orders executing", _orderNum, _table.count, _newBoxNum, s_executingOrderCount);
+    free(_table.item);
+    alarmLedSync();
+    xSemaphoreGive(g_ledStripBoxDataSemphHandle); // 库位数据变化,释放信号量处理亮灯
     return ESP_OK;
 }
 
 /**
- * @brief  取货完成
- * @param  data
+ * @brief  批量取货完成: 先确认每一项的订单与库位都存在,任一项不存在整条命令不生效;
+ *         校验通过后一次遍历库位队列扣减全部取物次数,最后统一刷新灯带
+ * @param  data {"pickup_list":[["订单","库位",取物次数],..]}
  * @return esp_err_t
  */
-esp_err_t ledStripPickupCompleted(cJSON *data)
+esp_err_t ledStripPickupCompletedBulk(cJSON *data)
 {
-    cJSON *_orderJson = getJSONobj(data, "order");
-    cJSON *_boxJson = getJSONobj(data, "box");
-    cJSON *_times = getJSONobj(data, "times");
-    if (_boxJson == NULL || _orderJson == NULL || _times == NULL)
+    cJSON *_pickupListJson = getJSONobj(data, "pickup_list");
+    if (_pickupListJson == NULL)
     {
         return ESP_FAIL;
     }
-    strcpy(_orderName, cJSON_GetStringValue(_orderJson));
-    uint16_t _orderNoForSerch = 0; // 用来搜索的订单顺序
-    bool _orderEffective = false;  // 当前订单有效
-    for (size_t i = 0; i < LED_STRIP_INDICATION_MAX_ORDERS; i++)
+    int _itemNum = cJSON_GetArraySize(_pickupListJson);
+    if (_itemNum <= 0 || _itemNum > LED_STRIP_INDICATION_OWNER_POOL_SIZE)
+    {
+        ESP_LOGE(TAG, "Bulk pickup_list size = %d out of range", _itemNum);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    BulkBoxTable_t _table;
+    esp_err_t err = bulkBoxTableCreate(&_table, _itemNum);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    cJSON *_pickupItemJson = NULL;
+    cJSON_ArrayForEach(_pickupItemJson, _pickupListJson)
     {
-        if (strcmp(_orderName, s_orderState[i].orderName) == 0)
+        BulkBoxItem_t *_item = &_table.item[_table.count];
+        const char *_order = bulkStringGet(cJSON_GetArrayItem(_pickupItemJson, 0), LED_STRIP_INDICATION_ORDER_STR_MAXSIZE);
+        OrderState_t *_orderState = _order != NULL ? orderStateFind(_order) : NULL;
+        _item->storageLocation = bulkStringGet(cJSON_GetArrayItem(_pickupItemJson, 1), LED_STRIP_INDICATION_STORAGE_LOCATION_STR_MAXSIZE);
+        _item->takeTimes = cJSON_GetNumberValue(cJSON_GetArrayItem(_pickupItemJson, 2));
+        _item->state = BULK_BOX_NEW;
+        if (_order == NULL || _item->storageLocation == NULL || cJSON_GetArraySize(_pickupItemJson) != LED_STRIP_PICKUP_LIST_ITEM_SIZE || !bulkNumbersCheck(_pickupItemJson, 2, LED_STRIP_PICKUP_LIST_ITEM_SIZE))
         {
-            _orderNoForSerch = s_orderState[i].orderNo;
-            _orderEffective = true;
+            ESP_LOGE(TAG, "Bulk pickup_list[%d] information error", _table.count);
+            free(_table.item);
+            return ESP_ERR_INVALID_ARG;
+        }
+        if (_orderState == NULL) // 订单全部完成,或该订单无效
+        {
+            ESP_LOGE(TAG, "Order [%s] have been completed", _order);
+            free(_table.item);
+            return ESP_ERR_NOT_FOUND;
         }
+        _item->orderNo = _orderState->orderNo;
+        _item->orderIndex = _orderState - s_orderState;
+        _table.count++;
     }
+    bulkBoxTableIndex(&_table);
 
-    char _storageLocation[LED_STRIP_INDICATION_STORAGE_LOCATION_STR_MAXSIZE] = {0};
-    strcpy(_storageLocation, cJSON_GetStringValue(_boxJson));
-    uint16_t deductTakeTimes = cJSON_GetNumberValue(_times); // 本次扣除的取物次数
+    // 第一次遍历库位队列: 确认每一项的库位中有该订单
     UBaseType_t _queueLen = uxQueueMessagesWaiting(g_ledStripBoxDataQueueHandler);
-    if (_queueLen == 0 || !_orderEffective) // 订单全部完成,或该订单无效
+    BoxData_t _searchBoxData;
+    for (size_t j = 0; j < _queueLen; j++)
     {
-        ESP_LOGE(TAG, "Order [%s] Order No = [%d] have been completed", _orderName, _orderNoForSerch);
-        return ESP_FAIL;
+        if (xQueueReceive(g_ledStripBoxDataQueueHandler, &_searchBoxData, 0) != pdPASS)
+        {
+            continue;
+        }
+        for (int16_t i = bulkBoxTableNext(&_table, _searchBoxData.storageLocation, -1); i >= 0; i = bulkBoxTableNext(&_table, _searchBoxData.storageLocation, i))
+        {
+            if (boxOwnerFind(&_searchBoxData, _table.item[i].orderNo) != NULL)
+            {
+                _table.item[i].state = BULK_BOX_EXISTING;
+            }
+        }
+        xQueueSendToBack(g_ledStripBoxDataQueueHandler, &_searchBoxData, 0);
     }
-    BoxData_t _searchBoxData = {0};        // 查找的目标数据
-    for (size_t i = 0; i < _queueLen; i++) // 遍历链表查找已有元素
+    for (int16_t i = 0; i < _table.count; i++)
     {
-        // 从队列中接收元素
-        if (xQueueReceive(g_ledStripBoxDataQueueHandler, &_searchBoxData, 0) == pdPASS)
+        if (_table.item[i].state != BULK_BOX_EXISTING)
+        {
+            ESP_LOGE(TAG, "Box [%s],Not have order [%s] No. = [%d] exists", _table.item[i].storageLocation,
+                     s_orderState[_table.item[i].orderIndex].orderName, _table.item[i].orderNo);
+            free(_table.item);
+            return ESP_ERR_NOT_FOUND;
+        }
+    }
+
+    // 第二次遍历库位队列: 扣减取物次数,取货完成的订单熄灭
+    bool _isLedChanged = false;     // 有订单熄灭
+    bool _isOrderCompleted = false; // 有订单全部取货完成
+    bool _isBoxOrderChanged = false; // 有等待中的订单分配到灯珠
+    for (size_t j = 0; j < _queueLen; j++)
+    {
+        if (xQueueReceive(g_ledStripBoxDataQueueHandler, &_searchBoxData, 0) != pdPASS)
+        {
+            continue;
+        }
+        for (int16_t i = bulkBoxTableNext(&_table, _searchBoxData.storageLocation, -1); i >= 0; i = bulkBoxTableNext(&_table, _searchBoxData.storageLocation, i))
         {
-            // ESP_LOGI(TAG, "_searchBoxData.storageLocation = %s", _searchBoxData.storageLocation);
-            if (strcmp(_storageLocation, _searchBoxData.storageLocation) == 0) // 找到相等的库位
+            BulkBoxItem_t *_item = &_table.item[i];
+            OrderBoxInfo_t *_owner = boxOwnerFind(&_searchBoxData, _item->orderNo);
+            if (_owner == NULL) // 同一库位重复取货,前面的条目已经熄灭
             {
-                // ESP_LOGI(TAG, "Matching storage location found");
-                for (size_t j = 0; j < LED_STRIP_INDICATION_MAX_ORDERS; j++) // 查找该库位的订单，相同则更新取货次数数据
-                {
-                    if (_searchBoxData.orderBoxInfo[j].orderNo == _orderNoForSerch)
-                    {
-                        if (_searchBoxData.orderBoxInfo[j].takeTimes > deductTakeTimes) // 该订单还有剩余取货次数，扣减取货寿命
-                        {
-                            _searchBoxData.orderBoxInfo[j].takeTimes -= deductTakeTimes;
-                            ESP_LOGI(TAG, "Order [%s] Box [%s] changed.take times deduct [%d] residue [%d]", _orderName, _storageLocation, deductTakeTimes, _searchBoxData.orderBoxInfo[j].takeTimes);
-                            xQueueSend(g_ledStripBoxDataQueueHandler, &_searchBoxData, 0);
-                            return ESP_OK;
-                            break;
-                        }
-                        else // 订单的该库位取货完成,执行灭灯,订单数据归零
-                        {
-                            ESP_LOGI(TAG, "Order [%s] Box [%s] kill", _orderName, _storageLocation);
-                            for (size_t k = _searchBoxData.orderBoxInfo[j].ownerStartLedId; k <= _searchBoxData.orderBoxInfo[j].ownerEndLedId; k++)
-                            {
-                                led_strip_set_pixel(g_ledstripRmtHandle, k - 1, 0, 0, 0);
-                            }
-                            LEDSTRIP_REFRESH;
-                            for (size_t k = 0; k < LED_STRIP_INDICATION_MAX_ORDERS; k++) // 订单残留指示减1个库位
-                            {
-                                if (s_orderState[k].orderNo == _searchBoxData.orderBoxInfo[j].orderNo && s_orderState[k].residueBoxCount >= 1)
-                                {
-                                    s_orderState[k].residueBoxCount--;
-                                    if (s_orderState[k].residueBoxCount == 0) // 订单的所有库位取货完毕了,订单已经完成，订单数据归零
-                                    {
-                                        memset(&s_orderState[k], 0, sizeof(OrderState_t));
-                                        s_executingOrderCount--;
-                                        ESP_LOGW(TAG, "Order [%s] completed. [%d] orders remaining", _orderName, s_executingOrderCount);
-                                        alarmLedSync();
-                                    }
-                                }
-                            }
-                            memset(&_searchBoxData.orderBoxInfo[j], 0, sizeof(OrderBoxInfo_t)); // 该库位清空订单占用数据
-                            bool isAllOrderDone = true;                                         // 所有订单取货完成
-                            for (size_t k = 0; k < LED_STRIP_INDICATION_MAX_ORDERS; k++)
-                            {
-                                if (_searchBoxData.orderBoxInfo[k].orderNo != 0)
-                                {
-                                    isAllOrderDone = false;
-                                }
-                            }
-                            if (isAllOrderDone) // 该库位的订单已经全部取货完成,数据不放回队列
-                            {
-                                return ESP_OK;
-                                break;
-                            }
-                            else // 还有其他订单未完成,数据放回队列
-                            {
-                                xQueueSend(g_ledStripBoxDataQueueHandler, &_searchBoxData, 0);
-                                return ESP_OK;
-                                break;
-                            }
-                        }
-                    }
-                }
-                // 库位匹配但找不到目标订单,库位放回队列尾部
-                ESP_LOGE(TAG, "Box [%s],Not have order [%s] No. = [%d] exists", _storageLocation, _orderName, _orderNoForSerch);
-                xQueueSendToBack(g_ledStripBoxDataQueueHandler, &_searchBoxData, 0);
-                return ESP_ERR_NOT_FOUND;
+                continue;
             }
-            else
+            if (_owner->takeTimes > _item->takeTimes) // 该订单还有剩余取货次数，扣减取货寿命
             {
-                // 库位不符合条件，放回队列尾部 继续查找
-                xQueueSendToBack(g_ledStripBoxDataQueueHandler, &_searchBoxData, 0);
+                _owner->takeTimes -= _item->takeTimes;
+                continue;
+            }
+            boxOwnerRemove(&_searchBoxData, _item->orderNo);
+            _isLedChanged = true;
+            OrderState_t *_orderState = &s_orderState[_item->orderIndex];
+            if (_orderState->residueBoxCount >= 1 && --_orderState->residueBoxCount == 0) // 订单的所有库位取货完毕了,订单数据归零
+            {
+                TRACE_EMIT(TRACE_EVENT_ORDER_STATE, TRACE_ORDER_COMPLETED, _item->orderNo);
+                ESP_LOGW(TAG, "Order [%s] completed. [%d] orders remaining", _orderState->orderName, s_executingOrderCount - 1);
+                orderStateRemove(_orderState);
+                _isOrderCompleted = true;
             }
         }
+        if (_searchBoxData.ownerCount != 0) // 还有其他订单未完成,数据放回队列
+        {
+            _isBoxOrderChanged |= _searchBoxData.isBoxOrderChanged;
+            xQueueSendToBack(g_ledStripBoxDataQueueHandler, &_searchBoxData, 0);
+        }
     }
-    // 队列中没有该库位
-    ESP_LOGE(TAG, "Box [%s],Not in queue", _storageLocation);
-    return ESP_ERR_NOT_FOUND;
+    ESP_LOGI(TAG, "Bulk pickup %d items", _table.count);
+    free(_table.item);
+    if (_isLedChanged)
+    {
+        LEDSTRIP_REFRESH;
+    }
+    if (_isOrderCompleted)
+    {
+        alarmLedSync();
+    }
+    if (_isBoxOrderChanged)
+    {
+        xSemaphoreGive(g_ledStripBoxDataSemphHandle);
+    }
+    return ESP_OK;
 }
 
 /**
- * @brief  结束取货指示
- * @param  data
+ * @brief  批量结束取货指示: 订单都在执行中才生效,一次遍历库位队列清除全部订单的占用,最后统一刷新灯带
+ * @param  data {"order_list":["订单",..]}
  * @return esp_err_t
  */
-esp_err_t ledStripEndPickupInstruction(cJSON *data)
+esp_err_t ledStripEndPickupInstructionBulk(cJSON *data)
 {
-    cJSON *_orderJson = getJSONobj(data, "order");
-    if (_orderJson == NULL)
+    cJSON *_orderListJson = getJSONobj(data, "order_list");
+    if (_orderListJson == NULL)
     {
         return ESP_FAIL;
     }
-    strcpy(_orderName, cJSON_GetStringValue(_orderJson));
-    uint16_t _orderNoForSerch = 0;
-    bool _orderEffective = false; // 当前订单有效
-    for (size_t i = 0; i < LED_STRIP_INDICATION_MAX_ORDERS; i++)
+    if (cJSON_GetArraySize(_orderListJson) <= 0)
+    {
+        ESP_LOGE(TAG, "Bulk order_list is empty");
+        return ESP_ERR_INVALID_ARG;
+    }
+    bool _isOrderEnd[LED_STRIP_INDICATION_MAX_ORDERS] = {0}; // 按订单表位置标记要结束的订单
+    cJSON *_orderJson = NULL;
+    cJSON_ArrayForEach(_orderJson, _orderListJson)
     {
-        if (strcmp(_orderName, s_orderState[i].orderName) == 0)
+        const char *_order = bulkStringGet(_orderJson, LED_STRIP_INDICATION_ORDER_STR_MAXSIZE);
+        OrderState_t *_orderState = _order != NULL ? orderStateFind(_order) : NULL;
+        if (_orderState == NULL)
         {
-            _orderNoForSerch = s_orderState[i].orderNo;
-            _orderEffective = true;
+            ESP_LOGE(TAG, "Order [%s] has been completed", _order != NULL ? _order : "");
+            return ESP_ERR_NOT_FOUND;
         }
+        _isOrderEnd[_orderState - s_orderState] = true;
     }
     UBaseType_t _queueLen = uxQueueMessagesWaiting(g_ledStripBoxDataQueueHandler);
-    if (_queueLen == 0 || !_orderEffective) // 订单全部完成,或该订单无效
-    {
-        ESP_LOGE(TAG, "Order [%s] has been completed", _orderName);
-        return ESP_FAIL;
-    }
-    BoxData_t _searchBoxData = {0};        // 查找的目标数据
-    for (size_t i = 0; i < _queueLen; i++) // 遍历链表查找已有元素,熄灭灯带
+    bool _isBoxOrderChanged = false; // 有等待中的订单分配到灯珠
+    BoxData_t _searchBoxData;
+    for (size_t j = 0; j < _queueLen; j++) // 遍历链表,清除订单的库位灯带占用信息
     {
-        // 从队列中接收元素,清除相等订单的库位灯带占用信息
-        if (xQueueReceive(g_ledStripBoxDataQueueHandler, &_searchBoxData, 0) == pdPASS)
+        if (xQueueReceive(g_ledStripBoxDataQueueHandler, &_searchBoxData, 0) != pdPASS)
         {
-            for (size_t j = 0; j < LED_STRIP_INDICATION_MAX_ORDERS; j++)
-            {
-                if (_orderNoForSerch == _searchBoxData.orderBoxInfo[j].orderNo) // 找到相等的订单
-                {
-                    for (size_t k = _searchBoxData.orderBoxInfo[j].ownerStartLedId; k <= _searchBoxData.orderBoxInfo[j].ownerEndLedId; k++)
-                    {
-                        led_strip_set_pixel(g_ledstripRmtHandle, k - 1, 0, 0, 0);
-                    }
-                    LEDSTRIP_REFRESH;
-                    memset(&_searchBoxData.orderBoxInfo[j], 0, sizeof(OrderBoxInfo_t)); // 清空该库位
-                }
-            }
-            bool isAllOrderDone = true;
-            for (size_t j = 0; j < LED_STRIP_INDICATION_MAX_ORDERS; j++)
-            {
-                if (_searchBoxData.orderBoxInfo[j].orderNo != 0)
-                {
-                    isAllOrderDone = false;
-                }
-            }
-            if (isAllOrderDone) // 所有订单已经取货完成,该库位数据不放回队列
-            {
-            }
-            else
-            {
-                xQueueSendToBack(g_ledStripBoxDataQueueHandler, &_searchBoxData, 0);
-            }
+            continue;
         }
-        // 清除三色灯状态
-        for (size_t j = 0; j < LED_STRIP_INDICATION_MAX_ORDERS; j++)
+        for (uint16_t i = _searchBoxData.ownerHead; i != LED_STRIP_OWNER_NONE;)
         {
-            if (_orderNoForSerch == s_orderState[j].orderNo) // 找到相等的订单
+            uint16_t _next = g_ledStripOwnerPool[i].next;
+            if (_isOrderEnd[g_ledStripOwnerPool[i].orderSlot])
             {
-                memset(&s_orderState[j], 0, sizeof(OrderState_t));
-                s_executingOrderCount--;
-                ESP_LOGW(TAG, "Order [%s] kill. [%d] orders remaining", _orderName, s_executingOrderCount);
-                alarmLedSync();
+                boxOwnerRemove(&_searchBoxData, g_ledStripOwnerPool[i].orderNo);
             }
+            i = _next;
+        }
+        if (_searchBoxData.ownerCount != 0) // 所有订单已经取货完成的库位数据不放回队列
+        {
+            _isBoxOrderChanged |= _searchBoxData.isBoxOrderChanged;
+            xQueueSendToBack(g_ledStripBoxDataQueueHandler, &_searchBoxData, 0);
+        }
+    }
+    LEDSTRIP_REFRESH;
+    for (size_t k = 0; k < LED_STRIP_INDICATION_MAX_ORDERS; k++)
+    {
+        if (_isOrderEnd[k])
+        {
+            TRACE_EMIT(TRACE_EVENT_ORDER_STATE, TRACE_ORDER_KILLED, s_orderState[k].orderNo);
+            ESP_LOGW(TAG, "Order [%s] kill. [%d] orders remaining", s_orderState[k].orderName, s_executingOrderCount - 1);
+            orderStateRemove(&s_orderState[k]);
         }
     }
+    alarmLedSync();
+    if (_isBoxOrderChanged)
+    {
+        xSemaphoreGive(g_ledStripBoxDataSemphHandle);
+    }
     return ESP_OK;
 }
 
@@ -590,18 +1263,10 @@ esp_err_t ledStripEndPickupInstruction(cJSON *data)
  */
 esp_err_t ledStripEndAllOrder()
 {
-    UBaseType_t _queueLen = uxQueueMessagesWaiting(g_ledStripBoxDataQueueHandler);
-    if (_queueLen != 0)
+    if (ledStripOrderClear())
     {
-        xQueueReset(g_ledStripBoxDataQueueHandler);
-        s_executingOrderCount = 0;
-        for (size_t i = 0; i < LED_STRIP_INDICATION_MAX_ORDERS; i++)
-        {
-            memset(&s_orderState[i], 0, sizeof(OrderState_t));
-        }
         LEDSTRIP_CLEAR;
         LEDSTRIP_REFRESH;
-        alarmLedSync();
         ESP_LOGW(TAG, "ledStripEndAllOrder debug. All Order kill.");
     }
     return ESP_OK;
@@ -622,16 +1287,8 @@ esp_err_t ledStripLocate(cJSON *data)
     }
     uint16_t _startLed = cJSON_GetNumberValue(_startLedJson);
     uint16_t _endLed = cJSON_GetNumberValue(_endLedJson);
-    UBaseType_t _queueLen = uxQueueMessagesWaiting(g_ledStripBoxDataQueueHandler);
-    if (_queueLen != 0)
+    if (ledStripOrderClear())
     {
-        xQueueReset(g_ledStripBoxDataQueueHandler);
-        s_executingOrderCount = 0;
-        for (size_t i = 0; i < LED_STRIP_INDICATION_MAX_ORDERS; i++)
-        {
-            memset(&s_orderState[i], 0, sizeof(OrderState_t));
-        }
-        alarmLedSync();
         ESP_LOGW(TAG, "ledBoxLocationCheck debug. All Order kill.");
     }
     LEDSTRIP_CLEAR;
@@ -640,15 +1297,38 @@ esp_err_t ledStripLocate(cJSON *data)
         led_strip_set_pixel(g_ledstripRmtHandle, i - 1, s_btightness, s_btightness, s_btightness);
     }
     LEDSTRIP_REFRESH;
+    xSemaphoreGive(g_ledStripOrderMutexHandle); // 等待期间不占用订单锁(由mqttSetBusinessHandle持有)
     vTaskDelay(pdMS_TO_TICKS(LED_STRIP_INDICATION_LED_LOCATE_TIMEOUT));
+    xSemaphoreTake(g_ledStripOrderMutexHandle, portMAX_DELAY);
     LEDSTRIP_CLEAR;
     queryResiduesOrder();                    // 向影子系统请求当前残留订单
     xQueueReset(g_mqttRecvDataQueueHandler); // 清除等待期间的业务命令
     return ESP_OK;
 }
 
+/**
+ * @brief  灯珠顺序跑马结束(完成或被新命令停止), 恢复影子系统中的残留订单
+ *         完成时在效果任务中执行; 被停止或替换时在执行命令的任务中执行, 该任务已持有订单锁
+ * @param  completed
+ */
+static void ledSequenceEnd(bool completed)
+{
+    ESP_LOGI(TAG, "ledSequence %s", completed ? "completed" : "stopped");
+    bool _lock = xSemaphoreGetMutexHolder(g_ledStripOrderMutexHandle) != xTaskGetCurrentTaskHandle();
+    if (_lock)
+    {
+        xSemaphoreTake(g_ledStripOrderMutexHandle, portMAX_DELAY);
+    }
+    queryResiduesOrder(); // 向影子系统请求当前残留订单
+    if (_lock)
+    {
+        xSemaphoreGive(g_ledStripOrderMutexHandle);
+    }
+}
+
 /**
  * @brief  灯珠顺序跑马
+ *         由效果任务按时间渲染, 立即返回; 跑马期间收到的命令会停止跑马后正常执行
  * @param  data
  * @return esp_err_t
  */
@@ -657,38 +1337,36 @@ esp_err_t ledSequence(cJSON *data)
     cJSON *_startLedJson = getJSONobj(data, "start_led");
     cJSON *_endLedJson = getJSONobj(data, "end_led");
     cJSON *_colorJson = getJSONobj(data, "color");
+    cJSON *_ledsPerSecJson = getJSONobj(data, "leds_per_sec");
     if (_startLedJson == NULL || _endLedJson == NULL)
     {
         return ESP_FAIL;
     }
-    uint16_t _startLed = cJSON_GetNumberValue(_startLedJson);
-    uint16_t _endLed = cJSON_GetNumberValue(_endLedJson);
     uint32_t _color = cJSON_GetNumberValue(_colorJson);
-    uint8_t _red = ((_color >> 16) & 0XFF) / 20;
-    uint8_t _green = ((_color >> 8) & 0XFF) / 20;
-    uint8_t _blue = (_color & 0XFF) / 20;
-    UBaseType_t _queueLen = uxQueueMessagesWaiting(g_ledStripBoxDataQueueHandler);
-    if (_queueLen != 0)
+    led_strip_effect_params_t _params = {
+        .effect_type = LED_EFFECT_SEQUENCE,
+        .start_led = cJSON_GetNumberValue(_startLedJson),
+        .end_led = cJSON_GetNumberValue(_endLedJson),
+        .brightness = 255, // 颜色已按调试亮度换算
+        .color1 = (LEDSTRIP_COLOR_RED(_color) / 20) << 16 | (LEDSTRIP_COLOR_GREEN(_color) / 20) << 8 | LEDSTRIP_COLOR_BLUE(_color) / 20,
+        .leds_per_sec = LED_SEQUENCE_DEFAULT_LEDS_PER_SEC,
+        .end_cb = ledSequenceEnd,
+    };
+    if (_ledsPerSecJson != NULL && cJSON_GetNumberValue(_ledsPerSecJson) > 0)
     {
-        xQueueReset(g_ledStripBoxDataQueueHandler);
-        s_executingOrderCount = 0;
-        for (size_t i = 0; i < LED_STRIP_INDICATION_MAX_ORDERS; i++)
-        {
-            memset(&s_orderState[i], 0, sizeof(OrderState_t));
-        }
-        alarmLedSync();
-        ESP_LOGW(TAG, "ledSequence debug. All Order kill.");
+        _params.leds_per_sec = cJSON_GetNumberValue(_ledsPerSecJson);
     }
-    LEDSTRIP_CLEAR;
-    for (size_t i = _startLed; i <= _endLed; i++)
+    esp_err_t err = led_strip_effect_check(&_params); // 范围无效时保留订单
+    if (err != ESP_OK)
     {
-        led_strip_set_pixel(g_ledstripRmtHandle, i - 1, _red, _green, _blue);
-        LEDSTRIP_REFRESH;
+        return err;
+    }
+    if (ledStripOrderClear())
+    {
+        ESP_LOGW(TAG, "ledSequence debug. All Order kill.");
     }
     LEDSTRIP_CLEAR;
-    queryResiduesOrder();                    // 向影子系统请求当前残留订单
-    xQueueReset(g_mqttRecvDataQueueHandler); // 清除等待期间的业务命令
-    return ESP_OK;
+    return led_strip_effect_run(&_params);
 }
 
 /**
@@ -715,16 +1393,8 @@ esp_err_t ledBoxLocationCheck(cJSON *data)
         ESP_LOGE(TAG, "BOX_LOCATION_CHECK location information error");
         return ESP_ERR_INVALID_ARG;
     }
-    UBaseType_t _queueLen = uxQueueMessagesWaiting(g_ledStripBoxDataQueueHandler);
-    if (_queueLen != 0)
+    if (ledStripOrderClear())
     {
-        xQueueReset(g_ledStripBoxDataQueueHandler);
-        s_executingOrderCount = 0;
-        for (size_t i = 0; i < LED_STRIP_INDICATION_MAX_ORDERS; i++)
-        {
-            memset(&s_orderState[i], 0, sizeof(OrderState_t));
-        }
-        alarmLedSync();
         ESP_LOGW(TAG, "ledBoxLocationCheck debug. All Order kill.");
     }
 
@@ -741,7 +1411,9 @@ esp_err_t ledBoxLocationCheck(cJSON *data)
         }
     }
     LEDSTRIP_REFRESH;
+    xSemaphoreGive(g_ledStripOrderMutexHandle); // 等待期间不占用订单锁(由mqttSetBusinessHandle持有)
     vTaskDelay(pdMS_TO_TICKS(LED_STRIP_BOX_LOCATION_CHECK_TIMEOUT));
+    xSemaphoreTake(g_ledStripOrderMutexHandle, portMAX_DELAY);
     LEDSTRIP_CLEAR;
     queryResiduesOrder();                    // 向影子系统请求当前残留订单
     xQueueReset(g_mqttRecvDataQueueHandler); // 清除等待期间的业务命令
@@ -755,47 +1427,51 @@ esp_err_t ledBoxLocationCheck(cJSON *data)
  */
 esp_err_t ledStripKillAllOrder()
 {
-    UBaseType_t _queueLen = uxQueueMessagesWaiting(g_ledStripBoxDataQueueHandler);
-    if (_queueLen != 0)
-    {
-        xQueueReset(g_ledStripBoxDataQueueHandler);
-        s_executingOrderCount = 0;
-        for (size_t i = 0; i < LED_STRIP_INDICATION_MAX_ORDERS; i++)
-        {
-            memset(&s_orderState[i], 0, sizeof(OrderState_t));
-        }
-        alarmLedSync();
-    }
+    xSemaphoreTake(g_ledStripOrderMutexHandle, portMAX_DELAY);
+    ledStripOrderClear();
     LEDSTRIP_CLEAR;
+    xSemaphoreGive(g_ledStripOrderMutexHandle);
     return ESP_OK;
 }
 
 /**
- * @brief   MQTT操作业务指令处理函数
+ * @brief  执行绘制灯带的命令前停止灯效
+ *         效果任务超时未清空灯带时不执行命令, 避免效果的最后一帧覆盖命令的绘制
+ * @return esp_err_t
+ */
+static esp_err_t ledStripEffectStop()
+{
+    esp_err_t err = led_strip_effect_stop();
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to stop LED effect [%s], command not executed", esp_err_to_name(err));
+    }
+    return err;
+}
+
+/**
+ * @brief  业务指令分发
  * @param  mqttContorType
  * @param  mqttCmdType
  * @param  data
  * @return esp_err_t
  */
-esp_err_t mqttSetBusinessHandle(uint16_t mqttContorType, uint16_t mqttCmdType, cJSON *data)
+static esp_err_t mqttBusinessCmdHandle(uint16_t mqttContorType, uint16_t mqttCmdType, cJSON *data)
 {
-    static bool initialized = false;
-    if (!initialized)
-    {
-        s_allowOrderOverwriteLocation = g_nvsData.projectConfigData.ledStripIndicationConfigData.allowOrderOverwriteLocation;
-        s_ledstripEnabled = g_nvsData.DeviceConfigData.ledstripConfigData.ledstripEnabled;
-        s_btightness = g_nvsData.DeviceConfigData.ledstripConfigData.btightness;
-        s_initLednum = g_nvsData.DeviceConfigData.ledstripConfigData.ledNum;
-        initialized = true;
-    }
+    esp_err_t err = ESP_OK;
     switch (mqttContorType)
     {
     // --------------------------------------------------- 订单相关 --------------------------------------------------------------------
     case MQTT_CONTROL_TYPE_BUSINESS_ORDER_MANAGE:
         if ((mqttCmdType == PLACE_NEW_ORDER || mqttCmdType == PLACE_NEW_ORDER_BY_NODE_RED) && s_ledstripEnabled)
         {
-            ESP_ERROR_CHECK(led_strip_effect_stop());
-            return ledStripPlaceNewOrder(data); // 下发新订单
+            err = ledStripEffectStop();
+            return err == ESP_OK ? ledStripPlaceNewOrder(data) : err; // 下发新订单
+        }
+        else if (mqttCmdType == PLACE_NEW_ORDER_BULK && s_ledstripEnabled)
+        {
+            err = ledStripEffectStop();
+            return err == ESP_OK ? ledStripPlaceNewOrderBulk(data) : err; // 批量下发订单
         }
         else if (mqttCmdType == QUERY_RESIDUES_ORDER)
         {
@@ -812,8 +1488,13 @@ esp_err_t mqttSetBusinessHandle(uint16_t mqttContorType, uint16_t mqttCmdType, c
     case MQTT_CONTROL_TYPE_BUSINESS_PICKUP_COMPLETED:
         if (mqttCmdType == PICKUP_COMPLETED && s_ledstripEnabled)
         {
-            ESP_ERROR_CHECK(led_strip_effect_stop());
-            return ledStripPickupCompleted(data);
+            err = ledStripEffectStop();
+            return err == ESP_OK ? ledStripPickupCompleted(data) : err;
+        }
+        else if (mqttCmdType == PICKUP_COMPLETED_BULK && s_ledstripEnabled)
+        {
+            err = ledStripEffectStop();
+            return err == ESP_OK ? ledStripPickupCompletedBulk(data) : err;
         }
         else
         {
@@ -826,13 +1507,18 @@ esp_err_t mqttSetBusinessHandle(uint16_t mqttContorType, uint16_t mqttCmdType, c
     case MQTT_CONTROL_TYPE_BUSINESS_END_PICKUP_INSTRUCTION:
         if ((mqttCmdType == END_PICKUP_INSTRUCTION || mqttCmdType == END_PICKUP_INSTRUCTION_BY_NODE_RED) && s_ledstripEnabled)
         {
-            ESP_ERROR_CHECK(led_strip_effect_stop());
-            return ledStripEndPickupInstruction(data);
+            err = ledStripEffectStop();
+            return err == ESP_OK ? ledStripEndPickupInstruction(data) : err;
+        }
+        if (mqttCmdType == END_PICKUP_INSTRUCTION_BULK && s_ledstripEnabled)
+        {
+            err = ledStripEffectStop();
+            return err == ESP_OK ? ledStripEndPickupInstructionBulk(data) : err;
         }
         if (mqttCmdType == END_ALL_ORDER_BY_DOJO_DEMO_PURPOSE && s_ledstripEnabled) // 结束所有订单
         {
-            ESP_ERROR_CHECK(led_strip_effect_stop());
-            return ledStripEndAllOrder();
+            err = ledStripEffectStop();
+            return err == ESP_OK ? ledStripEndAllOrder() : err;
         }
         else
         {
@@ -844,18 +1530,32 @@ esp_err_t mqttSetBusinessHandle(uint16_t mqttContorType, uint16_t mqttCmdType, c
     case MQTT_CONTROL_TYPE_BUSINESS_LEDSTRIP_DEBUG:
         if (mqttCmdType == LED_LOCATE && s_ledstripEnabled) // 灯珠定位
         {
-            ESP_ERROR_CHECK(led_strip_effect_stop());
-            return ledStripLocate(data);
+            err = ledStripEffectStop();
+            return err == ESP_OK ? ledStripLocate(data) : err;
         }
         else if (mqttCmdType == LED_SEQUENCE && s_ledstripEnabled) // 灯珠顺序跑马
         {
-            ESP_ERROR_CHECK(led_strip_effect_stop());
-            return ledSequence(data);
+            err = ledStripEffectStop();
+            return err == ESP_OK ? ledSequence(data) : err;
         }
         else if (mqttCmdType == LED_BOX_LOCATION_CHECK && s_ledstripEnabled) // 亮灯库位确认
         {
-            ESP_ERROR_CHECK(led_strip_effect_stop());
-            return ledBoxLocationCheck(data);
+            err = ledStripEffectStop();
+            return err == ESP_OK ? ledBoxLocationCheck(data) : err;
+        }
+        else
+        {
+            ESP_LOGE(TAG, "mqttCmdType = [%d], Command not supported", mqttCmdType);
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+        break;
+
+    // ---------------------------------------------------性能测试--------------------------------------------------------------------
+    case MQTT_CONTROL_TYPE_BUSINESS_BENCHMARK:
+        if (mqttCmdType == PICK_WAVE_BENCHMARK && s_ledstripEnabled) // 拣货波次性能测试
+        {
+            err = ledStripEffectStop();
+            return err == ESP_OK ? pickWaveBenchmarkRun(data) : err;
         }
         else
         {
@@ -867,8 +1567,8 @@ esp_err_t mqttSetBusinessHandle(uint16_t mqttContorType, uint16_t mqttCmdType, c
     case MQTT_CONTROL_TYPE_BUSINESS_LEDSTRIP_OPERATE:
         if (mqttCmdType == LED_SEQUENCE_RUN)
         {
-            ESP_ERROR_CHECK(led_strip_effect_stop());
-            return ledSequenceWithColorAndBrigh(data);
+            err = ledStripEffectStop();
+            return err == ESP_OK ? ledSequenceWithColorAndBrigh(data) : err;
         }
         else if (mqttCmdType == LED_EFFECT_RUN)
         {
@@ -876,13 +1576,17 @@ esp_err_t mqttSetBusinessHandle(uint16_t mqttContorType, uint16_t mqttCmdType, c
         }
         else if (mqttCmdType == LED_SET_COLOR_AND_BRIGHTNESS)
         {
-            ESP_ERROR_CHECK(led_strip_effect_stop());
-            return ledLightUpWithColorAndBrigh(data);
+            err = ledStripEffectStop();
+            return err == ESP_OK ? ledLightUpWithColorAndBrigh(data) : err;
         }
         else if (mqttCmdType == LED_LIGHT_OFF)
         {
-            ESP_ERROR_CHECK(led_strip_effect_stop());
-            return ledLightOff();
+            err = ledStripEffectStop();
+            return err == ESP_OK ? ledLightOff() : err;
+        }
+        else if (mqttCmdType == LED_TIMELINE_RUN)
+        {
+            return ledTimeline(data);
         }
         else
         {
@@ -897,3 +1601,39 @@ esp_err_t mqttSetBusinessHandle(uint16_t mqttContorType, uint16_t mqttCmdType, c
     }
     return ESP_FAIL;
 }
+
+/**
+ * @brief   MQTT操作业务指令处理函数
+ *          订单与灯带调试命令持有订单互斥锁执行,与灯带指示任务互斥访问订单表与库位队列
+ *          性能测试运行期间拒绝其他来源的订单、灯带调试与灯带操作命令
+ * @param  mqttContorType
+ * @param  mqttCmdType
+ * @param  data
+ * @return esp_err_t
+ */
+esp_err_t mqttSetBusinessHandle(uint16_t mqttContorType, uint16_t mqttCmdType, cJSON *data)
+{
+    static bool initialized = false;
+    if (!initialized)
+    {
+        s_allowOrderOverwriteLocation = g_nvsData.projectConfigData.ledStripIndicationConfigData.allowOrderOverwriteLocation;
+        s_ledstripEnabled = g_nvsData.DeviceConfigData.ledstripConfigData.ledstripEnabled;
+        s_btightness = g_nvsData.DeviceConfigData.ledstripConfigData.btightness;
+        s_initLednum = g_nvsData.DeviceConfigData.ledstripConfigData.ledNum;
+        initialized = true;
+    }
+    bool _orderCmd = mqttContorType >= MQTT_CONTROL_TYPE_BUSINESS_ORDER_MANAGE && mqttContorType <= MQTT_CONTROL_TYPE_BUSINESS_LEDSTRIP_DEBUG;
+    if ((_orderCmd || mqttContorType == MQTT_CONTROL_TYPE_BUSINESS_LEDSTRIP_OPERATE) && pickWaveBenchmarkBusy()) // 性能测试在独立任务中执行订单命令并测量灯带,期间拒绝其他来源的订单与灯带命令
+    {
+        ESP_LOGE(TAG, "mqttContorType = [%d] rejected, pick wave benchmark is running", mqttContorType);
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!_orderCmd) // 性能测试通过命令入口执行订单命令,不在此加锁
+    {
+        return mqttBusinessCmdHandle(mqttContorType, mqttCmdType, data);
+    }
+    xSemaphoreTake(g_ledStripOrderMutexHandle, portMAX_DELAY);
+    esp_err_t err = mqttBusinessCmdHandle(mqttContorType, mqttCmdType, data);
+    xSemaphoreGive(g_ledStripOrderMutexHandle);
+    return err;
+}
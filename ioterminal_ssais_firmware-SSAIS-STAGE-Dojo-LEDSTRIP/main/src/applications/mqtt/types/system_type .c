@@ -8,31 +8,208 @@
  *
  */
 #include "network.h"
+#include "mbedtls/base64.h"
 
 static char *TAG = "MQTT_SYSTEM_CMD";
 
+#define TRACE_DUMP_CHUNK_SIZE 1536                                // 每行导出的原始字节数
+#define TRACE_DUMP_LINE_SIZE (TRACE_DUMP_CHUNK_SIZE / 3 * 4 + 32) // "TRACE 偏移 总长 base64"
+#define TRACE_DUMP_TOPIC_SUFFIX "/trace"                          // 跟踪主题 = 发布主题 + 后缀
+#define PUB_LANE_TEST_TASK_STACK_SIZE 4096                        // 发送通道测试任务栈大小
+#define PUB_LANE_TEST_MAX_DELAY_MS 60000                          // 收到命令到开始入队的最长延时
+#define PUB_LANE_TEST_MAX_CRITICAL 500                            // 最多入队的关键消息数(超出关键通道的部分留在Flash日志中)
+#define PUB_LANE_TEST_MAX_BEST_EFFORT 2000                        // 最多入队的尽力消息数
+
+typedef struct _TraceDumpContext
+{
+    bool toMqtt;                     // true:MQTT导出 false:串口导出
+    char topic[MQTT_TOPIC_MAX_LEN];  // MQTT导出主题
+    char line[TRACE_DUMP_LINE_SIZE]; // 导出行缓冲区
+} TraceDumpContext_t;
+
+typedef struct _PubLaneTestArgs
+{
+    uint32_t delayMs;    // 回执发送后等待外部断开连接的时间
+    uint32_t critical;   // 关键消息数
+    uint32_t bestEffort; // 尽力消息数
+} PubLaneTestArgs_t;
+
+static PubLaneTestArgs_t s_pubLaneTestArgs = {0};
+static volatile bool s_pubLaneTestRunning = false;
+
+/**
+ * @brief  将一段跟踪数据编码为 "TRACE <偏移> <总长> <base64>" 文本行并导出
+ * @param  data
+ * @param  len
+ * @param  offset
+ * @param  total
+ * @param  ctx
+ * @return esp_err_t
+ */
+static esp_err_t mqttTraceDumpLine(const uint8_t *data, size_t len, size_t offset, size_t total, void *ctx)
+{
+    TraceDumpContext_t *_ctx = (TraceDumpContext_t *)ctx;
+    int _headLen = snprintf(_ctx->line, sizeof(_ctx->line), "TRACE %u %u ", (unsigned)offset, (unsigned)total);
+    size_t _base64Len = 0;
+    if (mbedtls_base64_encode((unsigned char *)&_ctx->line[_headLen], sizeof(_ctx->line) - _headLen, &_base64Len, data, len) != 0)
+    {
+        ESP_LOGE(TAG, "Trace base64 encode failed");
+        return ESP_FAIL;
+    }
+    if (_ctx->toMqtt)
+    {
+        if (esp_mqtt_client_publish(g_mqttClientHandle, _ctx->topic, _ctx->line, _headLen + _base64Len, 0, 0) < 0)
+        {
+            ESP_LOGE(TAG, "Trace publish failed at offset %u", (unsigned)offset);
+            return ESP_FAIL;
+        }
+    }
+    else
+    {
+        printf("%s\n", _ctx->line);
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief  导出跟踪记录
+ * @param  toMqtt   true:从跟踪主题导出 false:从调试串口导出
+ * @return esp_err_t
+ */
+static esp_err_t mqttTraceDump(bool toMqtt)
+{
+    if (toMqtt && getMqttState() != MQTT_READY)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    TraceDumpContext_t *_ctx = heap_caps_calloc(1, sizeof(TraceDumpContext_t), MALLOC_CAP_SPIRAM);
+    if (_ctx == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    _ctx->toMqtt = toMqtt;
+    snprintf(_ctx->topic, sizeof(_ctx->topic), "%s%s", g_nvsData.networkConfigData.mqttConfigData.pubTopic, TRACE_DUMP_TOPIC_SUFFIX);
+    esp_err_t err = trace_dump(TRACE_DUMP_CHUNK_SIZE, mqttTraceDumpLine, _ctx);
+    free(_ctx);
+    return err;
+}
+
+/**
+ * @brief  发布一条发送通道测试消息
+ *         {"control_type":153,"notify_type":3,"data":{"lane":"critical","seq":0}}
+ * @param  critical true:关键通道 false:尽力通道
+ * @param  seq      该通道内的序号,从0开始
+ */
+static void mqttPubLaneTestSend(bool critical, uint32_t seq)
+{
+    char _msg[96];
+    json_writer_t _writer;
+    mqttPubWriterInit(&_writer, _msg, sizeof(_msg));
+    json_writer_object_begin(&_writer);
+    json_writer_key_int(&_writer, "control_type", MQTT_CONTROL_TYPE_MQTT_STATE);
+    json_writer_key_int(&_writer, "notify_type", NOTIFY_PUB_LANE_TEST);
+    json_writer_key(&_writer, "data");
+    json_writer_object_begin(&_writer);
+    json_writer_key_string(&_writer, "lane", critical ? "critical" : "best_effort");
+    json_writer_key_uint(&_writer, "seq", seq);
+    json_writer_object_end(&_writer);
+    json_writer_object_end(&_writer);
+    mqttPubWriterSend(&_writer, critical ? MQTT_PUB_FLAG_CRITICAL : 0);
+}
+
+/**
+ * @brief  发送通道测试任务: 延时后交替放入两个通道的编号消息,用于在断线期间入队后检查重连补发(tools/mqtt_fake_broker_check.py)
+ * @param  arg
+ */
+static void mqttPubLaneTestTask(void *arg)
+{
+    vTaskDelay(pdMS_TO_TICKS(s_pubLaneTestArgs.delayMs));
+    ESP_LOGI(TAG, "Publish lane test: %lu critical, %lu best effort messages, MQTT %s", s_pubLaneTestArgs.critical, s_pubLaneTestArgs.bestEffort,
+             getMqttState() == MQTT_READY ? "connected" : "disconnected");
+    for (uint32_t i = 0; i < s_pubLaneTestArgs.critical || i < s_pubLaneTestArgs.bestEffort; i++)
+    {
+        if (i < s_pubLaneTestArgs.critical)
+        {
+            mqttPubLaneTestSend(true, i);
+        }
+        if (i < s_pubLaneTestArgs.bestEffort)
+        {
+            mqttPubLaneTestSend(false, i);
+        }
+    }
+    s_pubLaneTestRunning = false;
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief  读取发送通道测试参数
+ * @param  data
+ * @param  name
+ * @param  max
+ * @param  value    输出
+ * @return bool     字段不存在、不是数字或超出[0, max]时返回false
+ */
+static bool mqttPubLaneTestArgGet(cJSON *data, const char *name, uint32_t max, uint32_t *value)
+{
+    cJSON *_json = cJSON_GetObjectItem(data, name);
+    double _value = cJSON_IsNumber(_json) ? cJSON_GetNumberValue(_json) : -1;
+    if (!(_value >= 0 && _value <= max)) // NaN也不通过
+    {
+        ESP_LOGE(TAG, "Publish lane test %s is missing or out of range [0, %lu]", name, max);
+        return false;
+    }
+    *value = (uint32_t)_value;
+    return true;
+}
+
+/**
+ * @brief  启动发送通道测试
+ * @param  data {"delay_ms":3000,"critical":100,"best_effort":300}
+ * @return esp_err_t 参数错误、已有测试在运行或者任务创建失败时返回错误
+ */
+static esp_err_t mqttPubLaneTestStart(cJSON *data)
+{
+    PubLaneTestArgs_t _args;
+    if (!mqttPubLaneTestArgGet(data, "delay_ms", PUB_LANE_TEST_MAX_DELAY_MS, &_args.delayMs) ||
+        !mqttPubLaneTestArgGet(data, "critical", PUB_LANE_TEST_MAX_CRITICAL, &_args.critical) ||
+        !mqttPubLaneTestArgGet(data, "best_effort", PUB_LANE_TEST_MAX_BEST_EFFORT, &_args.bestEffort))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_pubLaneTestRunning)
+    {
+        ESP_LOGE(TAG, "Publish lane test is already running");
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_pubLaneTestArgs = _args;
+    s_pubLaneTestRunning = true;
+    if (xTaskCreate(mqttPubLaneTestTask, "pubLaneTest", PUB_LANE_TEST_TASK_STACK_SIZE, NULL, MQTT_TASK_PRIVILEGE | portPRIVILEGE_BIT, NULL) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Create publish lane test task failed");
+        s_pubLaneTestRunning = false;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
 /**
  * @brief 报告NVS存储的OTA参数
  */
 void mqttPubOtaParameterMsg()
 {
-    MqttPublishData_t _mqttPubData;
-    cJSON *msgBuff = NULL;
-    msgBuff = cJSON_CreateObject();
-    cJSON_AddNumberToObject(msgBuff, "control_type", MQTT_CONTROL_TYPE_SYSTEM_OTA);
-    cJSON_AddNumberToObject(msgBuff, "notify_type", NOTIFY_OTA_NVS_PARAMETER);
-    cJSON *data = NULL;
-    data = cJSON_CreateObject();
-    cJSON_AddStringToObject(data, "url", g_nvsData.networkConfigData.otaConfigData.esp32OtaServer);
-    cJSON_AddStringToObject(data, "file_name", g_nvsData.networkConfigData.otaConfigData.firmwareFileName);
-    cJSON_AddItemToObject(msgBuff, "data", data);
-    char *jsonStr = NULL;
-    jsonStr = cJSON_PrintUnformatted(msgBuff);
-    _mqttPubData.dataLen = strlen(jsonStr);
-    strcpy(_mqttPubData.data, jsonStr);
-    xQueueSend(g_mqttPubDataQueueHandler, &_mqttPubData, pdMS_TO_TICKS(100));
-    cJSON_free(jsonStr);
-    cJSON_Delete(msgBuff);
+    char _msg[MQTT_STATUS_MSG_MAX_LEN + MAX_URL_BUF_LEN + MAX_FIRMWARE_FILE_NAME_LEN];
+    json_writer_t _writer;
+    mqttPubWriterInit(&_writer, _msg, sizeof(_msg));
+    json_writer_object_begin(&_writer);
+    json_writer_key_int(&_writer, "control_type", MQTT_CONTROL_TYPE_SYSTEM_OTA);
+    json_writer_key_int(&_writer, "notify_type", NOTIFY_OTA_NVS_PARAMETER);
+    json_writer_key(&_writer, "data");
+    json_writer_object_begin(&_writer);
+    json_writer_key_string(&_writer, "url", g_nvsData.networkConfigData.otaConfigData.esp32OtaServer);
+    json_writer_key_string(&_writer, "file_name", g_nvsData.networkConfigData.otaConfigData.firmwareFileName);
+    json_writer_object_end(&_writer);
+    json_writer_object_end(&_writer);
+    mqttPubWriterSend(&_writer, 0);
 }
 
 /**
@@ -99,6 +276,30 @@ esp_err_t mqttSetSystemHandle(uint16_t mqttContorType, uint16_t mqttCmdType, cJS
             return ESP_ERR_NOT_SUPPORTED;
         }
         break;
+    case MQTT_CONTROL_TYPE_MQTT_STATE:
+        if (mqttCmdType == TEST_PUB_LANES)
+        {
+            return mqttPubLaneTestStart(data);
+        }
+        else
+        {
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+        break;
+    case MQTT_CONTROL_TYPE_SYSTEM_TRACE:
+        if (mqttCmdType == DUMP_TRACE_TO_MQTT || mqttCmdType == DUMP_TRACE_TO_UART)
+        {
+            return mqttTraceDump(mqttCmdType == DUMP_TRACE_TO_MQTT);
+        }
+        else if (mqttCmdType == CLEAR_TRACE)
+        {
+            trace_clear();
+        }
+        else
+        {
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+        break;
     default:
         return ESP_ERR_NOT_SUPPORTED;
         break;
@@ -267,7 +267,7 @@ void networkTaskLoop()
     {
         if (getMqttState() == MQTT_CONNECT)
         {
-            esp_mqtt_client_subscribe(g_mqttClientHandle, g_nvsData.networkConfigData.mqttConfigData.subTopic, g_nvsData.networkConfigData.mqttConfigData.subQos);
+            mqttCmdTopicSubscribe(&g_nvsData.networkConfigData.mqttConfigData);
             switchNetTaskState(NET_TASK_MQTT_READY);
         }
         break;
@@ -308,7 +308,7 @@ void networkTaskLoop()
             {
                 if (s_lastNetTaskState >= NET_TASK_READY)
                 {
-                    esp_mqtt_client_unsubscribe(g_mqttClientHandle, g_nvsData.networkConfigData.mqttConfigData.subTopic);
+                    mqttCmdTopicUnsubscribe(&g_nvsData.networkConfigData.mqttConfigData);
                 }
                 if (s_lastNetTaskState >= NET_TASK_MQTT_CHECK)
                 {
@@ -22,9 +22,11 @@ void screenCmdRecvTask(void *pvParameters)
     bool screenInited = false;
     for (;;)
     {
+        metricsGaugeSet(METRICS_GAUGE_SCREEN_RING, queue_get_size());
         screenCmdSize = queue_find_cmd(screenCmdBuffer, SCREEN_CMD_MAX_SIZE);
         if (screenCmdSize)
         {
+            TRACE_EMIT(TRACE_EVENT_SCREEN_FRAME_IN, screenCmdSize, screenCmdBuffer[1]);
             // ESP_LOGI(TAG, "screenCmdSize =  %d", screenCmdSize);
             ESP_ERROR_CHECK_WITHOUT_ABORT(screenCmdRecvHandle((PCTRL_MSG)screenCmdBuffer, screenCmdSize));
         }
@@ -42,6 +44,11 @@ void screenCmdRecvTask(void *pvParameters)
                 screenInfoUpdate(SCREEN_SYSTEMSET_AND_INFO_PAGE);
                 vTaskDelay(pdMS_TO_TICKS(200));
             }
+            else if (g_screenState.connectState && g_screenState.screenId == SCREEN_METRICS_INFO_PAGE)
+            {
+                screenInfoUpdate(SCREEN_METRICS_INFO_PAGE);
+                vTaskDelay(pdMS_TO_TICKS(500));
+            }
             xSemaphoreGive(g_screenStateMutex);
         }
         vTaskDelay(pdMS_TO_TICKS(10));
@@ -0,0 +1,219 @@
+/**
+ * @file metrics.c
+ * @brief 运行指标统计(计数器、计量值、直方图)与遥测快照
+ * @version 1.0
+ * @date 2024-06-05
+ *
+ * @copyright Copyright (c) 2024  雅马哈发动机（厦门）信息系统有限公司
+ *
+ */
+#include "common.h"
+#include "metrics.h"
+
+MetricsRegistry_t g_metricsRegistry = {0}; // 运行指标,采样点直接写入,无锁
+static portMUX_TYPE s_metricsWindowLock = portMUX_INITIALIZER_UNLOCKED; // 切换统计窗口(遥测与屏幕都可能切换)
+
+static const char *s_counterName[METRICS_COUNTER_MAX] = {
+    [METRICS_COUNTER_MQTT_CMD_OK] = "cmd_ok",
+    [METRICS_COUNTER_MQTT_CMD_FAILED] = "cmd_err",
+    [METRICS_COUNTER_MQTT_RECV_DROPPED] = "recv_drop",
+    [METRICS_COUNTER_MQTT_PUBLISHED] = "pub",
+    [METRICS_COUNTER_LEDSTRIP_INDICATION] = "ind_pass",
+    [METRICS_COUNTER_MQTT_PUB_DROPPED] = "pub_drop",
+    [METRICS_COUNTER_MQTT_PUB_HEAP_ALLOC] = "pub_alloc",
+    [METRICS_COUNTER_MQTT_PUB_CHUNKS] = "pub_chunk",
+    [METRICS_COUNTER_MQTT_PUB_EVENTS] = "pub_evt",
+    [METRICS_COUNTER_MQTT_PUB_BYTES] = "pub_bytes",
+    [METRICS_COUNTER_MQTT_PUB_REPLAYED] = "pub_replay",
+    [METRICS_COUNTER_MQTT_JOURNAL_FLUSHES] = "jrnl_flush",
+    [METRICS_COUNTER_MQTT_JOURNAL_BACKLOG] = "jrnl_backlog",
+    [METRICS_COUNTER_MQTT_CMD_DEDUP_HIT] = "dedup_hit",
+    [METRICS_COUNTER_MQTT_CMD_DEDUP_MISS] = "dedup_miss",
+    [METRICS_COUNTER_EFFECT_TASK_CREATE] = "fx_task",
+    [METRICS_COUNTER_EFFECT_FRAME_DROP] = "fx_drop",
+};
+
+static const char *s_gaugeName[METRICS_GAUGE_MAX] = {
+    [METRICS_GAUGE_MQTT_RECV_QUEUE] = "recv_q",
+    [METRICS_GAUGE_MQTT_PUB_QUEUE] = "pub_q",
+    [METRICS_GAUGE_MQTT_PUB_CRITICAL] = "pub_crit_q",
+    [METRICS_GAUGE_BOX_DATA_QUEUE] = "box_q",
+    [METRICS_GAUGE_SCREEN_RING] = "scr_ring",
+    [METRICS_GAUGE_EFFECT_FRAME_PERIOD] = "fx_period_ms",
+};
+
+static const char *s_histogramName[METRICS_HISTOGRAM_MAX] = {
+    [METRICS_HISTOGRAM_MQTT_CMD_LATENCY] = "cmd_us",
+    [METRICS_HISTOGRAM_LEDSTRIP_INDICATION] = "ind_us",
+    [METRICS_HISTOGRAM_EFFECT_FRAME_TIME] = "frame_us",
+    [METRICS_HISTOGRAM_MQTT_PUB_LATENCY] = "pub_us",
+    [METRICS_HISTOGRAM_STRIP_REFRESH] = "strip_us",
+    [METRICS_HISTOGRAM_STRIP_LOCK] = "strip_lock_us",
+    [METRICS_HISTOGRAM_EFFECT_SWITCH] = "fx_switch_us",
+    [METRICS_HISTOGRAM_EFFECT_RENDER] = "fx_render_us",
+    [METRICS_HISTOGRAM_EFFECT_JITTER] = "fx_jitter_us",
+};
+
+/**
+ * @brief  估算直方图分位数(返回所在桶的上界,不超过最大值)
+ * @param  histogram
+ * @param  percent  0-100
+ * @return uint32_t 微秒
+ */
+uint32_t metricsHistogramPercentile(const MetricsHistogram_t *histogram, uint8_t percent)
+{
+    const MetricsHistogram_t *_histogram = histogram;
+    uint32_t _count = _histogram->count;
+    if (_count == 0)
+    {
+        return 0;
+    }
+    uint32_t _target = ((uint64_t)_count * percent + 99) / 100; // 向上取整
+    uint32_t _sum = 0;
+    for (size_t i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++)
+    {
+        _sum += _histogram->bucket[i];
+        if (_sum >= _target)
+        {
+            uint32_t _upper = (i == 0) ? 0 : (i >= 31 ? UINT32_MAX : ((1UL << i) - 1));
+            if (i == METRICS_HISTOGRAM_BUCKETS - 1 || _upper > _histogram->max)
+            {
+                _upper = _histogram->max;
+            }
+            return _upper;
+        }
+    }
+    return _histogram->max;
+}
+
+/**
+ * @brief  开始新的统计窗口(计量值最高水位与直方图),计数器保持累计
+ *         清空另一个窗口后切换,采样点不会写入正在清空的窗口
+ * @param  closed   输出结束的窗口(可为NULL)
+ */
+void metricsWindowSwap(MetricsWindow_t *closed)
+{
+    portENTER_CRITICAL(&s_metricsWindowLock);
+    uint32_t _active = g_metricsRegistry.active;
+    MetricsWindow_t *_next = &g_metricsRegistry.window[!_active];
+    memset(_next->histogram, 0, sizeof(_next->histogram));
+    for (size_t i = 0; i < METRICS_GAUGE_MAX; i++)
+    {
+        _next->highWater[i] = g_metricsRegistry.gauge[i];
+    }
+    __atomic_store_n(&g_metricsRegistry.active, !_active, __ATOMIC_RELEASE);
+    if (closed != NULL)
+    {
+        memcpy(closed, &g_metricsRegistry.window[_active], sizeof(MetricsWindow_t));
+    }
+    portEXIT_CRITICAL(&s_metricsWindowLock);
+}
+
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+/**
+ * @brief  统计两次快照之间各任务的CPU占用(占全部核心总时间的千分比)
+ * @param  writer
+ */
+static void metricsWriteTaskCpuShare(json_writer_t *writer)
+{
+    static TaskHandle_t s_lastTaskHandle[METRICS_TASK_MAX_NUM] = {0};
+    static configRUN_TIME_COUNTER_TYPE s_lastTaskRunTime[METRICS_TASK_MAX_NUM] = {0};
+    static configRUN_TIME_COUNTER_TYPE s_lastTotalRunTime = 0;
+    TaskStatus_t *_taskStatus = heap_caps_malloc(METRICS_TASK_MAX_NUM * sizeof(TaskStatus_t), MALLOC_CAP_SPIRAM);
+    if (_taskStatus == NULL)
+    {
+        return;
+    }
+    configRUN_TIME_COUNTER_TYPE _totalRunTime = 0;
+    UBaseType_t _taskNum = uxTaskGetSystemState(_taskStatus, METRICS_TASK_MAX_NUM, &_totalRunTime);
+    uint64_t _elapsed = (uint64_t)(_totalRunTime - s_lastTotalRunTime) * portNUM_PROCESSORS;
+    json_writer_key(writer, "cpu");
+    json_writer_object_begin(writer);
+    for (size_t i = 0; i < _taskNum; i++)
+    {
+        configRUN_TIME_COUNTER_TYPE _lastRunTime = 0;
+        for (size_t j = 0; j < METRICS_TASK_MAX_NUM; j++)
+        {
+            if (s_lastTaskHandle[j] == _taskStatus[i].xHandle)
+            {
+                _lastRunTime = s_lastTaskRunTime[j];
+                break;
+            }
+        }
+        uint32_t _permille = _elapsed ? (uint64_t)(_taskStatus[i].ulRunTimeCounter - _lastRunTime) * 1000 / _elapsed : 0;
+        json_writer_key_uint(writer, _taskStatus[i].pcTaskName, _permille);
+    }
+    json_writer_object_end(writer);
+    memset(s_lastTaskHandle, 0, sizeof(s_lastTaskHandle));
+    for (size_t i = 0; i < _taskNum; i++)
+    {
+        s_lastTaskHandle[i] = _taskStatus[i].xHandle;
+        s_lastTaskRunTime[i] = _taskStatus[i].ulRunTimeCounter;
+    }
+    s_lastTotalRunTime = _totalRunTime;
+    free(_taskStatus);
+}
+#endif
+
+/**
+ * @brief  生成遥测快照,并开始新的统计窗口
+ *         {"control_type":155,"notify_type":1,"data":{"up":秒,"cnt":{..},"gauge":{"名称":[当前,最高水位]},
+ *          "hist":{"名称":[样本数,p50,p99,最大]},"heap":[内部RAM剩余,PSRAM剩余],"cpu":{"任务名":千分比}}}
+ * @param  writer   已初始化的生成器,由调用方结束生成
+ */
+void metricsSnapshotWrite(json_writer_t *writer)
+{
+    static MetricsWindow_t s_window; // 结束的窗口(仅在MQTT任务中生成快照)
+    metricsWindowSwap(&s_window);
+    json_writer_object_begin(writer);
+    json_writer_key_int(writer, "control_type", MQTT_CONTROL_TYPE_SYSTEM_TELEMETRY);
+    json_writer_key_int(writer, "notify_type", NOTIFY_TELEMETRY_SNAPSHOT);
+    json_writer_key(writer, "data");
+    json_writer_object_begin(writer);
+    json_writer_key_uint(writer, "up", esp_log_timestamp() / 1000);
+
+    json_writer_key(writer, "cnt");
+    json_writer_object_begin(writer);
+    for (size_t i = 0; i < METRICS_COUNTER_MAX; i++)
+    {
+        json_writer_key_uint(writer, s_counterName[i], g_metricsRegistry.counter[i]);
+    }
+    json_writer_object_end(writer);
+
+    json_writer_key(writer, "gauge");
+    json_writer_object_begin(writer);
+    for (size_t i = 0; i < METRICS_GAUGE_MAX; i++)
+    {
+        json_writer_key(writer, s_gaugeName[i]);
+        json_writer_array_begin(writer);
+        json_writer_uint(writer, g_metricsRegistry.gauge[i]);
+        json_writer_uint(writer, s_window.highWater[i]);
+        json_writer_array_end(writer);
+    }
+    json_writer_object_end(writer);
+
+    json_writer_key(writer, "hist");
+    json_writer_object_begin(writer);
+    for (size_t i = 0; i < METRICS_HISTOGRAM_MAX; i++)
+    {
+        json_writer_key(writer, s_histogramName[i]);
+        json_writer_array_begin(writer);
+        json_writer_uint(writer, s_window.histogram[i].count);
+        json_writer_uint(writer, metricsHistogramPercentile(&s_window.histogram[i], 50));
+        json_writer_uint(writer, metricsHistogramPercentile(&s_window.histogram[i], 99));
+        json_writer_uint(writer, s_window.histogram[i].max);
+        json_writer_array_end(writer);
+    }
+    json_writer_object_end(writer);
+
+    json_writer_key(writer, "heap");
+    json_writer_array_begin(writer);
+    json_writer_uint(writer, heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
+    json_writer_uint(writer, heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+    json_writer_array_end(writer);
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    metricsWriteTaskCpuShare(writer);
+#endif
+    json_writer_object_end(writer);
+    json_writer_object_end(writer);
+}
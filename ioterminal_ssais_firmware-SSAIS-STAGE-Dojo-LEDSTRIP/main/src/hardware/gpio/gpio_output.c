@@ -10,11 +10,14 @@
 
 #include "gpio_peripheral.h"
 #include "common.h"
+#include "tower_light.h"
 
 static const char *TAG = "GPIO OUT";
 
 static led_indicator_handle_t s_sysStateLedHandle = NULL;        ///< 系统状态灯操作句柄
-static led_indicator_handle_t s_alarmLedHandle[4] = {NULL};      ///< 警示灯操作句柄分别为 [0] beep/blue [1] red [2]yellow [3]green
+static TowerLight_t s_alarmLight;                                ///< 警示灯控制器 [0] beep/blue [1] red [2]yellow [3]green
+static esp_timer_handle_t s_alarmLedTimer = NULL;                ///< 警示灯闪烁定时器(四个通道共用, 只在有通道闪烁时运行)
+static SemaphoreHandle_t s_alarmLedMutex = NULL;                 ///< 警示灯状态互斥锁
 static led_indicator_handle_t s_digitalOutputHandle[2] = {NULL}; ///< 板载Digital output操作句柄分别为 [0]output 1 [1] output 2
 
 /**
@@ -106,167 +109,124 @@ esp_err_t stateLedIndicatorInit()
     return ESP_OK;
 }
 
-// 三色灯灯效定义
-static const blink_step_t alarm_led_off[] = {
-    {LED_BLINK_HOLD, LED_STATE_OFF, 100}, // step1: turn off LED 100 ms
-    {LED_BLINK_STOP, 0, 0},               // step2: stop
+// 三色灯通道引脚, 顺序与 TowerLightChannel_t 一致
+static const gpio_num_t s_alarmLedPin[TOWER_LIGHT_CHANNEL_MAX] = {
+    [TOWER_LIGHT_CHANNEL_BEEP] = CONFIG_ALARM_LED_BEEP_PIN,
+    [TOWER_LIGHT_CHANNEL_RED] = CONFIG_ALARM_LED_RED_PIN,
+    [TOWER_LIGHT_CHANNEL_YELLOW] = CONFIG_ALARM_LED_YELLOW_PIN,
+    [TOWER_LIGHT_CHANNEL_GREEN] = CONFIG_ALARM_LED_GREEN_PIN,
 };
 
-static const blink_step_t alarm_led_on[] = {
-    {LED_BLINK_HOLD, LED_STATE_ON, 100}, // step1: turn on LED 100 ms
-    {LED_BLINK_STOP, 0, 0},              // step2: stop
-};
-
-static const blink_step_t alarm_led_slow_blink_loop[] = {
-    {LED_BLINK_HOLD, LED_STATE_ON, 800},  // step1: turn on LED 800 ms
-    {LED_BLINK_HOLD, LED_STATE_OFF, 800}, // step2: turn off LED 800 ms
-    {LED_BLINK_LOOP, 0, 0},               // step3: loop from step1
-};
+/**
+ * @brief 写入一个警示灯通道
+ * @param ctx
+ * @param channel TowerLightChannel_t
+ * @param on
+ */
+static void alarmLedWrite(void *ctx, uint8_t channel, bool on)
+{
+    gpio_set_level(s_alarmLedPin[channel], on ? CONFIG_IS_LIGHT_ON_WHEN_LEVEL_HIGH : !CONFIG_IS_LIGHT_ON_WHEN_LEVEL_HIGH);
+}
 
-static blink_step_t const *alarm_led_indicator_blink_lists[] = {
-    [ALARM_LED_OFF] = alarm_led_off,
-    [ALARM_LED_ON] = alarm_led_on,
-    [ALARM_LED_SLOW_BLINK_LOOP] = alarm_led_slow_blink_loop,
-    [ALARM_LED_MAX] = NULL,
-};
+/**
+ * @brief 警示灯闪烁定时器回调(四个通道共用)
+ * @param arg
+ */
+static void alarmLedTimerCallback(void *arg)
+{
+    // 状态正在修改时跳过本次节拍, 输出按时间计算, 下一次节拍补上
+    if (xSemaphoreTake(s_alarmLedMutex, 0) == pdTRUE)
+    {
+        towerLightTick(&s_alarmLight, esp_timer_get_time() / 1000);
+        xSemaphoreGive(s_alarmLedMutex);
+    }
+}
 
 /**
- * @brief 初始化警示灯初始化全局句柄
+ * @brief 初始化警示灯: 四个通道由一个控制器和一个闪烁定时器驱动
  * @return esp_err_t
  */
 esp_err_t alarmLedIndicatorInit()
 {
-    // 警示灯初始化部分
-    led_indicator_gpio_config_t led_indicator_gpio_config[4] = {
-        [0] = {
-            .gpio_num = CONFIG_ALARM_LED_BEEP_PIN,
-            .is_active_level_high = CONFIG_IS_LIGHT_ON_WHEN_LEVEL_HIGH,
-        },
-        [1] = {
-            .gpio_num = CONFIG_ALARM_LED_RED_PIN,
-            .is_active_level_high = CONFIG_IS_LIGHT_ON_WHEN_LEVEL_HIGH,
-        },
-        [2] = {
-            .gpio_num = CONFIG_ALARM_LED_YELLOW_PIN,
-            .is_active_level_high = CONFIG_IS_LIGHT_ON_WHEN_LEVEL_HIGH,
-        },
-        [3] = {
-            .gpio_num = CONFIG_ALARM_LED_GREEN_PIN,
-            .is_active_level_high = CONFIG_IS_LIGHT_ON_WHEN_LEVEL_HIGH,
-        },
-
-    };
-
-    led_indicator_config_t alarm_led_config[4] = {
-        [0] = {
-            .mode = LED_GPIO_MODE,
-            .led_indicator_ledc_config = (led_indicator_ledc_config_t *)&led_indicator_gpio_config[0],
-            .blink_lists = alarm_led_indicator_blink_lists,
-            .blink_list_num = ALARM_LED_MAX,
-        },
-        [1] = {
-            .mode = LED_GPIO_MODE,
-            .led_indicator_ledc_config = (led_indicator_ledc_config_t *)&led_indicator_gpio_config[1],
-            .blink_lists = alarm_led_indicator_blink_lists,
-            .blink_list_num = ALARM_LED_MAX,
-        },
-        [2] = {
-            .mode = LED_GPIO_MODE,
-            .led_indicator_ledc_config = (led_indicator_ledc_config_t *)&led_indicator_gpio_config[2],
-            .blink_lists = alarm_led_indicator_blink_lists,
-            .blink_list_num = ALARM_LED_MAX,
-        },
-        [3] = {
-            .mode = LED_GPIO_MODE,
-            .led_indicator_ledc_config = (led_indicator_ledc_config_t *)&led_indicator_gpio_config[3],
-            .blink_lists = alarm_led_indicator_blink_lists,
-            .blink_list_num = ALARM_LED_MAX,
-        },
+    gpio_config_t ioConf = {};
+    ioConf.intr_type = GPIO_INTR_DISABLE;
+    ioConf.mode = GPIO_MODE_OUTPUT;
+    ioConf.pull_down_en = GPIO_PULLDOWN_DISABLE;
+    ioConf.pull_up_en = GPIO_PULLUP_DISABLE;
+    for (int i = 0; i < TOWER_LIGHT_CHANNEL_MAX; i++)
+    {
+        ioConf.pin_bit_mask |= 1ULL << s_alarmLedPin[i];
+    }
+    if (gpio_config(&ioConf) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "alarm led gpio config failed");
+        return ESP_FAIL;
+    }
+    s_alarmLedMutex = xSemaphoreCreateMutex();
+    const esp_timer_create_args_t timerArgs = {
+        .callback = alarmLedTimerCallback,
+        .name = "alarm_led",
     };
-    for (int i = 0; i < 4; i++)
+    if (s_alarmLedMutex == NULL || esp_timer_create(&timerArgs, &s_alarmLedTimer) != ESP_OK)
     {
-        s_alarmLedHandle[i] = led_indicator_create(&alarm_led_config[i]);
-        if (s_alarmLedHandle[i] == NULL)
-        {
-            ESP_LOGE(TAG, "s_alarmLedHandle[%d] create failed", i);
-            return ESP_FAIL;
-        }
+        ESP_LOGE(TAG, "alarm led timer create failed");
+        return ESP_FAIL;
     }
-    ESP_ERROR_CHECK(led_indicator_set_on_off(s_alarmLedHandle[0], false));
-    ESP_ERROR_CHECK(led_indicator_set_on_off(s_alarmLedHandle[1], false));
-    ESP_ERROR_CHECK(led_indicator_set_on_off(s_alarmLedHandle[2], false));
-    ESP_ERROR_CHECK(led_indicator_set_on_off(s_alarmLedHandle[3], false));
+    towerLightInit(&s_alarmLight, alarmLedWrite, NULL);
     return ESP_OK;
 }
 
 /**
  * @brief 警示灯状态设置
+ *        只写入变化的通道, 状态没有变化时不做任何操作; 有通道闪烁时运行闪烁定时器, 否则停止
  * @param alarmLedState 警示灯状态
  */
 void alarmLedStateSet(AlarmLedState alarmLedState)
 {
+    TowerLightState_t _state = {0};
     if (alarmLedState <= ALARM_STATE_BRYG_1111)
     {
-        if (alarmLedState & 0x01) // 绿灯
-        {
-            ESP_ERROR_CHECK(led_indicator_preempt_start(s_alarmLedHandle[3], ALARM_LED_ON));
-        }
-        else
-        {
-            ESP_ERROR_CHECK(led_indicator_preempt_start(s_alarmLedHandle[3], ALARM_LED_OFF));
-        }
-        if (alarmLedState & 0x02) // 黄灯
-        {
-            ESP_ERROR_CHECK(led_indicator_preempt_start(s_alarmLedHandle[2], ALARM_LED_ON));
-        }
-        else
-        {
-            ESP_ERROR_CHECK(led_indicator_preempt_start(s_alarmLedHandle[2], ALARM_LED_OFF));
-        }
-        if (alarmLedState & 0x04) // 红灯
-        {
-            ESP_ERROR_CHECK(led_indicator_preempt_start(s_alarmLedHandle[1], ALARM_LED_ON));
-        }
-        else
-        {
-            ESP_ERROR_CHECK(led_indicator_preempt_start(s_alarmLedHandle[1], ALARM_LED_OFF));
-        }
-        if (alarmLedState & 0x08) // 蜂鸣或者蓝色
-        {
-            ESP_ERROR_CHECK(led_indicator_preempt_start(s_alarmLedHandle[0], ALARM_LED_ON));
-        }
-        else
-        {
-            ESP_ERROR_CHECK(led_indicator_preempt_start(s_alarmLedHandle[0], ALARM_LED_OFF));
-        }
+        _state.pattern[TOWER_LIGHT_CHANNEL_GREEN] = (alarmLedState & 0x01) ? TOWER_LIGHT_PATTERN_ON : TOWER_LIGHT_PATTERN_OFF;  // 绿灯
+        _state.pattern[TOWER_LIGHT_CHANNEL_YELLOW] = (alarmLedState & 0x02) ? TOWER_LIGHT_PATTERN_ON : TOWER_LIGHT_PATTERN_OFF; // 黄灯
+        _state.pattern[TOWER_LIGHT_CHANNEL_RED] = (alarmLedState & 0x04) ? TOWER_LIGHT_PATTERN_ON : TOWER_LIGHT_PATTERN_OFF;    // 红灯
+        _state.pattern[TOWER_LIGHT_CHANNEL_BEEP] = (alarmLedState & 0x08) ? TOWER_LIGHT_PATTERN_ON : TOWER_LIGHT_PATTERN_OFF;   // 蜂鸣或者蓝色
     }
     else
     {
         switch (alarmLedState)
         {
         case ALARM_STATE_NET_DISCONNECT: // 网络断开 红灯闪烁
-            ESP_ERROR_CHECK(led_indicator_preempt_start(s_alarmLedHandle[0], ALARM_LED_OFF));
-            ESP_ERROR_CHECK(led_indicator_preempt_start(s_alarmLedHandle[1], ALARM_LED_SLOW_BLINK_LOOP));
-            ESP_ERROR_CHECK(led_indicator_preempt_start(s_alarmLedHandle[2], ALARM_LED_OFF));
-            ESP_ERROR_CHECK(led_indicator_preempt_start(s_alarmLedHandle[3], ALARM_LED_OFF));
+            _state.pattern[TOWER_LIGHT_CHANNEL_RED] = TOWER_LIGHT_PATTERN_SLOW_BLINK;
             break;
         case ALARM_STATE_SYSTEAM_STAND_BY:
-            ESP_ERROR_CHECK(led_indicator_preempt_start(s_alarmLedHandle[0], ALARM_LED_OFF));
-            ESP_ERROR_CHECK(led_indicator_preempt_start(s_alarmLedHandle[1], ALARM_LED_OFF));
-            ESP_ERROR_CHECK(led_indicator_preempt_start(s_alarmLedHandle[2], ALARM_LED_OFF));
-            ESP_ERROR_CHECK(led_indicator_preempt_start(s_alarmLedHandle[3], ALARM_LED_OFF));
             break;
         case ALARM_STATE_INDICATION_ERR:
-            ESP_ERROR_CHECK(led_indicator_preempt_start(s_alarmLedHandle[0], ALARM_LED_OFF));
-            ESP_ERROR_CHECK(led_indicator_preempt_start(s_alarmLedHandle[1], ALARM_LED_OFF));
-            ESP_ERROR_CHECK(led_indicator_preempt_start(s_alarmLedHandle[2], ALARM_LED_SLOW_BLINK_LOOP));
-            ESP_ERROR_CHECK(led_indicator_preempt_start(s_alarmLedHandle[3], ALARM_LED_OFF));
+            _state.pattern[TOWER_LIGHT_CHANNEL_YELLOW] = TOWER_LIGHT_PATTERN_SLOW_BLINK;
             break;
         default:
             ESP_LOGE(TAG, "alarmLedStateSet state err  alarmLedState = %d", alarmLedState);
-            break;
+            return;
+        }
+    }
+    if (s_alarmLedMutex == NULL)
+    {
+        ESP_LOGE(TAG, "alarm led not initialized");
+        return;
+    }
+    xSemaphoreTake(s_alarmLedMutex, portMAX_DELAY);
+    if (towerLightSet(&s_alarmLight, &_state, esp_timer_get_time() / 1000) != 0)
+    {
+        bool _blinking = towerLightIsBlinking(&s_alarmLight);
+        if (_blinking && !esp_timer_is_active(s_alarmLedTimer))
+        {
+            esp_timer_start_periodic(s_alarmLedTimer, TOWER_LIGHT_TICK_MS * 1000);
+        }
+        else if (!_blinking && esp_timer_is_active(s_alarmLedTimer))
+        {
+            esp_timer_stop(s_alarmLedTimer);
         }
     }
+    xSemaphoreGive(s_alarmLedMutex);
 }
 
 static const blink_step_t digital_output_Slow_blink_loop[] = {
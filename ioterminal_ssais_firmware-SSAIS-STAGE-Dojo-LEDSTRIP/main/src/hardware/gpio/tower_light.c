@@ -0,0 +1,144 @@
+/**
+ * @file tower_light.c
+ * @brief 三色灯(警示灯)控制器: 新状态与当前状态比较后只写入变化的通道, 全部通道的闪烁由同一个定时节拍驱动
+ *        只做状态计算, 定时器与引脚由调用者提供, 可在主机上回放
+ * @version 1.0
+ * @date 2024-07-29
+ *
+ * @copyright Copyright (c) 2024  雅马哈发动机（厦门）信息系统有限公司
+ *
+ */
+#include <string.h>
+#include "tower_light.h"
+
+/**
+ * @brief 图案: 第n位为一个周期内第n个时间单位(50ms)的输出
+ */
+static const uint32_t s_towerLightPatternMask[TOWER_LIGHT_PATTERN_MAX] = {
+    [TOWER_LIGHT_PATTERN_OFF] = 0x00000000,
+    [TOWER_LIGHT_PATTERN_ON] = 0xFFFFFFFF,
+    [TOWER_LIGHT_PATTERN_SLOW_BLINK] = 0x0000FFFF,
+    [TOWER_LIGHT_PATTERN_SLOW_BLINK_INV] = 0xFFFF0000,
+    [TOWER_LIGHT_PATTERN_FAST_BLINK] = 0x0F0F0F0F,
+    [TOWER_LIGHT_PATTERN_DOUBLE_FLASH] = 0x000001C7,
+};
+
+/**
+ * @brief  图案是否需要定时节拍(不是常亮或常灭)
+ * @param  pattern
+ * @return true
+ * @return false
+ */
+static bool towerLightPatternIsBlink(uint8_t pattern)
+{
+    return s_towerLightPatternMask[pattern] != 0 && s_towerLightPatternMask[pattern] != UINT32_MAX;
+}
+
+/**
+ * @brief  计算某一时刻各通道的输出, 并只写入与当前输出不同的通道
+ * @param  light
+ * @param  nowMs
+ * @return uint8_t 写入的通道(第n位为通道n)
+ */
+static uint8_t towerLightApply(TowerLight_t *light, uint32_t nowMs)
+{
+    uint32_t _slot = (nowMs - light->epochMs) / TOWER_LIGHT_TICK_MS % TOWER_LIGHT_SLOT_NUM;
+    uint8_t _output = 0;
+    for (uint8_t i = 0; i < TOWER_LIGHT_CHANNEL_MAX; i++)
+    {
+        if (s_towerLightPatternMask[light->state.pattern[i]] & (1UL << _slot))
+        {
+            _output |= 1 << i;
+        }
+    }
+    uint8_t _changed = _output ^ light->output;
+    for (uint8_t i = 0; i < TOWER_LIGHT_CHANNEL_MAX; i++)
+    {
+        if (_changed & (1 << i))
+        {
+            light->write(light->ctx, i, _output & (1 << i));
+        }
+    }
+    light->output = _output;
+    return _changed;
+}
+
+/**
+ * @brief  初始化控制器并关闭全部通道
+ * @param  light
+ * @param  write    写入一个通道的输出
+ * @param  ctx      write的参数
+ */
+void towerLightInit(TowerLight_t *light, TowerLightWrite_t write, void *ctx)
+{
+    memset(light, 0, sizeof(TowerLight_t));
+    light->write = write;
+    light->ctx = ctx;
+    for (uint8_t i = 0; i < TOWER_LIGHT_CHANNEL_MAX; i++)
+    {
+        write(ctx, i, false);
+    }
+}
+
+/**
+ * @brief  设置状态: 图案没有变化时不做任何写入
+ *         从没有通道闪烁变为有通道闪烁时重新开始闪烁周期(立即点亮); 已有通道在闪烁时新的闪烁通道按相同相位加入
+ *         不支持的图案按灭处理
+ * @param  light
+ * @param  state
+ * @param  nowMs    当前时间(毫秒)
+ * @return uint8_t  图案变化的通道(第n位为通道n)
+ */
+uint8_t towerLightSet(TowerLight_t *light, const TowerLightState_t *state, uint32_t nowMs)
+{
+    bool _wasBlinking = towerLightIsBlinking(light);
+    uint8_t _changed = 0;
+    for (uint8_t i = 0; i < TOWER_LIGHT_CHANNEL_MAX; i++)
+    {
+        uint8_t _pattern = state->pattern[i] < TOWER_LIGHT_PATTERN_MAX ? state->pattern[i] : TOWER_LIGHT_PATTERN_OFF;
+        if (_pattern != light->state.pattern[i])
+        {
+            light->state.pattern[i] = _pattern;
+            _changed |= 1 << i;
+        }
+    }
+    if (_changed == 0)
+    {
+        return 0;
+    }
+    if (!_wasBlinking)
+    {
+        light->epochMs = nowMs;
+    }
+    towerLightApply(light, nowMs);
+    return _changed;
+}
+
+/**
+ * @brief  定时节拍(每 TOWER_LIGHT_TICK_MS 调用一次), 只写入输出变化的通道
+ * @param  light
+ * @param  nowMs    当前时间(毫秒)
+ * @return uint8_t  写入的通道(第n位为通道n)
+ */
+uint8_t towerLightTick(TowerLight_t *light, uint32_t nowMs)
+{
+    return towerLightApply(light, nowMs);
+}
+
+/**
+ * @brief  是否有通道在闪烁(需要定时节拍)
+ * @param  light
+ * @return true
+ * @return false
+ */
+bool towerLightIsBlinking(const TowerLight_t *light)
+{
+    for (uint8_t i = 0; i < TOWER_LIGHT_CHANNEL_MAX; i++)
+    {
+        if (towerLightPatternIsBlink(light->state.pattern[i]))
+        {
+            return true;
+        }
+    }
+    return false;
+}
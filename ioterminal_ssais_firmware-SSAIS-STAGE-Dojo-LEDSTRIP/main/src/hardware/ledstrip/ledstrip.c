@@ -11,6 +11,80 @@
 
 static const char *TAG = "LEDSTRIP";
 
+static TaskHandle_t s_ledStripRenderTaskHandle = NULL; // 渲染任务句柄, 唯一负责提交刷新
+static uint32_t s_ledStripRequestSeq = 0;              // 刷新请求序号
+static uint32_t s_ledStripRenderedSeq = 0;             // 已提交(已拷贝到发送缓冲区)的请求序号
+static bool s_ledStripDoneCbRegistered = false;        // 后端支持发送完成回调
+static int64_t s_ledStripRefreshStartTime = 0;         // 当前一帧的发送开始时间
+
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0) && !CONFIG_LED_STRIP_BACKEND_SPI
+static const int s_ledStripOutputPin[] = {
+    CONFIG_LED_STRIP_PIN,
+#if CONFIG_LED_STRIP_OUTPUT_NUM >= 2
+    CONFIG_LED_STRIP_PIN_2,
+#endif
+#if CONFIG_LED_STRIP_OUTPUT_NUM >= 3
+    CONFIG_LED_STRIP_PIN_3,
+#endif
+#if CONFIG_LED_STRIP_OUTPUT_NUM >= 4
+    CONFIG_LED_STRIP_PIN_4,
+#endif
+};
+
+/**
+ * @brief  按配置把灯带划分到多路输出, 各路依次承接连续的灯珠编号
+ *         CONFIG_LED_STRIP_OUTPUT_SPLIT 给出除最后一路外各路的灯珠数, 未配置的路平分剩余灯珠
+ * @param  ledNum       灯珠总数
+ * @param  multiConfig
+ */
+static void ledStripOutputSplit(uint16_t ledNum, led_strip_rmt_multi_config_t *multiConfig)
+{
+    uint32_t _outputNum = sizeof(s_ledStripOutputPin) / sizeof(s_ledStripOutputPin[0]);
+    if (_outputNum > ledNum)
+    {
+        _outputNum = ledNum ? ledNum : 1; // 每路至少1颗灯珠
+    }
+#if CONFIG_LED_STRIP_OUTPUT_NUM >= 2
+    const char *_split = CONFIG_LED_STRIP_OUTPUT_SPLIT;
+#else
+    const char *_split = "";
+#endif
+    uint32_t _remain = ledNum;
+    multiConfig->output_num = _outputNum;
+    for (uint32_t i = 0; i < _outputNum; i++)
+    {
+        uint32_t _outputLeft = _outputNum - i;
+        uint32_t _num = 0;
+        if (_outputLeft == 1)
+        {
+            _num = _remain;
+        }
+        else
+        {
+            if (*_split)
+            {
+                char *_end = NULL;
+                _num = strtoul(_split, &_end, 10);
+                _split = (*_end == ',') ? _end + 1 : _end;
+            }
+            if (_num == 0)
+            {
+                _num = _remain / _outputLeft;
+            }
+            if (_num > _remain - (_outputLeft - 1))
+            {
+                ESP_LOGW(TAG, "LED strip output %lu: %lu leds exceed the strip, clamped", i + 1, _num);
+                _num = _remain - (_outputLeft - 1);
+            }
+        }
+        multiConfig->gpio_num[i] = s_ledStripOutputPin[i];
+        multiConfig->led_num[i] = _num;
+        _remain -= _num;
+        ESP_LOGI(TAG, "LED strip output %lu: gpio %d, leds %lu", i + 1, s_ledStripOutputPin[i], _num);
+    }
+}
+#endif
+
 /**
  * @brief  led灯带初始化
  * @param  ledstripConfigData
@@ -27,21 +101,144 @@ led_strip_handle_t LedStripInit(LedstripConfigData_t ledstripConfigData)
         .flags.invert_out = false,                // whether to invert the output signal
     };
 
+    ledStripColorLutInit();
+
+    // LED Strip object handle
+    led_strip_handle_t led_strip;
+#if CONFIG_LED_STRIP_BACKEND_SPI
+    // LED strip backend configuration: SPI, 以太网占用SPI2, 灯带使用SPI3
+    led_strip_spi_config_t spi_config = {
+        .clk_src = SPI_CLK_SRC_DEFAULT,
+        .spi_bus = SPI3_HOST,
+        .flags.with_dma = true, // 像素以DMA事务队列连续发送
+    };
+    ESP_ERROR_CHECK(led_strip_new_spi_device(&strip_config, &spi_config, &led_strip));
+    ESP_LOGI(TAG, "Created LED strip object with SPI backend");
+#else
     // LED strip backend configuration: RMT
     led_strip_rmt_config_t rmt_config = {
 #if ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(5, 0, 0)
         .rmt_channel = 0,
 #else
-        .mem_block_symbols = 2046,
+        .mem_block_symbols = CONFIG_LED_STRIP_RMT_MEM_BLOCK_SYMBOLS, // 编码器按需填充的乒乓缓冲区, 不需要容纳整条灯带
         .clk_src = RMT_CLK_SRC_DEFAULT,      // different clock source can lead to different power consumption
         .resolution_hz = (10 * 1000 * 1000), // RMT counter clock frequency 10MHz resolution, 1 tick = 0.1us (led strip needs a high resolution)
+#if CONFIG_LED_STRIP_RMT_WITH_DMA
         .flags.with_dma = true,              // DMA feature is available on ESP target like ESP32-S3
+#endif
 #endif
     };
 
-    // LED Strip object handle
-    led_strip_handle_t led_strip;
+#if ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(5, 0, 0)
     ESP_ERROR_CHECK(led_strip_new_rmt_device(&strip_config, &rmt_config, &led_strip));
-    ESP_LOGI(TAG, "Created LED strip object with RMT backend");
+#else
+    // 长货架按配置拆分到多路RMT输出并行刷新, 业务与灯效仍使用同一套灯珠编号
+    led_strip_rmt_multi_config_t multi_config = {0};
+    ledStripOutputSplit(ledstripConfigData.ledNum, &multi_config);
+    ESP_ERROR_CHECK(led_strip_new_rmt_multi_device(&strip_config, &rmt_config, &multi_config, &led_strip));
+#endif
+    ESP_LOGI(TAG, "Created LED strip object with RMT backend, %d symbols%s", CONFIG_LED_STRIP_RMT_MEM_BLOCK_SYMBOLS,
+             rmt_config.flags.with_dma ? " (DMA)" : "");
+#endif
     return led_strip;
 }
+
+/**
+ * @brief  一帧发送完成(中断上下文), 记录发送耗时
+ * @param  strip
+ * @param  userCtx
+ * @return bool     是否需要在中断退出时切换任务
+ */
+static bool ledStripRefreshDone(led_strip_handle_t strip, void *userCtx)
+{
+    metricsHistogramRecord(METRICS_HISTOGRAM_STRIP_REFRESH, esp_timer_get_time() - s_ledStripRefreshStartTime);
+    return false;
+}
+
+/**
+ * @brief  提交一帧: 持锁期间只拷贝像素到发送缓冲区, 发送在后台进行
+ *         后端不支持异步时退化为同步刷新
+ */
+static void ledStripRefreshSubmit(void)
+{
+    if (xSemaphoreTake(g_ledstripRmtHandleMetex, portMAX_DELAY) != pdTRUE)
+    {
+        return;
+    }
+    int64_t _submitStart = esp_timer_get_time();
+    uint32_t _requestSeq = __atomic_load_n(&s_ledStripRequestSeq, __ATOMIC_ACQUIRE); // 在拷贝像素前读取, 此前的请求都包含在这一帧里
+    TRACE_EMIT(TRACE_EVENT_STRIP_REFRESH_BEGIN, 0, 0);
+    s_ledStripRefreshStartTime = _submitStart;
+    led_strip_refresh_async(g_ledstripRmtHandle, LED_STRIP_REFRESH_DIRTY); // 只发送到最后一个变化的灯珠
+    uint32_t _lockUs = esp_timer_get_time() - _submitStart;
+    xSemaphoreGive(g_ledstripRmtHandleMetex);
+    TRACE_EMIT(TRACE_EVENT_STRIP_REFRESH_END, 0, _lockUs);
+    metricsHistogramRecord(METRICS_HISTOGRAM_STRIP_LOCK, _lockUs);
+    if (!s_ledStripDoneCbRegistered)
+    {
+        metricsHistogramRecord(METRICS_HISTOGRAM_STRIP_REFRESH, _lockUs);
+    }
+    __atomic_store_n(&s_ledStripRenderedSeq, _requestSeq, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief  请求刷新灯带, 不等待发送
+ *         渲染任务启动前(初始化阶段)直接同步刷新
+ */
+void ledStripRefreshRequest(void)
+{
+    __atomic_add_fetch(&s_ledStripRequestSeq, 1, __ATOMIC_RELEASE);
+    if (s_ledStripRenderTaskHandle == NULL)
+    {
+        ledStripRefreshSubmit();
+        led_strip_wait_refresh_done(g_ledstripRmtHandle, -1);
+        return;
+    }
+    xTaskNotifyGive(s_ledStripRenderTaskHandle);
+}
+
+/**
+ * @brief  请求刷新并等待这一帧发送完成(需要确认灯已点亮的场合使用)
+ * @param  timeoutMs
+ * @return esp_err_t
+ */
+esp_err_t ledStripRefreshFlush(uint32_t timeoutMs)
+{
+    uint32_t _requestSeq = __atomic_add_fetch(&s_ledStripRequestSeq, 1, __ATOMIC_RELEASE);
+    if (s_ledStripRenderTaskHandle == NULL)
+    {
+        ledStripRefreshSubmit();
+    }
+    else
+    {
+        xTaskNotifyGive(s_ledStripRenderTaskHandle);
+        TickType_t _waitStart = xTaskGetTickCount();
+        while ((int32_t)(__atomic_load_n(&s_ledStripRenderedSeq, __ATOMIC_ACQUIRE) - _requestSeq) < 0)
+        {
+            if (xTaskGetTickCount() - _waitStart > pdMS_TO_TICKS(timeoutMs))
+            {
+                return ESP_ERR_TIMEOUT;
+            }
+            vTaskDelay(1);
+        }
+    }
+    return led_strip_wait_refresh_done(g_ledstripRmtHandle, timeoutMs);
+}
+
+/**
+ * @brief  灯带渲染任务: 唯一的刷新提交者, 合并多个刷新请求为一帧
+ *         等待上一帧发送完成时不持锁, 业务与灯效可以继续绘制下一帧
+ * @param  pvParameters
+ */
+void ledStripRenderTask(void *pvParameters)
+{
+    s_ledStripDoneCbRegistered = led_strip_register_refresh_done_cb(g_ledstripRmtHandle, ledStripRefreshDone, NULL) == ESP_OK;
+    s_ledStripRenderTaskHandle = xTaskGetCurrentTaskHandle();
+    ESP_LOGI(TAG, "ledstrip render task started, async refresh %s", s_ledStripDoneCbRegistered ? "enabled" : "not supported");
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        led_strip_wait_refresh_done(g_ledstripRmtHandle, -1);
+        ledStripRefreshSubmit();
+    }
+}
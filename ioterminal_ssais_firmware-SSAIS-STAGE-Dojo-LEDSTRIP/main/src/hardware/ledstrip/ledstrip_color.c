@@ -0,0 +1,47 @@
+/**
+ * @file ledstrip_color.c
+ * @brief 灯带颜色亮度换算: 整数查表代替 RGB→HSV→RGB 的浮点往返
+ * @version 1.0
+ * @date 2024-07-08
+ *
+ * @copyright Copyright (c) 2024  雅马哈发动机（厦门）信息系统有限公司
+ *
+ */
+#include "ledstrip_color.h"
+
+static uint32_t s_reciprocalLut[256]; // 65536 / 最亮分量(四舍五入), 0号不使用
+
+/**
+ * @brief  初始化亮度换算表(灯带初始化时调用一次)
+ */
+void ledStripColorLutInit(void)
+{
+    s_reciprocalLut[0] = 0;
+    for (uint32_t i = 1; i < 256; i++)
+    {
+        s_reciprocalLut[i] = (65536 + i / 2) / i;
+    }
+}
+
+/**
+ * @brief  按亮度换算颜色: 保持色相与饱和度,最亮分量等于亮度(与替换HSV明度的结果一致)
+ * @param  color        0xRRGGBB
+ * @param  brightness   0-255
+ * @return uint32_t     换算后的0xRRGGBB, 可直接写入灯带
+ */
+uint32_t ledStripColorScale(uint32_t color, uint8_t brightness)
+{
+    uint32_t _red = LEDSTRIP_COLOR_RED(color);
+    uint32_t _green = LEDSTRIP_COLOR_GREEN(color);
+    uint32_t _blue = LEDSTRIP_COLOR_BLUE(color);
+    uint32_t _max = _red > _green ? (_red > _blue ? _red : _blue) : (_green > _blue ? _green : _blue);
+    if (_max == 0) // 黑色保持熄灭
+    {
+        return 0;
+    }
+    uint32_t _scale = brightness * s_reciprocalLut[_max]; // 16位定点的缩放系数,最大 255 * 65536
+    _red = (_red * _scale + 0x8000) >> 16;
+    _green = (_green * _scale + 0x8000) >> 16;
+    _blue = (_blue * _scale + 0x8000) >> 16;
+    return (_red << 16) | (_green << 8) | _blue;
+}
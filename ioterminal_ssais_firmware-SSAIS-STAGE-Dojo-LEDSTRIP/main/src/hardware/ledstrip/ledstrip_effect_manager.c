@@ -22,33 +22,99 @@
 
 static const char *TAG = "LED_EFFECT";
 
-// 效果更新任务堆栈大小
-#define EFFECT_TASK_STACK_SIZE 3072
+// 效果更新任务堆栈大小(效果结束回调也在该任务中执行)
+#define EFFECT_TASK_STACK_SIZE 4096
 
 // 效果更新任务优先级 (低优先级，不影响关键任务)
 #define EFFECT_TASK_PRIORITY 2
 
-// 效果更新间隔 (20ms = 50Hz 刷新率)
+// 最短效果更新间隔 (20ms = 50Hz 刷新率), 灯珠较多时按发送时间延长
 #define EFFECT_UPDATE_INTERVAL_MS 20
 
+// 一个颜色字节的发送时间(800kHz, 8bit × 1.25us)
+#define EFFECT_WIRE_US_PER_BYTE 10
+
+// 一帧的发送时间最多占帧间隔的百分比, 其余留给画面计算和业务刷新
+#define EFFECT_WIRE_BUDGET_PERCENT 70
+
+// 停止效果时等待效果任务清空灯带的最长帧数
+#define EFFECT_STOP_TIMEOUT_FRAMES 5
+
+/**
+ * @brief 一个效果的运行状态(只由效果任务访问)
+ */
+typedef struct
+{
+    led_strip_effect_params_t params; // 效果参数
+    LedStripTimeline_t *timeline;     // 时间线存储, 关键帧时间线时 params.timeline 指向这里
+    uint32_t start_time;              // 效果开始时间
+    uint32_t frame_count;             // 效果帧计数
+    bool running;                     // 效果运行标志
+} effect_slot_t;
+
 // 全局变量
-static TaskHandle_t effect_task_handle = NULL;       // 效果任务句柄
-static SemaphoreHandle_t effect_mutex = NULL;        // 效果互斥锁
-static led_strip_handle_t _ledstripRmtHandle = NULL; // LED灯带句柄
-static uint16_t led_count = 0;                       // LED数量
-static bool task_running = false;                    // 任务运行标志
-static bool effect_running = false;                  // 效果运行标志
-static led_strip_effect_params_t current_effect;     // 当前效果参数
-static uint32_t effect_start_time = 0;               // 效果开始时间
-static uint32_t effect_frame_count = 0;              // 效果帧计数
+static TaskHandle_t effect_task_handle = NULL;           // 效果任务句柄(常驻, 空闲时阻塞等待)
+static SemaphoreHandle_t effect_mutex = NULL;            // 效果互斥锁(保护待切换的参数)
+static SemaphoreHandle_t effect_idle_sem = NULL;         // 停止效果后效果任务已清空灯带
+static led_strip_handle_t _ledstripRmtHandle = NULL;     // LED灯带句柄
+static uint16_t led_count = 0;                           // LED数量
+static bool effect_running = false;                      // 效果运行标志(包括等待切换的效果)
+static bool effect_pending = false;                      // 有新参数等待在帧间切换
+static bool effect_stop_pending = false;                 // 有停止请求等待在帧间执行
+static int64_t effect_pending_time = 0;                  // 新参数的提交时间, 统计切换延迟
+static led_strip_effect_params_t effect_pending_params;  // 待切换的效果参数(双缓冲的写入端)
+static LedStripTimeline_t *effect_pending_timeline;      // 待切换的时间线
+static led_strip_effect_end_cb_t effect_end_cb = NULL;   // 最后提交的效果的结束回调
+static effect_slot_t effect_slot[2];                     // 当前效果与交叉渐变中的旧效果
+static uint8_t effect_active = 0;                        // 当前效果在 effect_slot 中的序号
+static uint8_t *frame_buf[2] = {NULL, NULL};             // 两个效果各自绘制的画面(RGB, 与 effect_slot 对应)
+static uint8_t *render_buf = NULL;                       // update_effect 正在绘制的画面
+static bool crossfading = false;                         // 正在交叉渐变
+static uint32_t crossfade_start_time = 0;                // 交叉渐变开始时间
+static TickType_t frame_period_ticks = 1;                // 帧间隔(系统节拍), 按灯珠数量确定
 
 // 前向声明
 static void effect_task(void *arg);
 static void initialize_manager(void);
-static bool update_effect(uint32_t current_time);
+static bool update_effect(effect_slot_t *slot, uint32_t current_time);
+
+/**
+ * @brief 取出最后提交的效果的结束回调(需持有效果互斥锁), 保证每个效果只回调一次
+ */
+static led_strip_effect_end_cb_t take_end_cb(void)
+{
+    led_strip_effect_end_cb_t end_cb = effect_end_cb;
+    effect_end_cb = NULL;
+    return end_cb;
+}
+
+/**
+ * @brief 效果时钟(毫秒), 不受系统节拍(10ms)限制
+ */
+static uint32_t effect_time_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
 
 /**
- * @brief 初始化效果管理器
+ * @brief 按灯珠数量确定帧间隔: 不短于 EFFECT_UPDATE_INTERVAL_MS, 且整条灯带的发送时间不超过帧间隔的 EFFECT_WIRE_BUDGET_PERCENT
+ *        向上取整到系统节拍, 帧按节拍调度
+ */
+static TickType_t frame_period_for_strip(uint16_t count)
+{
+    uint32_t bytes_per_pixel = g_nvsData.DeviceConfigData.ledstripConfigData.pixelFormat == LED_PIXEL_FORMAT_GRBW ? 4 : 3;
+    uint32_t wire_us = count * bytes_per_pixel * EFFECT_WIRE_US_PER_BYTE;
+    uint32_t period_ms = wire_us * 100 / EFFECT_WIRE_BUDGET_PERCENT / 1000 + 1;
+    if (period_ms < EFFECT_UPDATE_INTERVAL_MS)
+    {
+        period_ms = EFFECT_UPDATE_INTERVAL_MS;
+    }
+    TickType_t ticks = (period_ms * configTICK_RATE_HZ + 999) / 1000;
+    return ticks > 0 ? ticks : 1;
+}
+
+/**
+ * @brief 初始化效果管理器, 画面缓冲区与效果任务只创建一次
  */
 static void initialize_manager(void)
 {
@@ -56,7 +122,8 @@ static void initialize_manager(void)
     {
         // 创建效果互斥锁
         effect_mutex = xSemaphoreCreateMutex();
-        if (effect_mutex == NULL)
+        effect_idle_sem = xSemaphoreCreateBinary();
+        if (effect_mutex == NULL || effect_idle_sem == NULL)
         {
             ESP_LOGE(TAG, "Failed to create effect mutex");
             return;
@@ -83,14 +150,53 @@ static void initialize_manager(void)
             ESP_LOGE(TAG, "LED count is 0, cannot initialize effect manager");
             return;
         }
-        ESP_LOGI(TAG, "LED effect manager initialized, LED count: %d", led_count);
+        frame_period_ticks = frame_period_for_strip(led_count);
+        metricsGaugeSet(METRICS_GAUGE_EFFECT_FRAME_PERIOD, frame_period_ticks * portTICK_PERIOD_MS);
+        ESP_LOGI(TAG, "LED effect manager initialized, LED count: %d, frame period: %lu ms",
+                 led_count, (unsigned long)(frame_period_ticks * portTICK_PERIOD_MS));
+    }
+
+    if (frame_buf[0] == NULL)
+    {
+        frame_buf[0] = heap_caps_calloc(2 * led_count, 3, MALLOC_CAP_SPIRAM);
+        effect_pending_timeline = heap_caps_malloc(3 * sizeof(LedStripTimeline_t), MALLOC_CAP_SPIRAM);
+        if (frame_buf[0] == NULL || effect_pending_timeline == NULL)
+        {
+            ESP_LOGE(TAG, "No memory for effect frame buffers");
+            free(frame_buf[0]);
+            free(effect_pending_timeline);
+            frame_buf[0] = NULL;
+            effect_pending_timeline = NULL;
+            return;
+        }
+        frame_buf[1] = frame_buf[0] + led_count * 3;
+        effect_slot[0].timeline = effect_pending_timeline + 1;
+        effect_slot[1].timeline = effect_pending_timeline + 2;
+    }
+
+    if (effect_task_handle == NULL)
+    {
+        BaseType_t ret = xTaskCreate(
+            effect_task,
+            "led_effect_task",
+            EFFECT_TASK_STACK_SIZE,
+            NULL,
+            EFFECT_TASK_PRIORITY,
+            &effect_task_handle);
+        if (ret != pdPASS)
+        {
+            ESP_LOGE(TAG, "Failed to create effect task");
+            effect_task_handle = NULL;
+            return;
+        }
+        metricsCounterInc(METRICS_COUNTER_EFFECT_TASK_CREATE);
     }
 }
 
 /**
- * @brief 运行灯带效果
+ * @brief 检查效果参数(灯珠范围按当前灯带长度), 不启动效果
  */
-esp_err_t led_strip_effect_run(const led_strip_effect_params_t *params)
+esp_err_t led_strip_effect_check(const led_strip_effect_params_t *params)
 {
     if (params == NULL || params->effect_type >= LED_EFFECT_MAX)
     {
@@ -99,12 +205,11 @@ esp_err_t led_strip_effect_run(const led_strip_effect_params_t *params)
 
     initialize_manager();
 
-    if (effect_mutex == NULL)
+    if (effect_mutex == NULL || effect_task_handle == NULL)
     {
         return ESP_FAIL;
     }
 
-    // 验证参数
     if (params->start_led == 0 || params->start_led > led_count ||
         params->end_led == 0 || params->end_led > led_count ||
         params->start_led > params->end_led)
@@ -113,6 +218,31 @@ esp_err_t led_strip_effect_run(const led_strip_effect_params_t *params)
                  params->start_led, params->end_led, led_count);
         return ESP_ERR_INVALID_ARG;
     }
+    if (params->effect_type == LED_EFFECT_SEQUENCE && !(params->leds_per_sec > 0))
+    {
+        ESP_LOGE(TAG, "Invalid sequence speed: %.2f LEDs/s", params->leds_per_sec);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (params->effect_type == LED_EFFECT_TIMELINE && params->timeline == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief 运行灯带效果
+ *        参数写入待切换缓冲区后立即返回, 效果任务在下一帧开始前切换, 不重建任务
+ *        效果类型不变时(顺序点亮与时间线除外)保持原有相位, 只更新颜色、速度、亮度等参数
+ */
+esp_err_t led_strip_effect_run(const led_strip_effect_params_t *params)
+{
+    // 验证参数
+    esp_err_t err = led_strip_effect_check(params);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
 
     // 获取互斥锁
     if (xSemaphoreTake(effect_mutex, portMAX_DELAY) != pdTRUE)
@@ -120,46 +250,26 @@ esp_err_t led_strip_effect_run(const led_strip_effect_params_t *params)
         return ESP_FAIL;
     }
 
-    // 如果有正在运行的效果，先停止它
-    if (effect_running)
-    {
-        effect_running = false;
-        xSemaphoreGive(effect_mutex);
-        vTaskDelay(pdMS_TO_TICKS(50)); // 等待效果任务停止
-        xSemaphoreTake(effect_mutex, portMAX_DELAY);
-    }
+    // 被替换的效果(包括还未切换的)结束
+    led_strip_effect_end_cb_t replaced_end_cb = effect_running ? take_end_cb() : NULL;
 
     // 复制新效果参数
-    memcpy(&current_effect, params, sizeof(led_strip_effect_params_t));
-
-    // 重置效果状态
-    effect_start_time = (uint32_t)xTaskGetTickCount() * portTICK_PERIOD_MS;
-    effect_frame_count = 0;
-    effect_running = true;
-
-    // 如果任务不存在，创建任务
-    if (!task_running)
+    memcpy(&effect_pending_params, params, sizeof(led_strip_effect_params_t));
+    if (params->effect_type == LED_EFFECT_TIMELINE)
     {
-        task_running = true;
-        BaseType_t ret = xTaskCreate(
-            effect_task,
-            "led_effect_task",
-            EFFECT_TASK_STACK_SIZE,
-            NULL,
-            EFFECT_TASK_PRIORITY,
-            &effect_task_handle);
-
-        if (ret != pdPASS)
-        {
-            ESP_LOGE(TAG, "Failed to create effect task");
-            effect_running = false;
-            task_running = false;
-            xSemaphoreGive(effect_mutex);
-            return ESP_FAIL;
-        }
+        memcpy(effect_pending_timeline, params->timeline, sizeof(LedStripTimeline_t));
     }
+    effect_end_cb = params->end_cb;
+    effect_pending_time = esp_timer_get_time();
+    effect_pending = true;
+    effect_running = true;
 
     xSemaphoreGive(effect_mutex);
+    xTaskNotifyGive(effect_task_handle);
+    if (replaced_end_cb != NULL)
+    {
+        replaced_end_cb(false);
+    }
 
     ESP_LOGI(TAG, "Started effect type %d for LEDs %d-%d",
              params->effect_type, params->start_led, params->end_led);
@@ -169,6 +279,8 @@ esp_err_t led_strip_effect_run(const led_strip_effect_params_t *params)
 
 /**
  * @brief 停止当前正在运行的灯带效果
+ *        等待效果任务清空灯带后返回, 调用者随后的绘制不会被效果的下一帧覆盖
+ *        等待超时返回ESP_ERR_TIMEOUT(效果已停止, 但效果任务可能还会写入一帧), 调用者不应在此后绘制
  */
 esp_err_t led_strip_effect_stop(void)
 {
@@ -179,10 +291,28 @@ esp_err_t led_strip_effect_stop(void)
 
     if (xSemaphoreTake(effect_mutex, portMAX_DELAY) == pdTRUE)
     {
+        esp_err_t err = ESP_OK;
+        xSemaphoreTake(effect_idle_sem, 0);
         effect_running = false;
+        effect_pending = false;
+        effect_stop_pending = true;
+        led_strip_effect_end_cb_t end_cb = take_end_cb();
         xSemaphoreGive(effect_mutex);
+        if (xTaskGetCurrentTaskHandle() != effect_task_handle)
+        {
+            xTaskNotifyGive(effect_task_handle);
+            if (xSemaphoreTake(effect_idle_sem, frame_period_ticks * EFFECT_STOP_TIMEOUT_FRAMES) != pdTRUE)
+            {
+                ESP_LOGE(TAG, "Waiting for effect task to stop timeout");
+                err = ESP_ERR_TIMEOUT;
+            }
+        }
         ESP_LOGI(TAG, "Stopped LED effect");
-        return ESP_OK;
+        if (end_cb != NULL)
+        {
+            end_cb(false);
+        }
+        return err;
     }
 
     return ESP_FAIL;
@@ -207,26 +337,54 @@ bool led_strip_effect_is_running(void)
     return running;
 }
 
+/**
+ * @brief 效果写入画面缓冲区中的一颗灯珠
+ */
+static void frame_set_pixel(uint32_t index, uint32_t red, uint32_t green, uint32_t blue)
+{
+    if (index >= led_count)
+    {
+        return;
+    }
+    uint8_t *pixel = render_buf + index * 3;
+    pixel[0] = red & 0xFF;
+    pixel[1] = green & 0xFF;
+    pixel[2] = blue & 0xFF;
+}
+
+/**
+ * @brief 效果写入画面缓冲区中的一段灯珠
+ */
+static void frame_fill(void *ctx, uint16_t index, uint16_t count, uint8_t red, uint8_t green, uint8_t blue)
+{
+    for (uint32_t i = index; i < (uint32_t)index + count; i++)
+    {
+        frame_set_pixel(i, red, green, blue);
+    }
+}
+
 /**
  * @brief 更新当前效果
  *
+ * @param slot 效果
  * @param current_time 当前时间(毫秒)
  * @return true 如果效果仍在运行
  * @return false 如果效果已结束
  */
-static bool update_effect(uint32_t current_time)
+static bool update_effect(effect_slot_t *slot, uint32_t current_time)
 {
-    if (!effect_running)
+    if (!slot->running)
     {
         return false;
     }
 
-    uint32_t elapsed_time = current_time - effect_start_time;
-    uint16_t start_led = current_effect.start_led - 1; // 转为0基索引
-    uint16_t end_led = current_effect.end_led - 1;
-    uint8_t brightness = current_effect.brightness;
-    uint16_t duration = current_effect.speed;
-    uint8_t cycles = current_effect.cycles;
+    const led_strip_effect_params_t *effect = &slot->params;
+    uint32_t elapsed_time = current_time - slot->start_time;
+    uint16_t start_led = effect->start_led - 1; // 转为0基索引
+    uint16_t end_led = effect->end_led - 1;
+    uint8_t brightness = effect->brightness;
+    uint16_t duration = effect->speed;
+    uint8_t cycles = effect->cycles;
 
     // 检查是否完成所需循环
     if (cycles > 0)
@@ -234,43 +392,35 @@ static bool update_effect(uint32_t current_time)
         uint32_t total_duration = duration * cycles;
         if (elapsed_time >= total_duration)
         {
-            effect_running = false;
-
-            // 清空所有LED
-            for (uint16_t i = 0; i < led_count; i++)
-            {
-                led_strip_set_pixel(_ledstripRmtHandle, i, 0, 0, 0);
-            }
-            led_strip_refresh(_ledstripRmtHandle);
-
+            // 画面保持清空, 由效果任务写入灯带
             ESP_LOGI(TAG, "Effect completed after %d cycles", cycles);
             return false;
         }
     }
 
     // 提取颜色分量
-    uint8_t r1 = (current_effect.color1 >> 16) & 0xFF;
-    uint8_t g1 = (current_effect.color1 >> 8) & 0xFF;
-    uint8_t b1 = current_effect.color1 & 0xFF;
+    uint8_t r1 = (effect->color1 >> 16) & 0xFF;
+    uint8_t g1 = (effect->color1 >> 8) & 0xFF;
+    uint8_t b1 = effect->color1 & 0xFF;
 
-    uint8_t r2 = (current_effect.color2 >> 16) & 0xFF;
-    uint8_t g2 = (current_effect.color2 >> 8) & 0xFF;
-    uint8_t b2 = current_effect.color2 & 0xFF;
+    uint8_t r2 = (effect->color2 >> 16) & 0xFF;
+    uint8_t g2 = (effect->color2 >> 8) & 0xFF;
+    uint8_t b2 = effect->color2 & 0xFF;
 
     // 亮度调整
     float bright_factor = brightness / 255.0f;
 
     // 根据效果类型更新LED
-    switch (current_effect.effect_type)
+    switch (effect->effect_type)
     {
     case LED_EFFECT_STATIC:
         // 静态颜色显示
         for (uint16_t i = start_led; i <= end_led; i++)
         {
-            led_strip_set_pixel(_ledstripRmtHandle, i,
-                                r1 * bright_factor,
-                                g1 * bright_factor,
-                                b1 * bright_factor);
+            frame_set_pixel(i,
+                            r1 * bright_factor,
+                            g1 * bright_factor,
+                            b1 * bright_factor);
         }
         break;
 
@@ -283,14 +433,14 @@ static bool update_effect(uint32_t current_time)
             {
                 if (on)
                 {
-                    led_strip_set_pixel(_ledstripRmtHandle, i,
-                                        r1 * bright_factor,
-                                        g1 * bright_factor,
-                                        b1 * bright_factor);
+                    frame_set_pixel(i,
+                                    r1 * bright_factor,
+                                    g1 * bright_factor,
+                                    b1 * bright_factor);
                 }
                 else
                 {
-                    led_strip_set_pixel(_ledstripRmtHandle, i, 0, 0, 0);
+                    frame_set_pixel(i, 0, 0, 0);
                 }
             }
         }
@@ -304,10 +454,10 @@ static bool update_effect(uint32_t current_time)
 
             for (uint16_t i = start_led; i <= end_led; i++)
             {
-                led_strip_set_pixel(_ledstripRmtHandle, i,
-                                    r1 * intensity * bright_factor,
-                                    g1 * intensity * bright_factor,
-                                    b1 * intensity * bright_factor);
+                frame_set_pixel(i,
+                                r1 * intensity * bright_factor,
+                                g1 * intensity * bright_factor,
+                                b1 * intensity * bright_factor);
             }
         }
         break;
@@ -369,10 +519,10 @@ static bool update_effect(uint32_t current_time)
                     b = q;
                 }
 
-                led_strip_set_pixel(_ledstripRmtHandle, i,
-                                    r * 255.0f,
-                                    g * 255.0f,
-                                    b * 255.0f);
+                frame_set_pixel(i,
+                                r * 255.0f,
+                                g * 255.0f,
+                                b * 255.0f);
             }
         }
         break;
@@ -387,10 +537,10 @@ static bool update_effect(uint32_t current_time)
             {
                 if (i == start_led + pos)
                 {
-                    led_strip_set_pixel(_ledstripRmtHandle, i,
-                                        r1 * bright_factor,
-                                        g1 * bright_factor,
-                                        b1 * bright_factor);
+                    frame_set_pixel(i,
+                                    r1 * bright_factor,
+                                    g1 * bright_factor,
+                                    b1 * bright_factor);
                 }
                 else
                 {
@@ -402,14 +552,14 @@ static bool update_effect(uint32_t current_time)
                     if (distance <= 5)
                     {
                         float fade = (5 - distance) / 5.0f;
-                        led_strip_set_pixel(_ledstripRmtHandle, i,
-                                            r1 * fade * bright_factor,
-                                            g1 * fade * bright_factor,
-                                            b1 * fade * bright_factor);
+                        frame_set_pixel(i,
+                                        r1 * fade * bright_factor,
+                                        g1 * fade * bright_factor,
+                                        b1 * fade * bright_factor);
                     }
                     else
                     {
-                        led_strip_set_pixel(_ledstripRmtHandle, i, 0, 0, 0);
+                        frame_set_pixel(i, 0, 0, 0);
                     }
                 }
             }
@@ -428,10 +578,10 @@ static bool update_effect(uint32_t current_time)
 
             for (uint16_t i = start_led; i <= end_led; i++)
             {
-                led_strip_set_pixel(_ledstripRmtHandle, i,
-                                    r * bright_factor,
-                                    g * bright_factor,
-                                    b * bright_factor);
+                frame_set_pixel(i,
+                                r * bright_factor,
+                                g * bright_factor,
+                                b * bright_factor);
             }
         }
         break;
@@ -450,7 +600,7 @@ static bool update_effect(uint32_t current_time)
                 uint8_t g = 100 * intensity * rand_val; // 绿色分量随机变化
                 uint8_t b = 0;
 
-                led_strip_set_pixel(_ledstripRmtHandle, i, r, g, b);
+                frame_set_pixel(i, r, g, b);
             }
         }
         break;
@@ -471,10 +621,10 @@ static bool update_effect(uint32_t current_time)
                 float intensity = (sinf(phase * 2 * M_PI) * 0.5f + 0.5f) *
                                   (sinf(phase * 2 * M_PI / wave_width) * 0.5f + 0.5f);
 
-                led_strip_set_pixel(_ledstripRmtHandle, i,
-                                    r1 * intensity * bright_factor,
-                                    g1 * intensity * bright_factor,
-                                    b1 * intensity * bright_factor);
+                frame_set_pixel(i,
+                                r1 * intensity * bright_factor,
+                                g1 * intensity * bright_factor,
+                                b1 * intensity * bright_factor);
             }
         }
         break;
@@ -510,14 +660,14 @@ static bool update_effect(uint32_t current_time)
                 if (rand_val > 0.8f)
                 {
                     float intensity = (rand_val - 0.8f) * 5.0f; // 映射到0-1范围
-                    led_strip_set_pixel(_ledstripRmtHandle, i,
-                                        r * intensity * bright_factor,
-                                        g * intensity * bright_factor,
-                                        b * intensity * bright_factor);
+                    frame_set_pixel(i,
+                                    r * intensity * bright_factor,
+                                    g * intensity * bright_factor,
+                                    b * intensity * bright_factor);
                 }
                 else
                 {
-                    led_strip_set_pixel(_ledstripRmtHandle, i, 0, 0, 0);
+                    frame_set_pixel(i, 0, 0, 0);
                 }
             }
         }
@@ -552,14 +702,14 @@ static bool update_effect(uint32_t current_time)
                 if (rand_val > 0.8f)
                 {
                     float intensity = (rand_val - 0.8f) * 5.0f; // 映射到0-1范围
-                    led_strip_set_pixel(_ledstripRmtHandle, i,
-                                        r * intensity * bright_factor,
-                                        g * intensity * bright_factor,
-                                        b * intensity * bright_factor);
+                    frame_set_pixel(i,
+                                    r * intensity * bright_factor,
+                                    g * intensity * bright_factor,
+                                    b * intensity * bright_factor);
                 }
                 else
                 {
-                    led_strip_set_pixel(_ledstripRmtHandle, i, 0, 0, 0);
+                    frame_set_pixel(i, 0, 0, 0);
                 }
             }
         }
@@ -596,30 +746,94 @@ static bool update_effect(uint32_t current_time)
                 {
                     // 彗星头部最亮，尾部渐暗
                     float intensity = (comet_size - distance) / comet_size;
-                    led_strip_set_pixel(_ledstripRmtHandle, i,
-                                        r1 * intensity * bright_factor,
-                                        g1 * intensity * bright_factor,
-                                        b1 * intensity * bright_factor);
+                    frame_set_pixel(i,
+                                    r1 * intensity * bright_factor,
+                                    g1 * intensity * bright_factor,
+                                    b1 * intensity * bright_factor);
                 }
                 else
                 {
-                    led_strip_set_pixel(_ledstripRmtHandle, i, 0, 0, 0);
+                    frame_set_pixel(i, 0, 0, 0);
                 }
             }
         }
         break;
 
+    case LED_EFFECT_TIMELINE:
+        // 关键帧时间线 - 按经过的时间执行编译后的指令
+        if (!ledStripTimelineRender(effect->timeline, elapsed_time, frame_fill, NULL))
+        {
+            ESP_LOGI(TAG, "Timeline completed");
+            return false;
+        }
+        break;
+
+    case LED_EFFECT_SEQUENCE:
+        // 顺序点亮 - 按经过的时间计算已点亮的灯珠数, 与帧率无关
+        {
+            uint16_t seq_count = end_led - start_led + 1;
+            uint32_t lit_count = elapsed_time * effect->leds_per_sec / 1000.0f + 1;
+            if (lit_count > seq_count)
+            {
+                // 最后一颗灯珠也保持了一个间隔后结束, 画面保持清空
+                ESP_LOGI(TAG, "Sequence completed, %d LEDs", seq_count);
+                return false;
+            }
+            frame_fill(NULL, start_led, lit_count,
+                       r1 * bright_factor,
+                       g1 * bright_factor,
+                       b1 * bright_factor);
+        }
+        break;
+
     default:
         // 未知效果，不做任何处理
         break;
     }
 
-    effect_frame_count++;
+    slot->frame_count++;
     return true;
 }
 
 /**
- * @brief 效果更新任务
+ * @brief 在帧间切换到待切换的参数(需持有效果互斥锁)
+ *        当前效果成为交叉渐变的旧效果, 新参数写入另一个效果槽
+ * @param current_time 当前时间(毫秒)
+ */
+static void switch_effect(uint32_t current_time)
+{
+    effect_slot_t *old_slot = &effect_slot[effect_active];
+    effect_slot_t *new_slot = &effect_slot[!effect_active];
+    led_strip_effect_type_t type = effect_pending_params.effect_type;
+    bool keep_phase = old_slot->running && old_slot->params.effect_type == type &&
+                      type != LED_EFFECT_SEQUENCE && type != LED_EFFECT_TIMELINE;
+
+    memcpy(&new_slot->params, &effect_pending_params, sizeof(led_strip_effect_params_t));
+    if (type == LED_EFFECT_TIMELINE)
+    {
+        memcpy(new_slot->timeline, effect_pending_timeline, sizeof(LedStripTimeline_t));
+        new_slot->params.timeline = new_slot->timeline;
+    }
+    new_slot->start_time = keep_phase ? old_slot->start_time : current_time;
+    new_slot->frame_count = keep_phase ? old_slot->frame_count : 0;
+    new_slot->running = true;
+
+    crossfading = old_slot->running && new_slot->params.crossfade_ms > 0;
+    if (crossfading)
+    {
+        crossfade_start_time = current_time;
+    }
+    else
+    {
+        old_slot->running = false;
+    }
+    effect_active = !effect_active;
+}
+
+/**
+ * @brief 效果更新任务(常驻)
+ *        没有效果时阻塞等待; 参数在帧间切换, 效果各自绘制到画面缓冲区, 交叉渐变时按时间混合两帧后写入灯带
+ *        帧按固定间隔在绝对时间上调度, 落后时跳过错过的帧而不是连续补帧
  */
 static void effect_task(void *arg)
 {
@@ -627,51 +841,149 @@ static void effect_task(void *arg)
 
     TickType_t last_wake_time = xTaskGetTickCount();
     uint32_t current_time;
-    bool running = true;
+    int64_t last_frame_start_time = 0; // 上一帧开始时间, 0表示空闲后的第一帧
+    uint32_t frame_dropped = 0;        // 上一帧之后跳过的帧数
 
-    while (task_running)
+    for (;;)
     {
-        current_time = (uint32_t)xTaskGetTickCount() * portTICK_PERIOD_MS;
-        running = false;
-
-        // 清空所有LED
-        for (uint16_t i = 0; i < led_count; i++)
+        if (!effect_slot[effect_active].running && !effect_pending && !effect_stop_pending)
+        {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY); // 空闲, 等待新效果或停止请求
+            last_wake_time = xTaskGetTickCount();
+            last_frame_start_time = 0;
+        }
+        current_time = effect_time_ms();
+        int64_t frame_start_time = esp_timer_get_time();
+        if (last_frame_start_time != 0)
         {
-            led_strip_set_pixel(_ledstripRmtHandle, i, 0, 0, 0);
+            // 实际帧间隔与计划间隔(包括跳过的帧)的偏差
+            int64_t deviation = frame_start_time - last_frame_start_time -
+                                (int64_t)(frame_dropped + 1) * frame_period_ticks * portTICK_PERIOD_MS * 1000;
+            metricsHistogramRecord(METRICS_HISTOGRAM_EFFECT_JITTER, deviation < 0 ? -deviation : deviation);
         }
+        last_frame_start_time = frame_start_time;
 
-        // 更新效果
+        // 在帧间处理停止请求并切换参数
+        bool stopped = false;
+        int64_t switch_submit_time = 0;
         if (xSemaphoreTake(effect_mutex, portMAX_DELAY) == pdTRUE)
         {
-            if (effect_running && _ledstripRmtHandle != NULL)
+            if (effect_stop_pending)
             {
-                running = update_effect(current_time);
+                effect_stop_pending = false;
+                effect_slot[0].running = false;
+                effect_slot[1].running = false;
+                crossfading = false;
+                stopped = true;
+            }
+            if (effect_pending)
+            {
+                effect_pending = false;
+                switch_submit_time = effect_pending_time;
+                switch_effect(current_time);
             }
             xSemaphoreGive(effect_mutex);
         }
 
-        // 刷新LED灯带
-        if (_ledstripRmtHandle != NULL)
+        // 更新效果
+        int64_t render_start_time = esp_timer_get_time();
+        effect_slot_t *slot = &effect_slot[effect_active];
+        bool drawing = slot->running || crossfading;
+        bool completed = false;
+        render_buf = frame_buf[effect_active];
+        memset(render_buf, 0, led_count * 3);
+        if (slot->running && !update_effect(slot, current_time))
+        {
+            slot->running = false;
+            completed = true;
+        }
+        uint32_t alpha = 256; // 新效果所占的比例(1/256)
+        if (crossfading)
+        {
+            effect_slot_t *old_slot = &effect_slot[!effect_active];
+            uint32_t fade_elapsed = current_time - crossfade_start_time;
+            if (fade_elapsed >= slot->params.crossfade_ms)
+            {
+                crossfading = false;
+                old_slot->running = false;
+            }
+            else
+            {
+                render_buf = frame_buf[!effect_active];
+                memset(render_buf, 0, led_count * 3);
+                if (!update_effect(old_slot, current_time))
+                {
+                    old_slot->running = false; // 旧效果已结束, 继续从熄灭渐变到新效果
+                }
+                alpha = fade_elapsed * 256 / slot->params.crossfade_ms;
+            }
+        }
+
+        // 写入灯带: 效果拥有整条灯带, 每帧写入全部灯珠; 结束或停止时写入一帧熄灭
+        if (drawing || stopped)
+        {
+            metricsHistogramRecord(METRICS_HISTOGRAM_EFFECT_RENDER, esp_timer_get_time() - render_start_time);
+            const uint8_t *new_frame = frame_buf[effect_active];
+            const uint8_t *old_frame = frame_buf[!effect_active];
+            for (uint16_t i = 0; i < led_count; i++)
+            {
+                const uint8_t *p = new_frame + i * 3;
+                if (alpha < 256)
+                {
+                    const uint8_t *q = old_frame + i * 3;
+                    led_strip_set_pixel(_ledstripRmtHandle, i,
+                                        (p[0] * alpha + q[0] * (256 - alpha)) >> 8,
+                                        (p[1] * alpha + q[1] * (256 - alpha)) >> 8,
+                                        (p[2] * alpha + q[2] * (256 - alpha)) >> 8);
+                }
+                else
+                {
+                    led_strip_set_pixel(_ledstripRmtHandle, i, p[0], p[1], p[2]);
+                }
+            }
+            LEDSTRIP_REFRESH; // 交给渲染任务发送, 不阻塞下一帧的计算
+            metricsHistogramRecord(METRICS_HISTOGRAM_EFFECT_FRAME_TIME, esp_timer_get_time() - frame_start_time);
+        }
+        if (switch_submit_time != 0)
         {
-            led_strip_refresh(_ledstripRmtHandle);
+            metricsHistogramRecord(METRICS_HISTOGRAM_EFFECT_SWITCH, esp_timer_get_time() - switch_submit_time);
         }
 
-        // 如果没有运行的效果和处理中的效果，退出任务
-        if (!running && xSemaphoreTake(effect_mutex, portMAX_DELAY) == pdTRUE)
+        // 效果按设定完成: 没有新的效果在等待切换时执行结束回调
+        led_strip_effect_end_cb_t end_cb = NULL;
+        if (completed && xSemaphoreTake(effect_mutex, portMAX_DELAY) == pdTRUE)
         {
-            if (!effect_running)
+            if (!effect_pending)
             {
-                task_running = false;
+                effect_running = false;
+                end_cb = take_end_cb();
             }
             xSemaphoreGive(effect_mutex);
         }
+        if (end_cb != NULL)
+        {
+            end_cb(true);
+        }
+        if (stopped)
+        {
+            xSemaphoreGive(effect_idle_sem);
+        }
 
         // 定时等待，确保一致的更新频率
-        vTaskDelayUntil(&last_wake_time, pdMS_TO_TICKS(EFFECT_UPDATE_INTERVAL_MS));
+        // 已错过下一帧的计划时间时跳到下一个未到的帧, 效果按时间计算画面, 跳帧不影响动画速度
+        frame_dropped = 0;
+        if (effect_slot[effect_active].running || crossfading)
+        {
+            TickType_t behind = xTaskGetTickCount() - last_wake_time;
+            if (behind >= frame_period_ticks)
+            {
+                frame_dropped = behind / frame_period_ticks;
+                last_wake_time += frame_dropped * frame_period_ticks;
+                metricsCounterAdd(METRICS_COUNTER_EFFECT_FRAME_DROP, frame_dropped);
+            }
+            vTaskDelayUntil(&last_wake_time, frame_period_ticks);
+        }
     }
-    ESP_LOGI(TAG, "Effect task stopped");
-    effect_task_handle = NULL;
-    vTaskDelete(NULL);
 }
 
 /**
@@ -735,6 +1047,22 @@ esp_err_t ledEffect(cJSON *data)
         params.speed = 1000; // 默认1秒
     }
 
+    cJSON *leds_per_sec_json = getJSONobj(data, "leds_per_sec");
+    if (leds_per_sec_json != NULL)
+    {
+        params.leds_per_sec = (float)cJSON_GetNumberValue(leds_per_sec_json);
+    }
+    else
+    {
+        params.leds_per_sec = LED_SEQUENCE_DEFAULT_LEDS_PER_SEC;
+    }
+
+    cJSON *crossfade_json = getJSONobj(data, "crossfade_ms");
+    if (crossfade_json != NULL)
+    {
+        params.crossfade_ms = (uint16_t)cJSON_GetNumberValue(crossfade_json);
+    }
+
     cJSON *cycles_json = getJSONobj(data, "cycles");
     if (cycles_json != NULL)
     {
@@ -759,8 +1087,94 @@ esp_err_t ledEffect(cJSON *data)
     return ESP_OK;
 }
 
+/**
+ * @brief  上传并执行关键帧时间线, 编译后立即返回, 由效果任务按时间执行
+ *         {"loop":播放次数(0无限),"brightness":亮度,"keyframes":[[开始ms,持续ms,起始灯珠,结尾灯珠,颜色,效果,缓动(,闪烁周期ms)],..]}
+ * @param  data
+ * @return esp_err_t
+ */
+esp_err_t ledTimeline(cJSON *data)
+{
+    cJSON *_keyframesJson = getJSONobj(data, "keyframes");
+    cJSON *_loopJson = getJSONobj(data, "loop");
+    cJSON *_brightnessJson = getJSONobj(data, "brightness");
+    if (!cJSON_IsArray(_keyframesJson))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    size_t _keyframeNum = cJSON_GetArraySize(_keyframesJson);
+    if (_keyframeNum == 0 || _keyframeNum > LEDSTRIP_TIMELINE_MAX_KEYFRAMES)
+    {
+        ESP_LOGE(TAG, "Timeline keyframe number %d out of range (max %d)", _keyframeNum, LEDSTRIP_TIMELINE_MAX_KEYFRAMES);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    initialize_manager();
+    if (led_count == 0)
+    {
+        return ESP_FAIL;
+    }
+    LedStripKeyframe_t *_keyframe = heap_caps_calloc(_keyframeNum, sizeof(LedStripKeyframe_t), MALLOC_CAP_SPIRAM);
+    LedStripTimeline_t *_timeline = heap_caps_malloc(sizeof(LedStripTimeline_t), MALLOC_CAP_SPIRAM);
+    esp_err_t err = ESP_OK;
+    if (_keyframe == NULL || _timeline == NULL)
+    {
+        err = ESP_ERR_NO_MEM;
+        goto out;
+    }
+    size_t i = 0;
+    cJSON *_item = NULL;
+    cJSON_ArrayForEach(_item, _keyframesJson)
+    {
+        int _size = cJSON_GetArraySize(_item);
+        if (!cJSON_IsArray(_item) || _size < 7)
+        {
+            ESP_LOGE(TAG, "Timeline keyframe %d format error", i);
+            err = ESP_ERR_INVALID_ARG;
+            goto out;
+        }
+        _keyframe[i].atMs = cJSON_GetNumberValue(cJSON_GetArrayItem(_item, 0));
+        _keyframe[i].durationMs = cJSON_GetNumberValue(cJSON_GetArrayItem(_item, 1));
+        _keyframe[i].startLed = cJSON_GetNumberValue(cJSON_GetArrayItem(_item, 2));
+        _keyframe[i].endLed = cJSON_GetNumberValue(cJSON_GetArrayItem(_item, 3));
+        _keyframe[i].color = cJSON_GetNumberValue(cJSON_GetArrayItem(_item, 4));
+        _keyframe[i].effect = cJSON_GetNumberValue(cJSON_GetArrayItem(_item, 5));
+        _keyframe[i].easing = cJSON_GetNumberValue(cJSON_GetArrayItem(_item, 6));
+        _keyframe[i].periodMs = _size > 7 ? cJSON_GetNumberValue(cJSON_GetArrayItem(_item, 7)) : 0;
+        i++;
+    }
+    size_t _errIndex = 0;
+    LedStripTimelineResult_t _result = ledStripTimelineCompile(_keyframe, _keyframeNum, led_count,
+                                                               _brightnessJson ? cJSON_GetNumberValue(_brightnessJson) : 255,
+                                                               _loopJson ? cJSON_GetNumberValue(_loopJson) : 1,
+                                                               _timeline, &_errIndex);
+    if (_result != LEDSTRIP_TIMELINE_OK)
+    {
+        ESP_LOGE(TAG, "Timeline keyframe %d invalid [%d]", _errIndex, _result);
+        err = ESP_ERR_INVALID_ARG;
+        goto out;
+    }
+    led_strip_effect_params_t _params = {
+        .effect_type = LED_EFFECT_TIMELINE,
+        .start_led = 1,
+        .end_led = led_count,
+        .brightness = 255,
+        .timeline = _timeline,
+    };
+    err = led_strip_effect_run(&_params);
+    if (err == ESP_OK)
+    {
+        ESP_LOGI(TAG, "Timeline started, %d keyframes, %lu ms x %d", _timeline->instrNum, _timeline->lengthMs, _timeline->loop);
+    }
+out:
+    free(_keyframe);
+    free(_timeline);
+    return err;
+}
+
 /**
  * @brief  灯珠顺序跑马 携带颜色和亮度
+ *         由效果任务按时间渲染, 立即返回; 任何新的灯带命令都会停止跑马
+ *         速度: leds_per_sec(灯珠/秒), 未指定时按 delay(毫秒/灯珠) 换算, 两者都为0时使用默认速度
  * @param  data
  * @return esp_err_t
  */
@@ -771,43 +1185,36 @@ esp_err_t ledSequenceWithColorAndBrigh(cJSON *data)
     cJSON *_colorJson = getJSONobj(data, "color");
     cJSON *_brightnessJson = getJSONobj(data, "brightness");
     cJSON *_delayJson = getJSONobj(data, "delay");
-    if (_startLedJson == NULL || _endLedJson == NULL || _colorJson == NULL || _brightnessJson == NULL || _delayJson == NULL)
+    cJSON *_ledsPerSecJson = getJSONobj(data, "leds_per_sec");
+    if (_startLedJson == NULL || _endLedJson == NULL || _colorJson == NULL || _brightnessJson == NULL || (_delayJson == NULL && _ledsPerSecJson == NULL))
     {
         return ESP_FAIL;
     }
-    uint16_t _startLed = cJSON_GetNumberValue(_startLedJson);
-    uint16_t _endLed = cJSON_GetNumberValue(_endLedJson);
     uint32_t _color = cJSON_GetNumberValue(_colorJson);
     uint16_t _brightness = cJSON_GetNumberValue(_brightnessJson);
-    uint32_t _delay = cJSON_GetNumberValue(_delayJson);
-    uint8_t _red = ((_color >> 16) & 0XFF);
-    uint8_t _green = ((_color >> 8) & 0XFF);
-    uint8_t _blue = (_color & 0XFF);
-    float hue;          // hue (0 - 360)
-    uint8_t saturation; // saturation (0 - 255)
-    uint8_t value;      // value (0 - 255)
-    RGB8882HSV(_red, _green, _blue, &hue, &saturation, &value);
-    value = _brightness;
-    LEDSTRIP_CLEAR;
-    if (_delay == 0)
+    led_strip_effect_params_t _params = {
+        .effect_type = LED_EFFECT_SEQUENCE,
+        .start_led = cJSON_GetNumberValue(_startLedJson),
+        .end_led = cJSON_GetNumberValue(_endLedJson),
+        .brightness = 255, // 颜色已按亮度换算
+        .color1 = ledStripColorScale(_color, _brightness),
+        .leds_per_sec = LED_SEQUENCE_DEFAULT_LEDS_PER_SEC,
+    };
+    if (_ledsPerSecJson != NULL && cJSON_GetNumberValue(_ledsPerSecJson) > 0)
     {
-        for (size_t i = _startLed; i <= _endLed; i++)
-        {
-            led_strip_set_pixel_hsv(g_ledstripRmtHandle, i - 1, hue, saturation, value);
-            LEDSTRIP_REFRESH;
-        }
+        _params.leds_per_sec = cJSON_GetNumberValue(_ledsPerSecJson);
     }
-    else
+    else if (_delayJson != NULL && cJSON_GetNumberValue(_delayJson) > 0)
     {
-        for (size_t i = _startLed; i <= _endLed; i++)
-        {
-            led_strip_set_pixel_hsv(g_ledstripRmtHandle, i - 1, hue, saturation, value);
-            LEDSTRIP_REFRESH;
-            vTaskDelay(pdMS_TO_TICKS(_delay));
-        }
+        _params.leds_per_sec = 1000.0f / cJSON_GetNumberValue(_delayJson);
+    }
+    esp_err_t err = led_strip_effect_check(&_params); // 范围无效时保留灯带当前显示
+    if (err != ESP_OK)
+    {
+        return err;
     }
     LEDSTRIP_CLEAR;
-    return ESP_OK;
+    return led_strip_effect_run(&_params);
 }
 
 /**
@@ -829,18 +1236,11 @@ esp_err_t ledLightUpWithColorAndBrigh(cJSON *data)
     uint16_t _endLed = cJSON_GetNumberValue(_endLedJson);
     uint32_t _color = cJSON_GetNumberValue(_colorJson);
     uint16_t _brightness = cJSON_GetNumberValue(_brightnessJson);
-    uint8_t _red = ((_color >> 16) & 0XFF);
-    uint8_t _green = ((_color >> 8) & 0XFF);
-    uint8_t _blue = (_color & 0XFF);
-    float hue;          // hue (0 - 360)
-    uint8_t saturation; // saturation (0 - 255)
-    uint8_t value;      // value (0 - 255)
-    RGB8882HSV(_red, _green, _blue, &hue, &saturation, &value);
-    value = _brightness;
+    _color = ledStripColorScale(_color, _brightness);
     LEDSTRIP_CLEAR;
     for (size_t i = _startLed; i <= _endLed; i++)
     {
-        led_strip_set_pixel_hsv(g_ledstripRmtHandle, i - 1, hue, saturation, value);
+        led_strip_set_pixel(g_ledstripRmtHandle, i - 1, LEDSTRIP_COLOR_RED(_color), LEDSTRIP_COLOR_GREEN(_color), LEDSTRIP_COLOR_BLUE(_color));
     }
     LEDSTRIP_REFRESH;
     return ESP_OK;
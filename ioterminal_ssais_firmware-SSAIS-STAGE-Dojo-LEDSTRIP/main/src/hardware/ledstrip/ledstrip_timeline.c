@@ -0,0 +1,216 @@
+/**
+ * @file ledstrip_timeline.c
+ * @brief 灯带关键帧时间线: 上传的关键帧编译为按时间排序的指令, 由灯效帧循环按经过的时间执行
+ *        只使用整数运算, 同一时刻的输出在设备与主机上完全一致
+ * @version 1.0
+ * @date 2024-07-22
+ *
+ * @copyright Copyright (c) 2024  雅马哈发动机（厦门）信息系统有限公司
+ *
+ */
+#include <string.h>
+#include "ledstrip_color.h"
+#include "ledstrip_timeline.h"
+
+#define LEDSTRIP_TIMELINE_PROGRESS_MAX 65535 // 进度满量程
+
+/**
+ * @brief  按亮度缩放颜色分量(保留关键帧之间的明暗差异)
+ * @param  rgb          输出 R,G,B
+ * @param  color        0xRRGGBB
+ * @param  brightness   0-255
+ */
+static void timelineColorScale(uint8_t *rgb, uint32_t color, uint8_t brightness)
+{
+    rgb[0] = (LEDSTRIP_COLOR_RED(color) * brightness + 127) / 255;
+    rgb[1] = (LEDSTRIP_COLOR_GREEN(color) * brightness + 127) / 255;
+    rgb[2] = (LEDSTRIP_COLOR_BLUE(color) * brightness + 127) / 255;
+}
+
+/**
+ * @brief  计算缓动后的进度
+ * @param  easing
+ * @param  progress     0-65535
+ * @return uint32_t     0-65535
+ */
+static uint32_t timelineEase(uint8_t easing, uint32_t progress)
+{
+    uint32_t _rest = LEDSTRIP_TIMELINE_PROGRESS_MAX - progress;
+    switch (easing)
+    {
+    case LEDSTRIP_TIMELINE_EASING_IN:
+        return progress * progress / LEDSTRIP_TIMELINE_PROGRESS_MAX;
+    case LEDSTRIP_TIMELINE_EASING_OUT:
+        return LEDSTRIP_TIMELINE_PROGRESS_MAX - _rest * _rest / LEDSTRIP_TIMELINE_PROGRESS_MAX;
+    case LEDSTRIP_TIMELINE_EASING_IN_OUT:
+        if (progress < (LEDSTRIP_TIMELINE_PROGRESS_MAX + 1) / 2)
+        {
+            return 2 * progress * progress / LEDSTRIP_TIMELINE_PROGRESS_MAX;
+        }
+        return LEDSTRIP_TIMELINE_PROGRESS_MAX - 2 * _rest * _rest / LEDSTRIP_TIMELINE_PROGRESS_MAX;
+    default:
+        return progress;
+    }
+}
+
+/**
+ * @brief  编译关键帧: 校验参数, 换算颜色, 按开始时间稳定排序, 并确定渐变的起始颜色
+ * @param  keyframe     关键帧
+ * @param  keyframeNum  关键帧数量
+ * @param  ledNum       灯珠总数
+ * @param  brightness   整体亮度 0-255
+ * @param  loop         播放次数, 0表示无限循环
+ * @param  timeline     编译结果
+ * @param  errIndex     出错的关键帧序号(可为NULL)
+ * @return LedStripTimelineResult_t
+ */
+LedStripTimelineResult_t ledStripTimelineCompile(const LedStripKeyframe_t *keyframe, size_t keyframeNum, uint16_t ledNum,
+                                                 uint8_t brightness, uint8_t loop, LedStripTimeline_t *timeline, size_t *errIndex)
+{
+    if (errIndex != NULL)
+    {
+        *errIndex = 0;
+    }
+    if (keyframe == NULL || keyframeNum == 0 || keyframeNum > LEDSTRIP_TIMELINE_MAX_KEYFRAMES)
+    {
+        return LEDSTRIP_TIMELINE_ERR_SIZE;
+    }
+    memset(timeline, 0, sizeof(LedStripTimeline_t));
+    for (size_t i = 0; i < keyframeNum; i++)
+    {
+        const LedStripKeyframe_t *_keyframe = &keyframe[i];
+        LedStripTimelineResult_t _result = LEDSTRIP_TIMELINE_OK;
+        if (_keyframe->startLed == 0 || _keyframe->startLed > _keyframe->endLed || _keyframe->endLed > ledNum)
+        {
+            _result = LEDSTRIP_TIMELINE_ERR_RANGE;
+        }
+        else if (_keyframe->effect >= LEDSTRIP_TIMELINE_EFFECT_MAX || _keyframe->easing >= LEDSTRIP_TIMELINE_EASING_MAX)
+        {
+            _result = LEDSTRIP_TIMELINE_ERR_EFFECT;
+        }
+        else if (_keyframe->durationMs == 0 || _keyframe->atMs > UINT32_MAX - _keyframe->durationMs)
+        {
+            _result = LEDSTRIP_TIMELINE_ERR_DURATION;
+        }
+        if (_result != LEDSTRIP_TIMELINE_OK)
+        {
+            if (errIndex != NULL)
+            {
+                *errIndex = i;
+            }
+            return _result;
+        }
+
+        // 插入排序, 开始时间相同的保持上传顺序(后面的覆盖前面的)
+        LedStripTimelineInstr_t _instr = {
+            .startMs = _keyframe->atMs,
+            .endMs = _keyframe->atMs + _keyframe->durationMs,
+            .index = _keyframe->startLed - 1,
+            .count = _keyframe->endLed - _keyframe->startLed + 1,
+            .periodMs = _keyframe->periodMs ? _keyframe->periodMs : LEDSTRIP_TIMELINE_DEFAULT_BLINK_PERIOD,
+            .effect = _keyframe->effect,
+            .easing = _keyframe->easing,
+        };
+        timelineColorScale(_instr.to, _keyframe->color, brightness);
+        size_t _pos = timeline->instrNum;
+        while (_pos > 0 && timeline->instr[_pos - 1].startMs > _instr.startMs)
+        {
+            timeline->instr[_pos] = timeline->instr[_pos - 1];
+            _pos--;
+        }
+        timeline->instr[_pos] = _instr;
+        timeline->instrNum++;
+        if (_instr.endMs > timeline->lengthMs)
+        {
+            timeline->lengthMs = _instr.endMs;
+        }
+    }
+
+    // 渐变从同一段(灯珠范围相同)前一个关键帧的颜色开始
+    for (size_t i = 0; i < timeline->instrNum; i++)
+    {
+        LedStripTimelineInstr_t *_instr = &timeline->instr[i];
+        if (_instr->effect != LEDSTRIP_TIMELINE_EFFECT_FADE)
+        {
+            continue;
+        }
+        for (size_t j = i; j > 0; j--)
+        {
+            const LedStripTimelineInstr_t *_prev = &timeline->instr[j - 1];
+            if (_prev->index == _instr->index && _prev->count == _instr->count)
+            {
+                memcpy(_instr->from, _prev->to, sizeof(_instr->from));
+                break;
+            }
+        }
+    }
+    timeline->loop = loop;
+    return LEDSTRIP_TIMELINE_OK;
+}
+
+/**
+ * @brief  渲染某一时刻的画面: 按顺序执行当前时刻有效的指令, 后面的指令覆盖前面的
+ *         不在任何关键帧内的灯珠不写入(由调用者在每帧开始时清空)
+ * @param  timeline
+ * @param  elapsedMs    从时间线开始经过的时间(毫秒)
+ * @param  fill         写入一段灯珠
+ * @param  ctx          fill的参数
+ * @return true 时间线仍在播放; false 已播放完设定的次数
+ */
+bool ledStripTimelineRender(const LedStripTimeline_t *timeline, uint32_t elapsedMs, LedStripTimelineFill_t fill, void *ctx)
+{
+    if (timeline->instrNum == 0 || timeline->lengthMs == 0)
+    {
+        return false;
+    }
+    if (timeline->loop > 0 && elapsedMs / timeline->lengthMs >= timeline->loop)
+    {
+        return false;
+    }
+    uint32_t _time = elapsedMs % timeline->lengthMs;
+    for (size_t i = 0; i < timeline->instrNum; i++)
+    {
+        const LedStripTimelineInstr_t *_instr = &timeline->instr[i];
+        if (_instr->startMs > _time)
+        {
+            break; // 按开始时间排序, 之后的指令都未开始
+        }
+        if (_time >= _instr->endMs)
+        {
+            continue;
+        }
+        uint32_t _offset = _time - _instr->startMs;
+        uint32_t _progress = (uint64_t)_offset * LEDSTRIP_TIMELINE_PROGRESS_MAX / (_instr->endMs - _instr->startMs);
+        uint32_t _eased = timelineEase(_instr->easing, _progress);
+        switch (_instr->effect)
+        {
+        case LEDSTRIP_TIMELINE_EFFECT_FADE:
+        {
+            uint8_t _rgb[3];
+            for (size_t c = 0; c < 3; c++)
+            {
+                int32_t _delta = (int32_t)_instr->to[c] - (int32_t)_instr->from[c];
+                _rgb[c] = _instr->from[c] + _delta * (int32_t)_eased / LEDSTRIP_TIMELINE_PROGRESS_MAX;
+            }
+            fill(ctx, _instr->index, _instr->count, _rgb[0], _rgb[1], _rgb[2]);
+            break;
+        }
+        case LEDSTRIP_TIMELINE_EFFECT_WIPE:
+        {
+            uint16_t _litCount = 1 + (uint32_t)(_instr->count - 1) * _eased / LEDSTRIP_TIMELINE_PROGRESS_MAX;
+            fill(ctx, _instr->index, _litCount, _instr->to[0], _instr->to[1], _instr->to[2]);
+            break;
+        }
+        case LEDSTRIP_TIMELINE_EFFECT_BLINK:
+            if (_offset % _instr->periodMs < _instr->periodMs / 2)
+            {
+                fill(ctx, _instr->index, _instr->count, _instr->to[0], _instr->to[1], _instr->to[2]);
+            }
+            break;
+        default:
+            fill(ctx, _instr->index, _instr->count, _instr->to[0], _instr->to[1], _instr->to[2]);
+            break;
+        }
+    }
+    return true;
+}
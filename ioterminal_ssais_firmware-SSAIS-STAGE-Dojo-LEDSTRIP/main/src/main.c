@@ -20,6 +20,7 @@ void app_main(void)
     ESP_LOGI(TAG, "Build timestamp: %s %s", getCompiledDate(), __TIME__);
     g_sysStateInfo.bootFreeHeapSize = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
     ESP_LOGI(TAG, "system boot completed free heap size: %ld bytes", g_sysStateInfo.bootFreeHeapSize);
+    ESP_ERROR_CHECK_WITHOUT_ABORT(trace_init()); // 事件跟踪环形缓冲区
     static uint8_t staMac[6] = {0};
     ESP_ERROR_CHECK(esp_efuse_mac_get_default(staMac));
     sprintf(g_sysStateInfo.staMac, "%02x:%02x:%02x:%02x:%02x:%02x", staMac[0], staMac[1], staMac[2], staMac[3], staMac[4], staMac[5]);
@@ -49,7 +50,9 @@ void app_main(void)
 
     ESP_LOGI(TAG, "--------------------------Init MQTT---------------------------");
     g_mqttRecvDataQueueHandler = xQueueCreateWithCaps(MQTT_RECEIVE_QUEUE_LEN, sizeof(MqttReceiveData_t), MALLOC_CAP_SPIRAM);
-    g_mqttPubDataQueueHandler = xQueueCreateWithCaps(MQTT_PUBISH_QUEUE_LEN, sizeof(MqttPublishData_t), MALLOC_CAP_SPIRAM);
+    g_mqttPubRingHandle[MQTT_PUB_LANE_CRITICAL] = xRingbufferCreateWithCaps(CONFIG_MQTT_STORE_FORWARD_BYTES, RINGBUF_TYPE_NOSPLIT, MALLOC_CAP_SPIRAM);
+    g_mqttPubRingHandle[MQTT_PUB_LANE_BEST_EFFORT] = xRingbufferCreateWithCaps(MQTT_PUBLISH_BEST_EFFORT_RING_SIZE, RINGBUF_TYPE_NOSPLIT, MALLOC_CAP_SPIRAM);
+    mqttJournalInit(); // 恢复上次运行中未确认的关键消息
     mqttDefaultTopicPubStrMsg(MQTT_CONTROL_TYPE_SYSTEM_REBOOT, NOTIFY_SYSTEM_REBOOT, "version", FIRMWARE_VERSION);
     xTaskCreate(mqttTask, "mqttTask", 16384, NULL, MQTT_TASK_PRIVILEGE | portPRIVILEGE_BIT, NULL);
 
@@ -71,6 +74,7 @@ void app_main(void)
         g_ledstripRmtHandle = LedStripInit(g_nvsData.DeviceConfigData.ledstripConfigData);
         LEDSTRIP_CLEAR; // 带电复位的情况下，清除残留的灯珠
         LEDSTRIP_REFRESH;
+        xTaskCreate(ledStripRenderTask, "ledstripRender", 4096, NULL, LEDSTRIP_RENDER_TASK_PRIVILEGE | portPRIVILEGE_BIT, NULL);
     }
 
     ESP_LOGI(TAG, "--------------------------Init OTA---------------------------");
@@ -79,6 +83,7 @@ void app_main(void)
     xTaskCreate(otaTask, "otaTask", 8192, NULL, OTA_TASK_PRIVILEGE | portPRIVILEGE_BIT, NULL);
 
     ESP_LOGI(TAG, "--------------------------Init BUSINESS-------------------------");
+    ESP_ERROR_CHECK(ledStripOrderTableInit());
     if (g_nvsData.DeviceConfigData.ledstripConfigData.ledstripEnabled)
     {
         g_ledStripBoxDataQueueHandler = xQueueCreateWithCaps(LED_STRIP_INDICATION_MAX_ORDER_BOX_SIZE, sizeof(BoxData_t), MALLOC_CAP_SPIRAM);
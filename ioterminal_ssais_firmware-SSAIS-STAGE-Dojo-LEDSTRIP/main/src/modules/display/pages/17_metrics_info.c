@@ -0,0 +1,31 @@
+/**
+ * @file 17_metrics_info.c
+ * @brief 运行指标界面处理
+ * @version 1.0
+ * @date 2024-06-05
+ *
+ * @copyright Copyright (c) 2024  雅马哈发动机（厦门）信息系统有限公司
+ *
+ */
+#include "screen.h"
+
+/**
+ * @brief  运行指标界面处理
+ * @param  controlId
+ * @param  param
+ * @param  size
+ * @return esp_err_t
+ */
+esp_err_t metricsInfoHandle(uint16_t controlId, uint8_t param[256], uint16_t size)
+{
+    switch (controlId)
+    {
+    case SCREEN_METRICS_RESET_BUTTON:
+        metricsWindowSwap(NULL);
+        screenInfoUpdate(SCREEN_METRICS_INFO_PAGE);
+        break;
+    default:
+        break;
+    }
+    return ESP_OK;
+}
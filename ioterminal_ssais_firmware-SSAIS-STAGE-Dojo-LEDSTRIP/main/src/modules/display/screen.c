@@ -27,6 +27,7 @@ static screen_page_handle_t sysSetPageHandle[SCREEN_SET_PAGE_MAX] = {
     [SCREEN_SSAIS_LEDSTRIP_SET_PAGE] = {.screenId = SCREEN_SSAIS_LEDSTRIP_SET_PAGE, .screen_page_handle = ssaisLedstripHandle},
     [SCREEN_MESSAGE_DIALOG_PAGE] = {.screenId = SCREEN_MESSAGE_DIALOG_PAGE, .screen_page_handle = messageDialogHandle},
     [SCREEN_CHECK_DIALOG_PAGE] = {.screenId = SCREEN_CHECK_DIALOG_PAGE, .screen_page_handle = checkDialogHandle},
+    [SCREEN_METRICS_INFO_PAGE] = {.screenId = SCREEN_METRICS_INFO_PAGE, .screen_page_handle = metricsInfoHandle},
 };
 
 /**
@@ -163,6 +164,35 @@ void screenInfoUpdate(uint16_t screenId)
         SetTextNumValue(SCREEN_SSAIS_LEDSTRIP_SET_PAGE, RED_ALARM_LED_ASSOCIATED_RGB_TEXT, g_nvsData.projectConfigData.ledStripIndicationConfigData.colorRed);
         SetTextNumValue(SCREEN_SSAIS_LEDSTRIP_SET_PAGE, BLUE_ALARM_LED_ASSOCIATED_RGB_TEXT, g_nvsData.projectConfigData.ledStripIndicationConfigData.colorBlue);
         break;
+    case SCREEN_METRICS_INFO_PAGE:
+    {
+        static const uint16_t s_gaugeTextId[METRICS_GAUGE_MAX] = {
+            [METRICS_GAUGE_MQTT_RECV_QUEUE] = SCREEN_METRICS_RECV_QUEUE_TEXT,
+            [METRICS_GAUGE_MQTT_PUB_QUEUE] = SCREEN_METRICS_PUB_QUEUE_TEXT,
+            [METRICS_GAUGE_BOX_DATA_QUEUE] = SCREEN_METRICS_BOX_QUEUE_TEXT,
+            [METRICS_GAUGE_SCREEN_RING] = SCREEN_METRICS_SCREEN_RING_TEXT,
+        };
+        char metricsStr[48] = {0};
+        const MetricsWindow_t *_window = metricsWindowCurrent();
+        for (size_t i = 0; i < METRICS_GAUGE_MAX; i++)
+        {
+            if (s_gaugeTextId[i] == 0) // 画面上没有对应控件
+            {
+                continue;
+            }
+            sprintf(metricsStr, "%lu / %lu", g_metricsRegistry.gauge[i], _window->highWater[i]);
+            SetTextValue(SCREEN_METRICS_INFO_PAGE, s_gaugeTextId[i], (uint8_t *)metricsStr);
+        }
+        sprintf(metricsStr, "%lu / %lu / %lu", g_metricsRegistry.counter[METRICS_COUNTER_MQTT_CMD_OK], g_metricsRegistry.counter[METRICS_COUNTER_MQTT_CMD_FAILED], g_metricsRegistry.counter[METRICS_COUNTER_MQTT_RECV_DROPPED]);
+        SetTextValue(SCREEN_METRICS_INFO_PAGE, SCREEN_METRICS_CMD_TEXT, (uint8_t *)metricsStr);
+        sprintf(metricsStr, "%lu / %lu us", metricsHistogramPercentile(&_window->histogram[METRICS_HISTOGRAM_MQTT_CMD_LATENCY], 50), metricsHistogramPercentile(&_window->histogram[METRICS_HISTOGRAM_MQTT_CMD_LATENCY], 99));
+        SetTextValue(SCREEN_METRICS_INFO_PAGE, SCREEN_METRICS_CMD_LATENCY_TEXT, (uint8_t *)metricsStr);
+        sprintf(metricsStr, "%lu / %lu us", metricsHistogramPercentile(&_window->histogram[METRICS_HISTOGRAM_EFFECT_FRAME_TIME], 50), metricsHistogramPercentile(&_window->histogram[METRICS_HISTOGRAM_EFFECT_FRAME_TIME], 99));
+        SetTextValue(SCREEN_METRICS_INFO_PAGE, SCREEN_METRICS_FRAME_TIME_TEXT, (uint8_t *)metricsStr);
+        sprintf(metricsStr, "%u / %u KB", heap_caps_get_free_size(MALLOC_CAP_INTERNAL) / 1024, heap_caps_get_free_size(MALLOC_CAP_SPIRAM) / 1024);
+        SetTextValue(SCREEN_METRICS_INFO_PAGE, SCREEN_METRICS_HEAP_TEXT, (uint8_t *)metricsStr);
+        break;
+    }
     default:
         break;
     }
@@ -250,6 +280,7 @@ esp_err_t screenCmdRecvHandle(PCTRL_MSG msg, uint16_t size)
         {
             if (screenId == sysSetPageHandle[i].screenId)
             {
+                TRACE_EMIT(TRACE_EVENT_SCREEN_TOUCH, screenId, controlId);
                 return sysSetPageHandle[i].screen_page_handle(controlId, msg->param, paramLen);
             }
         }
@@ -0,0 +1,424 @@
+/**
+ * @file journal_crash_check.c
+ * @brief 消息日志的主机掉电测试: 日志区由文件模拟(NOR Flash语义), 在每一次写入与擦除时注入掉电, 重启后检查重放结果
+ *
+ * 编译运行(在工程目录下):
+ *     gcc -O2 -Icomponents/journal tools/journal_crash_check.c components/journal/journal.c -o /tmp/journal_crash_check
+ *     /tmp/journal_crash_check [日志文件=/tmp/journal_crash_check.bin] [-v]
+ *
+ * 工作负载与设备上的MQTT任务相同: 追加关键消息、按周期刷新、收到PUBACK后按顺序确认(journal_trim)。
+ * 先完整运行一次统计写入与擦除的次数, 然后对每一次操作分别注入几种掉电方式:
+ *     写入: 未写入 / 写入一半 / 只差最后一字节 / 写入一半且下一字节部分编程 / 全部写入但未返回
+ *     擦除: 未擦除 / 擦除一半 / 擦除一半且其余字节部分擦除 / 全部擦除但未返回
+ * 掉电后的操作全部失败; 重启(journal_open)后检查:
+ *     已写入Flash且未确认的记录全部重放, 重放按序号递增, 内容与追加时一致, 新记录的序号不与已写入的记录重复;
+ * 然后继续运行一段工作负载, 每轮之后重启检查, 确认恢复后的写入位置可用。
+ * 已确认的记录允许再次重放(至少一次)。有错误时输出掉电位置并返回1; -v 时输出每个掉电位置的结果。
+ */
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "journal.h"
+
+#define CHECK_SECTOR_NUM 4
+#define CHECK_FLASH_SIZE (CHECK_SECTOR_NUM * JOURNAL_SECTOR_SIZE)
+#define CHECK_ROUNDS 120      // 注入掉电的工作负载轮数
+#define CHECK_AFTER_ROUNDS 12 // 重启后继续运行的轮数, 每轮之后重启检查
+#define CHECK_MAX_SEQ 4096
+#define CHECK_VARIANTS 5
+
+typedef enum
+{
+    SEQ_NONE = 0, // 未追加或追加后未写入Flash就掉电
+    SEQ_APPENDED, // 在RAM批次中
+    SEQ_DURABLE,  // 已写入Flash, 未确认
+    SEQ_ACKED,    // 已确认
+} CheckSeqState_t;
+
+static FILE *s_file;
+static uint32_t s_opCount;  // 已执行的写入与擦除次数
+static uint32_t s_crashAt;  // 在第几次操作时掉电, 0表示不掉电
+static int s_variant;       // 掉电方式
+static bool s_powerOff;     // 已掉电, 之后的操作全部失败
+static uint32_t s_rng;
+static uint8_t s_seqState[CHECK_MAX_SEQ];
+static uint32_t s_ackSeq;   // 已确认的序号
+static uint32_t s_durableSeq;
+static uint32_t s_replayLast;
+static uint32_t s_replayNum;
+static uint8_t s_replayed[CHECK_MAX_SEQ];
+static int s_verbose;
+static int s_failed;
+static char s_error[128];
+
+static uint32_t checkRandom(void)
+{
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 17;
+    s_rng ^= s_rng << 5;
+    return s_rng;
+}
+
+static void checkFileRead(uint32_t offset, void *buf, size_t len)
+{
+    fseek(s_file, offset, SEEK_SET);
+    if (fread(buf, 1, len, s_file) != len)
+    {
+        memset(buf, 0xFF, len);
+    }
+}
+
+static void checkFileWrite(uint32_t offset, const void *buf, size_t len)
+{
+    fseek(s_file, offset, SEEK_SET);
+    fwrite(buf, 1, len, s_file);
+}
+
+static esp_err_t checkFlashRead(void *ctx, uint32_t offset, void *buf, size_t len)
+{
+    (void)ctx;
+    if (s_powerOff)
+    {
+        return ESP_FAIL;
+    }
+    checkFileRead(offset, buf, len);
+    return ESP_OK;
+}
+
+/* NOR Flash写入只能把1改为0; 掉电时按 s_variant 只写入一部分 */
+static esp_err_t checkFlashWrite(void *ctx, uint32_t offset, const void *buf, size_t len)
+{
+    (void)ctx;
+    if (s_powerOff)
+    {
+        return ESP_FAIL;
+    }
+    uint8_t data[JOURNAL_SECTOR_SIZE];
+    checkFileRead(offset, data, len);
+    size_t done = len;
+    bool crash = ++s_opCount == s_crashAt;
+    if (crash)
+    {
+        static const size_t s_cut[CHECK_VARIANTS][2] = {{0, 1}, {1, 2}, {1, 1}, {1, 2}, {1, 1}}; // 写入 len*分子/分母 字节
+        done = s_variant == 2 ? len - 1 : len * s_cut[s_variant][0] / s_cut[s_variant][1];
+    }
+    for (size_t i = 0; i < done; i++)
+    {
+        data[i] &= ((const uint8_t *)buf)[i];
+    }
+    if (crash && s_variant == 3 && done < len)
+    {
+        data[done] &= ((const uint8_t *)buf)[done] | 0xF0; // 正在编程的字节只写入了低4位
+    }
+    checkFileWrite(offset, data, len);
+    if (crash)
+    {
+        s_powerOff = true;
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+/* 擦除后全部为0xFF; 掉电时按 s_variant 只擦除一部分 */
+static esp_err_t checkFlashErase(void *ctx, uint32_t offset, size_t len)
+{
+    (void)ctx;
+    if (s_powerOff)
+    {
+        return ESP_FAIL;
+    }
+    uint8_t data[JOURNAL_SECTOR_SIZE];
+    checkFileRead(offset, data, len);
+    size_t done = len;
+    bool crash = ++s_opCount == s_crashAt;
+    if (crash)
+    {
+        done = s_variant == 0 ? 0 : (s_variant == 4 ? len : len / 2);
+    }
+    memset(data, 0xFF, done);
+    if (crash && s_variant == 2)
+    {
+        for (size_t i = done; i < len; i++)
+        {
+            data[i] |= checkRandom(); // 其余字节部分位已擦除
+        }
+    }
+    checkFileWrite(offset, data, len);
+    if (crash)
+    {
+        s_powerOff = true;
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+static const journal_flash_t s_flash = {
+    .read = checkFlashRead,
+    .write = checkFlashWrite,
+    .erase = checkFlashErase,
+    .ctx = NULL,
+    .size = CHECK_FLASH_SIZE,
+};
+
+/* 记录内容由序号决定, 掉电后序号被重新分配时内容相同 */
+static size_t checkPayload(uint32_t seq, uint8_t *buf)
+{
+    size_t len = seq % 23 == 0 ? JOURNAL_ENTRY_MAX_LEN : 1 + seq * 7919 % 900;
+    for (size_t i = 0; i < len; i++)
+    {
+        buf[i] = (uint8_t)(seq * 31 + i);
+    }
+    return len;
+}
+
+static void checkFail(const char *fmt, ...)
+{
+    if (s_error[0] == '\0')
+    {
+        va_list args;
+        va_start(args, fmt);
+        vsnprintf(s_error, sizeof(s_error), fmt, args);
+        va_end(args);
+    }
+}
+
+/* 刷新后已写入Flash的记录(写入按序号顺序进行) */
+static void checkDurableUpdate(const journal_t *journal)
+{
+    for (uint32_t seq = s_durableSeq + 1; seq <= journal->durable_seq && seq < CHECK_MAX_SEQ; seq++)
+    {
+        if (s_seqState[seq] == SEQ_APPENDED)
+        {
+            s_seqState[seq] = SEQ_DURABLE;
+        }
+    }
+    if (journal->durable_seq > s_durableSeq)
+    {
+        s_durableSeq = journal->durable_seq;
+    }
+}
+
+/**
+ * @brief  一轮工作负载: 追加1-3条记录, 随机刷新, 随机确认一部分已写入Flash的记录
+ * @return bool 掉电时返回false
+ */
+static bool checkRound(journal_t *journal)
+{
+    static uint8_t payload[JOURNAL_ENTRY_MAX_LEN];
+    uint32_t num = 1 + checkRandom() % 3;
+    for (uint32_t i = 0; i < num; i++)
+    {
+        uint32_t seq = journal->next_seq;
+        if (seq >= CHECK_MAX_SEQ)
+        {
+            return true;
+        }
+        size_t len = checkPayload(seq, payload);
+        uint32_t assigned = 0;
+        esp_err_t err = journal_append(journal, seq & 0xFF, payload, len, &assigned);
+        checkDurableUpdate(journal);
+        if (s_powerOff)
+        {
+            return false;
+        }
+        if (err == ESP_OK)
+        {
+            if (assigned != seq)
+            {
+                checkFail("append returned seq %u out of order", assigned);
+            }
+            s_seqState[seq] = SEQ_APPENDED;
+        }
+    }
+    if (checkRandom() % 2 == 0)
+    {
+        journal_flush(journal);
+        checkDurableUpdate(journal);
+        if (s_powerOff)
+        {
+            return false;
+        }
+    }
+    if (s_durableSeq > s_ackSeq && checkRandom() % 3 != 0) // PUBACK按发布顺序到达
+    {
+        uint32_t target = s_ackSeq + 1 + checkRandom() % (s_durableSeq - s_ackSeq);
+        journal_trim(journal, target);
+        for (uint32_t seq = s_ackSeq + 1; seq <= target; seq++)
+        {
+            s_seqState[seq] = s_seqState[seq] == SEQ_DURABLE ? SEQ_ACKED : s_seqState[seq];
+        }
+        s_ackSeq = target;
+    }
+    return true;
+}
+
+static void checkReplayCb(uint32_t seq, uint8_t tag, const uint8_t *data, size_t len, void *arg)
+{
+    (void)arg;
+    static uint8_t expect[JOURNAL_ENTRY_MAX_LEN];
+    if (seq <= s_replayLast)
+    {
+        checkFail("seq %u replayed out of order", seq);
+    }
+    s_replayLast = seq;
+    if (seq >= CHECK_MAX_SEQ || s_seqState[seq] == SEQ_NONE)
+    {
+        checkFail("seq %u replayed but never appended", seq);
+        return;
+    }
+    size_t expectLen = checkPayload(seq, expect);
+    if (tag != (seq & 0xFF) || len != expectLen || memcmp(data, expect, len) != 0)
+    {
+        checkFail("seq %u replayed with wrong content", seq);
+    }
+    s_replayed[seq] = 1;
+    s_replayNum++;
+}
+
+/**
+ * @brief  重启: 重新打开日志并重放, 检查已写入Flash且未确认的记录没有丢失; 之后按重放结果更新模型(与MQTT任务相同, 重放的记录重新发布)
+ * @return bool 检查是否通过
+ */
+static bool checkReboot(journal_t *journal)
+{
+    journal_close(journal);
+    s_powerOff = false;
+    s_crashAt = 0;
+    if (journal_open(journal, &s_flash) != ESP_OK)
+    {
+        checkFail("journal_open failed after power loss");
+        return false;
+    }
+    memset(s_replayed, 0, sizeof(s_replayed));
+    s_replayLast = 0;
+    s_replayNum = 0;
+    journal_replay(journal, journal->trim_seq + 1, UINT32_MAX, checkReplayCb, NULL);
+    for (uint32_t seq = 1; seq < CHECK_MAX_SEQ; seq++)
+    {
+        if (s_seqState[seq] == SEQ_DURABLE && !s_replayed[seq])
+        {
+            checkFail("durable unacknowledged seq %u lost", seq);
+        }
+        if ((s_seqState[seq] == SEQ_DURABLE || s_seqState[seq] == SEQ_ACKED) && seq >= journal->next_seq)
+        {
+            checkFail("next seq reuses durable seq %u", seq);
+        }
+    }
+    if (journal->trim_seq > s_ackSeq)
+    {
+        checkFail("trim seq %u was never acknowledged", journal->trim_seq);
+    }
+    s_ackSeq = journal->trim_seq;
+    s_durableSeq = journal->durable_seq;
+    for (uint32_t seq = 1; seq < CHECK_MAX_SEQ; seq++)
+    {
+        if (s_replayed[seq])
+        {
+            s_seqState[seq] = SEQ_DURABLE;
+        }
+        else if (seq > s_ackSeq)
+        {
+            s_seqState[seq] = SEQ_NONE;
+        }
+    }
+    return s_error[0] == '\0';
+}
+
+/**
+ * @brief  运行一次: 清空日志区, 运行工作负载直到掉电(或完成), 重启检查, 继续运行后再次重启检查
+ * @return uint32_t 写入与擦除的次数(不掉电时)
+ */
+static uint32_t checkRun(uint32_t crashAt, int variant)
+{
+    static uint8_t erased[CHECK_FLASH_SIZE];
+    memset(erased, 0xFF, sizeof(erased));
+    checkFileWrite(0, erased, sizeof(erased));
+    memset(s_seqState, 0, sizeof(s_seqState));
+    s_opCount = 0;
+    s_crashAt = crashAt;
+    s_variant = variant;
+    s_powerOff = false;
+    s_ackSeq = 0;
+    s_durableSeq = 0;
+    s_rng = 0x2545F491;
+    s_error[0] = '\0';
+
+    journal_t journal;
+    if (journal_open(&journal, &s_flash) != ESP_OK)
+    {
+        checkFail("journal_open failed on erased flash");
+        return 0;
+    }
+    for (int round = 0; round < CHECK_ROUNDS && checkRound(&journal); round++)
+    {
+    }
+    uint32_t opCount = s_opCount;
+    if (checkReboot(&journal))
+    {
+        uint32_t replayNum = s_replayNum;
+        for (int round = 0; round < CHECK_AFTER_ROUNDS && s_error[0] == '\0'; round++) // 每轮之后重启一次(批次中未刷新的记录丢失)
+        {
+            checkRound(&journal);
+            checkReboot(&journal);
+        }
+        if (s_verbose)
+        {
+            printf("  crash at %4u variant %d: replayed %u, after restart replayed %u, trim %u next %u %s\n",
+                   crashAt, variant, replayNum, s_replayNum, journal.trim_seq, journal.next_seq, s_error[0] ? s_error : "ok");
+        }
+    }
+    journal_close(&journal);
+    if (s_error[0] != '\0')
+    {
+        printf("crash at op %u variant %d: %s\n", crashAt, variant, s_error);
+        s_failed = 1;
+    }
+    return opCount;
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = "/tmp/journal_crash_check.bin";
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-v") == 0)
+        {
+            s_verbose = 1;
+        }
+        else
+        {
+            path = argv[i];
+        }
+    }
+    s_file = fopen(path, "w+b");
+    if (s_file == NULL)
+    {
+        fprintf(stderr, "can not open %s\n", path);
+        return 1;
+    }
+    uint32_t opNum = checkRun(0, 0);
+    printf("%-40s ops=%u %s\n", "no power loss", opNum, s_failed ? "FAILED" : "ok");
+    static const char *s_variantName[CHECK_VARIANTS] = {
+        "nothing written / not erased",
+        "half written / half erased",
+        "last byte missing / half erased, rest partial",
+        "half written, next byte partial / half erased",
+        "fully written / fully erased, no return",
+    };
+    for (int variant = 0; variant < CHECK_VARIANTS; variant++)
+    {
+        int failed = s_failed;
+        s_failed = 0;
+        for (uint32_t crashAt = 1; crashAt <= opNum; crashAt++)
+        {
+            checkRun(crashAt, variant);
+        }
+        printf("%-48s crash points=%u %s\n", s_variantName[variant], opNum, s_failed ? "FAILED" : "ok");
+        s_failed |= failed;
+    }
+    fclose(s_file);
+    return s_failed;
+}
@@ -0,0 +1,239 @@
+/**
+ * @file ledstrip_render_bench.c
+ * @brief 灯带指示重新计算的主机微基准: 对比旧的 RGB→HSV→RGB 逐灯珠写入与下发时换算颜色+整段填充
+ *
+ * 编译运行(在工程目录下):
+ *     gcc -O2 -Imain/inc tools/ledstrip_render_bench.c main/src/hardware/ledstrip/ledstrip_color.c -o /tmp/ledstrip_render_bench
+ *     /tmp/ledstrip_render_bench [灯珠数=1000] [每库位灯珠=4] [每库位订单=2] [次数=2000]
+ *
+ * 像素缓冲区的写入方式与 components/led_strip/src/led_strip_rmt_dev.c 一致(GRB, 3字节/灯珠)。
+ * 输出每次重新计算全部库位的平均耗时, 以及两种方式结果的最大分量差(取整误差, 应不超过2)。
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "ledstrip_color.h"
+
+#define BYTES_PER_PIXEL 3
+
+typedef struct
+{
+    uint16_t startLedId; // 从1开始
+    uint16_t ledNum;
+    uint32_t color;       // 下发的颜色
+    uint32_t scaledColor; // 下发时按亮度换算后的颜色
+} BenchOwner_t;
+
+static uint8_t *s_pixelBuf;
+static uint32_t s_stripLen;
+
+/* ---------------- 旧路径: 与 common.c RGB8882HSV、led_strip_api.c led_strip_set_pixel_hsv 相同 ---------------- */
+
+static void RGB8882HSV(unsigned char r, unsigned char g, unsigned char b, float *hue, unsigned char *saturation, unsigned char *value)
+{
+    float min, max, delta;
+    float rf = r / 255.0f;
+    float gf = g / 255.0f;
+    float bf = b / 255.0f;
+    min = rf < gf ? (rf < bf ? rf : bf) : (gf < bf ? gf : bf);
+    max = rf > gf ? (rf > bf ? rf : bf) : (gf > bf ? gf : bf);
+    *value = (unsigned char)(max * 255);
+    delta = max - min;
+    if (max != 0)
+    {
+        *saturation = (unsigned char)((delta / max) * 255);
+    }
+    else
+    {
+        *saturation = 0;
+        *hue = -1;
+        return;
+    }
+    if (delta == 0)
+    {
+        *hue = 0;
+        return;
+    }
+    if (rf == max)
+    {
+        *hue = (gf - bf) / delta;
+    }
+    else if (gf == max)
+    {
+        *hue = 2 + (bf - rf) / delta;
+    }
+    else
+    {
+        *hue = 4 + (rf - gf) / delta;
+    }
+    *hue *= 60;
+    if (*hue < 0)
+    {
+        *hue += 360;
+    }
+}
+
+static void benchSetPixel(uint32_t index, uint32_t red, uint32_t green, uint32_t blue)
+{
+    if (index >= s_stripLen)
+    {
+        return;
+    }
+    uint32_t start = index * BYTES_PER_PIXEL;
+    s_pixelBuf[start + 0] = green & 0xFF;
+    s_pixelBuf[start + 1] = red & 0xFF;
+    s_pixelBuf[start + 2] = blue & 0xFF;
+}
+
+static void benchSetPixelHsv(uint32_t index, uint16_t hue, uint8_t saturation, uint8_t value)
+{
+    uint32_t red = 0, green = 0, blue = 0;
+    uint32_t rgb_max = value;
+    uint32_t rgb_min = rgb_max * (255 - saturation) / 255.0f;
+    uint32_t i = hue / 60;
+    uint32_t diff = hue % 60;
+    uint32_t rgb_adj = (rgb_max - rgb_min) * diff / 60;
+    switch (i)
+    {
+    case 0:
+        red = rgb_max, green = rgb_min + rgb_adj, blue = rgb_min;
+        break;
+    case 1:
+        red = rgb_max - rgb_adj, green = rgb_max, blue = rgb_min;
+        break;
+    case 2:
+        red = rgb_min, green = rgb_max, blue = rgb_min + rgb_adj;
+        break;
+    case 3:
+        red = rgb_min, green = rgb_max - rgb_adj, blue = rgb_max;
+        break;
+    case 4:
+        red = rgb_min + rgb_adj, green = rgb_min, blue = rgb_max;
+        break;
+    default:
+        red = rgb_max, green = rgb_min, blue = rgb_max - rgb_adj;
+        break;
+    }
+    benchSetPixel(index, red, green, blue);
+}
+
+static void benchRenderHsv(const BenchOwner_t *owner, size_t ownerNum, uint8_t brightness)
+{
+    for (size_t n = 0; n < ownerNum; n++)
+    {
+        float hue;
+        uint8_t saturation, value;
+        RGB8882HSV(LEDSTRIP_COLOR_RED(owner[n].color), LEDSTRIP_COLOR_GREEN(owner[n].color), LEDSTRIP_COLOR_BLUE(owner[n].color), &hue, &saturation, &value);
+        value = brightness;
+        for (size_t x = owner[n].startLedId; x < owner[n].startLedId + owner[n].ledNum; x++)
+        {
+            benchSetPixelHsv(x - 1, hue, saturation, value);
+        }
+    }
+}
+
+/* ---------------- 新路径: 与 led_strip_fill(led_strip_rmt_dev.c) 相同 ---------------- */
+
+static void benchFill(uint32_t index, uint32_t count, uint32_t red, uint32_t green, uint32_t blue)
+{
+    if (index >= s_stripLen || count > s_stripLen - index || count == 0)
+    {
+        return;
+    }
+    benchSetPixel(index, red, green, blue);
+    uint8_t *buf = s_pixelBuf + index * BYTES_PER_PIXEL;
+    size_t done = BYTES_PER_PIXEL, total = count * BYTES_PER_PIXEL;
+    while (done < total)
+    {
+        size_t len = (total - done) < done ? (total - done) : done;
+        memcpy(buf + done, buf, len);
+        done += len;
+    }
+}
+
+static void benchRenderDirect(const BenchOwner_t *owner, size_t ownerNum)
+{
+    for (size_t n = 0; n < ownerNum; n++)
+    {
+        uint32_t _color = owner[n].scaledColor;
+        benchFill(owner[n].startLedId - 1, owner[n].ledNum, LEDSTRIP_COLOR_RED(_color), LEDSTRIP_COLOR_GREEN(_color), LEDSTRIP_COLOR_BLUE(_color));
+    }
+}
+
+static double benchNowUs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t ledNum = argc > 1 ? atoi(argv[1]) : 1000;
+    uint32_t boxLedNum = argc > 2 ? atoi(argv[2]) : 4;
+    uint32_t ordersPerBox = argc > 3 ? atoi(argv[3]) : 2;
+    uint32_t rounds = argc > 4 ? atoi(argv[4]) : 2000;
+    const uint8_t brightness = 40;
+    if (ledNum == 0 || boxLedNum == 0 || ordersPerBox == 0 || ordersPerBox > boxLedNum || boxLedNum > ledNum || rounds == 0)
+    {
+        fprintf(stderr, "invalid arguments\n");
+        return 1;
+    }
+    const uint32_t palette[] = {0x00FF00, 0xFFFF00, 0xFF0000, 0x0000FF, 0xFF8000, 0x40E0D0, 0x123456};
+    uint32_t boxNum = ledNum / boxLedNum;
+    size_t ownerNum = boxNum * ordersPerBox;
+    BenchOwner_t *owner = calloc(ownerNum, sizeof(BenchOwner_t));
+    s_stripLen = ledNum;
+    s_pixelBuf = calloc(ledNum, BYTES_PER_PIXEL);
+    uint8_t *hsvBuf = calloc(ledNum, BYTES_PER_PIXEL);
+    if (owner == NULL || s_pixelBuf == NULL || hsvBuf == NULL)
+    {
+        fprintf(stderr, "no memory\n");
+        return 1;
+    }
+    ledStripColorLutInit();
+    uint32_t ownerLedNum = boxLedNum / ordersPerBox;
+    for (uint32_t b = 0, n = 0; b < boxNum; b++)
+    {
+        for (uint32_t j = 0; j < ordersPerBox; j++, n++)
+        {
+            owner[n].startLedId = b * boxLedNum + 1 + j * ownerLedNum;
+            owner[n].ledNum = ownerLedNum;
+            owner[n].color = palette[n % (sizeof(palette) / sizeof(palette[0]))];
+            owner[n].scaledColor = ledStripColorScale(owner[n].color, brightness); // 下发订单时执行
+        }
+    }
+
+    benchRenderHsv(owner, ownerNum, brightness);
+    memcpy(hsvBuf, s_pixelBuf, ledNum * BYTES_PER_PIXEL);
+    memset(s_pixelBuf, 0, ledNum * BYTES_PER_PIXEL);
+    benchRenderDirect(owner, ownerNum);
+    int maxDiff = 0;
+    for (size_t i = 0; i < ledNum * BYTES_PER_PIXEL; i++)
+    {
+        int diff = abs((int)hsvBuf[i] - (int)s_pixelBuf[i]);
+        maxDiff = diff > maxDiff ? diff : maxDiff;
+    }
+
+    double start = benchNowUs();
+    for (uint32_t r = 0; r < rounds; r++)
+    {
+        benchRenderHsv(owner, ownerNum, brightness);
+    }
+    double hsvUs = (benchNowUs() - start) / rounds;
+    start = benchNowUs();
+    for (uint32_t r = 0; r < rounds; r++)
+    {
+        benchRenderDirect(owner, ownerNum);
+    }
+    double directUs = (benchNowUs() - start) / rounds;
+
+    printf("leds=%u boxes=%u owners=%zu rounds=%u\n", ledNum, boxNum, ownerNum, rounds);
+    printf("hsv_per_pixel_us=%.2f direct_fill_us=%.2f speedup=%.1fx max_channel_diff=%d\n", hsvUs, directUs, directUs > 0 ? hsvUs / directUs : 0, maxDiff);
+    free(owner);
+    free(s_pixelBuf);
+    free(hsvBuf);
+    return 0;
+}
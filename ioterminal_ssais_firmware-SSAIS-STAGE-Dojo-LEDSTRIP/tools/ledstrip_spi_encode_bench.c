@@ -0,0 +1,120 @@
+/**
+ * @file ledstrip_spi_encode_bench.c
+ * @brief 灯带SPI后端编码的主机微基准: 对比旧的逐位编码(每灯珠memset+逐位置位)与256项查表编码
+ *
+ * 编译运行(在工程目录下):
+ *     gcc -O2 tools/ledstrip_spi_encode_bench.c -o /tmp/ledstrip_spi_encode_bench
+ *     /tmp/ledstrip_spi_encode_bench [灯珠数=1000] [次数=2000]
+ *
+ * 编码方式与 components/led_strip/src/led_strip_spi_dev.c 一致(GRB, 每个颜色字节展开为3字节SPI数据)。
+ * 输出整条灯带编码一次的平均耗时, 以及两种方式结果是否逐字节一致。
+ * 刷新耗时的RMT/SPI对比在设备上通过拣货波次性能测试结果中的 refresh_us 获取。
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#define BIT(n) (1U << (n))
+#define SPI_BYTES_PER_COLOR_BYTE 3
+#define BYTES_PER_PIXEL 3
+#define PIXEL_SIZE (BYTES_PER_PIXEL * SPI_BYTES_PER_COLOR_BYTE)
+
+static uint8_t s_patternLut[256][SPI_BYTES_PER_COLOR_BYTE];
+
+/* ---------------- 旧路径: 与 led_strip_spi_dev.c __led_strip_spi_bit 相同 ---------------- */
+
+static void benchSpiBit(uint8_t data, uint8_t *buf)
+{
+    *(buf + 2) |= data & BIT(0) ? BIT(2) | BIT(1) : BIT(2);
+    *(buf + 2) |= data & BIT(1) ? BIT(5) | BIT(4) : BIT(5);
+    *(buf + 2) |= data & BIT(2) ? BIT(7) : 0x00;
+    *(buf + 1) |= BIT(0);
+    *(buf + 1) |= data & BIT(3) ? BIT(3) | BIT(2) : BIT(3);
+    *(buf + 1) |= data & BIT(4) ? BIT(6) | BIT(5) : BIT(6);
+    *(buf + 0) |= data & BIT(5) ? BIT(1) | BIT(0) : BIT(1);
+    *(buf + 0) |= data & BIT(6) ? BIT(4) | BIT(3) : BIT(4);
+    *(buf + 0) |= data & BIT(7) ? BIT(7) | BIT(6) : BIT(7);
+}
+
+static void benchSetPixelBitwise(uint8_t *pixelBuf, uint32_t index, uint8_t red, uint8_t green, uint8_t blue)
+{
+    uint32_t start = index * PIXEL_SIZE;
+    memset(pixelBuf + start, 0, PIXEL_SIZE);
+    benchSpiBit(green, &pixelBuf[start]);
+    benchSpiBit(red, &pixelBuf[start + SPI_BYTES_PER_COLOR_BYTE]);
+    benchSpiBit(blue, &pixelBuf[start + SPI_BYTES_PER_COLOR_BYTE * 2]);
+}
+
+/* ---------------- 新路径: 与 led_strip_spi_dev.c led_strip_spi_encode 相同 ---------------- */
+
+static void benchSetPixelLut(uint8_t *pixelBuf, uint32_t index, uint8_t red, uint8_t green, uint8_t blue)
+{
+    uint8_t *buf = pixelBuf + index * PIXEL_SIZE;
+    memcpy(buf, s_patternLut[green], SPI_BYTES_PER_COLOR_BYTE);
+    memcpy(buf + SPI_BYTES_PER_COLOR_BYTE, s_patternLut[red], SPI_BYTES_PER_COLOR_BYTE);
+    memcpy(buf + SPI_BYTES_PER_COLOR_BYTE * 2, s_patternLut[blue], SPI_BYTES_PER_COLOR_BYTE);
+}
+
+static double benchNowUs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t ledNum = argc > 1 ? atoi(argv[1]) : 1000;
+    uint32_t rounds = argc > 2 ? atoi(argv[2]) : 2000;
+    if (ledNum == 0 || rounds == 0)
+    {
+        fprintf(stderr, "invalid arguments\n");
+        return 1;
+    }
+    uint8_t *bitwiseBuf = calloc(ledNum, PIXEL_SIZE);
+    uint8_t *lutBuf = calloc(ledNum, PIXEL_SIZE);
+    uint8_t *color = malloc(ledNum * BYTES_PER_PIXEL);
+    if (bitwiseBuf == NULL || lutBuf == NULL || color == NULL)
+    {
+        fprintf(stderr, "no memory\n");
+        return 1;
+    }
+    for (int data = 0; data < 256; data++)
+    {
+        benchSpiBit(data, s_patternLut[data]);
+    }
+    srand(1);
+    for (uint32_t i = 0; i < ledNum * BYTES_PER_PIXEL; i++)
+    {
+        color[i] = rand() & 0xFF;
+    }
+
+    double start = benchNowUs();
+    for (uint32_t r = 0; r < rounds; r++)
+    {
+        for (uint32_t i = 0; i < ledNum; i++)
+        {
+            benchSetPixelBitwise(bitwiseBuf, i, color[i * 3], color[i * 3 + 1], color[i * 3 + 2] ^ (r & 1));
+        }
+    }
+    double bitwiseUs = (benchNowUs() - start) / rounds;
+    start = benchNowUs();
+    for (uint32_t r = 0; r < rounds; r++)
+    {
+        for (uint32_t i = 0; i < ledNum; i++)
+        {
+            benchSetPixelLut(lutBuf, i, color[i * 3], color[i * 3 + 1], color[i * 3 + 2] ^ (r & 1));
+        }
+    }
+    double lutUs = (benchNowUs() - start) / rounds;
+    int same = memcmp(bitwiseBuf, lutBuf, ledNum * PIXEL_SIZE) == 0;
+
+    printf("leds=%u rounds=%u spi_bytes=%u\n", ledNum, rounds, ledNum * PIXEL_SIZE);
+    printf("bitwise_encode_us=%.2f lut_encode_us=%.2f speedup=%.1fx identical=%s\n", bitwiseUs, lutUs, lutUs > 0 ? bitwiseUs / lutUs : 0, same ? "yes" : "no");
+    free(bitwiseBuf);
+    free(lutBuf);
+    free(color);
+    return same ? 0 : 1;
+}
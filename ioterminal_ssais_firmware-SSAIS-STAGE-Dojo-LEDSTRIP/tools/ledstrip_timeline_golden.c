@@ -0,0 +1,161 @@
+/**
+ * @file ledstrip_timeline_golden.c
+ * @brief 灯带关键帧时间线的主机回放: 编译示例(或命令行给出的)关键帧, 按灯效帧间隔输出每帧画面的校验值
+ *
+ * 编译运行(在工程目录下):
+ *     gcc -O2 -Imain/inc tools/ledstrip_timeline_golden.c main/src/hardware/ledstrip/ledstrip_timeline.c -o /tmp/ledstrip_timeline_golden
+ *     /tmp/ledstrip_timeline_golden [灯珠数=60] [帧间隔ms=20] [-v | -c 基准文件]
+ *     /tmp/ledstrip_timeline_golden 60 20 -c tools/ledstrip_timeline_golden.txt
+ *
+ * 编译与渲染只使用整数运算, 与设备上的效果任务(ledstrip_effect_manager.c LED_EFFECT_TIMELINE)结果逐字节一致。
+ * 基准文件 tools/ledstrip_timeline_golden.txt 为默认参数(60颗, 20ms)的输出, 修改时间线代码后用 -c 对比,
+ * 有差异时输出不一致的行并返回1; 有意修改渲染结果时重新生成基准文件并一起提交。
+ * 每行: 时间ms 画面FNV-1a校验值 点亮的灯珠数; -v 时追加每颗灯珠的RRGGBB。
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "ledstrip_timeline.h"
+
+#define BYTES_PER_PIXEL 3
+
+#define GOLDEN_LINE_MAX 128
+
+static uint8_t *s_pixelBuf;
+static FILE *s_golden; // 对比模式的基准文件, NULL时输出到标准输出
+static int s_lineNo;
+static int s_failed;
+
+/* 示例: 整段渐亮 -> 前半段逐颗点亮 -> 后半段闪烁 -> 整段渐灭 */
+static const LedStripKeyframe_t s_sampleKeyframe[] = {
+    {.atMs = 0, .durationMs = 500, .startLed = 1, .endLed = 60, .color = 0x0000FF, .effect = LEDSTRIP_TIMELINE_EFFECT_FADE, .easing = LEDSTRIP_TIMELINE_EASING_IN_OUT},
+    {.atMs = 500, .durationMs = 700, .startLed = 1, .endLed = 30, .color = 0x00FF00, .effect = LEDSTRIP_TIMELINE_EFFECT_WIPE, .easing = LEDSTRIP_TIMELINE_EASING_OUT},
+    {.atMs = 500, .durationMs = 700, .startLed = 31, .endLed = 60, .color = 0xFF8000, .effect = LEDSTRIP_TIMELINE_EFFECT_BLINK, .periodMs = 200},
+    {.atMs = 1200, .durationMs = 300, .startLed = 1, .endLed = 60, .color = 0x0000FF, .effect = LEDSTRIP_TIMELINE_EFFECT_SOLID},
+    {.atMs = 1500, .durationMs = 500, .startLed = 1, .endLed = 60, .color = 0x000000, .effect = LEDSTRIP_TIMELINE_EFFECT_FADE, .easing = LEDSTRIP_TIMELINE_EASING_IN},
+};
+
+static void goldenFill(void *ctx, uint16_t index, uint16_t count, uint8_t red, uint8_t green, uint8_t blue)
+{
+    uint32_t ledNum = *(uint32_t *)ctx;
+    for (uint32_t i = index; i < (uint32_t)index + count && i < ledNum; i++)
+    {
+        s_pixelBuf[i * BYTES_PER_PIXEL + 0] = red;
+        s_pixelBuf[i * BYTES_PER_PIXEL + 1] = green;
+        s_pixelBuf[i * BYTES_PER_PIXEL + 2] = blue;
+    }
+}
+
+static uint32_t goldenHash(const uint8_t *buf, size_t len)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++)
+    {
+        hash = (hash ^ buf[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/* 输出一行(不含换行), 对比模式下与基准文件的下一行比较 */
+static void goldenLine(const char *line)
+{
+    s_lineNo++;
+    if (s_golden == NULL)
+    {
+        printf("%s\n", line);
+        return;
+    }
+    char expect[GOLDEN_LINE_MAX];
+    if (fgets(expect, sizeof(expect), s_golden) == NULL)
+    {
+        printf("line %d: got \"%s\" expect end of file\n", s_lineNo, line);
+        s_failed = 1;
+        return;
+    }
+    expect[strcspn(expect, "\r\n")] = '\0';
+    if (strcmp(line, expect) != 0)
+    {
+        printf("line %d: got \"%s\" expect \"%s\"\n", s_lineNo, line, expect);
+        s_failed = 1;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t ledNum = argc > 1 ? atoi(argv[1]) : 60;
+    uint32_t frameMs = argc > 2 ? atoi(argv[2]) : 20;
+    int verbose = argc > 3 && strcmp(argv[3], "-v") == 0;
+    if (ledNum < 60 || ledNum > UINT16_MAX || frameMs == 0)
+    {
+        fprintf(stderr, "invalid arguments (at least 60 leds)\n");
+        return 1;
+    }
+    if (argc > 3 && strcmp(argv[3], "-c") == 0)
+    {
+        s_golden = argc > 4 ? fopen(argv[4], "r") : NULL;
+        if (s_golden == NULL)
+        {
+            fprintf(stderr, "can not open golden file\n");
+            return 1;
+        }
+    }
+    static LedStripTimeline_t timeline;
+    size_t errIndex = 0;
+    LedStripTimelineResult_t result = ledStripTimelineCompile(s_sampleKeyframe, sizeof(s_sampleKeyframe) / sizeof(s_sampleKeyframe[0]),
+                                                              ledNum, 128, 2, &timeline, &errIndex);
+    if (result != LEDSTRIP_TIMELINE_OK)
+    {
+        fprintf(stderr, "compile failed: keyframe %zu error %d\n", errIndex, result);
+        return 1;
+    }
+    s_pixelBuf = calloc(ledNum, BYTES_PER_PIXEL);
+    if (s_pixelBuf == NULL)
+    {
+        fprintf(stderr, "no memory\n");
+        return 1;
+    }
+    char line[GOLDEN_LINE_MAX];
+    snprintf(line, sizeof(line), "# leds=%u frame_ms=%u instr=%u length_ms=%u loop=%u", ledNum, frameMs, timeline.instrNum, timeline.lengthMs, timeline.loop);
+    goldenLine(line);
+    for (uint32_t t = 0;; t += frameMs)
+    {
+        memset(s_pixelBuf, 0, ledNum * BYTES_PER_PIXEL); // 与效果任务相同, 每帧先清空
+        if (!ledStripTimelineRender(&timeline, t, goldenFill, &ledNum))
+        {
+            snprintf(line, sizeof(line), "%u end", t);
+            goldenLine(line);
+            break;
+        }
+        uint32_t lit = 0;
+        for (uint32_t i = 0; i < ledNum; i++)
+        {
+            lit += (s_pixelBuf[i * 3] | s_pixelBuf[i * 3 + 1] | s_pixelBuf[i * 3 + 2]) != 0;
+        }
+        if (!verbose)
+        {
+            snprintf(line, sizeof(line), "%u %08x %u", t, goldenHash(s_pixelBuf, ledNum * BYTES_PER_PIXEL), lit);
+            goldenLine(line);
+            continue;
+        }
+        printf("%u %08x %u", t, goldenHash(s_pixelBuf, ledNum * BYTES_PER_PIXEL), lit);
+        for (uint32_t i = 0; i < ledNum; i++)
+        {
+            printf(" %02x%02x%02x", s_pixelBuf[i * 3], s_pixelBuf[i * 3 + 1], s_pixelBuf[i * 3 + 2]);
+        }
+        printf("\n");
+    }
+    if (s_golden != NULL)
+    {
+        char extra[GOLDEN_LINE_MAX];
+        if (fgets(extra, sizeof(extra), s_golden) != NULL)
+        {
+            printf("line %d: golden file has more lines\n", s_lineNo + 1);
+            s_failed = 1;
+        }
+        printf("%d lines %s\n", s_lineNo, s_failed ? "FAILED" : "ok");
+        fclose(s_golden);
+    }
+    free(s_pixelBuf);
+    return s_failed;
+}
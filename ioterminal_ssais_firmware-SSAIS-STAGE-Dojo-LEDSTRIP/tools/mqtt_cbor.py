@@ -0,0 +1,216 @@
+#!/usr/bin/env python3
+"""
+MQTT 命令/状态消息的 JSON 与 CBOR 互相转换 (调试用)
+
+设备同时订阅 <订阅主题> (JSON) 与 <订阅主题>/cbor (CBOR), 两者命令语义完全相同;
+设备的回执与状态消息使用最近一次收到命令的格式, CBOR 消息发布到 <发布主题>/cbor。
+
+用法:
+    # JSON -> CBOR, 发送到设备
+    python tools/mqtt_cbor.py encode cmd.json -o cmd.cbor
+    mosquitto_pub -h <broker> -t '<订阅主题>/cbor' -f cmd.cbor
+
+    # 查看设备的 CBOR 消息 (二进制文件或十六进制文本)
+    mosquitto_sub -h <broker> -t '<发布主题>/cbor' -C 1 > reply.cbor
+    python tools/mqtt_cbor.py decode reply.cbor
+
+    # 对比每条命令两种格式的字节数 (输入为每行一条 JSON 的文件)
+    python tools/mqtt_cbor.py stats commands.jsonl
+
+编码规则与设备端 json_writer 的 CBOR 输出一致: 整数值按整数编码, 其余浮点数可无损表示为 float32 时使用 float32;
+对象与数组使用定长编码 (设备端生成的消息使用不定长编码, 两者设备都能解码)。
+"""
+import argparse
+import binascii
+import json
+import math
+import struct
+import sys
+
+
+def encode_head(major, value):
+    if value < 24:
+        return bytes([major << 5 | value])
+    for info, fmt in ((24, ">B"), (25, ">H"), (26, ">I"), (27, ">Q")):
+        if value < 1 << (8 * struct.calcsize(fmt)):
+            return bytes([major << 5 | info]) + struct.pack(fmt, value)
+    raise ValueError("integer out of range: %d" % value)
+
+
+def encode(obj):
+    if obj is None:
+        return b"\xf6"
+    if obj is True:
+        return b"\xf5"
+    if obj is False:
+        return b"\xf4"
+    if isinstance(obj, float) and (math.isnan(obj) or math.isinf(obj)):
+        return b"\xf6"  # 与 JSON 输出的 null 一致
+    if isinstance(obj, float) and obj == int(obj) and abs(obj) <= 2 ** 53:
+        obj = int(obj)
+    if isinstance(obj, int):
+        return encode_head(0, obj) if obj >= 0 else encode_head(1, -1 - obj)
+    if isinstance(obj, float):
+        single = struct.pack(">f", obj)
+        if struct.unpack(">f", single)[0] == obj:
+            return b"\xfa" + single
+        return b"\xfb" + struct.pack(">d", obj)
+    if isinstance(obj, str):
+        data = obj.encode("utf-8")
+        return encode_head(3, len(data)) + data
+    if isinstance(obj, list):
+        return encode_head(4, len(obj)) + b"".join(encode(item) for item in obj)
+    if isinstance(obj, dict):
+        return encode_head(5, len(obj)) + b"".join(encode(key) + encode(value) for key, value in obj.items())
+    raise TypeError("unsupported type %s" % type(obj).__name__)
+
+
+class Decoder:
+    BREAK = object()
+
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def take(self, n):
+        if self.pos + n > len(self.data):
+            raise ValueError("truncated CBOR at offset %d" % self.pos)
+        chunk = self.data[self.pos:self.pos + n]
+        self.pos += n
+        return chunk
+
+    def head(self):
+        initial = self.take(1)[0]
+        major, info = initial >> 5, initial & 0x1F
+        if info < 24 or info == 31:
+            return major, info, info
+        if info > 27:
+            raise ValueError("reserved additional info %d at offset %d" % (info, self.pos - 1))
+        size = 1 << (info - 24)
+        return major, info, int.from_bytes(self.take(size), "big")
+
+    def item(self):
+        major, info, value = self.head()
+        while major == 6:  # 标签: 忽略, 与设备端一致
+            major, info, value = self.head()
+        indefinite = info == 31
+        if major == 0:
+            return value
+        if major == 1:
+            return -1 - value
+        if major == 2:
+            raise ValueError("byte strings are not supported")
+        if major == 3:
+            if indefinite:
+                raise ValueError("indefinite text is not supported")
+            return self.take(value).decode("utf-8")
+        if major == 4:
+            result = []
+            while True:
+                if indefinite and self.peek_break():
+                    return result
+                if not indefinite and len(result) == value:
+                    return result
+                result.append(self.item())
+        if major == 5:
+            result = {}
+            count = 0
+            while True:
+                if indefinite and self.peek_break():
+                    return result
+                if not indefinite and count == value:
+                    return result
+                key = self.item()
+                if not isinstance(key, str):
+                    raise ValueError("map keys must be text")
+                result[key] = self.item()
+                count += 1
+        if major == 7:
+            if info == 20:
+                return False
+            if info == 21:
+                return True
+            if info in (22, 23):
+                return None
+            if info == 25:
+                return struct.unpack(">e", value.to_bytes(2, "big"))[0]
+            if info == 26:
+                return struct.unpack(">f", value.to_bytes(4, "big"))[0]
+            if info == 27:
+                return struct.unpack(">d", value.to_bytes(8, "big"))[0]
+        raise ValueError("unsupported item 0x%02x at offset %d" % (major << 5 | info, self.pos))
+
+    def peek_break(self):
+        if self.pos < len(self.data) and self.data[self.pos] == 0xFF:
+            self.pos += 1
+            return True
+        return False
+
+
+def decode(data):
+    decoder = Decoder(data)
+    obj = decoder.item()
+    if decoder.pos != len(data):
+        raise ValueError("%d trailing bytes" % (len(data) - decoder.pos))
+    return obj
+
+
+def read_input(path):
+    if path == "-":
+        return sys.stdin.buffer.read()
+    with open(path, "rb") as f:
+        return f.read()
+
+
+def maybe_hex(data):
+    """mosquitto_sub -F %x 或手工复制的十六进制文本"""
+    text = data.strip()
+    try:
+        if text and all(c in b"0123456789abcdefABCDEF \n\r\t" for c in text):
+            return binascii.unhexlify(b"".join(text.split()))
+    except binascii.Error:
+        pass
+    return data
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Translate MQTT messages between JSON and CBOR")
+    sub = parser.add_subparsers(dest="mode", required=True)
+    enc = sub.add_parser("encode", help="JSON -> CBOR")
+    enc.add_argument("input", help="JSON file, - for stdin")
+    enc.add_argument("-o", "--output", help="binary output file (default: hex to stdout)")
+    dec = sub.add_parser("decode", help="CBOR (binary or hex) -> JSON")
+    dec.add_argument("input", help="CBOR file, - for stdin")
+    st = sub.add_parser("stats", help="compare sizes of JSON lines in both formats")
+    st.add_argument("input", help="file with one JSON message per line")
+    args = parser.parse_args()
+
+    if args.mode == "encode":
+        data = encode(json.loads(read_input(args.input)))
+        if args.output:
+            with open(args.output, "wb") as f:
+                f.write(data)
+            print("%d bytes -> %s" % (len(data), args.output))
+        else:
+            print(data.hex())
+    elif args.mode == "decode":
+        print(json.dumps(decode(maybe_hex(read_input(args.input))), ensure_ascii=False, separators=(",", ":")))
+    else:
+        total_json = total_cbor = 0
+        for line in read_input(args.input).decode("utf-8").splitlines():
+            if not line.strip():
+                continue
+            obj = json.loads(line)
+            text = json.dumps(obj, ensure_ascii=False, separators=(",", ":")).encode("utf-8")
+            data = encode(obj)
+            assert decode(data) == obj
+            total_json += len(text)
+            total_cbor += len(data)
+            name = "%s/%s" % (obj.get("control_type", "?"), obj.get("cmd_type", obj.get("notify_type", "?"))) if isinstance(obj, dict) else "-"
+            print("%-10s json %5d  cbor %5d  (%3d%%)" % (name, len(text), len(data), 100 * len(data) // len(text)))
+        if total_json:
+            print("%-10s json %5d  cbor %5d  (%3d%%)" % ("total", total_json, total_cbor, 100 * total_cbor // total_json))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,134 @@
+/**
+ * @file mqtt_cmd_cache_check.c
+ * @brief msg_id缓存的主机回放: 按场景重复下发命令, 检查命令是否执行、回执结果与命中/未命中计数
+ *
+ * 编译运行(在工程目录下):
+ *     gcc -O2 -Imain/inc tools/mqtt_cmd_cache_check.c main/src/applications/mqtt/mqtt_cmd_cache.c -o /tmp/mqtt_cmd_cache_check
+ *     /tmp/mqtt_cmd_cache_check [-v]
+ *
+ * 缓存与设备上(mqttTask.c mqttCmdDispatch)相同。模拟的命令执行时更新订单与灯带的计数, 重复的命令不应改变它们;
+ * 每一步的结果与期望不一致时输出差异并返回1; -v 时输出每一步。
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "mqtt_cmd_cache.h"
+
+#define CHECK_CAPACITY 4
+#define CHECK_BUCKETS 3 // 小于缓存项数量, 覆盖同一哈希桶中的链接与淘汰
+
+#define ERR_OK 0
+#define ERR_FAIL -1
+#define ERR_INVALID_ARG 0x102
+
+// 模拟的订单引擎与灯带
+typedef struct
+{
+    uint32_t orderUpdates; // 订单引擎写入次数
+    uint32_t stripFrames;  // 灯带刷新次数
+    int result;            // 本次执行的结果
+} CheckDevice_t;
+
+static MqttCmdCacheEntry_t s_entry[CHECK_CAPACITY];
+static int16_t s_bucket[CHECK_BUCKETS];
+static MqttCmdCache_t s_cache;
+static CheckDevice_t s_device;
+static int s_verbose = 0;
+static int s_failed = 0;
+
+static int checkExec(void *ctx)
+{
+    CheckDevice_t *_device = ctx;
+    if (_device->result == ERR_OK) // 参数错误的命令在修改订单与灯带前返回
+    {
+        _device->orderUpdates++;
+        _device->stripFrames++;
+    }
+    return _device->result;
+}
+
+/**
+ * @brief  下发一条命令并检查: 是否执行、是否判为重复、回执结果, 以及累计的命中/未命中计数
+ */
+static void checkSend(const char *name, const char *msgId, int execResult, int expectExec, int expectDup, int expectErr, uint32_t expectHit,
+                      uint32_t expectMiss)
+{
+    CheckDevice_t _before = s_device;
+    bool _dup = true;
+    s_device.result = execResult;
+    int _err = mqttCmdCacheExecute(&s_cache, msgId, checkExec, &s_device, &_dup);
+    int _exec = s_device.orderUpdates != _before.orderUpdates || s_device.stripFrames != _before.stripFrames;
+    int _same = _exec == expectExec && _dup == expectDup && _err == expectErr && s_cache.hit == expectHit && s_cache.miss == expectMiss;
+    if (s_verbose || !_same)
+    {
+        printf("  [%s] exec=%d dup=%d err=%d hit=%u miss=%u", msgId, _exec, _dup, _err, s_cache.hit, s_cache.miss);
+        if (!_same)
+        {
+            printf("  expect exec=%d dup=%d err=%d hit=%u miss=%u", expectExec, expectDup, expectErr, expectHit, expectMiss);
+        }
+        printf("\n");
+    }
+    if (!_same)
+    {
+        printf("%-48s FAILED\n", name);
+        s_failed = 1;
+    }
+}
+
+static void checkDone(const char *name, int failedBefore)
+{
+    if (s_failed == failedBefore)
+    {
+        printf("%-48s ok\n", name);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    s_verbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+    int _failed;
+    mqttCmdCacheInit(&s_cache, s_entry, CHECK_CAPACITY, s_bucket, CHECK_BUCKETS);
+
+    // WMS重试: 第二次不再修改订单与灯带, 直接回执成功
+    _failed = s_failed;
+    checkSend("replay: first", "WMS-1", ERR_OK, 1, 0, ERR_OK, 0, 1);
+    checkSend("replay: duplicate", "WMS-1", ERR_OK, 0, 1, ERR_OK, 1, 1);
+    checkSend("replay: duplicate again", "WMS-1", ERR_FAIL, 0, 1, ERR_OK, 2, 1);
+    checkDone("replay skips order engine and strip", _failed);
+
+    // 不带msg_id: 每次都执行, 不计数
+    _failed = s_failed;
+    checkSend("no msg_id: first", "", ERR_OK, 1, 0, ERR_OK, 2, 1);
+    checkSend("no msg_id: again", "", ERR_OK, 1, 0, ERR_OK, 2, 1);
+    checkDone("no msg_id always executes", _failed);
+
+    // 首次执行失败: 不记录, 同一msg_id重试时再次执行, 成功后才去重
+    _failed = s_failed;
+    checkSend("failed: first", "WMS-2", ERR_INVALID_ARG, 0, 0, ERR_INVALID_ARG, 2, 2);
+    checkSend("failed: retry fails again", "WMS-2", ERR_FAIL, 0, 0, ERR_FAIL, 2, 3);
+    checkSend("failed: retry succeeds", "WMS-2", ERR_OK, 1, 0, ERR_OK, 2, 4);
+    checkSend("failed: duplicate after success", "WMS-2", ERR_OK, 0, 1, ERR_OK, 3, 4);
+    checkDone("failed command can be retried", _failed);
+
+    // 缓存满时淘汰最久未使用的一项: WMS-1最近被命中, 淘汰WMS-2
+    _failed = s_failed;
+    checkSend("lru: touch WMS-1", "WMS-1", ERR_OK, 0, 1, ERR_OK, 4, 4);
+    checkSend("lru: WMS-3", "WMS-3", ERR_OK, 1, 0, ERR_OK, 4, 5);
+    checkSend("lru: WMS-4", "WMS-4", ERR_OK, 1, 0, ERR_OK, 4, 6);
+    checkSend("lru: WMS-5 evicts WMS-2", "WMS-5", ERR_OK, 1, 0, ERR_OK, 4, 7);
+    checkSend("lru: WMS-1 kept", "WMS-1", ERR_OK, 0, 1, ERR_OK, 5, 7);
+    checkSend("lru: WMS-2 evicted, executes", "WMS-2", ERR_OK, 1, 0, ERR_OK, 5, 8);
+    checkSend("lru: WMS-3 evicted by WMS-2", "WMS-3", ERR_OK, 1, 0, ERR_OK, 5, 9);
+    checkSend("lru: WMS-5 kept", "WMS-5", ERR_OK, 0, 1, ERR_OK, 6, 9);
+    checkDone("full cache evicts least recently used", _failed);
+
+    // 缓存申请失败: 不去重, 每次都执行
+    _failed = s_failed;
+    mqttCmdCacheInit(&s_cache, NULL, CHECK_CAPACITY, s_bucket, CHECK_BUCKETS);
+    checkSend("no cache: first", "WMS-6", ERR_OK, 1, 0, ERR_OK, 0, 0);
+    checkSend("no cache: again", "WMS-6", ERR_OK, 1, 0, ERR_OK, 0, 0);
+    checkDone("no cache executes every time", _failed);
+
+    printf("order updates=%u strip frames=%u\n", s_device.orderUpdates, s_device.stripFrames);
+    return s_failed;
+}
@@ -0,0 +1,308 @@
+#!/usr/bin/env python3
+"""
+发送通道断线补发测试: 以最小的 MQTT 3.1.1 Broker 代替真实 Broker, 在设备入队消息前断开连接并拒绝重连, 恢复后检查补发
+
+将设备的 MQTT Broker 地址设置为运行本脚本的主机 (mqtt://<主机IP>:<端口>), 然后:
+    python tools/mqtt_fake_broker_check.py [--port 1883] [--critical 100] [--best-effort 300] [--offline 15]
+
+测试过程:
+    1. 设备连接并订阅后, 向其订阅主题 (JSON) 发送 MQTT状态(153) cmd_type 3 发送通道测试命令;
+    2. 收到命令回执后立即关闭连接, 设备在 delay_ms 后交替放入编号的关键消息与尽力消息 (notify_type 3);
+    3. --offline 秒内设备的重连以 CONNACK 3 (服务不可用) 拒绝;
+    4. 之后接受连接, 收集设备发布的消息 (对象或合并的数组), 对 QoS1 报文回复 PUBACK。
+
+检查项 (与 document/MQTT命令表.md "优先级通道与断线补发" 一致), 任一项不通过时返回1:
+    - 关键消息全部送达, 按序号顺序且不重复;
+    - 尽力消息不超过发送数, 保留的是最新的连续一段 (通道满时丢弃最旧的消息);
+    - 关键消息的补发速率: 任意时间段 [t_i, t_j] 内送达的条数不超过 令牌桶容量 + 速率 × (t_j - t_i) (另加网络抖动余量)。
+补发速率默认从工程目录的 sdkconfig 读取 CONFIG_MQTT_REPLAY_RATE。
+"""
+import argparse
+import json
+import os
+import re
+import select
+import socket
+import struct
+import sys
+import time
+
+REPLAY_BURST = 4  # 与 main/inc/mqtt.h 中的 MQTT_PUB_REPLAY_BURST 保持一致
+CONTROL_TYPE_MQTT_STATE = 153
+TEST_PUB_LANES = 3
+NOTIFY_PUB_LANE_TEST = 3
+JITTER_SEC = 0.05  # 接收时间的网络抖动余量
+
+CONNECT, CONNACK, PUBLISH, PUBACK, SUBSCRIBE, SUBACK, PINGREQ, PINGRESP, DISCONNECT = 1, 2, 3, 4, 8, 9, 12, 13, 14
+CONNACK_ACCEPTED, CONNACK_SERVER_UNAVAILABLE = 0, 3
+
+
+class Connection:
+    def __init__(self, sock):
+        self.sock = sock
+        self.buf = b""
+        self.closed = False
+
+    def send(self, packet_type, flags, body):
+        length = len(body)
+        head = bytes([packet_type << 4 | flags])
+        while True:
+            byte = length & 0x7F
+            length >>= 7
+            head += bytes([byte | (0x80 if length else 0)])
+            if not length:
+                break
+        self.sock.sendall(head + body)
+
+    def _parse(self):
+        """从缓冲区取出一个完整报文, 返回 (类型, 标志, 报文体) 或 None"""
+        length, shift = 0, 0
+        for i in range(1, min(len(self.buf), 5)):
+            length |= (self.buf[i] & 0x7F) << shift
+            shift += 7
+            if not self.buf[i] & 0x80:
+                end = i + 1 + length
+                if len(self.buf) < end:
+                    return None
+                packet = (self.buf[0] >> 4, self.buf[0] & 0x0F, self.buf[i + 1 : end])
+                self.buf = self.buf[end:]
+                return packet
+        return None
+
+    def recv(self, timeout):
+        """等待一个报文, 超时返回 None, 连接关闭时 self.closed 为 True"""
+        deadline = time.monotonic() + timeout
+        while True:
+            packet = self._parse()
+            if packet is not None:
+                return packet
+            remaining = deadline - time.monotonic()
+            if self.closed or remaining <= 0:
+                return None
+            if not select.select([self.sock], [], [], remaining)[0]:
+                return None
+            try:
+                data = self.sock.recv(65536)
+            except OSError:
+                data = b""
+            if not data:
+                self.closed = True
+            self.buf += data
+
+    def close(self):
+        self.closed = True
+        self.sock.close()
+
+
+def read_string(body, offset):
+    (length,) = struct.unpack_from(">H", body, offset)
+    return body[offset + 2 : offset + 2 + length].decode("utf-8", "replace"), offset + 2 + length
+
+
+def accept(server, timeout):
+    """接受一个连接并读取 CONNECT, 返回 (Connection, client_id) 或 None"""
+    if not select.select([server], [], [], timeout)[0]:
+        return None
+    sock, _ = server.accept()
+    sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    conn = Connection(sock)
+    packet = conn.recv(5)
+    if packet is None or packet[0] != CONNECT:
+        conn.close()
+        return None
+    body = packet[2]
+    _, offset = read_string(body, 0)  # 协议名
+    client_id, _ = read_string(body, offset + 4)  # 跳过 级别, 连接标志, 保活时间
+    return conn, client_id
+
+
+class Session:
+    """一次被接受的连接: 处理订阅、PUBACK与心跳, 记录设备发布的消息"""
+
+    def __init__(self, conn):
+        self.conn = conn
+        self.subscriptions = []
+        self.messages = []  # (接收时间, 主题, 负载对象)
+        conn.send(CONNACK, 0, bytes([0, CONNACK_ACCEPTED]))
+
+    def poll(self, timeout):
+        packet = self.conn.recv(timeout)
+        if packet is None:
+            return
+        packet_type, flags, body = packet
+        if packet_type == SUBSCRIBE:
+            (packet_id,) = struct.unpack_from(">H", body, 0)
+            offset, granted = 2, b""
+            while offset < len(body):
+                topic, offset = read_string(body, offset)
+                qos = min(body[offset], 1)
+                offset += 1
+                self.subscriptions.append(topic)
+                granted += bytes([qos])
+            self.conn.send(SUBACK, 0, struct.pack(">H", packet_id) + granted)
+        elif packet_type == PUBLISH:
+            qos = flags >> 1 & 0x03
+            topic, offset = read_string(body, 0)
+            if qos > 0:
+                (packet_id,) = struct.unpack_from(">H", body, offset)
+                offset += 2
+                self.conn.send(PUBACK, 0, struct.pack(">H", packet_id))  # QoS2 不使用
+            try:
+                payload = json.loads(body[offset:].decode("utf-8"))
+            except ValueError:
+                payload = None  # CBOR、分段或跟踪数据, 与本测试无关
+            self.messages.append((time.monotonic(), topic, payload))
+        elif packet_type == PINGREQ:
+            self.conn.send(PINGRESP, 0, b"")
+        elif packet_type == DISCONNECT:
+            self.conn.close()
+
+    def command_topic(self):
+        for topic in self.subscriptions:
+            if not topic.endswith("/cbor"):
+                return topic
+        return None
+
+    def publish(self, topic, obj):
+        data = json.dumps(obj, separators=(",", ":")).encode("utf-8")
+        self.conn.send(PUBLISH, 0, struct.pack(">H", len(topic)) + topic.encode("utf-8") + data)
+
+
+def events(messages):
+    """展开合并的数组信封, 逐条返回 (接收时间, 消息对象)"""
+    for received, _, payload in messages:
+        for item in payload if isinstance(payload, list) else [payload]:
+            if isinstance(item, dict):
+                yield received, item
+
+
+def replay_rate_from_sdkconfig():
+    path = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "sdkconfig")
+    try:
+        with open(path, encoding="utf-8") as f:
+            match = re.search(r"^CONFIG_MQTT_REPLAY_RATE=(\d+)", f.read(), re.M)
+            return int(match.group(1)) if match else 20
+    except OSError:
+        return 20
+
+
+class Checker:
+    def __init__(self):
+        self.failed = 0
+
+    def check(self, name, ok, detail=""):
+        print("%-48s %s%s" % (name, "ok" if ok else "FAILED", "  " + detail if detail else ""))
+        self.failed |= not ok
+
+
+def main():
+    parser = argparse.ArgumentParser(description="发送通道断线补发测试 (最小 MQTT Broker)")
+    parser.add_argument("--host", default="0.0.0.0")
+    parser.add_argument("--port", type=int, default=1883)
+    parser.add_argument("--delay-ms", type=int, default=3000, help="回执后设备开始入队的延时")
+    parser.add_argument("--critical", type=int, default=100, help="关键消息数 (设备上限500)")
+    parser.add_argument("--best-effort", type=int, default=300, help="尽力消息数 (设备上限2000)")
+    parser.add_argument("--offline", type=float, default=15.0, help="断开后拒绝重连的秒数, 需大于 delay_ms")
+    parser.add_argument("--rate", type=int, default=replay_rate_from_sdkconfig(), help="CONFIG_MQTT_REPLAY_RATE")
+    parser.add_argument("--timeout", type=float, default=120.0, help="每个阶段的超时秒数")
+    args = parser.parse_args()
+
+    server = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    server.bind((args.host, args.port))
+    server.listen(4)
+    print("Listening on %s:%d, waiting for the device" % (args.host, args.port))
+
+    # 1. 等待设备连接并订阅, 发送测试命令
+    accepted = accept(server, args.timeout)
+    if accepted is None:
+        sys.exit("device did not connect")
+    session = Session(accepted[0])
+    print("Device %s connected" % accepted[1])
+    deadline = time.monotonic() + args.timeout
+    while session.command_topic() is None and time.monotonic() < deadline and not session.conn.closed:
+        session.poll(1)
+    topic = session.command_topic()
+    if topic is None:
+        sys.exit("device did not subscribe")
+    command = {
+        "control_type": CONTROL_TYPE_MQTT_STATE,
+        "cmd_type": TEST_PUB_LANES,
+        "data": {"delay_ms": args.delay_ms, "critical": args.critical, "best_effort": args.best_effort},
+    }
+    session.publish(topic, command)
+
+    # 2. 收到回执后立即断开
+    ack = None
+    while ack is None and time.monotonic() < deadline and not session.conn.closed:
+        session.poll(1)
+        for _, item in events(session.messages):
+            if item.get("control_type") == CONTROL_TYPE_MQTT_STATE and item.get("cmd_type") == TEST_PUB_LANES:
+                ack = item
+    session.conn.close()
+    if ack is None or ack.get("status", 0) != 0:
+        sys.exit("test command failed: %s" % ack)
+    dropped = time.monotonic()
+    print("Command acknowledged, connection dropped; refusing reconnects for %.0fs" % args.offline)
+
+    # 3. 拒绝重连
+    refused = 0
+    while time.monotonic() - dropped < args.offline:
+        accepted = accept(server, args.offline - (time.monotonic() - dropped))
+        if accepted is not None:
+            accepted[0].send(CONNACK, 0, bytes([0, CONNACK_SERVER_UNAVAILABLE]))
+            accepted[0].close()
+            refused += 1
+
+    # 4. 接受重连并收集消息, 关键消息收齐后再等待一会儿收集尽力消息
+    accepted = accept(server, args.timeout)
+    if accepted is None:
+        sys.exit("device did not reconnect")
+    session = Session(accepted[0])
+    reconnected = time.monotonic()
+    print("Device reconnected after %.1fs (%d attempts refused)" % (reconnected - dropped, refused))
+    deadline = reconnected + args.timeout
+    settle = None
+    while time.monotonic() < (settle or deadline) and not session.conn.closed:
+        session.poll(0.1)
+        critical_count = sum(1 for _, item in events(session.messages) if (item.get("data") or {}).get("lane") == "critical")
+        if settle is None and critical_count >= args.critical:
+            settle = time.monotonic() + 2
+    session.conn.close()
+    server.close()
+
+    critical, best_effort = [], []
+    for received, item in events(session.messages):
+        data = item.get("data")
+        if item.get("control_type") == CONTROL_TYPE_MQTT_STATE and item.get("notify_type") == NOTIFY_PUB_LANE_TEST and isinstance(data, dict):
+            (critical if data.get("lane") == "critical" else best_effort).append((received, data.get("seq")))
+
+    checker = Checker()
+    seqs = [seq for _, seq in critical]
+    checker.check("critical: all replayed in order", seqs == list(range(args.critical)), "received %d/%d" % (len(seqs), args.critical))
+    if seqs != list(range(args.critical)):
+        missing = sorted(set(range(args.critical)) - set(seqs))
+        print("  missing %s, first out of order at %s" % (missing[:10], next((i for i, s in enumerate(seqs) if s != i), None)))
+
+    seqs = [seq for _, seq in best_effort]
+    bounded = len(seqs) <= args.best_effort and len(set(seqs)) == len(seqs)
+    newest = seqs == list(range(args.best_effort - len(seqs), args.best_effort))
+    checker.check("best effort: bounded, no duplicates", bounded, "received %d/%d" % (len(seqs), args.best_effort))
+    checker.check("best effort: newest kept in order", newest and len(seqs) > 0, "dropped %d oldest" % (args.best_effort - len(seqs)))
+
+    worst = None  # 超出令牌桶上限最多的时间段
+    for i in range(len(critical)):
+        for j in range(i, len(critical)):
+            excess = (j - i + 1) - (REPLAY_BURST + args.rate * (critical[j][0] - critical[i][0] + JITTER_SEC))
+            if worst is None or excess > worst[0]:
+                worst = (excess, i, j)
+    duration = critical[-1][0] - critical[0][0] if critical else 0
+    detail = "%.1f/s over %.1fs, limit %d/s burst %d" % ((len(critical) - 1) / duration if duration > 0 else 0, duration, args.rate, REPLAY_BURST)
+    checker.check("critical: replay rate limited", worst is not None and worst[0] <= 1, detail)
+    if worst is not None and worst[0] > 1:
+        print("  %d messages in %.3fs (seq %d-%d)" % (worst[2] - worst[1] + 1, critical[worst[2]][0] - critical[worst[1]][0], worst[1], worst[2]))
+    return checker.failed
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,170 @@
+/**
+ * @file tower_light_check.c
+ * @brief 三色灯控制器的主机回放: 按场景设置状态并驱动定时节拍, 检查引脚写入序列
+ *
+ * 编译运行(在工程目录下):
+ *     gcc -O2 -Imain/inc tools/tower_light_check.c main/src/hardware/gpio/tower_light.c -o /tmp/tower_light_check
+ *     /tmp/tower_light_check [-v]
+ *
+ * 控制器与设备上(gpio_output.c alarmLedStateSet)相同, 定时节拍按 TOWER_LIGHT_TICK_MS 模拟。
+ * 每个场景的写入序列(时间ms 通道 电平)与期望不一致时输出差异并返回1; -v 时输出全部写入。
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "tower_light.h"
+
+#define CHECK_MAX_WRITES 64
+
+#define B TOWER_LIGHT_CHANNEL_BEEP
+#define R TOWER_LIGHT_CHANNEL_RED
+#define Y TOWER_LIGHT_CHANNEL_YELLOW
+#define G TOWER_LIGHT_CHANNEL_GREEN
+
+typedef struct
+{
+    uint32_t timeMs;
+    uint8_t channel;
+    uint8_t on;
+} CheckWrite_t;
+
+static CheckWrite_t s_write[CHECK_MAX_WRITES];
+static size_t s_writeNum;
+static uint32_t s_nowMs;
+static int s_verbose;
+static int s_failed;
+
+static void checkWrite(void *ctx, uint8_t channel, bool on)
+{
+    (void)ctx;
+    if (s_verbose)
+    {
+        printf("  %6u ch%u %u\n", s_nowMs, channel, on);
+    }
+    if (s_writeNum < CHECK_MAX_WRITES)
+    {
+        s_write[s_writeNum++] = (CheckWrite_t){s_nowMs, channel, on};
+    }
+}
+
+/* 设置状态(B R Y G 四个通道的图案), 与设备相同: 状态变化后有通道闪烁时定时器从当前时刻开始计时 */
+static uint32_t s_timerStartMs;
+static int s_timerActive;
+
+static void checkSet(TowerLight_t *light, uint8_t beep, uint8_t red, uint8_t yellow, uint8_t green)
+{
+    TowerLightState_t state = {.pattern = {[B] = beep, [R] = red, [Y] = yellow, [G] = green}};
+    if (towerLightSet(light, &state, s_nowMs) != 0)
+    {
+        int blinking = towerLightIsBlinking(light);
+        if (blinking && !s_timerActive)
+        {
+            s_timerActive = 1;
+            s_timerStartMs = s_nowMs;
+        }
+        else if (!blinking)
+        {
+            s_timerActive = 0;
+        }
+    }
+}
+
+/* 时间前进到 untilMs, 期间按定时器周期调用节拍 */
+static void checkRun(TowerLight_t *light, uint32_t untilMs)
+{
+    while (s_timerActive)
+    {
+        uint32_t next = s_timerStartMs + ((s_nowMs - s_timerStartMs) / TOWER_LIGHT_TICK_MS + 1) * TOWER_LIGHT_TICK_MS;
+        if (next > untilMs)
+        {
+            break;
+        }
+        s_nowMs = next;
+        towerLightTick(light, s_nowMs);
+    }
+    s_nowMs = untilMs;
+}
+
+static void checkExpect(const char *name, const CheckWrite_t *expect, size_t expectNum)
+{
+    int same = s_writeNum == expectNum;
+    for (size_t i = 0; same && i < expectNum; i++)
+    {
+        same = s_write[i].timeMs == expect[i].timeMs && s_write[i].channel == expect[i].channel && s_write[i].on == expect[i].on;
+    }
+    printf("%-40s writes=%zu %s\n", name, s_writeNum, same ? "ok" : "FAILED");
+    if (!same)
+    {
+        for (size_t i = 0; i < s_writeNum || i < expectNum; i++)
+        {
+            printf("  got ");
+            i < s_writeNum ? printf("%6u ch%u %u", s_write[i].timeMs, s_write[i].channel, s_write[i].on) : printf("%13s", "-");
+            printf("  expect ");
+            i < expectNum ? printf("%6u ch%u %u\n", expect[i].timeMs, expect[i].channel, expect[i].on) : printf("-\n");
+        }
+        s_failed = 1;
+    }
+    s_writeNum = 0;
+}
+
+#define EXPECT(name, ...)                                                 \
+    do                                                                    \
+    {                                                                     \
+        static const CheckWrite_t _expect[] = {__VA_ARGS__};              \
+        checkExpect(name, _expect, sizeof(_expect) / sizeof(_expect[0])); \
+    } while (0)
+#define EXPECT_NONE(name) checkExpect(name, NULL, 0)
+
+int main(int argc, char **argv)
+{
+    s_verbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+    TowerLight_t light;
+
+    towerLightInit(&light, checkWrite, NULL);
+    EXPECT("init: all off", {0, B, 0}, {0, R, 0}, {0, Y, 0}, {0, G, 0});
+
+    // 订单三色灯同步: 只写入变化的通道, 状态相同时不写入
+    s_nowMs = 100;
+    checkSet(&light, TOWER_LIGHT_PATTERN_OFF, TOWER_LIGHT_PATTERN_OFF, TOWER_LIGHT_PATTERN_OFF, TOWER_LIGHT_PATTERN_ON);
+    EXPECT("green on", {100, G, 1});
+    for (int i = 0; i < 10; i++)
+    {
+        checkSet(&light, TOWER_LIGHT_PATTERN_OFF, TOWER_LIGHT_PATTERN_OFF, TOWER_LIGHT_PATTERN_OFF, TOWER_LIGHT_PATTERN_ON);
+    }
+    EXPECT_NONE("same state x10: no writes");
+    checkSet(&light, TOWER_LIGHT_PATTERN_OFF, TOWER_LIGHT_PATTERN_OFF, TOWER_LIGHT_PATTERN_ON, TOWER_LIGHT_PATTERN_ON);
+    EXPECT("add yellow: only yellow", {100, Y, 1});
+    checkRun(&light, 1000);
+    EXPECT_NONE("steady: timer stopped, no writes");
+
+    // 网络断开: 红灯慢闪, 周期从设置时刻开始(立即点亮)
+    checkSet(&light, TOWER_LIGHT_PATTERN_OFF, TOWER_LIGHT_PATTERN_SLOW_BLINK, TOWER_LIGHT_PATTERN_OFF, TOWER_LIGHT_PATTERN_OFF);
+    checkRun(&light, 3000);
+    EXPECT("red slow blink", {1000, R, 1}, {1000, Y, 0}, {1000, G, 0}, {1800, R, 0}, {2600, R, 1});
+
+    // 组合图案: 黄灯与红灯交替, 按已有的相位加入
+    checkSet(&light, TOWER_LIGHT_PATTERN_OFF, TOWER_LIGHT_PATTERN_SLOW_BLINK, TOWER_LIGHT_PATTERN_SLOW_BLINK_INV, TOWER_LIGHT_PATTERN_OFF);
+    checkRun(&light, 4300);
+    EXPECT("red/yellow alternate in phase", {3400, R, 0}, {3400, Y, 1}, {4200, R, 1}, {4200, Y, 0});
+
+    // 蜂鸣双闪叠加在交替闪烁上(设置时正处于第一次闪亮的最后50ms)
+    checkSet(&light, TOWER_LIGHT_PATTERN_DOUBLE_FLASH, TOWER_LIGHT_PATTERN_SLOW_BLINK, TOWER_LIGHT_PATTERN_SLOW_BLINK_INV, TOWER_LIGHT_PATTERN_OFF);
+    checkRun(&light, 5800);
+    EXPECT("beep double flash joins cycle", {4300, B, 1}, {4350, B, 0}, {4500, B, 1}, {4650, B, 0}, {5000, R, 0}, {5000, Y, 1}, {5800, B, 1}, {5800, R, 1}, {5800, Y, 0});
+    checkRun(&light, 6300);
+    EXPECT("double flash steps", {5950, B, 0}, {6100, B, 1}, {6250, B, 0});
+
+    // 熄灭: 只写入亮着的通道, 定时器停止
+    s_nowMs = 6310;
+    checkSet(&light, TOWER_LIGHT_PATTERN_OFF, TOWER_LIGHT_PATTERN_OFF, TOWER_LIGHT_PATTERN_OFF, TOWER_LIGHT_PATTERN_OFF);
+    checkRun(&light, 9000);
+    EXPECT("stand by: only lit channels", {6310, R, 0});
+
+    // 常亮改为慢闪: 电平不变时不写入
+    checkSet(&light, TOWER_LIGHT_PATTERN_OFF, TOWER_LIGHT_PATTERN_OFF, TOWER_LIGHT_PATTERN_ON, TOWER_LIGHT_PATTERN_OFF);
+    checkSet(&light, TOWER_LIGHT_PATTERN_OFF, TOWER_LIGHT_PATTERN_OFF, TOWER_LIGHT_PATTERN_SLOW_BLINK, TOWER_LIGHT_PATTERN_OFF);
+    checkRun(&light, 9900);
+    EXPECT("on -> blink keeps level", {9000, Y, 1}, {9800, Y, 0});
+
+    return s_failed;
+}
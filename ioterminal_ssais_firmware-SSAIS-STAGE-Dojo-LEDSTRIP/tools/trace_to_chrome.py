@@ -0,0 +1,148 @@
+#!/usr/bin/env python3
+"""
+将设备导出的事件跟踪记录转换为 Chrome trace JSON (chrome://tracing 或 https://ui.perfetto.dev 打开)
+
+导出方式 (MQTT control_type 156):
+    cmd_type 1: 发布到 <发布主题>/trace, 例如
+        mosquitto_sub -h <broker> -t '<发布主题>/trace' -v > trace.txt
+    cmd_type 2: 打印到调试串口, 保存 idf.py monitor 的输出即可
+
+用法:
+    python tools/trace_to_chrome.py trace.txt -o trace.json
+
+输入文件中每行 "TRACE <偏移> <总长> <base64>" 为一段数据, 其余内容忽略;
+也可以直接输入拼接好的二进制数据流 (以 "TRC1" 开头)。
+"""
+import argparse
+import base64
+import json
+import re
+import struct
+import sys
+
+MAGIC = b"TRC1"
+TASK_NAME_LEN = 16
+RECORD = struct.Struct("<IIHHI")  # timestamp, task, event, arg0, arg1
+
+# 与 components/trace/trace.h 中的 trace_event_id_t 保持一致
+EVENT_MQTT_RECV = 1
+EVENT_MQTT_DISPATCH_BEGIN = 2
+EVENT_MQTT_DISPATCH_END = 3
+EVENT_ORDER_STATE = 4
+EVENT_STRIP_REFRESH_BEGIN = 5
+EVENT_STRIP_REFRESH_END = 6
+EVENT_SCREEN_FRAME_IN = 7
+EVENT_SCREEN_FRAME_OUT = 8
+EVENT_SCREEN_TOUCH = 9
+
+ORDER_STATE = {1: "added", 2: "completed", 3: "killed", 4: "dropped", 5: "cleared"}
+
+LINE_RE = re.compile(r"TRACE (\d+) (\d+) ([A-Za-z0-9+/=]+)")
+
+
+def load_stream(path):
+    """读取导出文件, 按偏移拼接为完整数据流"""
+    with open(path, "rb") as f:
+        raw = f.read()
+    if raw.startswith(MAGIC):
+        return raw
+    chunks = {}
+    total = None
+    for line in raw.decode("utf-8", errors="ignore").splitlines():
+        m = LINE_RE.search(line)
+        if m is None:
+            continue
+        offset, length = int(m.group(1)), int(m.group(2))
+        if total is not None and length != total:
+            chunks.clear()  # 新的一次导出, 只保留最后一次
+        total = length
+        chunks[offset] = base64.b64decode(m.group(3))
+    if total is None:
+        sys.exit("no TRACE lines found in %s" % path)
+    stream = bytearray(total)
+    received = 0
+    for offset, data in chunks.items():
+        stream[offset:offset + len(data)] = data
+        received += len(data)
+    if received < total:
+        print("warning: %d of %d bytes missing, some records are zero" % (total - received, total), file=sys.stderr)
+    return bytes(stream)
+
+
+def parse_stream(stream):
+    if stream[:4] != MAGIC:
+        sys.exit("bad magic, not a trace dump")
+    record_count, task_count = struct.unpack_from("<II", stream, 4)
+    pos = 12
+    tasks = {}
+    for _ in range(task_count):
+        handle, = struct.unpack_from("<I", stream, pos)
+        name = stream[pos + 4:pos + 4 + TASK_NAME_LEN].split(b"\0", 1)[0].decode("utf-8", errors="replace")
+        tasks[handle] = name
+        pos += 4 + TASK_NAME_LEN
+    records = []
+    for i in range(record_count):
+        if pos + RECORD.size > len(stream):
+            break
+        records.append(RECORD.unpack_from(stream, pos))
+        pos += RECORD.size
+    return tasks, records
+
+
+def to_chrome(tasks, records):
+    events = []
+    tids = {}
+
+    def tid_of(handle):
+        if handle not in tids:
+            tids[handle] = len(tids) + 1
+            name = tasks.get(handle, "task 0x%08x" % handle)
+            events.append({"ph": "M", "name": "thread_name", "pid": 0, "tid": tids[handle], "args": {"name": name}})
+        return tids[handle]
+
+    wrap = 0
+    last = None
+    for timestamp, task, event, arg0, arg1 in records:
+        if event == 0:
+            continue
+        if last is not None and timestamp < last and last - timestamp > 0x80000000:
+            wrap += 1 << 32  # esp_timer 低32位回绕
+        last = timestamp
+        ev = {"pid": 0, "tid": tid_of(task), "ts": wrap + timestamp}
+        if event == EVENT_MQTT_RECV:
+            ev.update(ph="i", s="t", name="mqtt recv", args={"len": arg0})
+        elif event == EVENT_MQTT_DISPATCH_BEGIN:
+            ev.update(ph="B", name="mqtt %d/%d" % (arg0, arg1), args={"control_type": arg0, "cmd_type": arg1})
+        elif event == EVENT_MQTT_DISPATCH_END:
+            ev.update(ph="E", args={"err": arg1})
+        elif event == EVENT_ORDER_STATE:
+            ev.update(ph="i", s="p", name="order %s" % ORDER_STATE.get(arg0, arg0), args={"order_no": arg1})
+        elif event == EVENT_STRIP_REFRESH_BEGIN:
+            ev.update(ph="B", name="strip submit")
+        elif event == EVENT_STRIP_REFRESH_END:
+            ev.update(ph="E", args={"lock_us": arg1})
+        elif event == EVENT_SCREEN_FRAME_IN:
+            ev.update(ph="i", s="t", name="screen in", args={"len": arg0, "cmd": arg1})
+        elif event == EVENT_SCREEN_FRAME_OUT:
+            ev.update(ph="i", s="t", name="screen out")
+        elif event == EVENT_SCREEN_TOUCH:
+            ev.update(ph="i", s="t", name="touch %d/%d" % (arg0, arg1), args={"screen": arg0, "control": arg1})
+        else:
+            ev.update(ph="i", s="t", name="event %d" % event, args={"arg0": arg0, "arg1": arg1})
+        events.append(ev)
+    return {"traceEvents": events, "displayTimeUnit": "ms"}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert a firmware trace dump to Chrome trace JSON")
+    parser.add_argument("input", help="captured MQTT/UART output or raw binary dump")
+    parser.add_argument("-o", "--output", default="trace.json")
+    args = parser.parse_args()
+    tasks, records = parse_stream(load_stream(args.input))
+    with open(args.output, "w") as f:
+        json.dump(to_chrome(tasks, records), f)
+    print("%d records, %d tasks -> %s" % (len(records), len(tasks), args.output))
+
+
+if __name__ == "__main__":
+    main()